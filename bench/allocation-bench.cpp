@@ -0,0 +1,59 @@
+#include "allocation.h"
+#include "benchmark.h"
+#include "matrix.h"
+
+#include <cstddef>
+#include <numeric>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t WALK_SIZE = 4096;
+constexpr size_t MUL_SIZE = 1024;
+
+constexpr AllocationPolicy REGULAR_PAGES{};
+constexpr AllocationPolicy HUGE_PAGES{.huge_pages = HugePages::Transparent};
+
+Matrix<double> make_matrix(size_t rows, size_t cols, const AllocationPolicy& policy) {
+  Matrix<double> m(rows, cols, policy);
+  std::iota(m.begin(), m.end(), 0.0);
+  return m;
+}
+
+void column_walk(Benchmark& state, const AllocationPolicy& policy) {
+  const Matrix<double> m = make_matrix(WALK_SIZE, WALK_SIZE, policy);
+  state.measure(static_cast<double>(m.size()), [&m] {
+    double sum = 0;
+    for (size_t col = 0; col < m.cols(); ++col) {
+      sum = std::accumulate(m.col(col).begin(), m.col(col).end(), sum);
+    }
+    do_not_optimize(sum);
+  });
+}
+
+void multiply(Benchmark& state, const AllocationPolicy& policy) {
+  const Matrix<double> a = make_matrix(MUL_SIZE, MUL_SIZE, policy);
+  const Matrix<double> b = make_matrix(MUL_SIZE, MUL_SIZE, policy);
+  state.measure(2.0 * MUL_SIZE * MUL_SIZE * MUL_SIZE, [&a, &b] { do_not_optimize(a * b); });
+}
+
+} // namespace
+
+CT_BENCHMARK("column_walk/regular_pages") {
+  column_walk(state, REGULAR_PAGES);
+}
+
+CT_BENCHMARK("column_walk/huge_pages") {
+  column_walk(state, HUGE_PAGES);
+}
+
+CT_BENCHMARK("multiply/regular_pages") {
+  multiply(state, REGULAR_PAGES);
+}
+
+CT_BENCHMARK("multiply/huge_pages") {
+  multiply(state, HUGE_PAGES);
+}
+
+} // namespace ct::bench
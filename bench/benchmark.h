@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace ct::bench {
+
+// Keeps the compiler from optimizing away the computation that produced `value`
+template <typename T>
+void do_not_optimize(const T& value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+// A named benchmark. Benchmarks register themselves at static initialization time through `CT_BENCHMARK` and are
+// run by `bench/main.cpp`.
+class Benchmark {
+public:
+  using Body = void (*)(Benchmark&);
+
+public:
+  Benchmark(const char* name, Body body)
+      : name_(name)
+      , body_(body) {
+    (last_ == nullptr ? first_ : last_->next_) = this;
+    last_ = this;
+  }
+
+  static Benchmark* first() {
+    return first_;
+  }
+
+  Benchmark* next() const {
+    return next_;
+  }
+
+  const char* name() const {
+    return name_;
+  }
+
+  void run() {
+    body_(*this);
+  }
+
+  // Runs `f` repeatedly for at least `MIN_TIME` and records the fastest run; `items` is the number of items
+  // (elements, flops, ...) one run of `f` processes
+  template <typename F>
+  void measure(double items, const F& f) {
+    using Clock = std::chrono::steady_clock;
+
+    f(); // warm-up: faults the pages in and fills the caches
+    double best = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t runs = 0; runs < MIN_RUNS || Clock::now() - start < MIN_TIME; ++runs) {
+      Clock::time_point run_start = Clock::now();
+      f();
+      double seconds = std::chrono::duration<double>(Clock::now() - run_start).count();
+      if (runs == 0 || seconds < best) {
+        best = seconds;
+      }
+    }
+    seconds_ = best;
+    items_ = items;
+  }
+
+  double seconds() const {
+    return seconds_;
+  }
+
+  double items_per_second() const {
+    return seconds_ == 0 ? 0 : items_ / seconds_;
+  }
+
+private:
+  static constexpr size_t MIN_RUNS = 3;
+  static constexpr std::chrono::milliseconds MIN_TIME{200};
+
+  inline static Benchmark* first_ = nullptr;
+  inline static Benchmark* last_ = nullptr;
+
+  const char* name_;
+  Body body_;
+  Benchmark* next_ = nullptr;
+  double seconds_ = 0;
+  double items_ = 0;
+};
+
+} // namespace ct::bench
+
+#define CT_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define CT_BENCHMARK_CONCAT(a, b) CT_BENCHMARK_CONCAT_IMPL(a, b)
+
+#define CT_BENCHMARK_IMPL(name, body, registration)                                                                   \
+  static void body(::ct::bench::Benchmark&);                                                                           \
+  static ::ct::bench::Benchmark registration(name, body);                                                              \
+  static void body(::ct::bench::Benchmark& state)
+
+// Defines a benchmark; the body receives the benchmark as `state` and must call `state.measure` once
+#define CT_BENCHMARK(name)                                                                                             \
+  CT_BENCHMARK_IMPL(name, CT_BENCHMARK_CONCAT(bench_body_, __LINE__), CT_BENCHMARK_CONCAT(bench_, __LINE__))
@@ -0,0 +1,46 @@
+#include "benchmark.h"
+#include "bitmatrix.h"
+#include "matrix.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 1024;
+constexpr size_t CLOSURE_SIZE = 2048;
+
+Matrix<bool> make_relation(size_t n, uint64_t sparsity) {
+  Matrix<bool> m(n, n);
+  uint64_t state = 1;
+  for (bool& x : m) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = (state >> 33) % sparsity == 0;
+  }
+  return m;
+}
+
+} // namespace
+
+CT_BENCHMARK("bool_product/dense_matrix") {
+  const Matrix<bool> a = make_relation(SIZE, 64);
+  const Matrix<bool> b = make_relation(SIZE, 64);
+  state.measure(static_cast<double>(SIZE * SIZE * SIZE), [&] { do_not_optimize(a * b); });
+}
+
+CT_BENCHMARK("bool_product/bit_matrix") {
+  const BitMatrix a(make_relation(SIZE, 64));
+  const BitMatrix b(make_relation(SIZE, 64));
+  state.measure(static_cast<double>(SIZE * SIZE * SIZE), [&] { do_not_optimize(a * b); });
+}
+
+CT_BENCHMARK("transitive_closure/bit_matrix") {
+  const BitMatrix relation(make_relation(CLOSURE_SIZE, CLOSURE_SIZE));
+  state.measure(static_cast<double>(CLOSURE_SIZE * CLOSURE_SIZE * CLOSURE_SIZE), [&] {
+    do_not_optimize(transitive_closure(relation));
+  });
+}
+
+} // namespace ct::bench
@@ -0,0 +1,94 @@
+#include "benchmark.h"
+#include "concurrent.h"
+#include "matrix.h"
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t ROWS = 256;
+constexpr size_t COLS = 256;
+constexpr size_t THREADS = 4;
+constexpr size_t UPDATES = 1 << 16;
+
+// Runs `f(thread)` on `THREADS` threads, each doing `UPDATES` updates, and joins them
+template <typename F>
+void run_threads(const F& f) {
+  std::thread threads[THREADS];
+  for (size_t t = 0; t < THREADS; ++t) {
+    threads[t] = std::thread([&f, t] { f(t); });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+// Scattered element updates: `(row, col)` of update `i` on thread `t`
+size_t row_of(size_t t, size_t i) {
+  return (i * 7 + t * 31) % ROWS;
+}
+
+size_t col_of(size_t i) {
+  return (i * 13) % COLS;
+}
+
+constexpr double ITEMS = static_cast<double>(THREADS * UPDATES);
+
+} // namespace
+
+CT_BENCHMARK("accumulate/global_mutex") {
+  Matrix<double> m(ROWS, COLS);
+  std::mutex mutex;
+  state.measure(ITEMS, [&] {
+    run_threads([&](size_t t) {
+      for (size_t i = 0; i < UPDATES; ++i) {
+        std::lock_guard lock(mutex);
+        m(row_of(t, i), col_of(i)) += 1.0;
+      }
+    });
+  });
+}
+
+CT_BENCHMARK("accumulate/atomic_add") {
+  Matrix<double> m(ROWS, COLS);
+  AtomicAdder<double> adder(m);
+  state.measure(ITEMS, [&] {
+    run_threads([&](size_t t) {
+      for (size_t i = 0; i < UPDATES; ++i) {
+        adder.add(row_of(t, i), col_of(i), 1.0);
+      }
+    });
+  });
+}
+
+CT_BENCHMARK("accumulate/row_locks") {
+  Matrix<double> m(ROWS, COLS);
+  RowLocks<double> locks(m);
+  state.measure(ITEMS, [&] {
+    run_threads([&](size_t t) {
+      for (size_t i = 0; i < UPDATES; ++i) {
+        locks.add(row_of(t, i), col_of(i), 1.0);
+      }
+    });
+  });
+}
+
+CT_BENCHMARK("accumulate/sharded") {
+  state.measure(ITEMS, [&] {
+    ShardedAccumulator<double> accumulator(ROWS, COLS, THREADS);
+    run_threads([&](size_t t) {
+      accumulator.with_local([t](Matrix<double>& shard) {
+        for (size_t i = 0; i < UPDATES; ++i) {
+          shard(row_of(t, i), col_of(i)) += 1.0;
+        }
+      });
+    });
+    do_not_optimize(accumulator.reduce());
+  });
+}
+
+} // namespace ct::bench
@@ -0,0 +1,100 @@
+#include "benchmark.h"
+#include "convolution.h"
+#include "matrix.h"
+
+#include <cstddef>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 2048;
+
+Matrix<float> make_matrix(size_t rows, size_t cols) {
+  Matrix<float> m(rows, cols);
+  size_t i = 0;
+  for (float& x : m) {
+    x = static_cast<float>(i++ % 17) / 16;
+  }
+  return m;
+}
+
+// The four-deep loop over `operator()` that `convolve2d` replaces, with zero padding
+void nested_loops(Benchmark& state, size_t kernel_size) {
+  const Matrix<float> image = make_matrix(SIZE, SIZE);
+  const Matrix<float> kernel = make_matrix(kernel_size, kernel_size);
+  std::ptrdiff_t anchor = static_cast<std::ptrdiff_t>(kernel_size / 2);
+  std::ptrdiff_t size = static_cast<std::ptrdiff_t>(SIZE);
+  state.measure(static_cast<double>(SIZE * SIZE * kernel_size * kernel_size), [&] {
+    Matrix<float> out(SIZE, SIZE);
+    for (std::ptrdiff_t i = 0; i < size; ++i) {
+      for (std::ptrdiff_t j = 0; j < size; ++j) {
+        float sum = 0;
+        for (std::ptrdiff_t p = 0; p < static_cast<std::ptrdiff_t>(kernel_size); ++p) {
+          for (std::ptrdiff_t q = 0; q < static_cast<std::ptrdiff_t>(kernel_size); ++q) {
+            std::ptrdiff_t r = i + p - anchor;
+            std::ptrdiff_t c = j + q - anchor;
+            if (r >= 0 && r < size && c >= 0 && c < size) {
+              sum += kernel(static_cast<size_t>(p), static_cast<size_t>(q)) *
+                     image(static_cast<size_t>(r), static_cast<size_t>(c));
+            }
+          }
+        }
+        out(static_cast<size_t>(i), static_cast<size_t>(j)) = sum;
+      }
+    }
+    do_not_optimize(out);
+  });
+}
+
+void convolve(Benchmark& state, size_t kernel_size, ConvolutionMethod method) {
+  const Matrix<float> image = make_matrix(SIZE, SIZE);
+  const Matrix<float> kernel = make_matrix(kernel_size, kernel_size);
+  state.measure(static_cast<double>(SIZE * SIZE * kernel_size * kernel_size), [&] {
+    do_not_optimize(convolve2d(image, kernel, Boundary::Zero, method));
+  });
+}
+
+} // namespace
+
+CT_BENCHMARK("convolve2d/3x3/nested_loops") {
+  nested_loops(state, 3);
+}
+
+CT_BENCHMARK("convolve2d/3x3/direct") {
+  convolve(state, 3, ConvolutionMethod::Direct);
+}
+
+CT_BENCHMARK("convolve2d/3x3/im2col") {
+  convolve(state, 3, ConvolutionMethod::Im2col);
+}
+
+CT_BENCHMARK("convolve2d/5x5/direct") {
+  convolve(state, 5, ConvolutionMethod::Direct);
+}
+
+CT_BENCHMARK("convolve2d/5x5/im2col") {
+  convolve(state, 5, ConvolutionMethod::Im2col);
+}
+
+CT_BENCHMARK("convolve2d/9x9/direct") {
+  convolve(state, 9, ConvolutionMethod::Direct);
+}
+
+CT_BENCHMARK("convolve2d/9x9/im2col") {
+  convolve(state, 9, ConvolutionMethod::Im2col);
+}
+
+CT_BENCHMARK("convolve2d/15x15/nested_loops") {
+  nested_loops(state, 15);
+}
+
+CT_BENCHMARK("convolve2d/15x15/direct") {
+  convolve(state, 15, ConvolutionMethod::Direct);
+}
+
+CT_BENCHMARK("convolve2d/15x15/im2col") {
+  convolve(state, 15, ConvolutionMethod::Im2col);
+}
+
+} // namespace ct::bench
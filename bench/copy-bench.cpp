@@ -0,0 +1,73 @@
+#include "benchmark.h"
+#include "matrix.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+
+namespace ct::bench {
+
+namespace {
+
+// 128 MiB of doubles: larger than most last-level caches, so the copy streams past the cache
+constexpr size_t LARGE_SIZE = 4096;
+// 2 MiB: stays cached and runs on one thread
+constexpr size_t SMALL_SIZE = 512;
+
+Matrix<double> make_matrix(size_t size) {
+  Matrix<double> m(size, size);
+  std::iota(m.begin(), m.end(), 0.0);
+  return m;
+}
+
+void copy(Benchmark& state, size_t size) {
+  const Matrix<double> m = make_matrix(size);
+  state.measure(static_cast<double>(m.size()), [&m] { do_not_optimize(Matrix<double>(m)); });
+}
+
+void assign(Benchmark& state, size_t size) {
+  const Matrix<double> m = make_matrix(size);
+  Matrix<double> out(size, size);
+  state.measure(static_cast<double>(m.size()), [&m, &out] {
+    out = m;
+    do_not_optimize(out);
+  });
+}
+
+// What copying used to do: one element at a time on the calling thread
+void assign_elementwise(Benchmark& state, size_t size) {
+  const Matrix<double> m = make_matrix(size);
+  Matrix<double> out(size, size);
+  state.measure(static_cast<double>(m.size()), [&m, &out] {
+    std::copy(m.begin(), m.end(), out.begin());
+    do_not_optimize(out);
+  });
+}
+
+} // namespace
+
+CT_BENCHMARK("copy/large") {
+  copy(state, LARGE_SIZE);
+}
+
+CT_BENCHMARK("copy/small") {
+  copy(state, SMALL_SIZE);
+}
+
+CT_BENCHMARK("assign/large") {
+  assign(state, LARGE_SIZE);
+}
+
+CT_BENCHMARK("assign/large_elementwise") {
+  assign_elementwise(state, LARGE_SIZE);
+}
+
+CT_BENCHMARK("assign/small") {
+  assign(state, SMALL_SIZE);
+}
+
+CT_BENCHMARK("assign/small_elementwise") {
+  assign_elementwise(state, SMALL_SIZE);
+}
+
+} // namespace ct::bench
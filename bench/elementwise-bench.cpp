@@ -0,0 +1,106 @@
+#include "benchmark.h"
+#include "elementwise.h"
+#include "matrix.h"
+
+#include <cstddef>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 2048;
+constexpr size_t KRONECKER_SIZE = 48;
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  size_t i = 0;
+  for (double& x : m) {
+    x = static_cast<double>(i++ % 17);
+  }
+  return m;
+}
+
+} // namespace
+
+CT_BENCHMARK("hadamard/nested_loops") {
+  const Matrix<double> a = make_matrix(SIZE, SIZE);
+  const Matrix<double> b = make_matrix(SIZE, SIZE);
+  state.measure(static_cast<double>(SIZE * SIZE), [&] {
+    Matrix<double> c(SIZE, SIZE);
+    for (size_t i = 0; i < SIZE; ++i) {
+      for (size_t j = 0; j < SIZE; ++j) {
+        c(i, j) = a(i, j) * b(i, j);
+      }
+    }
+    do_not_optimize(c);
+  });
+}
+
+CT_BENCHMARK("hadamard/fused") {
+  const Matrix<double> a = make_matrix(SIZE, SIZE);
+  const Matrix<double> b = make_matrix(SIZE, SIZE);
+  state.measure(static_cast<double>(SIZE * SIZE), [&] { do_not_optimize(hadamard(a, b)); });
+}
+
+CT_BENCHMARK("hadamard/in_place") {
+  Matrix<double> a = make_matrix(SIZE, SIZE);
+  const Matrix<double> b = make_matrix(SIZE, SIZE);
+  state.measure(static_cast<double>(SIZE * SIZE), [&] { do_not_optimize(hadamard_in_place(a, b)); });
+}
+
+CT_BENCHMARK("add_to_each_row/nested_loops") {
+  Matrix<double> m = make_matrix(SIZE, SIZE);
+  const Matrix<double> bias = make_matrix(1, SIZE);
+  state.measure(static_cast<double>(SIZE * SIZE), [&] {
+    for (size_t i = 0; i < SIZE; ++i) {
+      for (size_t j = 0; j < SIZE; ++j) {
+        m(i, j) += bias(0, j);
+      }
+    }
+    do_not_optimize(m);
+  });
+}
+
+CT_BENCHMARK("add_to_each_row/in_place") {
+  Matrix<double> m = make_matrix(SIZE, SIZE);
+  const Matrix<double> bias = make_matrix(1, SIZE);
+  state.measure(static_cast<double>(SIZE * SIZE), [&] { do_not_optimize(add_to_each_row_in_place(m, bias.row(0))); });
+}
+
+CT_BENCHMARK("add_to_each_col/in_place") {
+  Matrix<double> m = make_matrix(SIZE, SIZE);
+  const Matrix<double> bias = make_matrix(SIZE, 1);
+  state.measure(static_cast<double>(SIZE * SIZE), [&] { do_not_optimize(add_to_each_col_in_place(m, bias.col(0))); });
+}
+
+CT_BENCHMARK("kronecker/nested_loops") {
+  const Matrix<double> a = make_matrix(KRONECKER_SIZE, KRONECKER_SIZE);
+  const Matrix<double> b = make_matrix(KRONECKER_SIZE, KRONECKER_SIZE);
+  constexpr size_t N = KRONECKER_SIZE * KRONECKER_SIZE;
+  state.measure(static_cast<double>(N * N), [&] {
+    Matrix<double> c(N, N);
+    for (size_t i = 0; i < KRONECKER_SIZE; ++i) {
+      for (size_t j = 0; j < KRONECKER_SIZE; ++j) {
+        for (size_t p = 0; p < KRONECKER_SIZE; ++p) {
+          for (size_t q = 0; q < KRONECKER_SIZE; ++q) {
+            c(i * KRONECKER_SIZE + p, j * KRONECKER_SIZE + q) = a(i, j) * b(p, q);
+          }
+        }
+      }
+    }
+    do_not_optimize(c);
+  });
+}
+
+CT_BENCHMARK("kronecker/rows") {
+  const Matrix<double> a = make_matrix(KRONECKER_SIZE, KRONECKER_SIZE);
+  const Matrix<double> b = make_matrix(KRONECKER_SIZE, KRONECKER_SIZE);
+  constexpr size_t N = KRONECKER_SIZE * KRONECKER_SIZE;
+  Matrix<double> c;
+  state.measure(static_cast<double>(N * N), [&] {
+    kronecker_into(a, b, c);
+    do_not_optimize(c);
+  });
+}
+
+} // namespace ct::bench
@@ -0,0 +1,53 @@
+#include "benchmark.h"
+#include "footprint.h"
+#include "matrix.h"
+
+#include <cstddef>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t COUNT = 1 << 16;
+
+} // namespace
+
+// Accounting cost against the allocation it accounts: a small matrix, the raw buffer it wraps, and the two updates
+// of the counters that its construction and destruction make
+CT_BENCHMARK("footprint/small_matrix") {
+  state.measure(COUNT, [] {
+    for (size_t i = 0; i < COUNT; ++i) {
+      Matrix<double> m(4, 4);
+      do_not_optimize(m);
+    }
+  });
+}
+
+CT_BENCHMARK("footprint/raw_buffer") {
+  state.measure(COUNT, [] {
+    for (size_t i = 0; i < COUNT; ++i) {
+      double* buffer = new double[16]();
+      do_not_optimize(buffer);
+      delete[] buffer;
+    }
+  });
+}
+
+CT_BENCHMARK("footprint/record") {
+  state.measure(COUNT, [] {
+    for (size_t i = 0; i < COUNT; ++i) {
+      detail::record_buffer<double>(16 * sizeof(double));
+      detail::record_buffer<double>(-16 * static_cast<std::ptrdiff_t>(sizeof(double)));
+    }
+  });
+}
+
+CT_BENCHMARK("footprint/snapshot") {
+  state.measure(COUNT, [] {
+    for (size_t i = 0; i < COUNT; ++i) {
+      do_not_optimize(memory_usage<double>());
+    }
+  });
+}
+
+} // namespace ct::bench
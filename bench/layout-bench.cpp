@@ -0,0 +1,82 @@
+#include "benchmark.h"
+#include "layout.h"
+#include "matrix.h"
+
+#include <cstddef>
+#include <numeric>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 1024;
+constexpr size_t LARGE = 4096;
+
+template <typename Layout>
+Matrix<double, Layout> make_matrix(size_t rows, size_t cols) {
+  Matrix<double, Layout> m(rows, cols);
+  size_t i = 0;
+  for (double& x : m) {
+    x = static_cast<double>(i++ % 17);
+  }
+  return m;
+}
+
+template <typename Layout>
+double column_sums(const Matrix<double, Layout>& m) {
+  double total = 0;
+  for (size_t j = 0; j < m.cols(); ++j) {
+    total += std::accumulate(m.col_begin(j), m.col_end(j), 0.0);
+  }
+  return total;
+}
+
+constexpr double FLOPS = 2.0 * SIZE * SIZE * SIZE;
+constexpr double BYTES = 2.0 * LARGE * LARGE * sizeof(double);
+
+} // namespace
+
+CT_BENCHMARK("layout/column_sums_row_major") {
+  const auto m = make_matrix<RowMajor>(LARGE, LARGE);
+  state.measure(LARGE * LARGE, [&m] { do_not_optimize(column_sums(m)); });
+}
+
+CT_BENCHMARK("layout/column_sums_col_major") {
+  const auto m = make_matrix<ColMajor>(LARGE, LARGE);
+  state.measure(LARGE * LARGE, [&m] { do_not_optimize(column_sums(m)); });
+}
+
+CT_BENCHMARK("layout/multiply_row_major") {
+  const auto m = make_matrix<RowMajor>(SIZE, SIZE);
+  state.measure(FLOPS, [&m] { do_not_optimize(m * m); });
+}
+
+CT_BENCHMARK("layout/multiply_col_major") {
+  const auto m = make_matrix<ColMajor>(SIZE, SIZE);
+  state.measure(FLOPS, [&m] { do_not_optimize(m * m); });
+}
+
+CT_BENCHMARK("layout/multiply_tiled_64") {
+  const auto m = make_matrix<Tiled<64>>(SIZE, SIZE);
+  state.measure(FLOPS, [&m] { do_not_optimize(m * m); });
+}
+
+CT_BENCHMARK("layout/copy") {
+  const auto m = make_matrix<RowMajor>(LARGE, LARGE);
+  state.measure(BYTES, [&m] {
+    Matrix<double> copy = m;
+    do_not_optimize(copy);
+  });
+}
+
+CT_BENCHMARK("layout/convert_to_col_major") {
+  const auto m = make_matrix<RowMajor>(LARGE, LARGE);
+  state.measure(BYTES, [&m] { do_not_optimize(Matrix<double, ColMajor>(m)); });
+}
+
+CT_BENCHMARK("layout/convert_to_tiled_64") {
+  const auto m = make_matrix<RowMajor>(LARGE, LARGE);
+  state.measure(BYTES, [&m] { do_not_optimize(Matrix<double, Tiled<64>>(m)); });
+}
+
+} // namespace ct::bench
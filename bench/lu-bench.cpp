@@ -0,0 +1,72 @@
+#include "benchmark.h"
+#include "lu.h"
+#include "matrix.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 1024;
+
+Matrix<double> make_matrix(size_t n) {
+  Matrix<double> m(n, n);
+  uint64_t seed = 1;
+  for (double& x : m) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = static_cast<double>(seed >> 11) / static_cast<double>(uint64_t{1} << 52) - 1;
+  }
+  return m;
+}
+
+// Textbook right-looking LU with partial pivoting, one rank-1 update per column
+void unblocked_lu(Matrix<double>& a) {
+  size_t n = a.rows();
+  for (size_t j = 0; j < n; ++j) {
+    size_t pivot = j;
+    for (size_t i = j + 1; i < n; ++i) {
+      if (std::abs(a(i, j)) > std::abs(a(pivot, j))) {
+        pivot = i;
+      }
+    }
+    std::swap_ranges(a.row_begin(j), a.row_end(j), a.row_begin(pivot));
+    for (size_t i = j + 1; i < n; ++i) {
+      double l = a(i, j) /= a(j, j);
+      for (size_t c = j + 1; c < n; ++c) {
+        a(i, c) -= l * a(j, c);
+      }
+    }
+  }
+}
+
+constexpr double FLOPS = 2.0 / 3.0 * SIZE * SIZE * SIZE;
+
+} // namespace
+
+CT_BENCHMARK("lu/unblocked") {
+  const Matrix<double> a = make_matrix(SIZE);
+  state.measure(FLOPS, [&a] {
+    Matrix<double> factors = a;
+    unblocked_lu(factors);
+    do_not_optimize(factors);
+  });
+}
+
+CT_BENCHMARK("lu/blocked") {
+  const Matrix<double> a = make_matrix(SIZE);
+  state.measure(FLOPS, [&a] {
+    Matrix<double> factors = a;
+    do_not_optimize(lu(factors));
+  });
+}
+
+CT_BENCHMARK("lu/inverse") {
+  const Matrix<double> a = make_matrix(SIZE);
+  state.measure(1, [&a] { do_not_optimize(inverse(a)); });
+}
+
+} // namespace ct::bench
@@ -0,0 +1,20 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Usage: benchmarks [filter]
+// Runs every benchmark whose name contains `filter` and prints one tab-separated line per benchmark:
+// name, seconds per run and items per second.
+int main(int argc, char* argv[]) {
+  const char* filter = argc > 1 ? argv[1] : "";
+  for (ct::bench::Benchmark* benchmark = ct::bench::Benchmark::first(); benchmark != nullptr;
+       benchmark = benchmark->next()) {
+    if (std::strstr(benchmark->name(), filter) == nullptr) {
+      continue;
+    }
+    benchmark->run();
+    std::printf("%s\t%.6e\t%.6e\n", benchmark->name(), benchmark->seconds(), benchmark->items_per_second());
+    std::fflush(stdout);
+  }
+}
@@ -0,0 +1,93 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "modular.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 1024;
+// Rows of the product computed by the per-multiply-add baseline, which is too slow for the full product
+constexpr size_t BASELINE_ROWS = 64;
+
+constexpr uint64_t NTT_PRIME = 998244353;
+constexpr uint64_t MERSENNE_61 = (uint64_t{1} << 61) - 1;
+
+Matrix<uint64_t> make_matrix(size_t rows, size_t cols, uint64_t p) {
+  Matrix<uint64_t> m(rows, cols);
+  uint64_t state = 1;
+  for (uint64_t& x : m) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = (state >> 7) % p;
+  }
+  return m;
+}
+
+// Reducing after every multiply-add, the way an elementwise `% p` over an ordinary product would have to
+void per_multiply_add(Benchmark& state, uint64_t p) {
+  __extension__ typedef unsigned __int128 Wide;
+  const Matrix<uint64_t> a = make_matrix(BASELINE_ROWS, SIZE, p);
+  const Matrix<uint64_t> b = make_matrix(SIZE, SIZE, p);
+  Matrix<uint64_t> c(BASELINE_ROWS, SIZE);
+  state.measure(static_cast<double>(BASELINE_ROWS * SIZE * SIZE), [&, p] {
+    const uint64_t* right = b.data();
+    uint64_t* out = c.data();
+    for (size_t i = 0; i < BASELINE_ROWS; ++i) {
+      for (size_t j = 0; j < SIZE; ++j) {
+        out[i * SIZE + j] = 0;
+      }
+      for (size_t k = 0; k < SIZE; ++k) {
+        uint64_t x = a(i, k);
+        for (size_t j = 0; j < SIZE; ++j) {
+          out[i * SIZE + j] = static_cast<uint64_t>((out[i * SIZE + j] + static_cast<Wide>(x) * right[k * SIZE + j]) % p);
+        }
+      }
+    }
+    do_not_optimize(c);
+  });
+}
+
+void modular(Benchmark& state, uint64_t p, ModularReduction reduction) {
+  const Matrix<uint64_t> a = make_matrix(SIZE, SIZE, p);
+  const Matrix<uint64_t> b = make_matrix(SIZE, SIZE, p);
+  state.measure(static_cast<double>(SIZE * SIZE * SIZE), [&] { do_not_optimize(multiply_mod(a, b, p, reduction)); });
+}
+
+} // namespace
+
+CT_BENCHMARK("multiply_mod/ntt/per_multiply_add") {
+  per_multiply_add(state, NTT_PRIME);
+}
+
+CT_BENCHMARK("multiply_mod/ntt/lazy") {
+  modular(state, NTT_PRIME, ModularReduction::Lazy);
+}
+
+CT_BENCHMARK("multiply_mod/ntt/barrett") {
+  modular(state, NTT_PRIME, ModularReduction::Barrett);
+}
+
+CT_BENCHMARK("multiply_mod/ntt/montgomery") {
+  modular(state, NTT_PRIME, ModularReduction::Montgomery);
+}
+
+CT_BENCHMARK("multiply_mod/m61/per_multiply_add") {
+  per_multiply_add(state, MERSENNE_61);
+}
+
+CT_BENCHMARK("multiply_mod/m61/lazy") {
+  modular(state, MERSENNE_61, ModularReduction::Lazy);
+}
+
+CT_BENCHMARK("multiply_mod/m61/barrett") {
+  modular(state, MERSENNE_61, ModularReduction::Barrett);
+}
+
+CT_BENCHMARK("multiply_mod/m61/montgomery") {
+  modular(state, MERSENNE_61, ModularReduction::Montgomery);
+}
+
+} // namespace ct::bench
@@ -0,0 +1,137 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "multiply.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 512;
+
+template <typename T>
+Matrix<T> make_matrix(size_t rows, size_t cols) {
+  Matrix<T> m(rows, cols);
+  size_t i = 0;
+  for (T& x : m) {
+    x = static_cast<T>(i++ % 17);
+  }
+  return m;
+}
+
+template <typename To, typename From>
+Matrix<To> convert(const Matrix<From>& m) {
+  Matrix<To> result(m.rows(), m.cols());
+  std::copy(m.begin(), m.end(), result.begin());
+  return result;
+}
+
+constexpr double FLOPS = 2.0 * SIZE * SIZE * SIZE;
+
+} // namespace
+
+CT_BENCHMARK("multiply_widening/int8_upcast_then_multiply") {
+  const Matrix<int8_t> a = make_matrix<int8_t>(SIZE, SIZE);
+  state.measure(FLOPS, [&a] {
+    Matrix<int32_t> wide = convert<int32_t>(a);
+    do_not_optimize(wide * wide);
+  });
+}
+
+CT_BENCHMARK("multiply_widening/int8_to_int32") {
+  const Matrix<int8_t> a = make_matrix<int8_t>(SIZE, SIZE);
+  state.measure(FLOPS, [&a] { do_not_optimize(multiply<int32_t>(a, a)); });
+}
+
+CT_BENCHMARK("multiply_widening/float_upcast_then_multiply") {
+  const Matrix<float> a = make_matrix<float>(SIZE, SIZE);
+  state.measure(FLOPS, [&a] {
+    Matrix<double> wide = convert<double>(a);
+    do_not_optimize(wide * wide);
+  });
+}
+
+CT_BENCHMARK("multiply_widening/float_to_double") {
+  const Matrix<float> a = make_matrix<float>(SIZE, SIZE);
+  state.measure(FLOPS, [&a] { do_not_optimize(multiply<double>(a, a)); });
+}
+
+CT_BENCHMARK("pow/repeated_multiply_64") {
+  const Matrix<double> a = make_matrix<double>(SIZE / 2, SIZE / 2);
+  state.measure(1, [&a] {
+    Matrix<double> result = a;
+    for (size_t k = 1; k < 64; ++k) {
+      result *= a;
+    }
+    do_not_optimize(result);
+  });
+}
+
+CT_BENCHMARK("pow/binary_64") {
+  const Matrix<double> a = make_matrix<double>(SIZE / 2, SIZE / 2);
+  state.measure(1, [&a] { do_not_optimize(pow(a, 64)); });
+}
+
+CT_BENCHMARK("multiply_chain/left_to_right") {
+  const Matrix<double> a = make_matrix<double>(SIZE, 8);
+  const Matrix<double> b = make_matrix<double>(8, SIZE);
+  const Matrix<double> c = make_matrix<double>(SIZE, 8);
+  state.measure(1, [&] { do_not_optimize(a * b * c); });
+}
+
+CT_BENCHMARK("multiply_chain/optimal") {
+  const Matrix<double> a = make_matrix<double>(SIZE, 8);
+  const Matrix<double> b = make_matrix<double>(8, SIZE);
+  const Matrix<double> c = make_matrix<double>(SIZE, 8);
+  state.measure(1, [&] { do_not_optimize(multiply_chain(a, b, c)); });
+}
+
+// A tick that changes 8 rows of `a`, refreshed by a full product...
+CT_BENCHMARK("tick_refresh/full_product") {
+  Matrix<double> a = make_matrix<double>(SIZE, SIZE);
+  const Matrix<double> b = make_matrix<double>(SIZE, SIZE);
+  Matrix<double> c = a * b;
+  size_t tick = 0;
+  state.measure(1, [&] {
+    for (size_t i = 0; i < 8; ++i) {
+      a((tick * 61 + i * 67) % SIZE, i) += 1;
+    }
+    ++tick;
+    multiply_into(a, b, c);
+    do_not_optimize(c);
+  });
+}
+
+// ...and by `update_product`
+CT_BENCHMARK("tick_refresh/update_product") {
+  Matrix<double> a = make_matrix<double>(SIZE, SIZE);
+  Matrix<double> b = make_matrix<double>(SIZE, SIZE);
+  Matrix<double> c = a * b;
+  a.track_dirty_rows();
+  b.track_dirty_rows();
+  size_t tick = 0;
+  state.measure(1, [&] {
+    for (size_t i = 0; i < 8; ++i) {
+      a((tick * 61 + i * 67) % SIZE, i) += 1;
+    }
+    ++tick;
+    update_product(c, a, b);
+    do_not_optimize(c);
+  });
+}
+
+// A tick that changes 8 rows of `b`, folded in with a rank-8 update
+CT_BENCHMARK("tick_refresh/rank_update") {
+  const Matrix<double> u = make_matrix<double>(SIZE, 8);
+  const Matrix<double> v = make_matrix<double>(8, SIZE);
+  Matrix<double> c = make_matrix<double>(SIZE, SIZE);
+  state.measure(1, [&] {
+    rank_update(c, u, v);
+    do_not_optimize(c);
+  });
+}
+
+} // namespace ct::bench
@@ -0,0 +1,76 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "ranges.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t ROWS = 2048;
+constexpr size_t COLS = 1024;
+
+Matrix<double> make_matrix() {
+  Matrix<double> m(ROWS, COLS);
+  std::iota(m.begin(), m.end(), 0.0);
+  m *= 1.0 / static_cast<double>(m.size());
+  return m;
+}
+
+void softmax(Matrix<double>::RowView row) {
+  double max = *std::max_element(row.begin(), row.end());
+  double sum = 0;
+  for (double& x : row) {
+    x = std::exp(x - max);
+    sum += x;
+  }
+  row *= 1 / sum;
+}
+
+} // namespace
+
+CT_BENCHMARK("softmax/apply_rows") {
+  Matrix<double> m = make_matrix();
+  state.measure(static_cast<double>(m.size()), [&m] {
+    m.apply_rows(softmax);
+    do_not_optimize(m);
+  });
+}
+
+CT_BENCHMARK("softmax/rows_loop") {
+  Matrix<double> m = make_matrix();
+  state.measure(static_cast<double>(m.size()), [&m] {
+    for (auto row : views::rows(m)) {
+      softmax(row);
+    }
+    do_not_optimize(m);
+  });
+}
+
+// `c = (a + b) * 0.5 - a` through intermediate matrices
+CT_BENCHMARK("elementwise/temporaries") {
+  const Matrix<double> a = make_matrix();
+  const Matrix<double> b = make_matrix();
+  Matrix<double> c(ROWS, COLS);
+  state.measure(static_cast<double>(a.size()), [&] {
+    c = (a + b) * 0.5 - a;
+    do_not_optimize(c);
+  });
+}
+
+CT_BENCHMARK("elementwise/fused") {
+  const Matrix<double> a = make_matrix();
+  const Matrix<double> b = make_matrix();
+  Matrix<double> c(ROWS, COLS);
+  state.measure(static_cast<double>(a.size()), [&] {
+    auto mean = views::zip_transform([](double x, double y) { return (x + y) * 0.5; }, a, b);
+    c = views::zip_transform([](double m, double x) { return m - x; }, mean, a);
+    do_not_optimize(c);
+  });
+}
+
+} // namespace ct::bench
@@ -0,0 +1,81 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "reduction.h"
+
+#include <cstddef>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SUM_SIZE = 4096;
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<double>((i * 7 + j * 13) % 101) / 7.0;
+    }
+  }
+  return m;
+}
+
+// Runs `f` with the reduction mode set to `mode`
+template <typename F>
+void with_mode(ReductionMode mode, const F& f) {
+  ReductionMode previous = reduction_mode();
+  set_reduction_mode(mode);
+  f();
+  set_reduction_mode(previous);
+}
+
+void multiply(Benchmark& state, ReductionMode mode, size_t rows, size_t depth, size_t cols) {
+  const Matrix<double> a = make_matrix(rows, depth);
+  const Matrix<double> b = make_matrix(depth, cols);
+  with_mode(mode, [&] {
+    state.measure(2.0 * static_cast<double>(rows * depth * cols), [&a, &b] { do_not_optimize(a * b); });
+  });
+}
+
+void sum(Benchmark& state, ReductionMode mode) {
+  const Matrix<double> m = make_matrix(SUM_SIZE, SUM_SIZE);
+  with_mode(mode, [&] { state.measure(static_cast<double>(m.size()), [&m] { do_not_optimize(ct::sum(m)); }); });
+}
+
+} // namespace
+
+// Depth within one reproducible slice: both modes run the same kernel
+CT_BENCHMARK("reduction/multiply/1024x1024x1024/fast") {
+  multiply(state, ReductionMode::Fast, 1024, 1024, 1024);
+}
+
+CT_BENCHMARK("reduction/multiply/1024x1024x1024/reproducible") {
+  multiply(state, ReductionMode::Reproducible, 1024, 1024, 1024);
+}
+
+CT_BENCHMARK("reduction/multiply/512x8192x512/fast") {
+  multiply(state, ReductionMode::Fast, 512, 8192, 512);
+}
+
+CT_BENCHMARK("reduction/multiply/512x8192x512/reproducible") {
+  multiply(state, ReductionMode::Reproducible, 512, 8192, 512);
+}
+
+// Fewer rows than workers on a multi-core host: fast mode splits the inner dimension by the worker count
+CT_BENCHMARK("reduction/multiply/4x65536x512/fast") {
+  multiply(state, ReductionMode::Fast, 4, 65536, 512);
+}
+
+CT_BENCHMARK("reduction/multiply/4x65536x512/reproducible") {
+  multiply(state, ReductionMode::Reproducible, 4, 65536, 512);
+}
+
+CT_BENCHMARK("reduction/sum/fast") {
+  sum(state, ReductionMode::Fast);
+}
+
+CT_BENCHMARK("reduction/sum/reproducible") {
+  sum(state, ReductionMode::Reproducible);
+}
+
+} // namespace ct::bench
@@ -0,0 +1,81 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "serialize.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace ct::bench {
+
+namespace {
+
+// 64 MiB of 32-bit values, smooth enough to compress
+constexpr size_t SIZE = 4096;
+
+Matrix<int32_t> make_matrix() {
+  Matrix<int32_t> m(SIZE, SIZE);
+  for (size_t i = 0; i < SIZE; ++i) {
+    for (size_t j = 0; j < SIZE; ++j) {
+      m(i, j) = static_cast<int32_t>(1000 + (i + j) / 64);
+    }
+  }
+  return m;
+}
+
+// Writes `m` to an empty temporary file with `fd` serialization in each iteration
+void write_file(Benchmark& state, Compression compression) {
+  const Matrix<int32_t> m = make_matrix();
+  FILE* file = std::tmpfile();
+  int fd = fileno(file);
+  state.measure(static_cast<double>(m.size()), [&m, fd, compression] {
+    lseek(fd, 0, SEEK_SET);
+    serialize(fd, m, compression);
+  });
+  std::fclose(file);
+}
+
+void read_file(Benchmark& state, Compression compression) {
+  const Matrix<int32_t> m = make_matrix();
+  FILE* file = std::tmpfile();
+  int fd = fileno(file);
+  serialize(fd, m, compression);
+  state.measure(static_cast<double>(m.size()), [fd] {
+    lseek(fd, 0, SEEK_SET);
+    do_not_optimize(deserialize<int32_t>(fd));
+  });
+  std::fclose(file);
+}
+
+} // namespace
+
+CT_BENCHMARK("serialize/file") {
+  write_file(state, Compression::None);
+}
+
+CT_BENCHMARK("serialize/file_lz") {
+  write_file(state, Compression::Lz);
+}
+
+// Staging the whole payload in a string stream first, the way a generic `operator<<` would
+CT_BENCHMARK("serialize/stream_staged") {
+  const Matrix<int32_t> m = make_matrix();
+  state.measure(static_cast<double>(m.size()), [&m] {
+    std::ostringstream stream;
+    serialize(stream, m);
+    do_not_optimize(stream);
+  });
+}
+
+CT_BENCHMARK("deserialize/file") {
+  read_file(state, Compression::None);
+}
+
+CT_BENCHMARK("deserialize/file_lz") {
+  read_file(state, Compression::Lz);
+}
+
+} // namespace ct::bench
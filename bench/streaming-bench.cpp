@@ -0,0 +1,99 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "streaming.h"
+
+#include <cstddef>
+#include <numeric>
+
+namespace ct::bench {
+
+namespace {
+
+// 16384 columns of doubles: every step down a column moves 128 KiB
+constexpr size_t WIDE_ROWS = 2048;
+constexpr size_t WIDE_COLS = 16384;
+// 128 MiB of doubles per operand, at least four times most last-level caches
+constexpr size_t LARGE = 4096;
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  std::iota(m.begin(), m.end(), 0.0);
+  return m;
+}
+
+void column_sums(Benchmark& state, size_t distance) {
+  const Matrix<double> m = make_matrix(WIDE_ROWS, WIDE_COLS);
+  size_t previous = column_prefetch_distance();
+  set_column_prefetch_distance(distance);
+  state.measure(static_cast<double>(m.size()), [&m] {
+    double sum = 0;
+    for (size_t col = 0; col < m.cols(); col += 8) {
+      sum += m.col(col).accumulate();
+    }
+    do_not_optimize(sum);
+  });
+  set_column_prefetch_distance(previous);
+}
+
+void column_scale(Benchmark& state, size_t distance) {
+  Matrix<double> m = make_matrix(WIDE_ROWS, WIDE_COLS);
+  size_t previous = column_prefetch_distance();
+  set_column_prefetch_distance(distance);
+  state.measure(static_cast<double>(m.size()), [&m] {
+    for (size_t col = 0; col < m.cols(); col += 8) {
+      m.col(col) *= -1.0;
+    }
+    do_not_optimize(m);
+  });
+  set_column_prefetch_distance(previous);
+}
+
+} // namespace
+
+CT_BENCHMARK("column_sums/no_prefetch") {
+  column_sums(state, 0);
+}
+
+CT_BENCHMARK("column_sums/prefetch_4") {
+  column_sums(state, 4);
+}
+
+CT_BENCHMARK("column_sums/prefetch_8") {
+  column_sums(state, 8);
+}
+
+CT_BENCHMARK("column_sums/prefetch_16") {
+  column_sums(state, 16);
+}
+
+CT_BENCHMARK("column_scale/no_prefetch") {
+  column_scale(state, 0);
+}
+
+CT_BENCHMARK("column_scale/prefetch_8") {
+  column_scale(state, 8);
+}
+
+CT_BENCHMARK("elementwise/add_large") {
+  const Matrix<double> a = make_matrix(LARGE, LARGE);
+  const Matrix<double> b = make_matrix(LARGE, LARGE);
+  state.measure(static_cast<double>(a.size()), [&a, &b] { do_not_optimize(a + b); });
+}
+
+// The same sum through the cache: copy the left operand, then add in place
+CT_BENCHMARK("elementwise/add_large_cached") {
+  const Matrix<double> a = make_matrix(LARGE, LARGE);
+  const Matrix<double> b = make_matrix(LARGE, LARGE);
+  state.measure(static_cast<double>(a.size()), [&a, &b] {
+    Matrix<double> sum = a;
+    sum += b;
+    do_not_optimize(sum);
+  });
+}
+
+CT_BENCHMARK("elementwise/scale_large") {
+  const Matrix<double> a = make_matrix(LARGE, LARGE);
+  state.measure(static_cast<double>(a.size()), [&a] { do_not_optimize(a * 2.0); });
+}
+
+} // namespace ct::bench
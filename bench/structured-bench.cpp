@@ -0,0 +1,48 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "structured.h"
+
+#include <cstddef>
+
+namespace ct::bench {
+
+namespace {
+
+constexpr size_t SIZE = 1024;
+constexpr size_t BAND = 8;
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  size_t i = 0;
+  for (double& x : m) {
+    x = static_cast<double>(i++ % 17);
+  }
+  return m;
+}
+
+} // namespace
+
+CT_BENCHMARK("structured/dense") {
+  const Matrix<double> a = make_matrix(SIZE, SIZE);
+  state.measure(1, [&a] { do_not_optimize(a * a); });
+}
+
+CT_BENCHMARK("structured/symm") {
+  const Matrix<double> a = make_matrix(SIZE, SIZE);
+  const SymmetricMatrix<double> s(a);
+  state.measure(1, [&] { do_not_optimize(s * a); });
+}
+
+CT_BENCHMARK("structured/trmm") {
+  const Matrix<double> a = make_matrix(SIZE, SIZE);
+  const TriangularMatrix<double> t(a);
+  state.measure(1, [&] { do_not_optimize(t * a); });
+}
+
+CT_BENCHMARK("structured/banded") {
+  const Matrix<double> a = make_matrix(SIZE, SIZE);
+  const BandMatrix<double> b(a, BAND, BAND);
+  state.measure(1, [&] { do_not_optimize(b * a); });
+}
+
+} // namespace ct::bench
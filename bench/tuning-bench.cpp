@@ -0,0 +1,78 @@
+#include "benchmark.h"
+#include "matrix.h"
+#include "multiply.h"
+#include "tuning.h"
+
+#include <cstddef>
+
+namespace ct::bench {
+
+namespace {
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  size_t i = 0;
+  for (double& x : m) {
+    x = static_cast<double>(i++ % 17);
+  }
+  return m;
+}
+
+// `multiply<double>` always uses the default blocking, `operator*` the one tuned for the shape
+void product(Benchmark& state, size_t rows, size_t depth, size_t cols, bool tuned) {
+  const Matrix<double> a = make_matrix(rows, depth);
+  const Matrix<double> b = make_matrix(depth, cols);
+  double flops = 2.0 * static_cast<double>(rows * depth * cols);
+  if (tuned) {
+    // Tuned in memory, so that the benchmark neither reads nor writes the host's tuning file
+    KernelTuner::instance().reset("");
+    state.measure(flops, [&] { do_not_optimize(a * b); });
+    KernelTuner::instance().reset(KernelTuner::default_path());
+  } else {
+    state.measure(flops, [&] { do_not_optimize(multiply<double>(a, b)); });
+  }
+}
+
+} // namespace
+
+CT_BENCHMARK("tuned_multiply/square/default") {
+  product(state, 1024, 1024, 1024, false);
+}
+
+CT_BENCHMARK("tuned_multiply/square/tuned") {
+  product(state, 1024, 1024, 1024, true);
+}
+
+CT_BENCHMARK("tuned_multiply/tall_skinny/default") {
+  product(state, 32768, 64, 64, false);
+}
+
+CT_BENCHMARK("tuned_multiply/tall_skinny/tuned") {
+  product(state, 32768, 64, 64, true);
+}
+
+CT_BENCHMARK("tuned_multiply/short_wide/default") {
+  product(state, 64, 64, 32768, false);
+}
+
+CT_BENCHMARK("tuned_multiply/short_wide/tuned") {
+  product(state, 64, 64, 32768, true);
+}
+
+CT_BENCHMARK("tuned_multiply/deep/default") {
+  product(state, 64, 32768, 64, false);
+}
+
+CT_BENCHMARK("tuned_multiply/deep/tuned") {
+  product(state, 64, 32768, 64, true);
+}
+
+CT_BENCHMARK("tuned_multiply/shallow/default") {
+  product(state, 2048, 32, 2048, false);
+}
+
+CT_BENCHMARK("tuned_multiply/shallow/tuned") {
+  product(state, 2048, 32, 2048, true);
+}
+
+} // namespace ct::bench
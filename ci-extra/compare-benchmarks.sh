@@ -0,0 +1,87 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: compare-benchmarks.sh BUILD_TYPE BASELINE [FILTER]
+# Runs `build/BUILD_TYPE/benchmarks FILTER` RUNS times (default 3) and compares the best items per second of each
+# benchmark with BASELINE, a file of earlier `benchmarks` output from the same machine. Fails when any benchmark is
+# slower than its baseline by more than THRESHOLD percent (default 10), or, without FILTER, when a benchmark of the
+# baseline did not run. With UPDATE=1, writes the results to BASELINE instead, keeping the baseline of the
+# benchmarks that FILTER skips.
+
+BUILD_TYPE=$1
+BASELINE=$2
+FILTER=${3:-}
+THRESHOLD=${THRESHOLD:-10}
+RUNS=${RUNS:-3}
+
+runs=$(mktemp)
+results=$(mktemp)
+trap 'rm -f "$runs" "$results"' EXIT
+
+for ((run = 1; run <= RUNS; ++run)); do
+  "build/${BUILD_TYPE}/benchmarks" "$FILTER" | tee -a "$runs"
+done
+
+# Best run of each benchmark, in the order they ran
+awk -F '\t' -v OFS='\t' '
+  !($1 in best) {
+    order[++count] = $1
+  }
+  !($1 in best) || $3 > best[$1] {
+    best[$1] = $3
+    line[$1] = $0
+  }
+  END {
+    for (i = 1; i <= count; ++i) {
+      print line[order[i]]
+    }
+  }
+' "$runs" >"$results"
+
+if [[ ${UPDATE:-0} == 1 || ! -f $BASELINE ]]; then
+  if [[ -f $BASELINE ]]; then
+    awk -F '\t' 'NR == FNR { fresh[$1] = 1; print; next } !($1 in fresh)' "$results" "$BASELINE" >"$BASELINE.new"
+    mv "$BASELINE.new" "$BASELINE"
+  else
+    cp "$results" "$BASELINE"
+  fi
+  echo "Wrote baseline $BASELINE"
+  exit 0
+fi
+
+awk -F '\t' -v threshold="$THRESHOLD" -v filtered="${FILTER:+1}" '
+  NR == FNR {
+    baseline[$1] = $3
+    next
+  }
+  {
+    ran[$1] = 1
+  }
+  !($1 in baseline) {
+    printf "new\t%s\t%.3e items/s\n", $1, $3
+    next
+  }
+  {
+    change = 100 * ($3 / baseline[$1] - 1)
+    status = change < -threshold ? "SLOWER" : "ok"
+    failed = failed || status == "SLOWER"
+    printf "%s\t%s\t%.3e -> %.3e items/s (%+.1f%%)\n", status, $1, baseline[$1], $3, change
+  }
+  END {
+    if (!filtered) {
+      for (name in baseline) {
+        if (!(name in ran)) {
+          printf "MISSING\t%s\n", name
+          missing = 1
+        }
+      }
+    }
+    if (missing) {
+      print "Benchmarks of the baseline did not run" > "/dev/stderr"
+    }
+    if (failed) {
+      printf "Throughput regressed by more than %s%%\n", threshold > "/dev/stderr"
+    }
+    exit failed || missing
+  }
+' "$BASELINE" "$results"
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "numa.h"
+#include "parallel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ct {
+
+// Placement of a matrix buffer across NUMA nodes
+enum class NumaPlacement {
+  // Plain `new[]`: pages end up on the node of the thread that constructs the matrix
+  Default,
+  // Pages are spread round-robin over all nodes
+  Interleaved,
+  // Every row block lives on the node of the pool worker that processes that block in parallel operations
+  RowBlocks,
+};
+
+// Page size used for large matrix buffers. Huge pages cut the number of TLB misses, which matters most for
+// strided walks such as `ColIterator`, where every step lands on a different 4 KiB page.
+enum class HugePages {
+  // Regular pages only
+  Never,
+  // Huge-page-aligned mapping advised with `MADV_HUGEPAGE`; the kernel backs it with huge pages when it can
+  Transparent,
+  // `MAP_HUGETLB` pages from the reserved pool, falling back to `Transparent` when the pool is exhausted
+  Explicit,
+};
+
+// How the buffer of a matrix is allocated. Copies and results of arithmetic operations inherit the policy of
+// their (left) source.
+struct AllocationPolicy {
+  NumaPlacement placement = NumaPlacement::Default;
+  HugePages huge_pages = HugePages::Never;
+  // Buffers smaller than this (in bytes) always use regular pages
+  size_t huge_page_threshold = size_t{4} << 20;
+
+  friend bool operator==(const AllocationPolicy&, const AllocationPolicy&) = default;
+};
+
+namespace detail {
+
+enum class BufferKind : unsigned char {
+  // Allocated with `new T[]`
+  Array,
+  // Page-aligned anonymous mapping, elements are constructed in place
+  Mapped,
+};
+
+inline size_t page_size() {
+#ifdef __linux__
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+#else
+  return 4096;
+#endif
+}
+
+inline size_t compute_huge_page_size() {
+  std::ifstream in("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+  size_t size = 0;
+  in >> size;
+  return size == 0 ? size_t{2} << 20 : size;
+}
+
+// Size of the transparent huge pages
+inline size_t huge_page_size() {
+  static const size_t size = compute_huge_page_size();
+  return size;
+}
+
+inline size_t compute_hugetlb_page_size() {
+  std::ifstream in("/proc/meminfo");
+  std::string field;
+  while (in >> field) {
+    if (field == "Hugepagesize:") {
+      size_t kib = 0;
+      in >> kib;
+      return kib == 0 ? huge_page_size() : kib << 10;
+    }
+  }
+  return huge_page_size();
+}
+
+// Size of the pages of the `MAP_HUGETLB` pool, which need not be that of the transparent huge pages (e.g. 1 GiB)
+inline size_t hugetlb_page_size() {
+  static const size_t size = compute_hugetlb_page_size();
+  return size;
+}
+
+inline size_t round_up(size_t bytes, size_t granularity) {
+  return (bytes + granularity - 1) / granularity * granularity;
+}
+
+inline bool wants_huge_pages(size_t bytes, const AllocationPolicy& policy) {
+  return policy.huge_pages != HugePages::Never && bytes >= policy.huge_page_threshold;
+}
+
+// Page size that the mapping of a buffer of `bytes` bytes allocated with `policy` is sized, placed and unmapped in.
+// An `Explicit` mapping uses the `MAP_HUGETLB` page size even when it falls back to transparent huge pages, which
+// keeps its length a multiple of the page size it was mapped with either way.
+inline size_t mapping_page_size(size_t bytes, const AllocationPolicy& policy) {
+  if (!wants_huge_pages(bytes, policy)) {
+    return page_size();
+  }
+  return policy.huge_pages == HugePages::Explicit ? hugetlb_page_size() : huge_page_size();
+}
+
+// Length of the mapping that holds a buffer of `bytes` bytes allocated with `policy`
+inline size_t mapping_size(size_t bytes, const AllocationPolicy& policy) {
+  return round_up(bytes, mapping_page_size(bytes, policy));
+}
+
+// Applies the NUMA placement of `policy` to a fresh mapping holding `rows` rows of `row_bytes` bytes each. Ranges
+// are bound in whole pages of a `MAP_HUGETLB` mapping, which cannot be split.
+inline void place_pages(void* pages, size_t rows, size_t row_bytes, const AllocationPolicy& policy) {
+  size_t bytes = mapping_size(rows * row_bytes, policy);
+  size_t granularity = policy.huge_pages == HugePages::Explicit ? mapping_page_size(rows * row_bytes, policy)
+                                                                : page_size();
+  switch (policy.placement) {
+  case NumaPlacement::Default:
+    break;
+  case NumaPlacement::Interleaved:
+    numa_bind(pages, bytes, NumaMode::Interleave, all_numa_nodes());
+    break;
+  case NumaPlacement::RowBlocks: {
+    ThreadPool& pool = ThreadPool::instance();
+    size_t parts = max_row_blocks(rows);
+    char* base = static_cast<char*>(pages);
+    for (size_t part = 0; part < parts; ++part) {
+      BlockRange range = block_range(rows, parts, part);
+      // A page straddling two blocks goes to the earlier one
+      size_t begin = round_up(range.begin * row_bytes, granularity);
+      size_t end = part + 1 == parts ? bytes : round_up(range.end * row_bytes, granularity);
+      if (begin < end) {
+        numa_bind(base + begin, end - begin, NumaMode::Preferred, 1UL << pool.node(part));
+      }
+    }
+    break;
+  }
+  }
+}
+
+#ifdef __linux__
+// Anonymous mapping of `bytes` bytes whose start is aligned to `alignment`, or `nullptr`
+inline void* map_aligned(size_t bytes, size_t alignment) {
+  void* raw = mmap(nullptr, bytes + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+  char* begin = static_cast<char*>(raw);
+  size_t head = (alignment - reinterpret_cast<std::uintptr_t>(begin) % alignment) % alignment;
+  if (head != 0) {
+    munmap(begin, head);
+  }
+  munmap(begin + head + bytes, alignment - head);
+  return begin + head;
+}
+
+// `bytes` must be a multiple of `hugetlb_page_size()` for `Explicit`
+inline void* map_huge_pages(size_t bytes, HugePages huge_pages) {
+  if (huge_pages == HugePages::Explicit) {
+    void* pages = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (pages != MAP_FAILED) {
+      return pages;
+    }
+  }
+  void* pages = map_aligned(bytes, huge_page_size());
+  if (pages != nullptr) {
+    madvise(pages, bytes, MADV_HUGEPAGE);
+  }
+  return pages;
+}
+#endif
+
+// Maps pages for a buffer of `rows` rows of `row_bytes` bytes each, or returns `nullptr` if the policy does not
+// need a dedicated mapping (or the mapping failed), in which case the caller falls back to `new T[]`.
+// The memory is not touched here: the caller is expected to construct the elements from the workers that will
+// process them, which makes first-touch placement agree with `policy` even where `mbind` is unavailable.
+inline void* map_buffer(size_t rows, size_t row_bytes, const AllocationPolicy& policy) {
+#ifdef __linux__
+  size_t bytes = rows * row_bytes;
+  bool huge = wants_huge_pages(bytes, policy);
+  if (policy.placement == NumaPlacement::Default && !huge) {
+    return nullptr;
+  }
+  size_t length = mapping_size(bytes, policy);
+  void* pages = huge ? map_huge_pages(length, policy.huge_pages)
+                     : mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pages == nullptr || pages == MAP_FAILED) {
+    return nullptr;
+  }
+  place_pages(pages, rows, row_bytes, policy);
+  return pages;
+#else
+  static_cast<void>(rows);
+  static_cast<void>(row_bytes);
+  static_cast<void>(policy);
+  return nullptr;
+#endif
+}
+
+inline void unmap_buffer(void* pages, size_t bytes, const AllocationPolicy& policy) {
+#ifdef __linux__
+  munmap(pages, mapping_size(bytes, policy));
+#else
+  static_cast<void>(pages);
+  static_cast<void>(bytes);
+  static_cast<void>(policy);
+#endif
+}
+
+} // namespace detail
+
+} // namespace ct
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "kernels.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "reduction.h"
+#include "tuning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace ct {
+
+// Reported by `AsyncProduct::get` when the operation was cancelled before it finished
+class OperationCancelled : public std::exception {
+public:
+  const char* what() const noexcept override {
+    return "ct::OperationCancelled";
+  }
+};
+
+namespace detail {
+
+// A FIFO of background tasks served by a few dedicated threads. The tasks only coordinate: the heavy lifting is
+// split into row blocks and handed to `ThreadPool`, so a handful of threads is enough.
+class AsyncExecutor {
+public:
+  static constexpr size_t THREADS = 2;
+
+public:
+  AsyncExecutor() {
+    // Make sure the worker pool outlives the tasks that use it
+    ThreadPool::instance();
+    for (std::thread& thread : threads_) {
+      thread = std::thread([this] { work(); });
+    }
+  }
+
+  AsyncExecutor(const AsyncExecutor&) = delete;
+  AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+
+  // Tasks that have not started by the time the executor is destroyed are dropped, which breaks their promises
+  ~AsyncExecutor() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    while (head_ != nullptr) {
+      delete std::exchange(head_, head_->next);
+    }
+  }
+
+  static AsyncExecutor& instance() {
+    static AsyncExecutor executor;
+    return executor;
+  }
+
+  template <typename F>
+  void submit(F&& f) {
+    Task* task = new TaskImpl<std::decay_t<F>>(std::forward<F>(f));
+    {
+      std::lock_guard lock(mutex_);
+      (tail_ == nullptr ? head_ : tail_->next) = task;
+      tail_ = task;
+    }
+    wake_.notify_one();
+  }
+
+private:
+  struct Task {
+    Task* next = nullptr;
+
+    Task() = default;
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    virtual ~Task() = default;
+
+    virtual void run() = 0;
+  };
+
+  template <typename F>
+  struct TaskImpl : Task {
+    explicit TaskImpl(F f)
+        : f(std::move(f)) {}
+
+    void run() override {
+      f();
+    }
+
+    F f;
+  };
+
+  void work() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [this] { return stop_ || head_ != nullptr; });
+      if (stop_) {
+        return;
+      }
+      Task* task = std::exchange(head_, head_->next);
+      if (head_ == nullptr) {
+        tail_ = nullptr;
+      }
+      lock.unlock();
+      task->run();
+      delete task;
+      lock.lock();
+    }
+  }
+
+private:
+  std::thread threads_[THREADS];
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  Task* head_ = nullptr;
+  Task* tail_ = nullptr;
+  bool stop_ = false;
+};
+
+// Product work (in multiply-adds) done between two cancellation checks
+inline constexpr size_t CANCELLATION_CHUNK = size_t{1} << 24;
+
+// `left * right`, computed in row chunks with a cancellation check before each one. The chunks go through the
+// kernels `gemm_parallel` would use for the whole product, with the tuned blocking, so the result has the bits of
+// `left * right` in either reduction mode: the inner dimension is split in the same slices, which in fast mode only
+// happens for products with fewer rows than workers, and those are computed in a single chunk. Returns `false`
+// (leaving `result` partially computed) if a stop was requested. Exceptions thrown by the element operations on a
+// pool worker are rethrown on the calling thread.
+template <typename T>
+bool multiply_cancellable(
+    const Matrix<T>& left,
+    const Matrix<T>& right,
+    Matrix<T>& result,
+    std::stop_token first,
+    std::stop_token second
+) {
+  size_t rows = left.rows();
+  size_t depth = left.cols();
+  size_t cols = right.cols();
+  size_t work_per_row = std::max<size_t>(1, depth * cols);
+  size_t chunk = std::max(max_row_blocks(rows), CANCELLATION_CHUNK / work_per_row);
+  size_t slice = depth_chunk(rows, depth, cols);
+  GemmTiling tiling = KernelTuner::instance().tiling(left.data(), right.data(), rows, depth, cols);
+  T* out = result.data();
+  for (size_t chunk_begin = 0; chunk_begin < rows; chunk_begin += chunk) {
+    if (first.stop_requested() || second.stop_requested()) {
+      return false;
+    }
+    size_t chunk_rows = std::min(chunk, rows - chunk_begin);
+    if (slice < depth) {
+      gemm_split_depth(left.data() + chunk_begin * depth, right.data(), out + chunk_begin * cols, chunk_rows, depth,
+                       cols, tiling, slice);
+    } else {
+      parallel_rows(chunk_rows, work_per_row, [&](size_t begin, size_t end) {
+        gemm_rows(left.data(), right.data(), out, chunk_begin + begin, chunk_begin + end, depth, cols, tiling);
+      });
+    }
+  }
+  return true;
+}
+
+} // namespace detail
+
+template <typename T>
+class AsyncProduct;
+
+// Computes `left * right` on the internal executor and returns immediately.
+//
+// The task keeps its own handles to the operands, so the caller may destroy or modify its matrices right away.
+// Passing matrices in copy-on-write mode (see `Matrix::enable_sharing`) makes handing them over O(1); later writes
+// by the caller then detach the caller's copy and do not affect the product. `token` allows cancelling from an
+// external `std::stop_source` in addition to `AsyncProduct::cancel`.
+template <typename T>
+AsyncProduct<T> async_multiply(Matrix<T> left, Matrix<T> right, std::stop_token token = {});
+
+// Handle to a product computed in the background by `async_multiply`
+template <typename T>
+class AsyncProduct {
+public:
+  AsyncProduct() = default;
+
+  // Waits for the product and returns it; throws `OperationCancelled` if the operation was cancelled first, or
+  // rethrows what the computation threw (e.g. `std::bad_alloc` or an exception from the element operations).
+  // Like `std::future::get`, may be called only once.
+  Matrix<T> get() {
+    return future_.get();
+  }
+
+  bool valid() const {
+    return future_.valid();
+  }
+
+  bool ready() const {
+    return future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  void wait() const {
+    future_.wait();
+  }
+
+  template <typename Rep, typename Period>
+  std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+    return future_.wait_for(timeout);
+  }
+
+  // Requests cancellation. A product that has not started is never computed; one in progress stops at the next
+  // chunk boundary. Either way `get` then throws `OperationCancelled`. Has no effect on a finished product.
+  void cancel() {
+    stop_.request_stop();
+  }
+
+private:
+  AsyncProduct(std::future<Matrix<T>> future, std::stop_source stop)
+      : future_(std::move(future))
+      , stop_(std::move(stop)) {}
+
+  template <typename U>
+  friend AsyncProduct<U> async_multiply(Matrix<U> left, Matrix<U> right, std::stop_token token);
+
+private:
+  std::future<Matrix<T>> future_;
+  std::stop_source stop_{std::nostopstate};
+};
+
+template <typename T>
+AsyncProduct<T> async_multiply(Matrix<T> left, Matrix<T> right, std::stop_token token) {
+  std::promise<Matrix<T>> promise;
+  std::future<Matrix<T>> future = promise.get_future();
+  std::stop_source stop;
+
+  detail::AsyncExecutor::instance().submit(
+      [left = std::move(left),
+       right = std::move(right),
+       promise = std::move(promise),
+       own_token = stop.get_token(),
+       token = std::move(token)]() mutable {
+        // Anything thrown here, from allocating the result to the element operations, is reported by `get`
+        try {
+          Matrix<T> result(left.rows(), right.cols(), left.allocation_policy());
+          if (detail::multiply_cancellable(left, right, result, own_token, token)) {
+            promise.set_value(std::move(result));
+          } else {
+            promise.set_exception(std::make_exception_ptr(OperationCancelled()));
+          }
+        } catch (...) {
+          promise.set_exception(std::current_exception());
+        }
+      }
+  );
+
+  return {std::move(future), std::move(stop)};
+}
+
+} // namespace ct
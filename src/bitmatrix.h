@@ -0,0 +1,505 @@
+#pragma once
+
+#include "buffer.h"
+#include "matrix.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+namespace ct {
+
+namespace detail {
+
+inline constexpr size_t WORD_BITS = 64;
+
+// Number of 64-bit words holding `bits` bits
+inline constexpr size_t word_count(size_t bits) {
+  return (bits + WORD_BITS - 1) / WORD_BITS;
+}
+
+// Reference to one bit of a word
+class BitReference {
+public:
+  BitReference(uint64_t* word, size_t bit)
+      : word_(word)
+      , mask_(uint64_t{1} << bit) {}
+
+  BitReference(const BitReference&) = default;
+
+  operator bool() const {
+    return (*word_ & mask_) != 0;
+  }
+
+  const BitReference& operator=(bool value) const {
+    if (value) {
+      *word_ |= mask_;
+    } else {
+      *word_ &= ~mask_;
+    }
+    return *this;
+  }
+
+  // Assigns the value of the referenced bit, not the reference
+  const BitReference& operator=(const BitReference& other) const {
+    return *this = static_cast<bool>(other);
+  }
+
+  void flip() const {
+    *word_ ^= mask_;
+  }
+
+private:
+  uint64_t* word_;
+  uint64_t mask_;
+};
+
+// Read-only iterator over the bits of a row, producing `bool`s. Random-access in the C++20 sense, and only an input
+// iterator for legacy algorithms, since it has no element to refer to.
+class BitIterator {
+public:
+  using value_type = bool;
+  using reference = bool;
+  using difference_type = std::ptrdiff_t;
+  using iterator_concept = std::random_access_iterator_tag;
+  using iterator_category = std::input_iterator_tag;
+
+public:
+  BitIterator() = default;
+
+  BitIterator(const uint64_t* words, difference_type index)
+      : words_(words)
+      , index_(index) {}
+
+  bool operator*() const {
+    size_t i = static_cast<size_t>(index_);
+    return (words_[i / WORD_BITS] >> (i % WORD_BITS) & 1) != 0;
+  }
+
+  bool operator[](difference_type n) const {
+    return *(*this + n);
+  }
+
+  BitIterator& operator++() {
+    ++index_;
+    return *this;
+  }
+
+  BitIterator operator++(int) {
+    BitIterator copy = *this;
+    ++index_;
+    return copy;
+  }
+
+  BitIterator& operator--() {
+    --index_;
+    return *this;
+  }
+
+  BitIterator operator--(int) {
+    BitIterator copy = *this;
+    --index_;
+    return copy;
+  }
+
+  BitIterator& operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+
+  BitIterator& operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+
+  friend BitIterator operator+(BitIterator it, difference_type n) {
+    return it += n;
+  }
+
+  friend BitIterator operator+(difference_type n, BitIterator it) {
+    return it += n;
+  }
+
+  friend BitIterator operator-(BitIterator it, difference_type n) {
+    return it -= n;
+  }
+
+  friend difference_type operator-(const BitIterator& left, const BitIterator& right) {
+    return left.index_ - right.index_;
+  }
+
+  friend bool operator==(const BitIterator& left, const BitIterator& right) {
+    return left.words_ == right.words_ && left.index_ == right.index_;
+  }
+
+  friend auto operator<=>(const BitIterator& left, const BitIterator& right) {
+    return left.index_ <=> right.index_;
+  }
+
+private:
+  const uint64_t* words_ = nullptr;
+  difference_type index_ = 0;
+};
+
+// View of a row of a `BitMatrix`: a range of `bool`s like `Matrix<bool>::RowView`, writable through `operator[]`
+// unless `CONST`, with word-level access for bulk operations
+template <bool CONST>
+class BitRowView : public std::ranges::view_interface<BitRowView<CONST>> {
+public:
+  using Word = std::conditional_t<CONST, const uint64_t, uint64_t>;
+  using Reference = std::conditional_t<CONST, bool, BitReference>;
+
+public:
+  BitRowView() = default;
+
+  BitRowView(Word* words, size_t size)
+      : words_(words)
+      , size_(size) {}
+
+  BitRowView(const BitRowView<false>& other)
+    requires CONST
+      : words_(other.words())
+      , size_(other.size()) {}
+
+  BitIterator begin() const {
+    return {words_, 0};
+  }
+
+  BitIterator end() const {
+    return {words_, static_cast<std::ptrdiff_t>(size_)};
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  Reference operator[](size_t index) const {
+    if constexpr (CONST) {
+      return (words_[index / WORD_BITS] >> (index % WORD_BITS) & 1) != 0;
+    } else {
+      return {words_ + index / WORD_BITS, index % WORD_BITS};
+    }
+  }
+
+  // The `word_count(size())` words of the row; bits past `size()` are zero and must stay zero
+  Word* words() const {
+    return words_;
+  }
+
+  // Number of set bits
+  size_t count() const {
+    size_t count = 0;
+    for (size_t w = 0; w < word_count(size_); ++w) {
+      count += static_cast<size_t>(std::popcount(words_[w]));
+    }
+    return count;
+  }
+
+  // Sets every bit that is set in `other`, a row of the same size
+  const BitRowView& operator|=(const BitRowView<true>& other) const
+    requires (!CONST)
+  {
+    for (size_t w = 0; w < word_count(size_); ++w) {
+      words_[w] |= other.words()[w];
+    }
+    return *this;
+  }
+
+private:
+  Word* words_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Rows of the right operand combined by one Four Russians table: one byte of a left row selects an entry
+inline constexpr size_t RUSSIANS_ROWS = 8;
+inline constexpr size_t RUSSIANS_ENTRIES = size_t{1} << RUSSIANS_ROWS;
+// Tables covering one word
+inline constexpr size_t RUSSIANS_TABLES = WORD_BITS / RUSSIANS_ROWS;
+
+// Tables of the method of Four Russians for the `count` rows (up to one word's worth, `WORD_BITS`) of `stride` words
+// starting at `rows`: entry `x` of table `g` is the OR of the rows `g * 8 + b` for every set bit `b` of `x`. ORing
+// `tables[g][byte g of w]` for every `g` yields the OR of the rows selected by the bits of `w`, eight rows per
+// word operation.
+class RussiansTables {
+public:
+  explicit RussiansTables(size_t stride)
+      : stride_(stride)
+      , entries_(RUSSIANS_TABLES * RUSSIANS_ENTRIES * stride) {}
+
+  void build(const uint64_t* rows, size_t count) {
+    size_t groups = (count + RUSSIANS_ROWS - 1) / RUSSIANS_ROWS;
+    parallel_rows(groups, RUSSIANS_ENTRIES * stride_, [&](size_t begin, size_t end) {
+      for (size_t g = begin; g < end; ++g) {
+        uint64_t* table = entries_.data() + g * RUSSIANS_ENTRIES * stride_;
+        size_t available = std::min(RUSSIANS_ROWS, count - g * RUSSIANS_ROWS);
+        std::fill_n(table, stride_, uint64_t{0});
+        for (size_t x = 1; x < RUSSIANS_ENTRIES; ++x) {
+          size_t bit = static_cast<size_t>(std::countr_zero(x));
+          const uint64_t* rest = table + (x & (x - 1)) * stride_;
+          uint64_t* entry = table + x * stride_;
+          if (bit < available) {
+            const uint64_t* row = rows + (g * RUSSIANS_ROWS + bit) * stride_;
+            for (size_t w = 0; w < stride_; ++w) {
+              entry[w] = rest[w] | row[w];
+            }
+          } else {
+            std::copy_n(rest, stride_, entry);
+          }
+        }
+      }
+    });
+  }
+
+  // ORs into `out` the rows selected by the set bits of `selector`
+  void apply(uint64_t selector, uint64_t* out) const {
+    for (size_t g = 0; selector != 0; ++g, selector >>= RUSSIANS_ROWS) {
+      size_t byte = static_cast<size_t>(selector & (RUSSIANS_ENTRIES - 1));
+      if (byte != 0) {
+        const uint64_t* entry = entries_.data() + (g * RUSSIANS_ENTRIES + byte) * stride_;
+        for (size_t w = 0; w < stride_; ++w) {
+          out[w] |= entry[w];
+        }
+      }
+    }
+  }
+
+private:
+  size_t stride_;
+  PackedBuffer<uint64_t> entries_;
+};
+
+} // namespace detail
+
+// Boolean matrix packed 64 entries per word: each row is `words_per_row()` words, bit `j % 64` of word `j / 64`
+// holding column `j`. Takes an eighth of the memory of `Matrix<bool>`, and products and closures work on whole
+// words.
+class BitMatrix {
+public:
+  using ValueType = bool;
+
+  using Reference = detail::BitReference;
+
+  using RowView = detail::BitRowView<false>;
+  using ConstRowView = detail::BitRowView<true>;
+
+public:
+  BitMatrix() = default;
+
+  // All-false `rows x cols` matrix
+  BitMatrix(size_t rows, size_t cols)
+      : words_(rows * detail::word_count(cols))
+      , rows_(rows)
+      , cols_(cols)
+      , stride_(detail::word_count(cols)) {}
+
+  // Entries of `m` that are not equal to `T()`
+  template <typename T, typename Layout>
+  explicit BitMatrix(const Matrix<T, Layout>& m)
+      : BitMatrix(m.rows(), m.cols()) {
+    for (size_t i = 0; i < rows_; ++i) {
+      uint64_t* words = row_words(i);
+      for (size_t j = 0; j < cols_; ++j) {
+        words[j / detail::WORD_BITS] |= uint64_t{m(i, j) != T()} << (j % detail::WORD_BITS);
+      }
+    }
+  }
+
+  BitMatrix(const BitMatrix&) = default;
+  BitMatrix& operator=(const BitMatrix&) = default;
+
+  // Moving leaves `other` empty
+  BitMatrix(BitMatrix&& other) noexcept
+      : words_(std::move(other.words_))
+      , rows_(std::exchange(other.rows_, 0))
+      , cols_(std::exchange(other.cols_, 0))
+      , stride_(std::exchange(other.stride_, 0)) {}
+
+  BitMatrix& operator=(BitMatrix&& other) noexcept {
+    words_ = std::move(other.words_);
+    rows_ = std::exchange(other.rows_, 0);
+    cols_ = std::exchange(other.cols_, 0);
+    stride_ = std::exchange(other.stride_, 0);
+    return *this;
+  }
+
+  // `n x n` matrix with only the diagonal set
+  static BitMatrix identity(size_t n) {
+    BitMatrix result(n, n);
+    for (size_t i = 0; i < n; ++i) {
+      result(i, i) = true;
+    }
+    return result;
+  }
+
+  size_t rows() const {
+    return rows_;
+  }
+
+  size_t cols() const {
+    return cols_;
+  }
+
+  size_t size() const {
+    return rows_ * cols_;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  size_t words_per_row() const {
+    return stride_;
+  }
+
+  // Bytes taken by the entries
+  size_t stored_bytes() const {
+    return words_.size() * sizeof(uint64_t);
+  }
+
+  Reference operator()(size_t row, size_t col) {
+    return {row_words(row) + col / detail::WORD_BITS, col % detail::WORD_BITS};
+  }
+
+  bool operator()(size_t row, size_t col) const {
+    return (row_words(row)[col / detail::WORD_BITS] >> (col % detail::WORD_BITS) & 1) != 0;
+  }
+
+  RowView row(size_t row) {
+    return {row_words(row), cols_};
+  }
+
+  ConstRowView row(size_t row) const {
+    return {row_words(row), cols_};
+  }
+
+  uint64_t* row_words(size_t row) {
+    return words_.data() + row * stride_;
+  }
+
+  const uint64_t* row_words(size_t row) const {
+    return words_.data() + row * stride_;
+  }
+
+  // Number of `true` entries
+  size_t count() const {
+    size_t count = 0;
+    for (size_t w = 0; w < words_.size(); ++w) {
+      count += static_cast<size_t>(std::popcount(words_[w]));
+    }
+    return count;
+  }
+
+  Matrix<bool> to_dense() const {
+    Matrix<bool> result(rows_, cols_);
+    for (size_t i = 0; i < rows_; ++i) {
+      std::ranges::copy(row(i), result.row_begin(i));
+    }
+    return result;
+  }
+
+  friend bool operator==(const BitMatrix& left, const BitMatrix& right) {
+    return left.rows_ == right.rows_ && left.cols_ == right.cols_ && left.words_ == right.words_;
+  }
+
+  // Elementwise OR and AND of matrices of the same shape
+
+  BitMatrix& operator|=(const BitMatrix& other) {
+    for (size_t w = 0; w < words_.size(); ++w) {
+      words_[w] |= other.words_[w];
+    }
+    return *this;
+  }
+
+  BitMatrix& operator&=(const BitMatrix& other) {
+    for (size_t w = 0; w < words_.size(); ++w) {
+      words_[w] &= other.words_[w];
+    }
+    return *this;
+  }
+
+  friend BitMatrix operator|(BitMatrix left, const BitMatrix& right) {
+    left |= right;
+    return left;
+  }
+
+  friend BitMatrix operator&(BitMatrix left, const BitMatrix& right) {
+    left &= right;
+    return left;
+  }
+
+  // Boolean (OR-AND) product: `result(i, j)` is whether `left(i, k) && right(k, j)` for some `k`.
+  //
+  // Method of Four Russians: the rows of `right` are taken 64 at a time, the width of one word of a row of `left`,
+  // and turned into eight tables of all 256 ORs of 8 rows. Every row of the result then takes eight table lookups
+  // and word-wide ORs per word of the left row, in parallel over rows, instead of 64 row ORs.
+  // O(rows * depth * cols / 512) word operations.
+  friend BitMatrix operator*(const BitMatrix& left, const BitMatrix& right) {
+    BitMatrix result(left.rows_, right.cols_);
+    if (result.empty() || left.cols_ == 0) {
+      return result;
+    }
+    size_t stride = result.stride_;
+    detail::RussiansTables tables(stride);
+    for (size_t word = 0; word < left.stride_; ++word) {
+      size_t first = word * detail::WORD_BITS;
+      tables.build(right.row_words(first), std::min(detail::WORD_BITS, right.rows_ - first));
+      detail::parallel_rows(left.rows_, detail::RUSSIANS_TABLES * stride, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          tables.apply(left.row_words(i)[word], result.row_words(i));
+        }
+      });
+    }
+    return result;
+  }
+
+private:
+  detail::PackedBuffer<uint64_t> words_;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  size_t stride_ = 0;
+};
+
+// Transitive closure of the relation `m` (square): `result(i, j)` is whether `j` can be reached from `i` by a path
+// of one or more edges. OR the identity in for reflexive reachability.
+//
+// Warshall's algorithm over blocks of 64 intermediate vertices: the rows of the block are first closed over the
+// block among themselves, and every other row then absorbs, through Four Russians tables built from the block's
+// rows, the rows of the block vertices it reaches. Using the block's final rows instead of Warshall's intermediate
+// ones only adds paths that exist, so the result is the same, with one parallel pass per 64 vertices.
+// O(n^3 / 512) word operations.
+inline BitMatrix transitive_closure(const BitMatrix& m) {
+  BitMatrix result = m;
+  size_t n = result.rows();
+  size_t stride = result.words_per_row();
+  detail::RussiansTables tables(stride);
+  for (size_t word = 0; word < stride; ++word) {
+    size_t first = word * detail::WORD_BITS;
+    size_t last = std::min(n, first + detail::WORD_BITS);
+    for (size_t k = first; k < last; ++k) {
+      for (size_t i = first; i < last; ++i) {
+        if (result(i, k)) {
+          result.row(i) |= std::as_const(result).row(k);
+        }
+      }
+    }
+    tables.build(result.row_words(first), last - first);
+    detail::parallel_rows(n, detail::RUSSIANS_TABLES * stride, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        if (i < first || i >= last) {
+          uint64_t* row = result.row_words(i);
+          tables.apply(row[word], row);
+        }
+      }
+    });
+  }
+  return result;
+}
+
+} // namespace ct
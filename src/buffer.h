@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ct::detail {
+
+// Owning, zero-initialized array of elements: the storage of the structured matrices and of LU pivots
+template <typename T>
+class PackedBuffer {
+public:
+  PackedBuffer() = default;
+
+  explicit PackedBuffer(size_t size)
+      : data_(new T[size]())
+      , size_(size) {}
+
+  PackedBuffer(const PackedBuffer& other)
+      : PackedBuffer(other.size_) {
+    std::copy_n(other.data_, size_, data_);
+  }
+
+  PackedBuffer& operator=(const PackedBuffer& other) {
+    if (this != &other) {
+      PackedBuffer copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  PackedBuffer(PackedBuffer&& other) noexcept {
+    swap(other);
+  }
+
+  PackedBuffer& operator=(PackedBuffer&& other) noexcept {
+    if (this != &other) {
+      PackedBuffer moved(std::move(other));
+      swap(moved);
+    }
+    return *this;
+  }
+
+  ~PackedBuffer() {
+    delete[] data_;
+  }
+
+  T* data() {
+    return data_;
+  }
+
+  const T* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  T& operator[](size_t index) {
+    return data_[index];
+  }
+
+  const T& operator[](size_t index) const {
+    return data_[index];
+  }
+
+  friend bool operator==(const PackedBuffer& left, const PackedBuffer& right) {
+    return left.size_ == right.size_ && std::equal(left.data_, left.data_ + left.size_, right.data_);
+  }
+
+private:
+  void swap(PackedBuffer& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+private:
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Bitmap of the rows of a matrix written since tracking started or was last cleared. Inactive, and free, until
+// `track` is called; an inactive set reports every row as dirty.
+class DirtyRows {
+public:
+  DirtyRows() = default;
+
+  DirtyRows(const DirtyRows&) = delete;
+  DirtyRows& operator=(const DirtyRows&) = delete;
+
+  constexpr DirtyRows(DirtyRows&& other) noexcept
+      : words_(std::exchange(other.words_, nullptr))
+      , rows_(std::exchange(other.rows_, 0)) {}
+
+  constexpr DirtyRows& operator=(DirtyRows&& other) noexcept {
+    if (this != &other) {
+      delete[] words_;
+      words_ = std::exchange(other.words_, nullptr);
+      rows_ = std::exchange(other.rows_, 0);
+    }
+    return *this;
+  }
+
+  constexpr ~DirtyRows() {
+    delete[] words_;
+  }
+
+  constexpr bool active() const {
+    return words_ != nullptr;
+  }
+
+  // Starts tracking `rows` rows, all of them clean
+  constexpr void track(size_t rows) {
+    delete[] words_;
+    rows_ = rows;
+    // At least one word, so that an active set never holds a null or zero-length array
+    words_ = new uint64_t[std::max<size_t>(1, word_count())]();
+  }
+
+  // Follows a replacement of the whole matrix by one with `rows` rows: all of them are dirty afterwards
+  constexpr void reset(size_t rows) {
+    if (active()) {
+      if (rows != rows_) {
+        track(rows);
+      }
+      set_all();
+    }
+  }
+
+  constexpr void set(size_t row) {
+    if (active()) {
+      words_[row / BITS] |= uint64_t{1} << (row % BITS);
+    }
+  }
+
+  constexpr void set_all() {
+    if (active() && rows_ != 0) {
+      std::fill_n(words_, word_count(), ~uint64_t{0});
+      if (rows_ % BITS != 0) {
+        words_[word_count() - 1] = (uint64_t{1} << (rows_ % BITS)) - 1;
+      }
+    }
+  }
+
+  constexpr void clear() {
+    if (active()) {
+      std::fill_n(words_, word_count(), uint64_t{0});
+    }
+  }
+
+  constexpr bool test(size_t row) const {
+    return !active() || ((words_[row / BITS] >> (row % BITS)) & 1) != 0;
+  }
+
+  // Number of dirty rows; only meaningful while active
+  constexpr size_t count() const {
+    size_t count = 0;
+    for (size_t i = 0; i < word_count(); ++i) {
+      count += static_cast<size_t>(std::popcount(words_[i]));
+    }
+    return count;
+  }
+
+private:
+  static constexpr size_t BITS = 64;
+
+private:
+  constexpr size_t word_count() const {
+    return (rows_ + BITS - 1) / BITS;
+  }
+
+private:
+  uint64_t* words_ = nullptr;
+  size_t rows_ = 0;
+};
+
+} // namespace ct::detail
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <type_traits>
+
+// Checked-access mode. Builds configured with the `CT_CHECKED` CMake option (which defines `CT_CHECKED`) validate
+// every element index, row and column index, and iterator position of matrices and their views and iterators, and
+// throw `OutOfRange` instead of reading or writing outside the line or buffer. Otherwise the checks compile to
+// nothing and iterators carry no extra state, so the fast path is unchanged.
+
+namespace ct {
+
+// Index or iterator position out of range, in checked-access mode
+class OutOfRange : public std::exception {
+public:
+  const char* what() const noexcept override {
+    return "ct::OutOfRange";
+  }
+};
+
+namespace detail {
+
+#ifdef CT_CHECKED
+inline constexpr bool CHECKED = true;
+#else
+inline constexpr bool CHECKED = false;
+#endif
+
+// `index` must designate one of `size` elements
+constexpr void check_index(size_t index, size_t size) {
+  if constexpr (CHECKED) {
+    if (index >= size) {
+      throw OutOfRange();
+    }
+  }
+}
+
+// Number of elements of the line an iterator walks, kept only in checked-access mode. Otherwise the class is empty
+// and, as a `[[no_unique_address]]` member, takes no space in the iterator.
+#ifdef CT_CHECKED
+class LineBound {
+public:
+  LineBound() = default;
+
+  constexpr explicit LineBound(size_t size)
+      : size_(static_cast<std::ptrdiff_t>(size)) {}
+
+  // `index` must designate an element
+  constexpr void check_index(std::ptrdiff_t index) const {
+    if (index < 0 || index >= size_) {
+      throw OutOfRange();
+    }
+  }
+
+  // `position` must be an element or the end of the line
+  constexpr void check_position(std::ptrdiff_t position) const {
+    if (position < 0 || position > size_) {
+      throw OutOfRange();
+    }
+  }
+
+private:
+  std::ptrdiff_t size_;
+};
+#else
+class LineBound {
+public:
+  LineBound() = default;
+
+  constexpr explicit LineBound(size_t) {}
+
+  constexpr void check_index(std::ptrdiff_t) const {}
+
+  constexpr void check_position(std::ptrdiff_t) const {}
+};
+#endif
+
+#ifdef CT_CHECKED
+// Iterator over a contiguous row, column or whole buffer in checked-access mode: a pointer that knows the bounds of
+// its line.
+// Contiguous like the pointer it stands for; `operator->`, and so `std::to_address`, also accepts the end of the
+// line, since forming that address accesses nothing.
+template <typename T>
+class BoundedPointer {
+public:
+  using value_type = std::remove_const_t<T>;
+  using element_type = T;
+  using reference = T&;
+  using pointer = T*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+  using iterator_concept = std::contiguous_iterator_tag;
+
+public:
+  BoundedPointer() = default;
+
+  constexpr BoundedPointer(T* line, size_t position, size_t size)
+      : line_(line)
+      , index_(static_cast<difference_type>(position))
+      , bound_(size) {}
+
+  template <typename U>
+    requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+  constexpr BoundedPointer(const BoundedPointer<U>& other)
+      : line_(other.line_)
+      , index_(other.index_)
+      , bound_(other.bound_) {}
+
+  constexpr reference operator*() const {
+    bound_.check_index(index_);
+    return line_[index_];
+  }
+
+  constexpr pointer operator->() const {
+    bound_.check_position(index_);
+    return line_ + index_;
+  }
+
+  constexpr reference operator[](difference_type n) const {
+    bound_.check_index(index_ + n);
+    return line_[index_ + n];
+  }
+
+  constexpr BoundedPointer& operator++() {
+    bound_.check_position(index_ + 1);
+    ++index_;
+    return *this;
+  }
+
+  constexpr BoundedPointer operator++(int) {
+    BoundedPointer tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  constexpr BoundedPointer& operator--() {
+    bound_.check_position(index_ - 1);
+    --index_;
+    return *this;
+  }
+
+  constexpr BoundedPointer operator--(int) {
+    BoundedPointer tmp = *this;
+    --*this;
+    return tmp;
+  }
+
+  constexpr BoundedPointer& operator+=(difference_type n) {
+    bound_.check_position(index_ + n);
+    index_ += n;
+    return *this;
+  }
+
+  constexpr BoundedPointer& operator-=(difference_type n) {
+    bound_.check_position(index_ - n);
+    index_ -= n;
+    return *this;
+  }
+
+  friend constexpr BoundedPointer operator+(BoundedPointer it, difference_type n) {
+    return it += n;
+  }
+
+  friend constexpr BoundedPointer operator+(difference_type n, BoundedPointer it) {
+    return it += n;
+  }
+
+  friend constexpr BoundedPointer operator-(BoundedPointer it, difference_type n) {
+    return it -= n;
+  }
+
+  friend constexpr difference_type operator-(const BoundedPointer& left, const BoundedPointer& right) {
+    return left.index_ - right.index_;
+  }
+
+  friend constexpr bool operator==(const BoundedPointer& left, const BoundedPointer& right) {
+    return left.line_ == right.line_ && left.index_ == right.index_;
+  }
+
+  friend constexpr auto operator<=>(const BoundedPointer& left, const BoundedPointer& right) {
+    return left.index_ <=> right.index_;
+  }
+
+private:
+  template <typename U>
+  friend class BoundedPointer;
+
+private:
+  T* line_;
+  difference_type index_;
+  LineBound bound_;
+};
+
+template <typename T>
+using ContiguousIterator = BoundedPointer<T>;
+#else
+template <typename T>
+using ContiguousIterator = T*;
+#endif
+
+// Iterator to element `position` (the end if it is `size`) of the contiguous row, column or buffer of `size`
+// elements at `line`: a plain pointer unless in checked-access mode
+template <typename T>
+constexpr ContiguousIterator<T> contiguous_iterator(T* line, size_t position, size_t size) {
+#ifdef CT_CHECKED
+  return {line, position, size};
+#else
+  static_cast<void>(size);
+  return line + position;
+#endif
+}
+
+} // namespace detail
+
+} // namespace ct
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// LZ4-style block compression: a byte-oriented LZ77 with a single-probe hash table, trading ratio for speed.
+//
+// A block is a sequence of sequences, each a token byte (literal count in the high nibble, match length minus
+// `LZ_MIN_MATCH` in the low one, `15` meaning "continued in 255-terminated extra bytes"), the literals, and a
+// little-endian 16-bit match offset. The last sequence has literals only. Matches stop `LZ_LAST_LITERALS` bytes
+// before the end of the input, so the decoder can tell the final sequence by running out of input.
+
+namespace ct::detail {
+
+inline constexpr size_t LZ_MIN_MATCH = 4;
+inline constexpr size_t LZ_LAST_LITERALS = 5;
+// Inputs shorter than this are stored as literals only
+inline constexpr size_t LZ_MIN_INPUT = 12;
+inline constexpr size_t LZ_MAX_OFFSET = 65535;
+inline constexpr unsigned LZ_HASH_BITS = 12;
+
+// Largest possible compressed size of `size` input bytes
+inline constexpr size_t lz_compress_bound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+inline uint32_t lz_read32(const uint8_t* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t lz_hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+// Appends `length` in the 255-run encoding used for lengths that do not fit in a token nibble
+inline uint8_t* lz_write_length(uint8_t* out, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = static_cast<uint8_t>(length);
+  return out;
+}
+
+inline uint8_t* lz_write_sequence(
+    uint8_t* out,
+    const uint8_t* literals,
+    size_t literal_count,
+    size_t offset,
+    size_t match_length
+) {
+  size_t match_code = match_length == 0 ? 0 : match_length - LZ_MIN_MATCH;
+  uint8_t* token = out++;
+  *token = static_cast<uint8_t>((literal_count < 15 ? literal_count : 15) << 4);
+  if (literal_count >= 15) {
+    out = lz_write_length(out, literal_count - 15);
+  }
+  std::memcpy(out, literals, literal_count);
+  out += literal_count;
+  if (match_length == 0) {
+    return out;
+  }
+  *out++ = static_cast<uint8_t>(offset);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  *token = static_cast<uint8_t>(*token | (match_code < 15 ? match_code : 15));
+  if (match_code >= 15) {
+    out = lz_write_length(out, match_code - 15);
+  }
+  return out;
+}
+
+// Compresses `size` bytes from `in` into `out`, which must have room for `lz_compress_bound(size)` bytes.
+// Returns the compressed size.
+inline size_t lz_compress(const uint8_t* in, size_t size, uint8_t* out) {
+  uint8_t* begin = out;
+  size_t anchor = 0;
+  if (size >= LZ_MIN_INPUT) {
+    uint32_t table[size_t{1} << LZ_HASH_BITS] = {};
+    size_t match_limit = size - LZ_LAST_LITERALS;
+    for (size_t pos = 0; pos + LZ_MIN_INPUT <= size;) {
+      uint32_t sequence = lz_read32(in + pos);
+      uint32_t hash = lz_hash(sequence);
+      size_t candidate = table[hash];
+      table[hash] = static_cast<uint32_t>(pos);
+      if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET || lz_read32(in + candidate) != sequence) {
+        ++pos;
+        continue;
+      }
+      size_t length = LZ_MIN_MATCH;
+      while (pos + length < match_limit && in[candidate + length] == in[pos + length]) {
+        ++length;
+      }
+      out = lz_write_sequence(out, in + anchor, pos - anchor, pos - candidate, length);
+      pos += length;
+      anchor = pos;
+    }
+  }
+  out = lz_write_sequence(out, in + anchor, size - anchor, 0, 0);
+  return static_cast<size_t>(out - begin);
+}
+
+// Reads a 255-run length continuation, returning `false` if the input ends first
+inline bool lz_read_length(const uint8_t* in, size_t size, size_t& pos, size_t& length) {
+  uint8_t byte;
+  do {
+    if (pos >= size) {
+      return false;
+    }
+    byte = in[pos++];
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// Decompresses a block of `size` bytes from `in` into exactly `out_size` bytes at `out`. Returns `false` if the
+// block is malformed or does not decode to exactly `out_size` bytes; never reads or writes out of bounds.
+inline bool lz_decompress(const uint8_t* in, size_t size, uint8_t* out, size_t out_size) {
+  size_t pos = 0;
+  size_t written = 0;
+  while (pos < size) {
+    uint8_t token = in[pos++];
+    size_t literal_count = token >> 4;
+    if (literal_count == 15 && !lz_read_length(in, size, pos, literal_count)) {
+      return false;
+    }
+    if (literal_count > size - pos || literal_count > out_size - written) {
+      return false;
+    }
+    std::memcpy(out + written, in + pos, literal_count);
+    pos += literal_count;
+    written += literal_count;
+    if (pos == size) {
+      return written == out_size;
+    }
+
+    if (size - pos < 2) {
+      return false;
+    }
+    size_t offset = in[pos] | size_t{in[pos + 1]} << 8;
+    pos += 2;
+    size_t length = token & 15;
+    if (length == 15 && !lz_read_length(in, size, pos, length)) {
+      return false;
+    }
+    length += LZ_MIN_MATCH;
+    if (offset == 0 || offset > written || length > out_size - written) {
+      return false;
+    }
+    // Byte by byte: the match may overlap the bytes it produces
+    const uint8_t* from = out + written - offset;
+    for (size_t i = 0; i < length; ++i) {
+      out[written + i] = from[i];
+    }
+    written += length;
+  }
+  return false;
+}
+
+} // namespace ct::detail
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "footprint.h"
+#include "matrix.h"
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <ranges>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Concurrent accumulation into one matrix from many threads, without a global lock.
+//
+// `AtomicAdder` and `RowLocks` take the target's buffer once, when they are built: that is when a buffer shared in
+// copy-on-write mode is detached (see `Matrix::enable_sharing`) and, with `Matrix::track_dirty_rows`, every row is
+// marked dirty. Meanwhile the target must not be copied, resized, moved or assigned to, since the updates through
+// the handle bypass the matrix.
+
+namespace ct {
+
+// Test-and-test-and-set lock for short critical sections. Waiters spin on a plain load, and yield the core after a
+// while so that a preempted holder can finish.
+class SpinLock {
+public:
+  static constexpr int SPINS_BEFORE_YIELD = 64;
+
+public:
+  void lock() noexcept {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      for (int spins = 0; locked_.load(std::memory_order_relaxed); ++spins) {
+        if (spins < SPINS_BEFORE_YIELD) {
+          pause();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  bool try_lock() noexcept {
+    return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() noexcept {
+    locked_.store(false, std::memory_order_release);
+  }
+
+private:
+  static void pause() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+    _mm_pause();
+#endif
+  }
+
+private:
+  std::atomic<bool> locked_ = false;
+};
+
+// Atomic element updates of a matrix: `add(row, col, value)` is `m(row, col) += value` as one atomic
+// read-modify-write, safe against concurrent `add`s to the same element from any thread. Relaxed: use a
+// synchronization point (joining the threads, a barrier) before reading the results. `m` must outlive the adder.
+template <typename T, typename Layout = RowMajor>
+  requires (std::integral<T> || std::floating_point<T>)
+class AtomicAdder {
+public:
+  explicit AtomicAdder(Matrix<T, Layout>& m)
+      : data_(m.data())
+      , rows_(m.rows())
+      , cols_(m.cols()) {}
+
+  void add(size_t row, size_t col, T value) const {
+    std::atomic_ref<T>(data_[Layout::index(row, col, rows_, cols_)]).fetch_add(value, std::memory_order_relaxed);
+  }
+
+private:
+  T* data_;
+  size_t rows_;
+  size_t cols_;
+};
+
+// Row-striped locking over a matrix: row `r` is guarded by spinlock `r % stripes()`, so threads updating different
+// rows almost never contend, and whole-row updates cost one lock acquisition instead of one atomic per element.
+template <typename T, typename Layout = RowMajor>
+class RowLocks {
+public:
+  using RowView = typename Matrix<T, Layout>::RowView;
+
+  // Stripe count used when none is given, bounding the memory of the locks for tall matrices
+  static constexpr size_t DEFAULT_MAX_STRIPES = 4096;
+
+public:
+  // One lock per row, up to `DEFAULT_MAX_STRIPES`. `m` must outlive the locks.
+  explicit RowLocks(Matrix<T, Layout>& m)
+      : RowLocks(m, std::min(m.rows(), DEFAULT_MAX_STRIPES)) {}
+
+  RowLocks(Matrix<T, Layout>& m, size_t stripes)
+      : data_(m.data())
+      , rows_(m.rows())
+      , cols_(m.cols())
+      , stripes_(std::max<size_t>(1, stripes))
+      , locks_(new Stripe[stripes_]) {}
+
+  RowLocks(const RowLocks&) = delete;
+  RowLocks& operator=(const RowLocks&) = delete;
+
+  ~RowLocks() {
+    delete[] locks_;
+  }
+
+  size_t stripes() const {
+    return stripes_;
+  }
+
+  // Calls `f(view)` with the `RowView` of row `row` while holding its lock
+  template <typename F>
+  void update(size_t row, F&& f) {
+    std::lock_guard lock(locks_[row % stripes_].lock);
+    std::forward<F>(f)(Layout::row(data_, row, rows_, cols_));
+  }
+
+  // Adds `values` (`cols()` of them) to row `row` under its lock
+  template <std::ranges::input_range R>
+  void add(size_t row, R&& values) {
+    update(row, [&values](RowView view) {
+      std::transform(view.begin(), view.end(), std::ranges::begin(values), view.begin(), std::plus<>{});
+    });
+  }
+
+  // Adds `value` to one element under the lock of its row
+  void add(size_t row, size_t col, const T& value) {
+    std::lock_guard lock(locks_[row % stripes_].lock);
+    data_[Layout::index(row, col, rows_, cols_)] += value;
+  }
+
+private:
+  struct alignas(CACHE_LINE) Stripe {
+    SpinLock lock;
+  };
+
+private:
+  T* data_;
+  size_t rows_;
+  size_t cols_;
+  size_t stripes_;
+  Stripe* locks_;
+};
+
+// Per-thread accumulation buffers reduced at the end: each thread adds into its own zero-initialized shard, so
+// the hot path takes no shared lock and touches no shared cache line, and `reduce` sums the shards in parallel.
+// Shards are allocated on first use, so idle ones cost nothing. With more threads than shards, threads share
+// shards (each shard has an uncontended-in-practice spinlock).
+template <typename T, typename Layout = RowMajor>
+class ShardedAccumulator {
+public:
+  // One shard per hardware thread
+  ShardedAccumulator(size_t rows, size_t cols)
+      : ShardedAccumulator(rows, cols, std::max(1U, std::thread::hardware_concurrency())) {}
+
+  ShardedAccumulator(size_t rows, size_t cols, size_t shards)
+      : rows_(rows)
+      , cols_(cols)
+      , count_(std::max<size_t>(1, shards))
+      , shards_(new Shard[count_]) {}
+
+  ShardedAccumulator(const ShardedAccumulator&) = delete;
+  ShardedAccumulator& operator=(const ShardedAccumulator&) = delete;
+
+  ~ShardedAccumulator() {
+    delete[] shards_;
+  }
+
+  size_t rows() const {
+    return rows_;
+  }
+
+  size_t cols() const {
+    return cols_;
+  }
+
+  size_t shards() const {
+    return count_;
+  }
+
+  // `(row, col) += value` in the calling thread's shard
+  void add(size_t row, size_t col, const T& value) {
+    with_local([&](Matrix<T, Layout>& values) { values(row, col) += value; });
+  }
+
+  // Adds `values` (`cols()` of them) to row `row` in the calling thread's shard
+  template <std::ranges::input_range R>
+  void add(size_t row, R&& values) {
+    with_local([&](Matrix<T, Layout>& shard) {
+      auto view = shard.row(row);
+      std::transform(view.begin(), view.end(), std::ranges::begin(values), view.begin(), std::plus<>{});
+    });
+  }
+
+  // Calls `f(shard)` on the calling thread's shard, a `rows() x cols()` matrix, while holding the shard's lock
+  template <typename F>
+  void with_local(F&& f) {
+    Shard& shard = shards_[detail::current_thread_index() % count_];
+    std::lock_guard lock(shard.lock);
+    if (shard.values.empty()) {
+      shard.values = Matrix<T, Layout>(rows_, cols_);
+    }
+    std::forward<F>(f)(shard.values);
+  }
+
+  // Adds the sum of all shards to `target`. Must not run concurrently with `add`.
+  void reduce_into(Matrix<T, Layout>& target) const {
+    for (size_t i = 0; i < count_; ++i) {
+      if (!shards_[i].values.empty()) {
+        target += shards_[i].values;
+      }
+    }
+  }
+
+  // Sum of all shards. Must not run concurrently with `add`.
+  Matrix<T, Layout> reduce() const {
+    Matrix<T, Layout> sum(rows_, cols_);
+    reduce_into(sum);
+    return sum;
+  }
+
+  // Zeroes all shards, keeping their buffers
+  void clear() {
+    for (size_t i = 0; i < count_; ++i) {
+      if (!shards_[i].values.empty()) {
+        std::fill(shards_[i].values.begin(), shards_[i].values.end(), T());
+      }
+    }
+  }
+
+private:
+  struct alignas(CACHE_LINE) Shard {
+    SpinLock lock;
+    Matrix<T, Layout> values;
+  };
+
+private:
+  size_t rows_;
+  size_t cols_;
+  size_t count_;
+  Shard* shards_;
+};
+
+} // namespace ct
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "buffer.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace ct {
+
+// Values of the image outside its borders (the halo), as seen by a kernel overlapping them. The halo is never
+// materialized: interior pixels read the image directly, and only taps that fall outside remap their index.
+enum class Boundary {
+  Zero,    // zeros
+  Clamp,   // the nearest border pixel
+  Reflect, // mirrored at the border, the border pixel included: `... 1 0 | 0 1 2 ... n-1 | n-1 n-2 ...`
+  Wrap,    // periodic
+};
+
+enum class ConvolutionMethod {
+  // `Direct` for kernels of up to `DIRECT_CONVOLUTION_TAPS` elements, `Im2col` for larger ones
+  Auto,
+  // Stencil sweeps over the image rows, four kernel elements per sweep over the output row
+  Direct,
+  // Image patches lowered into a matrix with one row per kernel element, multiplied by the kernel with the blocked
+  // product kernel
+  Im2col,
+};
+
+// Largest kernel (in elements) convolved directly by `ConvolutionMethod::Auto`: up to 15x15 the stencil sweeps beat
+// the lowering, which copies every pixel once per tap
+inline constexpr size_t DIRECT_CONVOLUTION_TAPS = 225;
+
+namespace detail {
+
+// Elements of the im2col patch matrix each thread builds at a time
+inline constexpr size_t IM2COL_BLOCK = size_t{1} << 15;
+
+// Index in `[0, size)` that `index` reads under `boundary`, or -1 for a zero
+inline std::ptrdiff_t boundary_index(std::ptrdiff_t index, std::ptrdiff_t size, Boundary boundary) {
+  if (index >= 0 && index < size) {
+    return index;
+  }
+  switch (boundary) {
+    case Boundary::Zero:
+      return -1;
+    case Boundary::Clamp:
+      return std::clamp<std::ptrdiff_t>(index, 0, size - 1);
+    case Boundary::Reflect: {
+      std::ptrdiff_t period = 2 * size;
+      std::ptrdiff_t folded = (index % period + period) % period;
+      return folded < size ? folded : period - 1 - folded;
+    }
+    case Boundary::Wrap:
+      return (index % size + size) % size;
+  }
+  return -1;
+}
+
+// A row-major image convolved with a kernel anchored at its center
+template <typename T>
+class Convolution {
+public:
+  Convolution(const Matrix<T>& image, const Matrix<T>& kernel, Boundary boundary)
+      : image_(image.data())
+      , kernel_(kernel.data())
+      , rows_(static_cast<std::ptrdiff_t>(image.rows()))
+      , cols_(static_cast<std::ptrdiff_t>(image.cols()))
+      , kernel_rows_(static_cast<std::ptrdiff_t>(kernel.rows()))
+      , kernel_cols_(static_cast<std::ptrdiff_t>(kernel.cols()))
+      , boundary_(boundary) {
+    // Output columns `[interior_begin_, interior_end_)` read no column outside the image, whatever the tap
+    interior_begin_ = std::min(anchor_col(), cols_);
+    interior_end_ = std::max(interior_begin_, cols_ - (kernel_cols_ - 1 - anchor_col()));
+  }
+
+  size_t taps() const {
+    return static_cast<size_t>(kernel_rows_ * kernel_cols_);
+  }
+
+  // Output row `i` written to `out` by sweeps over the interior columns that each add four taps, the shape of the
+  // inner loop of `gemm_tile`; the border columns remap the taps that fall outside the image one at a time
+  void direct_row(size_t i, T* out) const {
+    std::fill_n(out, cols_, T());
+    const T* sources[4];
+    T weights[4];
+    size_t pending = 0;
+    for (std::ptrdiff_t p = 0; p < kernel_rows_; ++p) {
+      const T* source = source_row(i, p);
+      if (source == nullptr) {
+        continue;
+      }
+      for (std::ptrdiff_t q = 0; q < kernel_cols_; ++q) {
+        const T& weight = kernel_[p * kernel_cols_ + q];
+        std::ptrdiff_t shift = q - anchor_col();
+        for_each_border_column([&](std::ptrdiff_t j) {
+          std::ptrdiff_t col = boundary_index(j + shift, cols_, boundary_);
+          if (col >= 0) {
+            out[j] += weight * source[col];
+          }
+        });
+        sources[pending] = source + shift;
+        weights[pending] = weight;
+        if (++pending == 4) {
+          const T* s0 = sources[0];
+          const T* s1 = sources[1];
+          const T* s2 = sources[2];
+          const T* s3 = sources[3];
+          for (std::ptrdiff_t j = interior_begin_; j < interior_end_; ++j) {
+            out[j] += weights[0] * s0[j] + weights[1] * s1[j] + weights[2] * s2[j] + weights[3] * s3[j];
+          }
+          pending = 0;
+        }
+      }
+    }
+    for (size_t t = 0; t < pending; ++t) {
+      const T* shifted = sources[t];
+      const T weight = weights[t];
+      for (std::ptrdiff_t j = interior_begin_; j < interior_end_; ++j) {
+        out[j] += weight * shifted[j];
+      }
+    }
+  }
+
+  // Output row `i` written to `out` as the product of the kernel, as a `1 x taps()` matrix, by the `taps() x width`
+  // im2col matrix of the pixels each tap reads, built in `patches` for blocks of `width` columns
+  void im2col_row(size_t i, T* out, T* patches, size_t width) const {
+    size_t taps = this->taps();
+    for (std::ptrdiff_t begin = 0; begin < cols_; begin += static_cast<std::ptrdiff_t>(width)) {
+      std::ptrdiff_t end = std::min(cols_, begin + static_cast<std::ptrdiff_t>(width));
+      size_t block = static_cast<size_t>(end - begin);
+      for (std::ptrdiff_t p = 0; p < kernel_rows_; ++p) {
+        const T* source = source_row(i, p);
+        for (std::ptrdiff_t q = 0; q < kernel_cols_; ++q) {
+          gather(source, q - anchor_col(), begin, end, patches + static_cast<size_t>(p * kernel_cols_ + q) * block);
+        }
+      }
+      std::fill(out + begin, out + end, T());
+      gemm_rows(kernel_, patches, out + begin, 0, 1, taps, block);
+    }
+  }
+
+private:
+  std::ptrdiff_t anchor_row() const {
+    return kernel_rows_ / 2;
+  }
+
+  std::ptrdiff_t anchor_col() const {
+    return kernel_cols_ / 2;
+  }
+
+  // Image row read by kernel row `p` for output row `i`, or null for a row of zeros
+  const T* source_row(size_t i, std::ptrdiff_t p) const {
+    std::ptrdiff_t row = boundary_index(static_cast<std::ptrdiff_t>(i) + p - anchor_row(), rows_, boundary_);
+    return row < 0 ? nullptr : image_ + row * cols_;
+  }
+
+  template <typename F>
+  void for_each_border_column(const F& f) const {
+    for (std::ptrdiff_t j = 0; j < interior_begin_; ++j) {
+      f(j);
+    }
+    for (std::ptrdiff_t j = interior_end_; j < cols_; ++j) {
+      f(j);
+    }
+  }
+
+  // `out[j - begin] = source[j + shift]` for output columns `[begin, end)`, remapping the columns outside the image
+  void gather(const T* source, std::ptrdiff_t shift, std::ptrdiff_t begin, std::ptrdiff_t end, T* out) const {
+    if (source == nullptr) {
+      std::fill_n(out, end - begin, T());
+      return;
+    }
+    std::ptrdiff_t interior_begin = std::clamp(interior_begin_, begin, end);
+    std::ptrdiff_t interior_end = std::clamp(interior_end_, interior_begin, end);
+    for (std::ptrdiff_t j = begin; j < end; ++j) {
+      if (j == interior_begin) {
+        std::copy(source + j + shift, source + interior_end + shift, out + (j - begin));
+        j = interior_end;
+        if (j == end) {
+          break;
+        }
+      }
+      std::ptrdiff_t col = boundary_index(j + shift, cols_, boundary_);
+      out[j - begin] = col < 0 ? T() : source[col];
+    }
+  }
+
+private:
+  const T* image_;
+  const T* kernel_;
+  std::ptrdiff_t rows_;
+  std::ptrdiff_t cols_;
+  std::ptrdiff_t kernel_rows_;
+  std::ptrdiff_t kernel_cols_;
+  Boundary boundary_;
+  std::ptrdiff_t interior_begin_;
+  std::ptrdiff_t interior_end_;
+};
+
+} // namespace detail
+
+// 2D convolution of `image` by `kernel`, anchored at the kernel's center (`(kernel.rows() / 2, kernel.cols() / 2)`),
+// giving an output of the size of the image:
+//
+//   out(i, j) = sum_{p, q} kernel(p, q) * image(i + p - kernel.rows() / 2, j + q - kernel.cols() / 2)
+//
+// with pixels outside the image taken from `boundary`. As usual for image filters and neural networks, the kernel
+// is not flipped (this is a cross-correlation); flip it along both axes for the convolution of signal processing.
+//
+// Small kernels are applied as direct stencils, with vectorizable multiply-add sweeps reading the image rows in
+// place; large ones are lowered to im2col blocks multiplied with the blocked product kernel. Either way the work is
+// split by bands of output rows over the thread pool.
+template <typename T>
+Matrix<T> convolve2d(
+    const Matrix<T>& image,
+    const Matrix<T>& kernel,
+    Boundary boundary = Boundary::Zero,
+    ConvolutionMethod method = ConvolutionMethod::Auto
+) {
+  Matrix<T> result(image.rows(), image.cols(), image.allocation_policy());
+  if (result.empty() || kernel.empty()) {
+    return result;
+  }
+  detail::Convolution<T> convolution(image, kernel, boundary);
+  size_t taps = convolution.taps();
+  if (method == ConvolutionMethod::Auto) {
+    method = taps <= DIRECT_CONVOLUTION_TAPS ? ConvolutionMethod::Direct : ConvolutionMethod::Im2col;
+  }
+  size_t cols = image.cols();
+  T* out = result.data();
+  if (method == ConvolutionMethod::Direct) {
+    detail::parallel_rows(image.rows(), cols * taps, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        convolution.direct_row(i, out + i * cols);
+      }
+    });
+  } else {
+    size_t width = std::clamp<size_t>(detail::IM2COL_BLOCK / taps, 1, cols);
+    detail::parallel_rows(image.rows(), cols * taps, [&](size_t begin, size_t end) {
+      detail::PackedBuffer<T> patches(taps * width);
+      for (size_t i = begin; i < end; ++i) {
+        convolution.im2col_row(i, out + i * cols, patches.data(), width);
+      }
+    });
+  }
+  return result;
+}
+
+} // namespace ct
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace ct::detail {
+
+// Copies of fewer bytes than this run on the calling thread. Above it a single core cannot keep up with the memory
+// bandwidth of the machine, and the copy is split over the pool workers.
+inline constexpr size_t PARALLEL_COPY_THRESHOLD = size_t{4} << 20;
+
+inline size_t compute_last_level_cache_size() {
+#if defined(__linux__) && defined(_SC_LEVEL3_CACHE_SIZE)
+  for (int name : {_SC_LEVEL3_CACHE_SIZE, _SC_LEVEL2_CACHE_SIZE}) {
+    long size = sysconf(name);
+    if (size > 0) {
+      return static_cast<size_t>(size);
+    }
+  }
+#endif
+  return size_t{8} << 20;
+}
+
+// Size of the last-level cache in bytes (8 MiB when the system does not report it). Copies at least this large,
+// and elementwise results at least `STREAMING_STORE_LLC_FACTOR` times as large, are written with streaming stores:
+// they cannot stay in the LLC anyway, and writing them through the cache would evict the working set of every
+// thread sharing the LLC.
+inline size_t last_level_cache_size() {
+  static const size_t size = compute_last_level_cache_size();
+  return size;
+}
+
+// Whether a copy of `bytes` bytes split into `parts` chunks uses streaming stores (see `last_level_cache_size`).
+// A copy that is not split is left to `memcpy`, which switches to streaming stores by itself at these sizes (and
+// does so faster than `stream_copy`); the chunks of a split copy are each too small for that.
+inline bool wants_streaming_copy(size_t bytes, size_t parts) {
+  return parts > 1 && bytes >= last_level_cache_size();
+}
+
+// `memcpy` that writes `to` with non-temporal stores, bypassing the cache. Plain `memcpy` where they are not
+// available.
+inline void stream_copy(const void* from, void* to, size_t bytes) {
+#if defined(__x86_64__) || defined(_M_X64)
+  const char* in = static_cast<const char*>(from);
+  char* out = static_cast<char*>(to);
+  size_t head = std::min(bytes, (16 - reinterpret_cast<uintptr_t>(out) % 16) % 16);
+  std::memcpy(out, in, head);
+  in += head;
+  out += head;
+  bytes -= head;
+  for (; bytes >= 64; bytes -= 64, in += 64, out += 64) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 32));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out), a);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out + 48), d);
+  }
+  std::memcpy(out, in, bytes);
+  // Streaming stores are weakly ordered: make them visible before the copy is reported done
+  _mm_sfence();
+#else
+  std::memcpy(to, from, bytes);
+#endif
+}
+
+// Copies `count` elements on the calling thread, with `memcpy` for trivially copyable elements. `to` may also be
+// raw memory when `T` is trivially copyable.
+template <typename T>
+void copy_block(const T* from, T* to, size_t count, bool streaming) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    if (count == 0) {
+      return;
+    }
+    if (streaming) {
+      stream_copy(from, to, count * sizeof(T));
+    } else {
+      std::memcpy(to, from, count * sizeof(T));
+    }
+  } else {
+    std::copy_n(from, count, to);
+  }
+}
+
+// Copies `count` elements between two non-overlapping buffers: by `memcpy` for trivially copyable elements, in
+// parallel chunks when there are more than `PARALLEL_COPY_THRESHOLD` bytes, and bypassing the cache when the
+// destination outgrows the LLC
+template <typename T>
+constexpr void copy_elements(const T* from, T* to, size_t count) {
+  if consteval {
+    std::copy_n(from, count, to);
+  } else {
+    size_t bytes = count * sizeof(T);
+    size_t parts = bytes < PARALLEL_COPY_THRESHOLD ? 1 : max_row_blocks(count);
+    bool streaming = wants_streaming_copy(bytes, parts);
+    for_each_row_block(count, parts, [=](size_t begin, size_t end) {
+      copy_block(from + begin, to + begin, end - begin, streaming);
+    });
+  }
+}
+
+} // namespace ct::detail
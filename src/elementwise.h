@@ -0,0 +1,115 @@
+#pragma once
+
+#include "buffer.h"
+#include "matrix.h"
+#include "ranges.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ranges>
+
+// Elementwise (Hadamard) and Kronecker products, and broadcast additions of a row or column to a whole matrix.
+// Large operations run in parallel over rows, with tight loops over contiguous lines that the compiler can vectorize,
+// and the `_in_place` variants allocate no matrix.
+
+namespace ct {
+
+namespace detail {
+
+// Copy of the elements of `line` as `T`s, so that a line may be broadcast into the matrix it belongs to
+template <typename T, typename Line>
+PackedBuffer<T> copy_line(const Line& line) {
+  PackedBuffer<T> copy(static_cast<size_t>(std::ranges::distance(line)));
+  std::ranges::copy(line, copy.data());
+  return copy;
+}
+
+} // namespace detail
+
+// `left(i, j) * right(i, j)` for matrices of the same shape. Fused into one pass, with streaming stores for large
+// results, through the elementwise views of "ranges.h".
+template <typename T, typename Layout>
+Matrix<T, Layout> hadamard(const Matrix<T, Layout>& left, const Matrix<T, Layout>& right) {
+  return Matrix<T, Layout>(views::zip_transform(std::multiplies<>{}, left, right));
+}
+
+// `left(i, j) *= right(i, j)`
+template <typename T, typename Layout>
+Matrix<T, Layout>& hadamard_in_place(Matrix<T, Layout>& left, const Matrix<T, Layout>& right) {
+  return left = views::zip_transform(std::multiplies<>{}, left, right);
+}
+
+// `m(i, j) += row[j]` for every row `i`: `row` is any range of `m.cols()` values, such as a `RowView` (possibly of
+// `m` itself). Parallel over rows.
+template <typename T, typename Layout, std::ranges::input_range Row>
+Matrix<T, Layout>& add_to_each_row_in_place(Matrix<T, Layout>& m, const Row& row) {
+  detail::PackedBuffer<T> values = detail::copy_line<T>(row);
+  m.apply_rows([&values](typename Matrix<T, Layout>::RowView view) {
+    std::transform(view.begin(), view.end(), values.data(), view.begin(), std::plus<>{});
+  });
+  return m;
+}
+
+template <typename T, typename Layout, std::ranges::input_range Row>
+Matrix<T, Layout> add_to_each_row(const Matrix<T, Layout>& m, const Row& row) {
+  Matrix<T, Layout> result = m;
+  add_to_each_row_in_place(result, row);
+  return result;
+}
+
+// `m(i, j) += col[i]` for every column `j`: `col` is any range of `m.rows()` values, such as a `ColView`. Parallel
+// over rows.
+template <typename T, typename Layout, std::ranges::input_range Col>
+Matrix<T, Layout>& add_to_each_col_in_place(Matrix<T, Layout>& m, const Col& col) {
+  detail::PackedBuffer<T> values = detail::copy_line<T>(col);
+  m.apply_rows([&values](typename Matrix<T, Layout>::RowView view, size_t i) {
+    const T& value = values[i];
+    std::for_each(view.begin(), view.end(), [&value](T& x) { x += value; });
+  });
+  return m;
+}
+
+template <typename T, typename Layout, std::ranges::input_range Col>
+Matrix<T, Layout> add_to_each_col(const Matrix<T, Layout>& m, const Col& col) {
+  Matrix<T, Layout> result = m;
+  add_to_each_col_in_place(result, col);
+  return result;
+}
+
+// Kronecker product written to `out`, which is reshaped to `(left.rows() * right.rows()) x (left.cols() *
+// right.cols())` unless it already has that shape: block `(i, j)` of `out` is `left(i, j) * right`. Row `i * r + p`
+// of `out` is made of the scaled copies `left(i, j) * right.row(p)` side by side, so it is written in one
+// sequential sweep, in parallel over the rows of `out`. `out` must not be one of the operands.
+template <typename T, typename Layout>
+void kronecker_into(const Matrix<T, Layout>& left, const Matrix<T, Layout>& right, Matrix<T, Layout>& out) {
+  size_t rows = left.rows() * right.rows();
+  size_t cols = left.cols() * right.cols();
+  if (out.rows() != rows || out.cols() != cols) {
+    out = Matrix<T, Layout>(rows, cols, left.allocation_policy());
+  }
+  if (out.empty()) {
+    return;
+  }
+  size_t block_rows = right.rows();
+  out.apply_rows([&left, &right, block_rows](typename Matrix<T, Layout>::RowView view, size_t r) {
+    size_t i = r / block_rows;
+    size_t p = r % block_rows;
+    auto out_it = view.begin();
+    for (auto it = left.row_begin(i); it != left.row_end(i); ++it) {
+      const T& factor = *it;
+      auto scaled = [&factor](const T& x) { return factor * x; };
+      out_it = std::transform(right.row_begin(p), right.row_end(p), out_it, scaled);
+    }
+  });
+}
+
+template <typename T, typename Layout>
+Matrix<T, Layout> kronecker(const Matrix<T, Layout>& left, const Matrix<T, Layout>& right) {
+  Matrix<T, Layout> result;
+  kronecker_into(left, right, result);
+  return result;
+}
+
+} // namespace ct
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// Memory footprint of matrix buffers. Every buffer a `Matrix` allocates or frees, temporaries of arithmetic
+// operations included, is accounted for its element type and for all types together: live bytes, the high-water
+// mark of live bytes, live buffers and allocations. Mapped buffers count the whole mapping, rounded up to pages.
+//
+// The counters are sharded by thread: each of the first `MEMORY_SHARDS` threads to allocate a buffer owns a shard,
+// which only it writes, without atomic read-modify-writes. It keeps small buffers to its shard and publishes the
+// shard's balance to the shared counters once it exceeds `MEMORY_SLACK` bytes; buffers of at least `MEMORY_SLACK`
+// bytes, and all buffers of further threads, are published right away. The high-water mark is sampled on each
+// publication, so it is exact at the allocation of a large buffer and may miss a peak made of small buffers by less
+// than `MEMORY_SHARDS * MEMORY_SLACK` bytes. Live bytes and counts are always exact.
+
+namespace ct {
+
+// Size of a cache line, the unit of padding between locks and shards so that neighbouring ones do not falsely share
+inline constexpr size_t CACHE_LINE = 64;
+
+// Shards of the counters of each element type
+inline constexpr size_t MEMORY_SHARDS = 64;
+
+// Balance (in bytes) up to which a shard keeps allocations and frees to itself
+inline constexpr size_t MEMORY_SLACK = size_t{16} << 10;
+
+// Snapshot of the buffers of one element type, or of all of them
+struct MemoryUsage {
+  size_t live_bytes = 0;
+  size_t peak_bytes = 0;
+  size_t live_buffers = 0;
+  // Buffers allocated so far, freed ones included
+  size_t allocations = 0;
+
+  friend bool operator==(const MemoryUsage&, const MemoryUsage&) = default;
+};
+
+namespace detail {
+
+// Small dense id of the calling thread, assigned on first use
+inline size_t current_thread_index() {
+  static std::atomic<size_t> next = 0;
+  thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+inline void raise_to(std::atomic<std::ptrdiff_t>& peak, std::ptrdiff_t value) {
+  std::ptrdiff_t current = peak.load(std::memory_order_relaxed);
+  while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+// Counters of the buffers of one element type
+class MemoryAccount {
+public:
+  // Records the allocation (`bytes > 0`) or the release (`bytes < 0`) of a buffer of `|bytes|` bytes
+  void record(std::ptrdiff_t bytes) {
+    size_t thread = current_thread_index();
+    constexpr auto SLACK = static_cast<std::ptrdiff_t>(MEMORY_SLACK);
+    if (thread >= MEMORY_SHARDS) {
+      (bytes > 0 ? allocations_ : releases_).fetch_add(1, std::memory_order_relaxed);
+      publish(bytes);
+      return;
+    }
+    Shard& shard = shards_[thread];
+    increment(bytes > 0 ? shard.allocations : shard.releases);
+    std::ptrdiff_t balance = shard.balance.load(std::memory_order_relaxed) + bytes;
+    if (bytes >= SLACK || bytes <= -SLACK || balance >= SLACK || balance <= -SLACK) {
+      shard.balance.store(0, std::memory_order_relaxed);
+      publish(balance);
+    } else {
+      shard.balance.store(balance, std::memory_order_relaxed);
+    }
+  }
+
+  MemoryUsage usage() const {
+    std::ptrdiff_t live = this->live();
+    size_t allocations = allocations_.load(std::memory_order_relaxed);
+    size_t releases = releases_.load(std::memory_order_relaxed);
+    for (const Shard& shard : shards_) {
+      allocations += shard.allocations.load(std::memory_order_relaxed);
+      releases += shard.releases.load(std::memory_order_relaxed);
+    }
+    MemoryUsage usage;
+    usage.live_bytes = static_cast<size_t>(live);
+    usage.peak_bytes = static_cast<size_t>(std::max(peak_.load(std::memory_order_relaxed), live));
+    usage.live_buffers = allocations - std::min(releases, allocations);
+    usage.allocations = allocations;
+    return usage;
+  }
+
+  // Restarts the high-water mark from the current live bytes, and returns the previous one
+  size_t reset_peak() {
+    std::ptrdiff_t live = this->live();
+    return static_cast<size_t>(std::max(peak_.exchange(live, std::memory_order_relaxed), live));
+  }
+
+  // Raises the high-water mark back to at least `peak`
+  void restore_peak(size_t peak) {
+    raise_to(peak_, static_cast<std::ptrdiff_t>(peak));
+  }
+
+private:
+  // Written by its owner thread only, read by any
+  struct alignas(CACHE_LINE) Shard {
+    // Bytes allocated minus bytes released through this shard, not yet published
+    std::atomic<std::ptrdiff_t> balance = 0;
+    std::atomic<size_t> allocations = 0;
+    std::atomic<size_t> releases = 0;
+  };
+
+private:
+  static void increment(std::atomic<size_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  void publish(std::ptrdiff_t bytes) {
+    live_.fetch_add(bytes, std::memory_order_relaxed);
+    if (bytes > 0) {
+      raise_to(peak_, live());
+    }
+  }
+
+  // Published bytes plus the balances of the shards
+  std::ptrdiff_t live() const {
+    std::ptrdiff_t live = live_.load(std::memory_order_relaxed);
+    for (const Shard& shard : shards_) {
+      live += shard.balance.load(std::memory_order_relaxed);
+    }
+    // A buffer may be released through a shard that is read before the one it was allocated through
+    return std::max<std::ptrdiff_t>(live, 0);
+  }
+
+private:
+  Shard shards_[MEMORY_SHARDS];
+  // Shared counters, and those of threads without a shard
+  alignas(CACHE_LINE) std::atomic<std::ptrdiff_t> live_ = 0;
+  std::atomic<std::ptrdiff_t> peak_ = 0;
+  std::atomic<size_t> allocations_ = 0;
+  std::atomic<size_t> releases_ = 0;
+};
+
+// Counters of the buffers of `T`, and of all element types for `void`
+template <typename T>
+inline MemoryAccount memory_account;
+
+// Records the allocation (`bytes > 0`) or the release (`bytes < 0`) of a buffer of `T`
+template <typename T>
+void record_buffer(std::ptrdiff_t bytes) {
+  memory_account<T>.record(bytes);
+  memory_account<void>.record(bytes);
+}
+
+} // namespace detail
+
+// Buffers of element type `T` (possibly cv-qualified), or of all element types for `void`
+template <typename T = void>
+MemoryUsage memory_usage() {
+  return detail::memory_account<std::remove_cv_t<T>>.usage();
+}
+
+// Footprint of a region of code. The high-water mark restarts from the current live bytes when the scope opens, and
+// `usage()` reports it, with the allocations made since. Closing the scope folds its peak back into the global one.
+// Scopes of the same type `T` must nest (they may be opened on any thread, but not overlap otherwise); buffers
+// allocated by other threads meanwhile count towards the scope.
+template <typename T = void>
+class MemoryScope {
+public:
+  MemoryScope()
+      : outer_peak_(detail::memory_account<std::remove_cv_t<T>>.reset_peak())
+      , allocations_(memory_usage<T>().allocations) {}
+
+  MemoryScope(const MemoryScope&) = delete;
+  MemoryScope& operator=(const MemoryScope&) = delete;
+
+  ~MemoryScope() {
+    detail::memory_account<std::remove_cv_t<T>>.restore_peak(outer_peak_);
+  }
+
+  // Live bytes and buffers now, peak bytes and allocations since the scope opened
+  MemoryUsage usage() const {
+    MemoryUsage usage = memory_usage<T>();
+    usage.allocations -= allocations_;
+    return usage;
+  }
+
+  size_t peak_bytes() const {
+    return usage().peak_bytes;
+  }
+
+private:
+  size_t outer_peak_;
+  size_t allocations_;
+};
+
+} // namespace ct
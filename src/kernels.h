@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace ct::detail {
+
+// Blocking of the product kernel. The output is produced in panels of `col_tile` columns, and the inner dimension is
+// consumed `depth_tile` rows of the right operand at a time, so that the part of the right operand a panel reads
+// (`depth_tile * col_tile` elements) stays in cache while it is reused for every row of the left operand.
+struct GemmTiling {
+  size_t depth_tile = 128;
+  size_t col_tile = 512;
+};
+
+// `out[i][j] += sum_k Acc(left[i][k]) * panel[k][j]` over one tile: rows `i` in `[begin, end)`, `k` in
+// `[0, depth)` and `j` in `[0, width)`. `left` and `out` point at the first element of the tile in their rows.
+//
+// The inner loop consumes four rows of the panel per pass over an output row: that quarters the load/store traffic
+// on `out` and is the multiply-add-of-pairs shape that `pmaddwd`/`vpdpbusd`-style instructions implement for narrow
+// integers, when the compiler targets them.
+template <typename Acc, typename T, typename P>
+constexpr void gemm_tile(
+    const T* left,
+    size_t left_stride,
+    const P* panel,
+    size_t panel_stride,
+    Acc* out,
+    size_t out_stride,
+    size_t begin,
+    size_t end,
+    size_t depth,
+    size_t width
+) {
+  for (size_t i = begin; i < end; ++i) {
+    const T* left_row = left + i * left_stride;
+    Acc* out_row = out + i * out_stride;
+    size_t k = 0;
+    for (; k + 4 <= depth; k += 4) {
+      Acc a0 = static_cast<Acc>(left_row[k]);
+      Acc a1 = static_cast<Acc>(left_row[k + 1]);
+      Acc a2 = static_cast<Acc>(left_row[k + 2]);
+      Acc a3 = static_cast<Acc>(left_row[k + 3]);
+      const P* b0 = panel + k * panel_stride;
+      const P* b1 = b0 + panel_stride;
+      const P* b2 = b1 + panel_stride;
+      const P* b3 = b2 + panel_stride;
+      for (size_t j = 0; j < width; ++j) {
+        out_row[j] += a0 * static_cast<Acc>(b0[j]) + a1 * static_cast<Acc>(b1[j]) + a2 * static_cast<Acc>(b2[j]) +
+                      a3 * static_cast<Acc>(b3[j]);
+      }
+    }
+    for (; k < depth; ++k) {
+      Acc a = static_cast<Acc>(left_row[k]);
+      const P* b = panel + k * panel_stride;
+      for (size_t j = 0; j < width; ++j) {
+        out_row[j] += a * static_cast<Acc>(b[j]);
+      }
+    }
+  }
+}
+
+// `out[i][j] += sum_k Acc(left[i][k]) * Acc(right[k][j])` for rows `i` in `[begin, end)`, where `left` is
+// `? x depth` with rows `left_stride` elements apart (a slice of the columns of a wider matrix), `right` is
+// `depth x cols` and `out` is `? x cols`, all row-major.
+//
+// Products are accumulated in `Acc`, so `Acc` wider than `T` avoids overflow and rounding without converting the
+// operands up front. In that case each tile of `right` is widened once into a tile-sized buffer and reused for
+// every row, instead of being converted again for each row of `left`.
+template <typename Acc, typename T>
+constexpr void gemm_rows_strided(
+    const T* left,
+    size_t left_stride,
+    const T* right,
+    Acc* out,
+    size_t begin,
+    size_t end,
+    size_t depth,
+    size_t cols,
+    const GemmTiling& tiling = {}
+) {
+  constexpr bool WIDENING = !std::is_same_v<Acc, T>;
+  Acc* packed = WIDENING ? new Acc[std::min(depth, tiling.depth_tile) * std::min(cols, tiling.col_tile)] : nullptr;
+
+  for (size_t col_begin = 0; col_begin < cols; col_begin += tiling.col_tile) {
+    size_t width = std::min(cols - col_begin, tiling.col_tile);
+    for (size_t depth_begin = 0; depth_begin < depth; depth_begin += tiling.depth_tile) {
+      size_t tile_depth = std::min(depth - depth_begin, tiling.depth_tile);
+      const T* left_tile = left + depth_begin;
+      const T* right_tile = right + depth_begin * cols + col_begin;
+      Acc* out_tile = out + col_begin;
+      if constexpr (WIDENING) {
+        for (size_t k = 0; k < tile_depth; ++k) {
+          std::transform(right_tile + k * cols, right_tile + k * cols + width, packed + k * width, [](const T& x) {
+            return static_cast<Acc>(x);
+          });
+        }
+        gemm_tile(left_tile, left_stride, packed, width, out_tile, cols, begin, end, tile_depth, width);
+      } else {
+        gemm_tile(left_tile, left_stride, right_tile, cols, out_tile, cols, begin, end, tile_depth, width);
+      }
+    }
+  }
+
+  delete[] packed;
+}
+
+// `gemm_rows_strided` for a whole `? x depth` left operand
+template <typename Acc, typename T>
+constexpr void gemm_rows(
+    const T* left,
+    const T* right,
+    Acc* out,
+    size_t begin,
+    size_t end,
+    size_t depth,
+    size_t cols,
+    const GemmTiling& tiling = {}
+) {
+  gemm_rows_strided(left, depth, right, out, begin, end, depth, cols, tiling);
+}
+
+} // namespace ct::detail
@@ -0,0 +1,468 @@
+#pragma once
+
+#include "checked.h"
+#include "kernels.h"
+#include "parallel.h"
+#include "reduction.h"
+#include "tuning.h"
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+
+namespace ct {
+
+namespace detail {
+
+template <typename T>
+class ColIterator;
+
+template <typename T>
+class RowView;
+
+template <typename T>
+class ColView;
+
+template <typename T, typename Layout, bool ROW>
+class IndexIterator;
+
+template <typename T, typename Layout, bool ROW>
+class IndexView;
+
+} // namespace detail
+
+// Storage layouts of `Matrix`. A layout maps `(row, col)` to a position in the buffer and provides the iterator and
+// view types of rows and columns, the contiguous one where the layout allows it.
+//
+// Whatever the layout, the buffer is also treated as `lines(rows, cols)` contiguous chunks of equal size: that is
+// the unit in which elementwise operations are split between threads and in which NUMA pages are placed.
+
+// Rows are contiguous, columns are walked with a stride of `cols`. The default.
+struct RowMajor {
+  template <typename T>
+  using RowIterator = detail::ContiguousIterator<T>;
+  template <typename T>
+  using ColIterator = detail::ColIterator<T>;
+  template <typename T>
+  using RowView = detail::RowView<T>;
+  template <typename T>
+  using ColView = detail::ColView<T>;
+
+  static constexpr size_t index(size_t row, size_t col, size_t, size_t cols) {
+    return row * cols + col;
+  }
+
+  static constexpr size_t lines(size_t rows, size_t) {
+    return rows;
+  }
+
+  template <typename T>
+  static constexpr RowIterator<T> row_begin(T* data, size_t row, size_t, size_t cols) {
+    return detail::contiguous_iterator(data + row * cols, 0, cols);
+  }
+
+  template <typename T>
+  static constexpr RowIterator<T> row_end(T* data, size_t row, size_t, size_t cols) {
+    return detail::contiguous_iterator(data + row * cols, cols, cols);
+  }
+
+  template <typename T>
+  static constexpr ColIterator<T> col_begin(T* data, size_t col, size_t rows, size_t cols) {
+    return {data + col, 0, static_cast<std::ptrdiff_t>(cols), rows};
+  }
+
+  template <typename T>
+  static constexpr ColIterator<T> col_end(T* data, size_t col, size_t rows, size_t cols) {
+    return {data + col, static_cast<std::ptrdiff_t>(rows), static_cast<std::ptrdiff_t>(cols), rows};
+  }
+
+  template <typename T>
+  static constexpr RowView<T> row(T* data, size_t row, size_t, size_t cols) {
+    return {data + row * cols, cols};
+  }
+
+  template <typename T>
+  static constexpr ColView<T> col(T* data, size_t col, size_t rows, size_t cols) {
+    return {data + col, rows, static_cast<std::ptrdiff_t>(cols)};
+  }
+
+  // `out += left * right` for `rows x depth` times `depth x cols`, blocked as tuned for the shape
+  template <typename T>
+  static constexpr void multiply(const T* left, const T* right, T* out, size_t rows, size_t depth, size_t cols) {
+    if consteval {
+      detail::gemm_rows(left, right, out, 0, rows, depth, cols);
+    } else {
+      detail::GemmTiling tiling = KernelTuner::instance().tiling(left, right, rows, depth, cols);
+      detail::gemm_parallel(left, right, out, rows, depth, cols, tiling);
+    }
+  }
+};
+
+// Columns are contiguous, rows are walked with a stride of `rows`
+struct ColMajor {
+  template <typename T>
+  using RowIterator = detail::ColIterator<T>;
+  template <typename T>
+  using ColIterator = detail::ContiguousIterator<T>;
+  template <typename T>
+  using RowView = detail::ColView<T>;
+  template <typename T>
+  using ColView = detail::RowView<T>;
+
+  static constexpr size_t index(size_t row, size_t col, size_t rows, size_t) {
+    return col * rows + row;
+  }
+
+  static constexpr size_t lines(size_t, size_t cols) {
+    return cols;
+  }
+
+  template <typename T>
+  static constexpr RowIterator<T> row_begin(T* data, size_t row, size_t rows, size_t cols) {
+    return {data + row, 0, static_cast<std::ptrdiff_t>(rows), cols};
+  }
+
+  template <typename T>
+  static constexpr RowIterator<T> row_end(T* data, size_t row, size_t rows, size_t cols) {
+    return {data + row, static_cast<std::ptrdiff_t>(cols), static_cast<std::ptrdiff_t>(rows), cols};
+  }
+
+  template <typename T>
+  static constexpr ColIterator<T> col_begin(T* data, size_t col, size_t rows, size_t) {
+    return detail::contiguous_iterator(data + col * rows, 0, rows);
+  }
+
+  template <typename T>
+  static constexpr ColIterator<T> col_end(T* data, size_t col, size_t rows, size_t) {
+    return detail::contiguous_iterator(data + col * rows, rows, rows);
+  }
+
+  template <typename T>
+  static constexpr RowView<T> row(T* data, size_t row, size_t rows, size_t cols) {
+    return {data + row, cols, static_cast<std::ptrdiff_t>(rows)};
+  }
+
+  template <typename T>
+  static constexpr ColView<T> col(T* data, size_t col, size_t rows, size_t) {
+    return {data + col * rows, rows};
+  }
+
+  // A column-major buffer is the row-major buffer of the transpose, and `(left * right)^T = right^T * left^T`
+  template <typename T>
+  static constexpr void multiply(const T* left, const T* right, T* out, size_t rows, size_t depth, size_t cols) {
+    if consteval {
+      detail::gemm_rows(right, left, out, 0, cols, depth, rows);
+    } else {
+      detail::GemmTiling tiling = KernelTuner::instance().tiling(right, left, cols, depth, rows);
+      detail::gemm_parallel(right, left, out, cols, depth, rows, tiling);
+    }
+  }
+};
+
+// The matrix is cut into `TILE x TILE` tiles (smaller at the bottom and right edges), each stored contiguously in
+// row-major order; tiles follow each other in row-major order too. A product then works tile by tile on contiguous
+// operands with no packing, and neither rows nor columns stride across more than one tile at a time.
+template <size_t TILE>
+struct Tiled {
+  static_assert(TILE > 0);
+
+  template <typename T>
+  using RowIterator = detail::IndexIterator<T, Tiled, true>;
+  template <typename T>
+  using ColIterator = detail::IndexIterator<T, Tiled, false>;
+  template <typename T>
+  using RowView = detail::IndexView<T, Tiled, true>;
+  template <typename T>
+  using ColView = detail::IndexView<T, Tiled, false>;
+
+  static constexpr size_t index(size_t row, size_t col, size_t rows, size_t cols) {
+    size_t tile_row = row / TILE * TILE;
+    size_t tile_col = col / TILE * TILE;
+    size_t height = std::min(TILE, rows - tile_row);
+    size_t width = std::min(TILE, cols - tile_col);
+    return tile_row * cols + tile_col * height + (row - tile_row) * width + (col - tile_col);
+  }
+
+  static constexpr size_t lines(size_t rows, size_t) {
+    return rows;
+  }
+
+  template <typename T>
+  static constexpr RowIterator<T> row_begin(T* data, size_t row, size_t rows, size_t cols) {
+    return {data, row, rows, cols, 0};
+  }
+
+  template <typename T>
+  static constexpr RowIterator<T> row_end(T* data, size_t row, size_t rows, size_t cols) {
+    return {data, row, rows, cols, static_cast<std::ptrdiff_t>(cols)};
+  }
+
+  template <typename T>
+  static constexpr ColIterator<T> col_begin(T* data, size_t col, size_t rows, size_t cols) {
+    return {data, col, rows, cols, 0};
+  }
+
+  template <typename T>
+  static constexpr ColIterator<T> col_end(T* data, size_t col, size_t rows, size_t cols) {
+    return {data, col, rows, cols, static_cast<std::ptrdiff_t>(rows)};
+  }
+
+  template <typename T>
+  static constexpr RowView<T> row(T* data, size_t row, size_t rows, size_t cols) {
+    return {data, row, rows, cols};
+  }
+
+  template <typename T>
+  static constexpr ColView<T> col(T* data, size_t col, size_t rows, size_t cols) {
+    return {data, col, rows, cols};
+  }
+
+  // Tile `(i, k)` of `left` times tile `(k, j)` of `right` accumulated into tile `(i, j)` of `out`, in parallel
+  // over bands of tile rows
+  template <typename T>
+  static constexpr void multiply(const T* left, const T* right, T* out, size_t rows, size_t depth, size_t cols) {
+    size_t bands = (rows + TILE - 1) / TILE;
+    detail::parallel_rows(bands, TILE * depth * cols, [&](size_t begin, size_t end) {
+      for (size_t band = begin; band < end; ++band) {
+        size_t i = band * TILE;
+        size_t height = std::min(TILE, rows - i);
+        for (size_t j = 0; j < cols; j += TILE) {
+          size_t width = std::min(TILE, cols - j);
+          T* out_tile = out + i * cols + j * height;
+          for (size_t k = 0; k < depth; k += TILE) {
+            size_t tile_depth = std::min(TILE, depth - k);
+            const T* left_tile = left + i * depth + k * height;
+            const T* right_tile = right + k * cols + j * tile_depth;
+            detail::gemm_tile(left_tile, tile_depth, right_tile, width, out_tile, width, 0, height, tile_depth, width);
+          }
+        }
+      }
+    });
+  }
+};
+
+namespace detail {
+
+// Random access iterator over a row (`ROW`) or a column of a matrix buffer in `Layout`, locating every element
+// through `Layout::index`
+template <typename T, typename Layout, bool ROW>
+class IndexIterator {
+public:
+  using value_type = std::remove_const_t<T>;
+  using reference = T&;
+  using pointer = T*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+public:
+  IndexIterator() = default;
+
+  template <typename U>
+    requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+  constexpr IndexIterator(const IndexIterator<U, Layout, ROW>& other)
+      : data_(other.data_)
+      , line_(other.line_)
+      , rows_(other.rows_)
+      , cols_(other.cols_)
+      , index_(other.index_) {}
+
+  constexpr reference operator*() const {
+    return *address(index_);
+  }
+
+  constexpr pointer operator->() const {
+    return address(index_);
+  }
+
+  constexpr reference operator[](difference_type n) const {
+    return *address(index_ + n);
+  }
+
+  constexpr IndexIterator& operator++() {
+    bound().check_position(index_ + 1);
+    ++index_;
+    return *this;
+  }
+
+  constexpr IndexIterator operator++(int) {
+    IndexIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  constexpr IndexIterator& operator--() {
+    bound().check_position(index_ - 1);
+    --index_;
+    return *this;
+  }
+
+  constexpr IndexIterator operator--(int) {
+    IndexIterator tmp = *this;
+    --*this;
+    return tmp;
+  }
+
+  constexpr IndexIterator& operator+=(difference_type n) {
+    bound().check_position(index_ + n);
+    index_ += n;
+    return *this;
+  }
+
+  constexpr IndexIterator& operator-=(difference_type n) {
+    bound().check_position(index_ - n);
+    index_ -= n;
+    return *this;
+  }
+
+  friend constexpr IndexIterator operator+(IndexIterator it, difference_type n) {
+    return it += n;
+  }
+
+  friend constexpr IndexIterator operator+(difference_type n, IndexIterator it) {
+    return it += n;
+  }
+
+  friend constexpr IndexIterator operator-(IndexIterator it, difference_type n) {
+    return it -= n;
+  }
+
+  friend constexpr difference_type operator-(const IndexIterator& left, const IndexIterator& right) {
+    return left.index_ - right.index_;
+  }
+
+  friend constexpr bool operator==(const IndexIterator& left, const IndexIterator& right) {
+    return left.data_ == right.data_ && left.line_ == right.line_ && left.index_ == right.index_;
+  }
+
+  friend constexpr auto operator<=>(const IndexIterator& left, const IndexIterator& right) {
+    return left.index_ <=> right.index_;
+  }
+
+private:
+  constexpr IndexIterator(T* data, size_t line, size_t rows, size_t cols, difference_type index)
+      : data_(data)
+      , line_(line)
+      , rows_(rows)
+      , cols_(cols)
+      , index_(index) {}
+
+  constexpr LineBound bound() const {
+    return LineBound(ROW ? cols_ : rows_);
+  }
+
+  constexpr T* address(difference_type index) const {
+    bound().check_index(index);
+    size_t i = static_cast<size_t>(index);
+    return data_ + (ROW ? Layout::index(line_, i, rows_, cols_) : Layout::index(i, line_, rows_, cols_));
+  }
+
+  template <typename U, typename L, bool R>
+  friend class IndexIterator;
+
+  template <typename U, typename L, bool R>
+  friend class IndexView;
+
+  template <size_t TILE>
+  friend struct ct::Tiled;
+
+private:
+  T* data_;
+  size_t line_;
+  size_t rows_;
+  size_t cols_;
+  difference_type index_;
+};
+
+// View of a row (`ROW`) or a column of a matrix buffer in `Layout`
+template <typename T, typename Layout, bool ROW>
+class IndexView : public std::ranges::view_interface<IndexView<T, Layout, ROW>> {
+public:
+  using Iterator = IndexIterator<T, Layout, ROW>;
+
+public:
+  IndexView() = default;
+
+  template <typename U>
+    requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+  constexpr IndexView(const IndexView<U, Layout, ROW>& other)
+      : data_(other.data_)
+      , line_(other.line_)
+      , rows_(other.rows_)
+      , cols_(other.cols_) {}
+
+  constexpr Iterator begin() const {
+    return {data_, line_, rows_, cols_, 0};
+  }
+
+  constexpr Iterator end() const {
+    return {data_, line_, rows_, cols_, static_cast<std::ptrdiff_t>(size())};
+  }
+
+  constexpr size_t size() const {
+    return ROW ? cols_ : rows_;
+  }
+
+  constexpr const IndexView& operator*=(const std::remove_const_t<T>& factor) const
+    requires (!std::is_const_v<T>)
+  {
+    std::for_each(begin(), end(), [&factor](T& x) { x *= factor; });
+    return *this;
+  }
+
+private:
+  constexpr IndexView(T* data, size_t line, size_t rows, size_t cols)
+      : data_(data)
+      , line_(line)
+      , rows_(rows)
+      , cols_(cols) {}
+
+  template <typename U, typename L, bool R>
+  friend class IndexView;
+
+  template <size_t TILE>
+  friend struct ct::Tiled;
+
+private:
+  T* data_ = nullptr;
+  size_t line_ = 0;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+};
+
+// Side of the square blocks in which `convert_layout` moves elements
+inline constexpr size_t CONVERSION_BLOCK = 64;
+
+// Copies a `rows x cols` matrix from a buffer in layout `From` to a buffer in layout `To`. Elements are moved in
+// square blocks, so both the reads and the writes of a block stay within a few cache lines per row or column
+// whatever the pair of layouts.
+template <typename From, typename To, typename T>
+constexpr void convert_layout(const T* from, T* to, size_t rows, size_t cols) {
+  if constexpr (std::is_same_v<From, To>) {
+    parallel_rows(rows, cols, [&](size_t begin, size_t end) {
+      std::copy(from + begin * cols, from + end * cols, to + begin * cols);
+    });
+  } else {
+    size_t blocks = (rows + CONVERSION_BLOCK - 1) / CONVERSION_BLOCK;
+    parallel_rows(blocks, CONVERSION_BLOCK * cols, [&](size_t begin, size_t end) {
+      for (size_t row_block = begin * CONVERSION_BLOCK; row_block < std::min(rows, end * CONVERSION_BLOCK);
+           row_block += CONVERSION_BLOCK) {
+        size_t row_end = std::min(rows, row_block + CONVERSION_BLOCK);
+        for (size_t col_block = 0; col_block < cols; col_block += CONVERSION_BLOCK) {
+          size_t col_end = std::min(cols, col_block + CONVERSION_BLOCK);
+          for (size_t i = row_block; i < row_end; ++i) {
+            for (size_t j = col_block; j < col_end; ++j) {
+              to[To::index(i, j, rows, cols)] = from[From::index(i, j, rows, cols)];
+            }
+          }
+        }
+      }
+    });
+  }
+}
+
+} // namespace detail
+
+} // namespace ct
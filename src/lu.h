@@ -0,0 +1,301 @@
+#pragma once
+
+#include "buffer.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "multiply.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace ct {
+
+// Reported by the LU routines when a pivot is exactly zero
+class SingularMatrix : public std::exception {
+public:
+  const char* what() const noexcept override {
+    return "ct::SingularMatrix";
+  }
+};
+
+// Row interchanges of an LU factorization: at step `k`, row `k` was swapped with row `(*this)[k]` (`>= k`)
+class LuPivots {
+public:
+  LuPivots() = default;
+
+  explicit LuPivots(size_t size)
+      : pivots_(size) {}
+
+  size_t size() const {
+    return pivots_.size();
+  }
+
+  size_t operator[](size_t k) const {
+    return pivots_[k];
+  }
+
+  size_t& operator[](size_t k) {
+    return pivots_[k];
+  }
+
+  // `+1` or `-1`: the sign of the permutation, i.e. the factor relating the determinant to the product of the
+  // diagonal of `U`
+  int sign() const {
+    int sign = 1;
+    for (size_t k = 0; k < size(); ++k) {
+      if (pivots_[k] != k) {
+        sign = -sign;
+      }
+    }
+    return sign;
+  }
+
+private:
+  detail::PackedBuffer<size_t> pivots_;
+};
+
+namespace detail {
+
+// Columns factored at a time by `lu`. Each step does `O(n * LU_BLOCK^2)` work in the panel and hands the rest of
+// the `O(n^2 * LU_BLOCK)` to the product kernel.
+inline constexpr size_t LU_BLOCK = 64;
+
+template <typename T>
+void swap_rows(Matrix<T>& a, size_t first, size_t second) {
+  if (first != second) {
+    std::swap_ranges(a.row_begin(first), a.row_end(first), a.row_begin(second));
+  }
+}
+
+// Unblocked LU with partial pivoting of the panel `a[k0:, k0:k0 + width]`. Row interchanges are applied to whole
+// rows, so they also reach the factored columns on the left and the trailing columns on the right.
+template <typename T>
+void factor_panel(Matrix<T>& a, LuPivots& pivots, size_t k0, size_t width) {
+  size_t n = a.rows();
+  T* data = a.data();
+  for (size_t j = k0; j < k0 + width; ++j) {
+    size_t pivot = j;
+    for (size_t i = j + 1; i < n; ++i) {
+      if (std::abs(data[i * n + j]) > std::abs(data[pivot * n + j])) {
+        pivot = i;
+      }
+    }
+    pivots[j] = pivot;
+    if (data[pivot * n + j] == T(0)) {
+      throw SingularMatrix();
+    }
+    swap_rows(a, j, pivot);
+
+    T inverse = T(1) / data[j * n + j];
+    const T* pivot_row = data + j * n;
+    for (size_t i = j + 1; i < n; ++i) {
+      T* row = data + i * n;
+      T l = row[j] *= inverse;
+      for (size_t c = j + 1; c < k0 + width; ++c) {
+        row[c] -= l * pivot_row[c];
+      }
+    }
+  }
+}
+
+// `a[k0:k0 + width, k0 + width:] = L11^-1 * a[k0:k0 + width, k0 + width:]`, where `L11` is the unit lower
+// triangle of the diagonal block, in parallel over column chunks
+template <typename T>
+void solve_panel_rows(Matrix<T>& a, size_t k0, size_t width) {
+  size_t n = a.rows();
+  size_t first_col = k0 + width;
+  T* data = a.data();
+  parallel_rows(n - first_col, width * width, [&](size_t begin, size_t end) {
+    for (size_t i = k0 + 1; i < k0 + width; ++i) {
+      T* row = data + i * n + first_col;
+      for (size_t m = k0; m < i; ++m) {
+        T l = data[i * n + m];
+        const T* source = data + m * n + first_col;
+        for (size_t c = begin; c < end; ++c) {
+          row[c] -= l * source[c];
+        }
+      }
+    }
+  });
+}
+
+// `out -= left * right` for a `rows x depth` left operand and a `depth x width` right one, all row-major with the
+// given row strides. The left operand is negated into a packed buffer once, so the product kernel accumulates as
+// usual.
+template <typename T>
+void subtract_product(
+    const T* left,
+    size_t left_stride,
+    const T* right,
+    size_t right_stride,
+    T* out,
+    size_t out_stride,
+    size_t rows,
+    size_t depth,
+    size_t width,
+    const GemmTiling& tiling = {}
+) {
+  if (rows == 0 || depth == 0) {
+    return;
+  }
+  T* packed = new T[rows * depth];
+  for (size_t i = 0; i < rows; ++i) {
+    std::transform(left + i * left_stride, left + i * left_stride + depth, packed + i * depth, [](const T& x) {
+      return -x;
+    });
+  }
+  for (size_t col_begin = 0; col_begin < width; col_begin += tiling.col_tile) {
+    size_t tile_width = std::min(tiling.col_tile, width - col_begin);
+    for (size_t depth_begin = 0; depth_begin < depth; depth_begin += tiling.depth_tile) {
+      gemm_tile(
+          packed + depth_begin,
+          depth,
+          right + depth_begin * right_stride + col_begin,
+          right_stride,
+          out + col_begin,
+          out_stride,
+          0,
+          rows,
+          std::min(tiling.depth_tile, depth - depth_begin),
+          tile_width
+      );
+    }
+  }
+  delete[] packed;
+}
+
+// `a[k0 + width:, k0 + width:] -= a[k0 + width:, k0:k0 + width] * a[k0:k0 + width, k0 + width:]` on the product
+// kernel, in parallel over row blocks
+template <typename T>
+void update_trailing(Matrix<T>& a, size_t k0, size_t width) {
+  size_t n = a.rows();
+  size_t first = k0 + width;
+  size_t rest = n - first;
+  T* data = a.data();
+  parallel_rows(rest, width * rest, [&](size_t begin, size_t end) {
+    T* block = data + (first + begin) * n;
+    subtract_product(block + k0, n, data + k0 * n + first, n, block + first, n, end - begin, width, rest);
+  });
+}
+
+// Solves `L * U * X = P * B` in place for the factors computed by `lu`, in parallel over column chunks of `x`.
+// Both substitutions go block by block: the contribution of the rows already solved is subtracted from a block
+// by the product kernel, and only the small triangle inside the block is solved element by element.
+template <typename T>
+void lu_substitute(const Matrix<T>& factors, const LuPivots& pivots, Matrix<T>& x) {
+  size_t n = factors.rows();
+  size_t cols = x.cols();
+  for (size_t k = 0; k < n; ++k) {
+    swap_rows(x, k, pivots[k]);
+  }
+  const T* lu = factors.data();
+  T* data = x.data();
+  parallel_rows(cols, n * n, [&](size_t begin, size_t end) {
+    size_t width = end - begin;
+    T* out = data + begin;
+
+    for (size_t k0 = 0; k0 < n; k0 += LU_BLOCK) {
+      size_t k1 = std::min(n, k0 + LU_BLOCK);
+      subtract_product(lu + k0 * n, n, out, cols, out + k0 * cols, cols, k1 - k0, k0, width);
+      for (size_t i = k0 + 1; i < k1; ++i) {
+        for (size_t m = k0; m < i; ++m) {
+          T l = lu[i * n + m];
+          for (size_t c = 0; c < width; ++c) {
+            out[i * cols + c] -= l * out[m * cols + c];
+          }
+        }
+      }
+    }
+
+    for (size_t k1 = n; k1 > 0;) {
+      size_t k0 = k1 > LU_BLOCK ? k1 - LU_BLOCK : 0;
+      subtract_product(lu + k0 * n + k1, n, out + k1 * cols, cols, out + k0 * cols, cols, k1 - k0, n - k1, width);
+      for (size_t i = k1; i-- > k0;) {
+        for (size_t m = i + 1; m < k1; ++m) {
+          T u = lu[i * n + m];
+          for (size_t c = 0; c < width; ++c) {
+            out[i * cols + c] -= u * out[m * cols + c];
+          }
+        }
+        T inverse = T(1) / lu[i * n + i];
+        for (size_t c = 0; c < width; ++c) {
+          out[i * cols + c] *= inverse;
+        }
+      }
+      k1 = k0;
+    }
+  });
+}
+
+} // namespace detail
+
+// Factors the square matrix `a` in place as `P * a = L * U` with partial pivoting: `U` ends up on and above the
+// diagonal, the unit lower triangular `L` below it. Returns the row interchanges making up `P`.
+//
+// Right-looking and blocked: a panel of `LU_BLOCK` columns is factored, the matching block row of `U` is solved
+// for, and the trailing submatrix is updated by the product kernel, in parallel over row blocks.
+// Throws `std::invalid_argument` if `a` is not square, and `SingularMatrix` if a pivot is exactly zero; `a` is then
+// left partially factored.
+template <std::floating_point T>
+LuPivots lu(Matrix<T>& a) {
+  if (a.rows() != a.cols()) {
+    throw std::invalid_argument("ct::lu: the matrix is not square");
+  }
+  size_t n = a.rows();
+  LuPivots pivots(n);
+  for (size_t k0 = 0; k0 < n; k0 += detail::LU_BLOCK) {
+    size_t width = std::min(detail::LU_BLOCK, n - k0);
+    detail::factor_panel(a, pivots, k0, width);
+    if (k0 + width < n) {
+      detail::solve_panel_rows(a, k0, width);
+      detail::update_trailing(a, k0, width);
+    }
+  }
+  return pivots;
+}
+
+// `X` such that `a * X = b`, for `a` factored by `lu`. Throws `std::invalid_argument` if the factors are not square,
+// the pivots are not theirs, or `b` does not have as many rows as `a`.
+template <std::floating_point T>
+Matrix<T> lu_solve(const Matrix<T>& factors, const LuPivots& pivots, Matrix<T> b) {
+  if (factors.rows() != factors.cols() || pivots.size() != factors.rows()) {
+    throw std::invalid_argument("ct::lu_solve: the factors are not those of a square matrix");
+  }
+  if (!b.empty() && b.rows() != factors.rows()) {
+    throw std::invalid_argument("ct::lu_solve: the right-hand side does not have as many rows as the matrix");
+  }
+  if (!b.empty()) {
+    detail::lu_substitute(factors, pivots, b);
+  }
+  return b;
+}
+
+// `X` such that `a * X = b` for a square nonsingular `a`. Throws `std::invalid_argument` if `a` is not square or
+// `b` does not have as many rows, and `SingularMatrix` if `a` is singular.
+template <std::floating_point T>
+Matrix<T> solve(Matrix<T> a, Matrix<T> b) {
+  if (!b.empty() && b.rows() != a.rows()) {
+    throw std::invalid_argument("ct::solve: the right-hand side does not have as many rows as the matrix");
+  }
+  LuPivots pivots = lu(a);
+  return lu_solve(a, pivots, std::move(b));
+}
+
+// Inverse of a square nonsingular `a`. Throws `std::invalid_argument` if `a` is not square, and `SingularMatrix` if
+// it is singular.
+template <std::floating_point T>
+Matrix<T> inverse(Matrix<T> a) {
+  if (a.rows() != a.cols()) {
+    throw std::invalid_argument("ct::inverse: the matrix is not square");
+  }
+  size_t n = a.rows();
+  return solve(std::move(a), identity<T>(n));
+}
+
+} // namespace ct
@@ -1,10 +1,316 @@
 #pragma once
 
+#include "allocation.h"
+#include "buffer.h"
+#include "checked.h"
+#include "copy.h"
+#include "footprint.h"
+#include "kernels.h"
+#include "layout.h"
+#include "parallel.h"
+#include "streaming.h"
+
+#include <algorithm>
+#include <atomic>
+#include <compare>
+#include <concepts>
 #include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
 
 namespace ct {
 
+template <typename T, typename Layout = RowMajor>
+class Matrix;
+
+namespace detail {
+
+// `rows x cols` matrix with default-initialized elements, for callers that overwrite all of them
+template <typename T, typename Layout = RowMajor>
+Matrix<T, Layout> uninitialized_matrix(size_t rows, size_t cols);
+
+template <typename T>
+class ColIterator {
+public:
+  using value_type = std::remove_const_t<T>;
+  using reference = T&;
+  using pointer = T*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+public:
+  ColIterator() = default;
+
+  template <typename U>
+    requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+  constexpr ColIterator(const ColIterator<U>& other)
+      : base_(other.base_)
+      , index_(other.index_)
+      , stride_(other.stride_)
+      , bound_(other.bound_) {}
+
+  constexpr reference operator*() const {
+    bound_.check_index(index_);
+    return base_[index_ * stride_];
+  }
+
+  constexpr pointer operator->() const {
+    bound_.check_index(index_);
+    return base_ + index_ * stride_;
+  }
+
+  constexpr reference operator[](difference_type n) const {
+    bound_.check_index(index_ + n);
+    return base_[(index_ + n) * stride_];
+  }
+
+  constexpr ColIterator& operator++() {
+    bound_.check_position(index_ + 1);
+    ++index_;
+    return *this;
+  }
+
+  constexpr ColIterator operator++(int) {
+    ColIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  constexpr ColIterator& operator--() {
+    bound_.check_position(index_ - 1);
+    --index_;
+    return *this;
+  }
+
+  constexpr ColIterator operator--(int) {
+    ColIterator tmp = *this;
+    --*this;
+    return tmp;
+  }
+
+  constexpr ColIterator& operator+=(difference_type n) {
+    bound_.check_position(index_ + n);
+    index_ += n;
+    return *this;
+  }
+
+  constexpr ColIterator& operator-=(difference_type n) {
+    bound_.check_position(index_ - n);
+    index_ -= n;
+    return *this;
+  }
+
+  friend constexpr ColIterator operator+(ColIterator it, difference_type n) {
+    return it += n;
+  }
+
+  friend constexpr ColIterator operator+(difference_type n, ColIterator it) {
+    return it += n;
+  }
+
+  friend constexpr ColIterator operator-(ColIterator it, difference_type n) {
+    return it -= n;
+  }
+
+  friend constexpr difference_type operator-(const ColIterator& left, const ColIterator& right) {
+    return left.index_ - right.index_;
+  }
+
+  friend constexpr bool operator==(const ColIterator& left, const ColIterator& right) {
+    return left.base_ == right.base_ && left.index_ == right.index_;
+  }
+
+  friend constexpr auto operator<=>(const ColIterator& left, const ColIterator& right) {
+    return left.index_ <=> right.index_;
+  }
+
+private:
+  constexpr ColIterator(T* base, difference_type index, difference_type stride, size_t size)
+      : base_(base)
+      , index_(index)
+      , stride_(stride)
+      , bound_(size) {}
+
+  template <typename U>
+  friend class ColIterator;
+
+  template <typename U>
+  friend class ColView;
+
+  template <typename U, typename L>
+  friend class ct::Matrix;
+
+  friend struct ct::RowMajor;
+  friend struct ct::ColMajor;
+
+private:
+  // `base_` points to the first element of the column; the current element is `base_[index_ * stride_]`.
+  // Keeping the row index instead of a raw pointer means `col_end` never forms an out-of-bounds pointer.
+  T* base_;
+  difference_type index_;
+  difference_type stride_;
+  [[no_unique_address]] LineBound bound_;
+};
+
 template <typename T>
+class RowView : public std::ranges::view_interface<RowView<T>> {
+public:
+  using Iterator = ContiguousIterator<T>;
+
+public:
+  RowView() = default;
+
+  template <typename U>
+    requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+  constexpr RowView(const RowView<U>& other)
+      : data_(other.data_)
+      , size_(other.size_) {}
+
+  constexpr Iterator begin() const {
+    return contiguous_iterator(data_, 0, size_);
+  }
+
+  constexpr Iterator end() const {
+    return contiguous_iterator(data_, size_, size_);
+  }
+
+  constexpr size_t size() const {
+    return size_;
+  }
+
+  constexpr T& operator[](size_t index) const {
+    check_index(index, size_);
+    return data_[index];
+  }
+
+  constexpr const RowView& operator*=(const std::remove_const_t<T>& factor) const
+    requires (!std::is_const_v<T>)
+  {
+    std::for_each(begin(), end(), [&factor](T& x) { x *= factor; });
+    return *this;
+  }
+
+private:
+  constexpr RowView(T* data, size_t size)
+      : data_(data)
+      , size_(size) {}
+
+  template <typename U>
+  friend class RowView;
+
+  template <typename U, typename L>
+  friend class ct::Matrix;
+
+  friend struct ct::RowMajor;
+  friend struct ct::ColMajor;
+
+private:
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+template <typename T>
+class ColView : public std::ranges::view_interface<ColView<T>> {
+public:
+  using Iterator = ColIterator<T>;
+
+public:
+  ColView() = default;
+
+  template <typename U>
+    requires (std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+  constexpr ColView(const ColView<U>& other)
+      : base_(other.base_)
+      , size_(other.size_)
+      , stride_(other.stride_) {}
+
+  constexpr Iterator begin() const {
+    return {base_, 0, stride_, size_};
+  }
+
+  constexpr Iterator end() const {
+    return {base_, static_cast<std::ptrdiff_t>(size_), stride_, size_};
+  }
+
+  constexpr size_t size() const {
+    return size_;
+  }
+
+  constexpr const ColView& operator*=(const std::remove_const_t<T>& factor) const
+    requires (!std::is_const_v<T>)
+  {
+    for_each([&factor](T& x) { x *= factor; });
+    return *this;
+  }
+
+  // Calls `f(x)` on the elements in order, prefetching `column_prefetch_distance()` elements ahead
+  template <typename F>
+  constexpr void for_each(F f) const {
+    std::ptrdiff_t size = static_cast<std::ptrdiff_t>(size_);
+    std::ptrdiff_t i = 0;
+    if !consteval {
+      std::ptrdiff_t distance = static_cast<std::ptrdiff_t>(ct::column_prefetch_distance());
+      if (distance != 0) {
+        for (; i + distance < size; ++i) {
+          prefetch<!std::is_const_v<T>>(base_ + (i + distance) * stride_);
+          f(base_[i * stride_]);
+        }
+      }
+    }
+    for (; i < size; ++i) {
+      f(base_[i * stride_]);
+    }
+  }
+
+  // `init` folded with every element by `op`: the column sum by default
+  template <typename Acc = std::remove_const_t<T>, typename Op = std::plus<>>
+  constexpr Acc accumulate(Acc init = Acc(), Op op = {}) const {
+    for_each([&init, &op](const T& x) { init = op(std::move(init), x); });
+    return init;
+  }
+
+private:
+  constexpr ColView(T* base, size_t size, std::ptrdiff_t stride)
+      : base_(base)
+      , size_(size)
+      , stride_(stride) {}
+
+  template <typename U>
+  friend class ColView;
+
+  template <typename U, typename L>
+  friend class ct::Matrix;
+
+  friend struct ct::RowMajor;
+  friend struct ct::ColMajor;
+
+private:
+  T* base_ = nullptr;
+  size_t size_ = 0;
+  std::ptrdiff_t stride_ = 0;
+};
+
+// Lazy elementwise expression over matrices in `Layout`, such as `views::transform` (see "ranges.h"): it has
+// `rows()` and `cols()`, and `evaluator()` gives a function object computing the element at each index of a buffer
+// in `Layout` from the elements at the same index of its operands
+template <typename E, typename Layout>
+inline constexpr bool ELEMENTWISE_EXPRESSION = requires(const E& e) {
+  requires std::is_same_v<typename E::Layout, Layout>;
+  { e.rows() } -> std::same_as<size_t>;
+  { e.cols() } -> std::same_as<size_t>;
+  e.evaluator()(size_t{});
+};
+
+} // namespace detail
+
+// Dense `rows x cols` matrix. `Layout` (`RowMajor`, `ColMajor` or `Tiled<TILE>`, see "layout.h") decides how the
+// elements are laid out in the buffer: `Iterator` walks the buffer in storage order, and it and whichever of
+// `RowIterator` and `ColIterator` follows the storage order are plain pointers (bounded in checked-access mode).
+template <typename T, typename Layout>
 class Matrix {
 public:
   using ValueType = T;
@@ -15,92 +321,658 @@ public:
   using Pointer = T*;
   using ConstPointer = const T*;
 
-  using Iterator = void;
-  using ConstIterator = void;
+  using Iterator = detail::ContiguousIterator<T>;
+  using ConstIterator = detail::ContiguousIterator<const T>;
 
-  using RowIterator = void;
-  using ConstRowIterator = void;
+  using RowIterator = typename Layout::template RowIterator<T>;
+  using ConstRowIterator = typename Layout::template RowIterator<const T>;
 
-  using ColIterator = void;
-  using ConstColIterator = void;
+  using ColIterator = typename Layout::template ColIterator<T>;
+  using ConstColIterator = typename Layout::template ColIterator<const T>;
 
-  using RowView = void;
-  using ConstRowView = void;
+  using RowView = typename Layout::template RowView<T>;
+  using ConstRowView = typename Layout::template RowView<const T>;
 
-  using ColView = void;
-  using ConstColView = void;
+  using ColView = typename Layout::template ColView<T>;
+  using ConstColView = typename Layout::template ColView<const T>;
 
 public:
-  Matrix();
-
-  Matrix(size_t rows, size_t cols);
+  Matrix() = default;
 
-  template <size_t ROWS, size_t COLS>
-  Matrix(const T (&init)[ROWS][COLS]);
-
-  Matrix(const Matrix& other);
+  constexpr Matrix(size_t rows, size_t cols)
+      : Matrix(rows, cols, AllocationPolicy{}) {}
 
-  Matrix& operator=(const Matrix& other);
+  // Zero matrix whose buffer is allocated according to `policy`. With a NUMA placement the elements are
+  // initialized by the pool workers, each touching the row block it processes in parallel operations.
+  constexpr Matrix(size_t rows, size_t cols, const AllocationPolicy& policy)
+      : Matrix(rows, cols, policy, nullptr) {}
 
-  ~Matrix();
+  template <size_t ROWS, size_t COLS>
+  constexpr Matrix(const T (&init)[ROWS][COLS])
+      : data_(new T[ROWS * COLS])
+      , rows_(ROWS)
+      , cols_(COLS) {
+    if !consteval {
+      detail::record_buffer<T>(buffer_bytes());
+    }
+    // Constant evaluation does not allow walking the rows of `init` as one flat array
+    if !consteval {
+      if constexpr (std::is_same_v<Layout, RowMajor>) {
+        detail::copy_elements(&init[0][0], data_, ROWS * COLS);
+        return;
+      }
+    }
+    for (size_t i = 0; i < ROWS; ++i) {
+      for (size_t j = 0; j < COLS; ++j) {
+        data_[Layout::index(i, j, ROWS, COLS)] = init[i][j];
+      }
+    }
+  }
+
+  // Copy of `other` in this matrix's layout
+  template <typename From>
+    requires (!std::is_same_v<From, Layout>)
+  constexpr explicit Matrix(const Matrix<T, From>& other)
+      : Matrix(other.rows(), other.cols(), other.allocation_policy(), DefaultInit{}) {
+    if (!empty()) {
+      detail::convert_layout<From, Layout>(other.data(), data_, rows_, cols_);
+    }
+  }
+
+  // Evaluates a lazy elementwise expression in one parallel pass, without intermediate matrices
+  template <typename E>
+    requires detail::ELEMENTWISE_EXPRESSION<E, Layout>
+  constexpr explicit Matrix(const E& expression)
+      : Matrix(expression.rows(), expression.cols(), AllocationPolicy{}, DefaultInit{}) {
+    assign_elements(expression.evaluator());
+  }
+
+  constexpr Matrix(const Matrix& other)
+      : rows_(other.rows_)
+      , cols_(other.cols_)
+      , policy_(other.policy_) {
+    if (other.refs_ != nullptr) {
+      data_ = other.data_;
+      kind_ = other.kind_;
+      refs_ = other.refs_;
+      refs_->fetch_add(1, std::memory_order_relaxed);
+    } else if (!other.empty()) {
+      allocate(other.data_);
+    }
+  }
+
+  constexpr Matrix& operator=(const Matrix& other) {
+    if (this == &other || (data_ == other.data_ && refs_ == other.refs_)) {
+      return *this;
+    }
+    if (refs_ == nullptr && other.refs_ == nullptr && rows_ == other.rows_ && cols_ == other.cols_ &&
+        policy_ == other.policy_) {
+      detail::copy_elements(other.data_, data_, other.size());
+      dirty_.set_all();
+      return *this;
+    }
+    Matrix copy(other);
+    swap(copy);
+    dirty_.reset(rows_);
+    return *this;
+  }
+
+  // Moving leaves `other` empty
+  constexpr Matrix(Matrix&& other) noexcept
+      : dirty_(std::move(other.dirty_)) {
+    swap(other);
+  }
+
+  constexpr Matrix& operator=(Matrix&& other) noexcept {
+    if (this != &other) {
+      Matrix moved(std::move(other));
+      swap(moved);
+      dirty_.reset(rows_);
+    }
+    return *this;
+  }
+
+  // Assigns a lazy elementwise expression in one parallel pass, without intermediate matrices. The expression may
+  // read this matrix, e.g. `m = views::transform(m, f)`, since every element is computed only from the elements at
+  // the same position.
+  template <typename E>
+    requires detail::ELEMENTWISE_EXPRESSION<E, Layout>
+  constexpr Matrix& operator=(const E& expression) {
+    if (rows_ != expression.rows() || cols_ != expression.cols()) {
+      return *this = Matrix(expression);
+    }
+    prepare_write();
+    assign_elements(expression.evaluator());
+    return *this;
+  }
+
+  constexpr ~Matrix() {
+    release();
+  }
+
+  // Copy-on-write
+
+  // Switches the matrix into copy-on-write mode: copies made from it afterwards share its buffer, and the buffer is
+  // duplicated on the first mutable access through any of the owners. Copies inherit the mode of their source.
+  // Has no effect on an empty matrix.
+  //
+  // Concurrent copying and const access from several threads are safe. Pointers, references, iterators and views
+  // obtained through a mutable accessor keep pointing into the buffer they were obtained from, so they must not be
+  // used for writing after the matrix has been copied.
+  constexpr void enable_sharing() {
+    if (refs_ == nullptr && !empty()) {
+      refs_ = new std::atomic<size_t>(1);
+    }
+  }
+
+  constexpr bool sharing_enabled() const {
+    return refs_ != nullptr;
+  }
+
+  // Number of matrices referencing the same buffer (`1` for a matrix that is not in copy-on-write mode)
+  constexpr size_t use_count() const {
+    return refs_ == nullptr ? 1 : refs_->load(std::memory_order_relaxed);
+  }
+
+  // Dirty-row tracking
+
+  // Starts recording which rows are written, with every row clean. Mutable `operator()`, `row()`, `row_begin()` and
+  // `row_end()` mark their row; the other mutable accessors and the in-place operations can reach any element and
+  // mark every row, as does assigning a new value to the whole matrix. The record moves along with the matrix, but
+  // copies start untracked.
+  constexpr void track_dirty_rows() {
+    dirty_.track(rows_);
+  }
+
+  constexpr bool tracks_dirty_rows() const {
+    return dirty_.active();
+  }
+
+  // Whether `row` may have been written since tracking started or the record was last cleared; always `true` for
+  // a matrix that is not tracked
+  constexpr bool row_dirty(size_t row) const {
+    return dirty_.test(row);
+  }
+
+  // Number of rows for which `row_dirty` is `true`
+  constexpr size_t dirty_row_count() const {
+    return dirty_.active() ? dirty_.count() : rows_;
+  }
+
+  // Marks `row` as written, for writes through pointers or views obtained before the record was cleared
+  constexpr void mark_row_dirty(size_t row) {
+    dirty_.set(row);
+  }
+
+  constexpr void clear_dirty_rows() {
+    dirty_.clear();
+  }
+
+  // Allocation
+
+  constexpr const AllocationPolicy& allocation_policy() const {
+    return policy_;
+  }
 
   // Iterators
 
-  Iterator begin();
-  ConstIterator begin() const;
-  Iterator end();
-  ConstIterator end() const;
+  constexpr Iterator begin() {
+    prepare_write();
+    return detail::contiguous_iterator(data_, 0, size());
+  }
+
+  constexpr ConstIterator begin() const {
+    return detail::contiguous_iterator(const_data(), 0, size());
+  }
+
+  constexpr Iterator end() {
+    prepare_write();
+    return detail::contiguous_iterator(data_, size(), size());
+  }
+
+  constexpr ConstIterator end() const {
+    return detail::contiguous_iterator(const_data(), size(), size());
+  }
+
+  constexpr RowIterator row_begin(size_t row) {
+    detail::check_index(row, rows_);
+    prepare_write(row);
+    return Layout::row_begin(data_, row, rows_, cols_);
+  }
+
+  constexpr ConstRowIterator row_begin(size_t row) const {
+    detail::check_index(row, rows_);
+    return Layout::row_begin(const_data(), row, rows_, cols_);
+  }
+
+  constexpr RowIterator row_end(size_t row) {
+    detail::check_index(row, rows_);
+    prepare_write(row);
+    return Layout::row_end(data_, row, rows_, cols_);
+  }
+
+  constexpr ConstRowIterator row_end(size_t row) const {
+    detail::check_index(row, rows_);
+    return Layout::row_end(const_data(), row, rows_, cols_);
+  }
+
+  constexpr ColIterator col_begin(size_t col) {
+    detail::check_index(col, cols_);
+    prepare_write();
+    return Layout::col_begin(data_, col, rows_, cols_);
+  }
+
+  constexpr ConstColIterator col_begin(size_t col) const {
+    detail::check_index(col, cols_);
+    return Layout::col_begin(const_data(), col, rows_, cols_);
+  }
+
+  constexpr ColIterator col_end(size_t col) {
+    detail::check_index(col, cols_);
+    prepare_write();
+    return Layout::col_end(data_, col, rows_, cols_);
+  }
+
+  constexpr ConstColIterator col_end(size_t col) const {
+    detail::check_index(col, cols_);
+    return Layout::col_end(const_data(), col, rows_, cols_);
+  }
 
-  RowIterator row_begin(size_t row);
-  ConstRowIterator row_begin(size_t row) const;
-  RowIterator row_end(size_t row);
-  ConstRowIterator row_end(size_t row) const;
+  // Views
 
-  ColIterator col_begin(size_t col);
-  ConstColIterator col_begin(size_t col) const;
-  ColIterator col_end(size_t col);
-  ConstColIterator col_end(size_t col) const;
+  constexpr RowView row(size_t row) {
+    detail::check_index(row, rows_);
+    prepare_write(row);
+    return Layout::row(data_, row, rows_, cols_);
+  }
+
+  constexpr ConstRowView row(size_t row) const {
+    detail::check_index(row, rows_);
+    return Layout::row(const_data(), row, rows_, cols_);
+  }
+
+  constexpr ColView col(size_t col) {
+    detail::check_index(col, cols_);
+    prepare_write();
+    return Layout::col(data_, col, rows_, cols_);
+  }
+
+  constexpr ConstColView col(size_t col) const {
+    detail::check_index(col, cols_);
+    return Layout::col(const_data(), col, rows_, cols_);
+  }
+
+  // Calls `f(view)` with the `RowView` of every row, or `f(view, row)` if `f` takes the row index too, in parallel
+  // over blocks of rows. `f` may be called concurrently, and must write to no other row than its own.
+  template <typename F>
+  constexpr void apply_rows(const F& f) {
+    prepare_write();
+    for_each_row_view<RowView>(data_, f);
+  }
+
+  // Same with `ConstRowView`s, for row-wise reductions
+  template <typename F>
+  constexpr void apply_rows(const F& f) const {
+    for_each_row_view<ConstRowView>(const_data(), f);
+  }
 
-  // Views
+  // Size
 
-  RowView row(size_t row);
-  ConstRowView row(size_t row) const;
+  constexpr size_t rows() const {
+    return rows_;
+  }
 
-  ColView col(size_t col);
-  ConstColView col(size_t col) const;
+  constexpr size_t cols() const {
+    return cols_;
+  }
 
-  // Size
+  constexpr size_t size() const {
+    return rows_ * cols_;
+  }
 
-  size_t rows() const;
-  size_t cols() const;
-  size_t size() const;
-  bool empty() const;
+  constexpr bool empty() const {
+    return size() == 0;
+  }
 
   // Elements access
 
-  Reference operator()(size_t row, size_t col);
-  ConstReference operator()(size_t row, size_t col) const;
+  constexpr Reference operator()(size_t row, size_t col) {
+    detail::check_index(row, rows_);
+    detail::check_index(col, cols_);
+    prepare_write(row);
+    return data_[Layout::index(row, col, rows_, cols_)];
+  }
+
+  constexpr ConstReference operator()(size_t row, size_t col) const {
+    detail::check_index(row, rows_);
+    detail::check_index(col, cols_);
+    return data_[Layout::index(row, col, rows_, cols_)];
+  }
 
-  Pointer data();
-  ConstPointer data() const;
+  constexpr Pointer data() {
+    prepare_write();
+    return data_;
+  }
+
+  constexpr ConstPointer data() const {
+    return data_;
+  }
 
   // Comparison
 
-  friend bool operator==(const Matrix& left, const Matrix& right);
-  friend bool operator!=(const Matrix& left, const Matrix& right);
+  friend constexpr bool operator==(const Matrix& left, const Matrix& right) {
+    if (left.rows_ != right.rows_ || left.cols_ != right.cols_) {
+      return false;
+    }
+    return left.data_ == right.data_ || std::equal(left.data_, left.data_ + left.size(), right.data_);
+  }
 
-  // Arithmetic operations
+  friend constexpr bool operator!=(const Matrix& left, const Matrix& right) {
+    return !(left == right);
+  }
 
-  Matrix& operator+=(const Matrix& other);
-  Matrix& operator-=(const Matrix& other);
-  Matrix& operator*=(const Matrix& other);
-  Matrix& operator*=(ConstReference factor);
+  // Arithmetic operations
 
-  friend Matrix operator+(const Matrix& left, const Matrix& right);
-  friend Matrix operator-(const Matrix& left, const Matrix& right);
-  friend Matrix operator*(const Matrix& left, const Matrix& right);
-  friend Matrix operator*(const Matrix& left, ConstReference right);
-  friend Matrix operator*(ConstReference left, const Matrix& right);
+  constexpr Matrix& operator+=(const Matrix& other) {
+    prepare_write();
+    detail::parallel_rows(lines(), line_size(), [this, &other](size_t begin, size_t end) {
+      std::transform(line_ptr(begin), line_ptr(end), other.line_ptr(begin), line_ptr(begin), std::plus<>{});
+    });
+    return *this;
+  }
+
+  constexpr Matrix& operator-=(const Matrix& other) {
+    prepare_write();
+    detail::parallel_rows(lines(), line_size(), [this, &other](size_t begin, size_t end) {
+      std::transform(line_ptr(begin), line_ptr(end), other.line_ptr(begin), line_ptr(begin), std::minus<>{});
+    });
+    return *this;
+  }
+
+  constexpr Matrix& operator*=(const Matrix& other) {
+    Matrix product = *this * other;
+    if (sharing_enabled()) {
+      product.enable_sharing();
+    }
+    swap(product);
+    dirty_.reset(rows_);
+    return *this;
+  }
+
+  constexpr Matrix& operator*=(ConstReference factor) {
+    prepare_write();
+    detail::parallel_rows(lines(), line_size(), [this, &factor](size_t begin, size_t end) {
+      std::for_each(line_ptr(begin), line_ptr(end), [&factor](T& x) { x *= factor; });
+    });
+    return *this;
+  }
+
+  friend constexpr Matrix operator+(const Matrix& left, const Matrix& right) {
+    if constexpr (detail::STREAMABLE<T>) {
+      if (left.streams_results()) {
+        return generate_streaming(left, [&left, &right](size_t i) { return left.data_[i] + right.data_[i]; });
+      }
+    }
+    Matrix result = left;
+    result += right;
+    return result;
+  }
+
+  friend constexpr Matrix operator-(const Matrix& left, const Matrix& right) {
+    if constexpr (detail::STREAMABLE<T>) {
+      if (left.streams_results()) {
+        return generate_streaming(left, [&left, &right](size_t i) { return left.data_[i] - right.data_[i]; });
+      }
+    }
+    Matrix result = left;
+    result -= right;
+    return result;
+  }
+
+  friend constexpr Matrix operator*(const Matrix& left, const Matrix& right) {
+    Matrix result(left.rows_, right.cols_, left.policy_);
+    Layout::multiply(left.data_, right.data_, result.data_, left.rows_, left.cols_, right.cols_);
+    return result;
+  }
+
+  friend constexpr Matrix operator*(const Matrix& left, ConstReference right) {
+    if constexpr (detail::STREAMABLE<T>) {
+      if (left.streams_results()) {
+        return generate_streaming(left, [&left, &right](size_t i) { return left.data_[i] * right; });
+      }
+    }
+    Matrix result = left;
+    result *= right;
+    return result;
+  }
+
+  friend constexpr Matrix operator*(ConstReference left, const Matrix& right) {
+    if constexpr (detail::STREAMABLE<T>) {
+      if (right.streams_results()) {
+        return generate_streaming(right, [&left, &right](size_t i) { return left * right.data_[i]; });
+      }
+    }
+    Matrix result = right;
+    std::for_each(result.begin(), result.end(), [&left](T& x) { x = left * x; });
+    return result;
+  }
+
+private:
+  // Tag of the constructor that leaves the elements default-initialized, for callers that overwrite all of them
+  struct DefaultInit {};
+
+  template <typename U, typename L>
+  friend Matrix<U, L> detail::uninitialized_matrix(size_t rows, size_t cols);
+
+  constexpr Matrix(size_t rows, size_t cols, const AllocationPolicy& policy, const T* init)
+      : policy_(policy) {
+    if (rows != 0 && cols != 0) {
+      rows_ = rows;
+      cols_ = cols;
+      allocate(init);
+    }
+  }
+
+  constexpr Matrix(size_t rows, size_t cols, const AllocationPolicy& policy, DefaultInit)
+      : policy_(policy) {
+    if (rows != 0 && cols != 0) {
+      rows_ = rows;
+      cols_ = cols;
+      allocate(nullptr, false);
+    }
+  }
+
+  // Allocates a buffer for `size()` elements according to `policy_`. The elements are copied from `init`, or
+  // value-initialized if `init` is null (default-initialized if `value_init` is also false). During constant
+  // evaluation the buffer always comes from `new T[]`, whatever the policy. Copies of trivially copyable elements
+  // go through `memcpy`, streaming past the cache for buffers larger than the LLC.
+  constexpr void allocate(const T* init, bool value_init = true) {
+    void* pages = nullptr;
+    if !consteval {
+      pages = detail::map_buffer(lines(), line_size() * sizeof(T), policy_);
+    }
+    if (pages == nullptr) {
+      kind_ = detail::BufferKind::Array;
+      data_ = init == nullptr && value_init ? new T[size()]() : new T[size()];
+      if !consteval {
+        detail::record_buffer<T>(buffer_bytes());
+      }
+      if (init != nullptr) {
+        detail::copy_elements(init, data_, size());
+      }
+      return;
+    }
+    kind_ = detail::BufferKind::Mapped;
+    data_ = static_cast<T*>(pages);
+    detail::record_buffer<T>(buffer_bytes());
+    size_t parts = detail::max_row_blocks(lines());
+    bool streaming = detail::wants_streaming_copy(size() * sizeof(T), parts);
+    detail::for_each_row_block(lines(), parts, [=, this](size_t begin, size_t end) {
+      size_t count = (end - begin) * line_size();
+      if (init == nullptr && !value_init) {
+        std::uninitialized_default_construct_n(line_ptr(begin), count);
+      } else if (init == nullptr) {
+        std::uninitialized_value_construct_n(line_ptr(begin), count);
+      } else if constexpr (std::is_trivially_copyable_v<T>) {
+        detail::copy_block(init + begin * line_size(), line_ptr(begin), count, streaming);
+      } else {
+        std::uninitialized_copy_n(init + begin * line_size(), count, line_ptr(begin));
+      }
+    });
+  }
+
+  // Whether the result of an elementwise operation on this matrix is written with streaming stores
+  constexpr bool streams_results() const {
+    if consteval {
+      return false;
+    } else {
+      return detail::wants_streaming_store<T>(size());
+    }
+  }
+
+  // Matrix shaped like `like` with `result.data_[i] = f(i)`, written with streaming stores in parallel over lines
+  template <typename F>
+  static Matrix generate_streaming(const Matrix& like, const F& f) {
+    Matrix result(like.rows_, like.cols_, like.policy_, DefaultInit{});
+    detail::parallel_rows(result.lines(), result.line_size(), [&result, &f](size_t begin, size_t end) {
+      size_t offset = begin * result.line_size();
+      detail::stream_generate(result.line_ptr(begin), (end - begin) * result.line_size(), [&f, offset](size_t i) {
+        return f(offset + i);
+      });
+    });
+    if (like.sharing_enabled()) {
+      result.enable_sharing();
+    }
+    return result;
+  }
+
+  // `data_[i] = f(i)` for every element, in parallel over lines, with streaming stores for large results
+  template <typename F>
+  constexpr void assign_elements(const F& f) {
+    detail::parallel_rows(lines(), line_size(), [this, &f](size_t begin, size_t end) {
+      size_t offset = begin * line_size();
+      size_t count = (end - begin) * line_size();
+      if constexpr (detail::STREAMABLE<T>) {
+        if (streams_results()) {
+          detail::stream_generate(line_ptr(begin), count, [&f, offset](size_t i) { return f(offset + i); });
+          return;
+        }
+      }
+      for (size_t i = offset; i < offset + count; ++i) {
+        data_[i] = f(i);
+      }
+    });
+  }
+
+  template <typename View, typename U, typename F>
+  constexpr void for_each_row_view(U* data, const F& f) const {
+    detail::parallel_rows(rows_, cols_, [this, data, &f](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        View view = Layout::row(data, i, rows_, cols_);
+        if constexpr (std::is_invocable_v<const F&, View, size_t>) {
+          f(view, i);
+        } else {
+          f(view);
+        }
+      }
+    });
+  }
+
+  constexpr void free_buffer() noexcept {
+    if !consteval {
+      if (data_ != nullptr) {
+        detail::record_buffer<T>(-static_cast<std::ptrdiff_t>(buffer_bytes()));
+      }
+    }
+    if (kind_ == detail::BufferKind::Array) {
+      delete[] data_;
+    } else {
+      std::destroy_n(data_, size());
+      detail::unmap_buffer(data_, size() * sizeof(T), policy_);
+    }
+  }
+
+  // Bytes held by the buffer, as accounted in "footprint.h": the whole mapping for a mapped buffer
+  size_t buffer_bytes() const {
+    size_t bytes = size() * sizeof(T);
+    return kind_ == detail::BufferKind::Array ? bytes : detail::mapping_size(bytes, policy_);
+  }
+
+  constexpr const T* const_data() const {
+    return data_;
+  }
+
+  // The buffer as `lines()` contiguous chunks of `line_size()` elements (rows of a row-major matrix), the unit of
+  // parallel elementwise work and of NUMA placement
+  constexpr size_t lines() const {
+    return Layout::lines(rows_, cols_);
+  }
+
+  constexpr size_t line_size() const {
+    return empty() ? 0 : size() / lines();
+  }
+
+  constexpr T* line_ptr(size_t line) const {
+    return data_ + line * line_size();
+  }
+
+  constexpr void swap(Matrix& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(rows_, other.rows_);
+    std::swap(cols_, other.cols_);
+    std::swap(refs_, other.refs_);
+    std::swap(policy_, other.policy_);
+    std::swap(kind_, other.kind_);
+  }
+
+  // Drops this matrix's reference to its buffer, freeing the buffer if it was the last one
+  constexpr void release() noexcept {
+    if (refs_ == nullptr) {
+      free_buffer();
+    } else if (refs_->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      free_buffer();
+      delete refs_;
+    }
+  }
+
+  // Makes the buffer exclusively owned before a mutable access that may reach any element, and marks every row dirty
+  constexpr void prepare_write() {
+    detach();
+    dirty_.set_all();
+  }
+
+  // Same before a mutable access confined to row `row`
+  constexpr void prepare_write(size_t row) {
+    detach();
+    dirty_.set(row);
+  }
+
+  // Makes the buffer exclusively owned before a mutable access, duplicating it if it is shared
+  constexpr void detach() {
+    if (refs_ != nullptr && refs_->load(std::memory_order_acquire) != 1) {
+      Matrix copy(rows_, cols_, policy_, data_);
+      copy.enable_sharing();
+      swap(copy);
+    }
+  }
+
+private:
+  T* data_ = nullptr;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  std::atomic<size_t>* refs_ = nullptr;
+  AllocationPolicy policy_;
+  detail::BufferKind kind_ = detail::BufferKind::Array;
+  detail::DirtyRows dirty_;
 };
 
+namespace detail {
+
+template <typename T, typename Layout>
+Matrix<T, Layout> uninitialized_matrix(size_t rows, size_t cols) {
+  return Matrix<T, Layout>(rows, cols, AllocationPolicy{}, typename Matrix<T, Layout>::DefaultInit{});
+}
+
+} // namespace detail
+
 } // namespace ct
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "buffer.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+// Matrix products modulo a prime (or any modulus `p >= 2`) over `uint64_t`, without a division per multiply-add.
+//
+// Products are accumulated in wide integers and reduced only once per `depth_tile` of the blocked product, or as
+// often as needed to stay clear of overflow: for `p <= 2^32` the operands are narrowed to 32 bits and accumulated
+// in 64 bits, which vectorizes as widening multiplies (`pmuludq`); larger moduli accumulate in 128 bits.
+
+#ifdef __SIZEOF_INT128__
+
+namespace ct {
+
+// How `multiply_mod` reduces its accumulators
+enum class ModularReduction {
+  // Plain `%`: one hardware (or 128-bit library) division per reduction
+  Lazy,
+  // Multiplication by a precomputed reciprocal of `p` and at most two corrections
+  Barrett,
+  // The left operand is taken to Montgomery form once, and the accumulators are reduced by Montgomery reduction
+  // (two multiplications). Needs an odd `p < 2^63` (falls back to `Barrett` otherwise), and always accumulates in
+  // 128 bits.
+  Montgomery,
+};
+
+namespace detail {
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// High 64 bits of `x * y`
+inline uint64_t mul_high(uint64_t x, uint64_t y) {
+  return static_cast<uint64_t>(static_cast<uint128_t>(x) * y >> 64);
+}
+
+// High 128 bits of the 256-bit `x * y`
+inline uint128_t mul_high(uint128_t x, uint128_t y) {
+  uint64_t x0 = static_cast<uint64_t>(x);
+  uint64_t x1 = static_cast<uint64_t>(x >> 64);
+  uint64_t y0 = static_cast<uint64_t>(y);
+  uint64_t y1 = static_cast<uint64_t>(y >> 64);
+  uint128_t low = static_cast<uint128_t>(x0) * y0;
+  uint128_t cross0 = static_cast<uint128_t>(x1) * y0;
+  uint128_t cross1 = static_cast<uint128_t>(x0) * y1;
+  uint128_t middle = (low >> 64) + static_cast<uint64_t>(cross0) + static_cast<uint64_t>(cross1);
+  return static_cast<uint128_t>(x1) * y1 + (cross0 >> 64) + (cross1 >> 64) + (middle >> 64);
+}
+
+// Number of products of two residues that fit into an accumulator of `Acc` on top of one residue, i.e. the largest
+// `n` with `(p - 1) + n * (p - 1)^2 <= max(Acc)`, capped at `cap`
+template <typename Acc>
+size_t max_product_terms(uint64_t p, size_t cap) {
+  Acc largest = static_cast<Acc>(p - 1);
+  if (largest == 0) {
+    return cap;
+  }
+  Acc terms = (std::numeric_limits<Acc>::max() - largest) / (largest * largest);
+  return terms < static_cast<Acc>(cap) ? static_cast<size_t>(terms) : cap;
+}
+
+// Reducers: `Operand` is the type operands are narrowed to in the kernel, `Acc` the accumulator type; `terms`
+// products can be accumulated between reductions, and `add(out, sum)` returns `(out + sum) mod p` for a residue
+// `out` and a sum of `terms` products.
+
+template <typename Operand, typename Acc>
+struct DivisionReducer {
+  uint64_t p;
+  size_t terms;
+
+  DivisionReducer(uint64_t modulus, size_t cap)
+      : p(modulus)
+      , terms(max_product_terms<Acc>(modulus, cap)) {}
+
+  Operand left(uint64_t x) const {
+    return static_cast<Operand>(x % p);
+  }
+
+  Operand right(uint64_t x) const {
+    return static_cast<Operand>(x % p);
+  }
+
+  uint64_t add(uint64_t out, Acc sum) const {
+    return static_cast<uint64_t>((out + sum) % p);
+  }
+};
+
+// Barrett reduction with the reciprocal `floor((2^N - 1) / p)` for an `N`-bit accumulator: the estimated quotient
+// falls short of the true one by at most two
+template <typename Operand, typename Acc>
+struct BarrettReducer {
+  uint64_t p;
+  size_t terms;
+  Acc reciprocal;
+
+  BarrettReducer(uint64_t modulus, size_t cap)
+      : p(modulus)
+      , terms(max_product_terms<Acc>(modulus, cap))
+      , reciprocal(std::numeric_limits<Acc>::max() / modulus) {}
+
+  Operand left(uint64_t x) const {
+    return static_cast<Operand>(x % p);
+  }
+
+  Operand right(uint64_t x) const {
+    return static_cast<Operand>(x % p);
+  }
+
+  uint64_t add(uint64_t out, Acc sum) const {
+    Acc x = out + sum;
+    Acc r = x - mul_high(x, reciprocal) * p;
+    r -= r >= p ? p : 0;
+    r -= r >= p ? p : 0;
+    return static_cast<uint64_t>(r);
+  }
+};
+
+// Montgomery reduction with `R = 2^64`. The left operand is stored as `a * R mod p`, so a sum `S` of products is
+// `R` times the sum of the true products, and `REDC(S) = S / R mod p` recovers it for any `S < p * R`.
+struct MontgomeryReducer {
+  uint64_t p;
+  size_t terms;
+  // `-p^-1 mod 2^64`
+  uint64_t inverse;
+
+  MontgomeryReducer(uint64_t modulus, size_t cap)
+      : p(modulus)
+      , terms(std::min(cap, montgomery_terms(modulus)))
+      , inverse(negated_inverse(modulus)) {}
+
+  uint64_t left(uint64_t x) const {
+    return static_cast<uint64_t>((static_cast<uint128_t>(x % p) << 64) % p);
+  }
+
+  uint64_t right(uint64_t x) const {
+    return x % p;
+  }
+
+  uint64_t add(uint64_t out, uint128_t sum) const {
+    uint64_t m = static_cast<uint64_t>(sum) * inverse;
+    uint64_t reduced = static_cast<uint64_t>((sum + static_cast<uint128_t>(m) * p) >> 64);
+    if (reduced >= p) {
+      reduced -= p;
+    }
+    uint64_t r = out + reduced;
+    return r >= p ? r - p : r;
+  }
+
+  // Newton's iteration doubles the number of correct low bits of the inverse at every step, starting from the 3
+  // that `p` itself provides for any odd `p`
+  static uint64_t negated_inverse(uint64_t p) {
+    uint64_t x = p;
+    for (int i = 0; i < 5; ++i) {
+      x *= 2 - p * x;
+    }
+    return 0 - x;
+  }
+
+  // Largest `n` with `n * (p - 1)^2 < p * R`, so that `REDC` applies to a sum of `n` products, and `sum + m * p`
+  // (`< 2 * p * R`) does not overflow for `p < 2^63`
+  static size_t montgomery_terms(uint64_t p) {
+    uint128_t square = static_cast<uint128_t>(p - 1) * (p - 1);
+    uint128_t terms = ((static_cast<uint128_t>(p) << 64) - 1) / square;
+    constexpr size_t MAX = std::numeric_limits<size_t>::max();
+    return terms < MAX ? static_cast<size_t>(terms) : MAX;
+  }
+};
+
+// Rows of the left operand processed together against one packed panel of the right operand
+inline constexpr size_t MODULAR_ROW_CHUNK = 8;
+
+// `out[i][j] = (left * right)[i][j] mod p` for rows `i` in `[begin, end)`, with `left` already converted by
+// `reducer.left` (`? x depth`) and `right` raw (`depth x cols`). Same blocking as `gemm_rows`, except that the depth
+// tile is shortened to `reducer.terms` when the accumulators would otherwise overflow, and that every tile is
+// accumulated from zero in a chunk-sized scratch buffer and then folded into `out` by `reducer.add`.
+template <typename Acc, typename Operand, typename Reducer>
+void modular_rows(
+    const Operand* left,
+    const uint64_t* right,
+    uint64_t* out,
+    size_t begin,
+    size_t end,
+    size_t depth,
+    size_t cols,
+    const Reducer& reducer,
+    const GemmTiling& tiling = {}
+) {
+  size_t depth_tile = std::max<size_t>(1, std::min(tiling.depth_tile, reducer.terms));
+  size_t col_tile = std::min(cols, tiling.col_tile);
+  PackedBuffer<Operand> panel(std::min(depth, depth_tile) * col_tile);
+  PackedBuffer<Acc> sums(MODULAR_ROW_CHUNK * col_tile);
+
+  std::fill(out + begin * cols, out + end * cols, uint64_t{0});
+  for (size_t col_begin = 0; col_begin < cols; col_begin += col_tile) {
+    size_t width = std::min(cols - col_begin, col_tile);
+    for (size_t depth_begin = 0; depth_begin < depth; depth_begin += depth_tile) {
+      size_t tile_depth = std::min(depth - depth_begin, depth_tile);
+      for (size_t k = 0; k < tile_depth; ++k) {
+        const uint64_t* from = right + (depth_begin + k) * cols + col_begin;
+        std::transform(from, from + width, panel.data() + k * width, [&reducer](uint64_t x) {
+          return reducer.right(x);
+        });
+      }
+      for (size_t chunk = begin; chunk < end; chunk += MODULAR_ROW_CHUNK) {
+        size_t chunk_rows = std::min(end - chunk, MODULAR_ROW_CHUNK);
+        std::fill(sums.data(), sums.data() + chunk_rows * width, Acc(0));
+        gemm_tile(
+            left + chunk * depth + depth_begin,
+            depth,
+            panel.data(),
+            width,
+            sums.data(),
+            width,
+            0,
+            chunk_rows,
+            tile_depth,
+            width
+        );
+        for (size_t i = 0; i < chunk_rows; ++i) {
+          uint64_t* out_row = out + (chunk + i) * cols + col_begin;
+          const Acc* sum_row = sums.data() + i * width;
+          for (size_t j = 0; j < width; ++j) {
+            out_row[j] = reducer.add(out_row[j], sum_row[j]);
+          }
+        }
+      }
+    }
+  }
+}
+
+// `a * b mod p` with the left operand converted once by `reducer.left`, in parallel over row blocks
+template <typename Acc, typename Operand, typename Reducer>
+Matrix<uint64_t> multiply_mod_with(const Matrix<uint64_t>& a, const Matrix<uint64_t>& b, const Reducer& reducer) {
+  Matrix<uint64_t> result(a.rows(), b.cols(), a.allocation_policy());
+  if (result.empty() || a.cols() == 0) {
+    return result;
+  }
+  size_t depth = a.cols();
+  size_t cols = b.cols();
+  PackedBuffer<Operand> left(a.size());
+  const uint64_t* from = a.data();
+  parallel_rows(a.rows(), depth, [&](size_t begin, size_t end) {
+    std::transform(from + begin * depth, from + end * depth, left.data() + begin * depth, [&reducer](uint64_t x) {
+      return reducer.left(x);
+    });
+  });
+  uint64_t* out = result.data();
+  parallel_rows(a.rows(), depth * cols, [&](size_t begin, size_t end) {
+    modular_rows<Acc>(left.data(), b.data(), out, begin, end, depth, cols, reducer);
+  });
+  return result;
+}
+
+} // namespace detail
+
+// `a * b` modulo `p >= 2`, for `a` and `b` of any `uint64_t` values (they are reduced first). The result has every
+// element in `[0, p)`. See `ModularReduction` for the reduction strategies. Throws `std::invalid_argument` for
+// `p < 2`.
+inline Matrix<uint64_t> multiply_mod(
+    const Matrix<uint64_t>& a,
+    const Matrix<uint64_t>& b,
+    uint64_t p,
+    ModularReduction reduction = ModularReduction::Lazy
+) {
+  if (p < 2) {
+    throw std::invalid_argument("ct::multiply_mod: the modulus must be at least 2");
+  }
+  size_t cap = detail::GemmTiling{}.depth_tile;
+  bool narrow = p <= (uint64_t{1} << 32);
+  switch (reduction) {
+  case ModularReduction::Lazy:
+    if (narrow) {
+      return detail::multiply_mod_with<uint64_t, uint32_t>(a, b, detail::DivisionReducer<uint32_t, uint64_t>(p, cap));
+    }
+    return detail::multiply_mod_with<detail::uint128_t, uint64_t>(
+        a,
+        b,
+        detail::DivisionReducer<uint64_t, detail::uint128_t>(p, cap)
+    );
+  case ModularReduction::Barrett:
+    if (narrow) {
+      return detail::multiply_mod_with<uint64_t, uint32_t>(a, b, detail::BarrettReducer<uint32_t, uint64_t>(p, cap));
+    }
+    return detail::multiply_mod_with<detail::uint128_t, uint64_t>(
+        a,
+        b,
+        detail::BarrettReducer<uint64_t, detail::uint128_t>(p, cap)
+    );
+  case ModularReduction::Montgomery:
+    if (p % 2 == 0 || p < 3 || p >= (uint64_t{1} << 63)) {
+      return multiply_mod(a, b, p, ModularReduction::Barrett);
+    }
+    return detail::multiply_mod_with<detail::uint128_t, uint64_t>(a, b, detail::MontgomeryReducer(p, cap));
+  }
+  return {};
+}
+
+} // namespace ct
+
+#endif
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "buffer.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "reduction.h"
+#include "tuning.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace ct {
+
+namespace detail {
+
+// `out = left * right` for row-major buffers (`left` is `rows x depth`, `right` is `depth x cols`); `out` is
+// overwritten and must not overlap the operands
+template <typename T>
+void multiply_raw(const T* left, const T* right, T* out, size_t rows, size_t depth, size_t cols) {
+  GemmTiling tiling = KernelTuner::instance().tiling(left, right, rows, depth, cols);
+  parallel_rows(rows, cols, [&](size_t begin, size_t end) {
+    std::fill(out + begin * cols, out + end * cols, T());
+  });
+  gemm_parallel(left, right, out, rows, depth, cols, tiling);
+}
+
+// Recomputes the rows of `c = a * b` whose row of `a` is dirty. Consecutive dirty rows go through the kernel
+// together, and the work is split over the dirty rows only.
+template <typename T>
+void update_dirty_rows(Matrix<T>& c, const Matrix<T>& a, const Matrix<T>& b) {
+  size_t depth = a.cols();
+  size_t cols = b.cols();
+  PackedBuffer<size_t> dirty(a.dirty_row_count());
+  size_t count = 0;
+  for (size_t i = 0; i < a.rows(); ++i) {
+    if (a.row_dirty(i)) {
+      dirty[count++] = i;
+    }
+  }
+  // Taking the rows through `row` instead of `data` marks only the recomputed rows dirty in `c`
+  PackedBuffer<T*> out(count);
+  for (size_t k = 0; k < count; ++k) {
+    out[k] = c.row(dirty[k]).data();
+  }
+  parallel_rows(count, depth * cols, [&](size_t begin, size_t end) {
+    for (size_t run = begin; run < end;) {
+      size_t run_end = run + 1;
+      while (run_end < end && dirty[run_end] == dirty[run_end - 1] + 1) {
+        ++run_end;
+      }
+      // The rows of a run are adjacent in the buffer, starting at the first one
+      size_t first = dirty[run];
+      size_t height = dirty[run_end - 1] + 1 - first;
+      std::fill(out[run], out[run] + height * cols, T());
+      gemm_rows_ordered(a.data() + first * depth, b.data(), out[run], 0, height, depth, cols);
+      run = run_end;
+    }
+  });
+}
+
+// Scratch buffers for intermediate products, recycled as soon as an intermediate has been consumed
+template <typename T>
+class Workspace {
+public:
+  explicit Workspace(size_t capacity)
+      : slots_(new Slot[capacity]) {}
+
+  Workspace(const Workspace&) = delete;
+  Workspace& operator=(const Workspace&) = delete;
+
+  ~Workspace() {
+    for (size_t i = 0; i < count_; ++i) {
+      delete[] slots_[i].data;
+    }
+    delete[] slots_;
+  }
+
+  // A free buffer of at least `size` elements: the smallest free one that fits, else the largest free one grown
+  T* acquire(size_t size) {
+    Slot* fit = nullptr;
+    Slot* largest = nullptr;
+    for (size_t i = 0; i < count_; ++i) {
+      Slot& slot = slots_[i];
+      if (slot.in_use) {
+        continue;
+      }
+      if (slot.size >= size && (fit == nullptr || slot.size < fit->size)) {
+        fit = &slot;
+      }
+      if (largest == nullptr || slot.size > largest->size) {
+        largest = &slot;
+      }
+    }
+    Slot* slot = fit != nullptr ? fit : largest != nullptr ? largest : &slots_[count_++];
+    if (slot->size < size) {
+      delete[] slot->data;
+      slot->data = new T[size];
+      slot->size = size;
+    }
+    slot->in_use = true;
+    return slot->data;
+  }
+
+  void release(T* data) {
+    for (size_t i = 0; i < count_; ++i) {
+      if (slots_[i].data == data) {
+        slots_[i].in_use = false;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    T* data = nullptr;
+    size_t size = 0;
+    bool in_use = false;
+  };
+
+  Slot* slots_;
+  size_t count_ = 0;
+};
+
+// Evaluates `operands[0] * ... * operands[count - 1]` in the order minimizing the number of multiply-adds
+template <typename T>
+class ChainEvaluator {
+public:
+  ChainEvaluator(const Matrix<T>* const* operands, size_t count)
+      : operands_(operands)
+      , count_(count)
+      , split_(count, count)
+      , workspace_(count) {
+    plan();
+  }
+
+  Matrix<T> evaluate() {
+    if (count_ == 1) {
+      return *operands_[0];
+    }
+    Matrix<T> result(rows(0), cols(count_ - 1), operands_[0]->allocation_policy());
+    if (!result.empty()) {
+      evaluate_into(0, count_ - 1, result.data());
+    }
+    return result;
+  }
+
+  // Number of multiply-adds of the optimal order
+  size_t cost() const {
+    return cost_;
+  }
+
+  // Index `s` such that the product of operands `[first, last]` is split into `[first, s] * [s + 1, last]`
+  size_t split(size_t first, size_t last) const {
+    return split_(first, last);
+  }
+
+private:
+  size_t rows(size_t i) const {
+    return operands_[i]->rows();
+  }
+
+  size_t cols(size_t i) const {
+    return operands_[i]->cols();
+  }
+
+  // Classic O(n^3) dynamic programming over the operand shapes
+  void plan() {
+    Matrix<size_t> cost(count_, count_);
+    for (size_t length = 2; length <= count_; ++length) {
+      for (size_t first = 0; first + length <= count_; ++first) {
+        size_t last = first + length - 1;
+        cost(first, last) = std::numeric_limits<size_t>::max();
+        for (size_t s = first; s < last; ++s) {
+          size_t candidate = cost(first, s) + cost(s + 1, last) + rows(first) * cols(s) * cols(last);
+          if (candidate < cost(first, last)) {
+            cost(first, last) = candidate;
+            split_(first, last) = s;
+          }
+        }
+      }
+    }
+    cost_ = std::as_const(cost)(0, count_ - 1);
+  }
+
+  // Product of operands `[first, last]` (at least two of them) written to `out`
+  void evaluate_into(size_t first, size_t last, T* out) {
+    size_t s = split_(first, last);
+    T* left_temp = first == s ? nullptr : workspace_.acquire(rows(first) * cols(s));
+    if (left_temp != nullptr) {
+      evaluate_into(first, s, left_temp);
+    }
+    T* right_temp = s + 1 == last ? nullptr : workspace_.acquire(rows(s + 1) * cols(last));
+    if (right_temp != nullptr) {
+      evaluate_into(s + 1, last, right_temp);
+    }
+
+    const T* left = left_temp == nullptr ? operands_[first]->data() : left_temp;
+    const T* right = right_temp == nullptr ? operands_[last]->data() : right_temp;
+    multiply_raw(left, right, out, rows(first), cols(s), cols(last));
+
+    workspace_.release(left_temp);
+    workspace_.release(right_temp);
+  }
+
+private:
+  const Matrix<T>* const* operands_;
+  size_t count_;
+  Matrix<size_t> split_;
+  size_t cost_ = 0;
+  Workspace<T> workspace_;
+};
+
+} // namespace detail
+
+// Product of `left` and `right` accumulated and returned in `Acc`, e.g. `multiply<int32_t>` of two `Matrix<int8_t>`
+// or `multiply<double>` of two `Matrix<float>`. Elements are widened one at a time inside the kernel, so no
+// full-size converted copies of the operands are made.
+template <typename Acc, typename T>
+  requires std::constructible_from<Acc, const T&>
+Matrix<Acc> multiply(const Matrix<T>& left, const Matrix<T>& right) {
+  Matrix<Acc> result(left.rows(), right.cols(), left.allocation_policy());
+  detail::gemm_parallel(left.data(), right.data(), result.data(), left.rows(), left.cols(), right.cols());
+  return result;
+}
+
+// `out = left * right`, reusing the buffer of `out` when it already has the shape of the product
+template <typename T>
+void multiply_into(const Matrix<T>& left, const Matrix<T>& right, Matrix<T>& out) {
+  if (&out == &left || &out == &right) {
+    out = left * right;
+    return;
+  }
+  if (out.rows() != left.rows() || out.cols() != right.cols()) {
+    out = Matrix<T>(left.rows(), right.cols(), left.allocation_policy());
+  }
+  if (!out.empty()) {
+    detail::multiply_raw(left.data(), right.data(), out.data(), left.rows(), left.cols(), right.cols());
+  }
+}
+
+// Brings `c` back to `a * b` after some rows of `a` were written, recomputing only the matching rows of `c`:
+// O(k * depth * cols) for `k` dirty rows instead of O(rows * depth * cols). See `Matrix::track_dirty_rows`.
+//
+// `c` must have been equal to `a * b` when the dirty records of `a` and `b` were last cleared or started; both are
+// cleared again afterwards. Falls back to the full product when `a` is not tracked, when any row of `b` may have
+// changed, or when `c` does not have the shape of the product. The recomputed rows are marked dirty in `c`, so
+// products that depend on `c` can in turn be updated incrementally.
+template <typename T>
+void update_product(Matrix<T>& c, Matrix<T>& a, Matrix<T>& b) {
+  if (&c == &a || &c == &b || !a.tracks_dirty_rows() || b.dirty_row_count() != 0 || c.rows() != a.rows() ||
+      c.cols() != b.cols()) {
+    c = a * b;
+  } else if (a.dirty_row_count() != 0) {
+    detail::update_dirty_rows(c, std::as_const(a), std::as_const(b));
+  }
+  a.clear_dirty_rows();
+  b.clear_dirty_rows();
+}
+
+// Rank-k update `c += u * v` for a `rows x k` matrix `u` and a `k x cols` matrix `v`, in O(rows * k * cols).
+// When `k` rows of the right operand of `c = a * b` change, `c += a[:, changed] * (b_new - b_old)[changed, :]`
+// updates the product with a rank-k update instead of recomputing it.
+template <typename T>
+void rank_update(Matrix<T>& c, const Matrix<T>& u, const Matrix<T>& v) {
+  if (&c == &u || &c == &v) {
+    c += u * v;
+    return;
+  }
+  if (u.empty()) {
+    return;
+  }
+  detail::gemm_parallel(u.data(), v.data(), c.data(), c.rows(), u.cols(), v.cols());
+}
+
+// `n x n` identity matrix
+template <typename T>
+Matrix<T> identity(size_t n) {
+  Matrix<T> result(n, n);
+  for (size_t i = 0; i < n; ++i) {
+    result(i, i) = T(1);
+  }
+  return result;
+}
+
+// `m` raised to the power `exponent` (`m` must be square) by binary exponentiation: O(log exponent)
+// multiplications ping-ponging between three buffers, however large the exponent
+template <typename T>
+Matrix<T> pow(const Matrix<T>& m, size_t exponent) {
+  if (exponent == 0) {
+    return identity<T>(m.rows());
+  }
+  Matrix<T> base = m;
+  Matrix<T> result;
+  Matrix<T> scratch;
+  bool first = true;
+  while (true) {
+    if (exponent % 2 == 1) {
+      if (first) {
+        result = base;
+        first = false;
+      } else {
+        multiply_into(result, base, scratch);
+        std::swap(result, scratch);
+      }
+    }
+    exponent /= 2;
+    if (exponent == 0) {
+      return result;
+    }
+    multiply_into(base, base, scratch);
+    std::swap(base, scratch);
+  }
+}
+
+// `first * rest...`, parenthesized to minimize the number of multiply-adds given the operand shapes.
+// Intermediate products live in a small set of scratch buffers that are reused as the chain is evaluated.
+template <typename T, typename... Rest>
+  requires (std::same_as<Rest, Matrix<T>> && ...)
+Matrix<T> multiply_chain(const Matrix<T>& first, const Rest&... rest) {
+  const Matrix<T>* operands[] = {&first, &rest...};
+  return detail::ChainEvaluator<T>(operands, 1 + sizeof...(rest)).evaluate();
+}
+
+} // namespace ct
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ct::detail {
+
+// Minimal NUMA support on top of raw syscalls, so that no libnuma is required. Every function degrades to a no-op
+// on systems without NUMA (or when the syscalls are not permitted), which makes a single-node machine behave exactly
+// like a machine where the requested placement happened to be local.
+
+inline constexpr size_t MAX_NUMA_NODES = sizeof(unsigned long) * 8;
+
+// Calls `f(first, last)` for every range in a sysfs list such as "0-3,8,10-11"
+template <typename F>
+void for_each_in_sysfs_list(const std::string& list, F f) {
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = list.size();
+    }
+    std::string item = list.substr(pos, comma - pos);
+    size_t dash = item.find('-');
+    if (!item.empty()) {
+      size_t first = std::stoul(item.substr(0, dash));
+      size_t last = dash == std::string::npos ? first : std::stoul(item.substr(dash + 1));
+      f(first, last);
+    }
+    pos = comma + 1;
+  }
+}
+
+inline std::string read_sysfs_list(const std::string& path) {
+  std::ifstream in(path);
+  std::string list;
+  in >> list;
+  return list;
+}
+
+inline size_t compute_numa_node_count() {
+#ifdef __linux__
+  size_t count = 0;
+  for_each_in_sysfs_list(read_sysfs_list("/sys/devices/system/node/online"), [&count](size_t, size_t last) {
+    count = std::max(count, last + 1);
+  });
+  return std::clamp<size_t>(count, 1, MAX_NUMA_NODES);
+#else
+  return 1;
+#endif
+}
+
+// Number of NUMA nodes (the highest online node id plus one); `1` on non-NUMA systems
+inline size_t numa_node_count() {
+  static const size_t count = compute_numa_node_count();
+  return count;
+}
+
+// Restricts the calling thread to the CPUs of `node`; does nothing on a single-node system
+inline void pin_current_thread_to_node(size_t node) {
+#ifdef __linux__
+  if (numa_node_count() <= 1) {
+    return;
+  }
+  std::string cpus = read_sysfs_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  bool any = false;
+  for_each_in_sysfs_list(cpus, [&set, &any](size_t first, size_t last) {
+    for (size_t cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, &set);
+      any = true;
+    }
+  });
+  if (any) {
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#else
+  static_cast<void>(node);
+#endif
+}
+
+enum class NumaMode {
+  Preferred = 1,
+  Interleave = 3,
+};
+
+// Applies a memory policy to the pages in `[addr, addr + bytes)`; `addr` must be page-aligned.
+// Returns `false` if the policy could not be applied, in which case the pages keep the default first-touch policy.
+inline bool numa_bind(void* addr, size_t bytes, NumaMode mode, unsigned long nodes) {
+#ifdef __linux__
+  if (numa_node_count() <= 1 || bytes == 0) {
+    return false;
+  }
+  // The kernel decrements `maxnode` before reading the mask, hence the `+ 1`
+  return syscall(SYS_mbind, addr, bytes, static_cast<int>(mode), &nodes, MAX_NUMA_NODES + 1, 0U) == 0;
+#else
+  static_cast<void>(addr);
+  static_cast<void>(bytes);
+  static_cast<void>(mode);
+  static_cast<void>(nodes);
+  return false;
+#endif
+}
+
+inline unsigned long all_numa_nodes() {
+  size_t count = numa_node_count();
+  return count == MAX_NUMA_NODES ? ~0UL : (1UL << count) - 1;
+}
+
+} // namespace ct::detail
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "numa.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace ct::detail {
+
+struct BlockRange {
+  size_t begin;
+  size_t end;
+};
+
+// The `index`-th of `parts` contiguous blocks that `[0, count)` is split into; block sizes differ by at most one
+inline BlockRange block_range(size_t count, size_t parts, size_t index) {
+  return {count * index / parts, count * (index + 1) / parts};
+}
+
+// A fixed set of worker threads that execute fork-join jobs. Part `i` of a job always runs on worker `i % size()`,
+// and workers are spread evenly over NUMA nodes (pinned when there is more than one), so the same row block of a
+// matrix is always processed on the same node.
+class ThreadPool {
+public:
+  static constexpr size_t NOT_A_WORKER = static_cast<size_t>(-1);
+
+public:
+  explicit ThreadPool(size_t size)
+      : size_(size == 0 ? 1 : size)
+      , workers_(new std::thread[size_]) {
+    for (size_t i = 0; i < size_; ++i) {
+      workers_[i] = std::thread([this, i] { work(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < size_; ++i) {
+      workers_[i].join();
+    }
+    delete[] workers_;
+  }
+
+  // The process-wide pool; its size is taken from `CT_NUM_THREADS` or the number of hardware threads
+  static ThreadPool& instance() {
+    static ThreadPool pool(default_size());
+    return pool;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  // NUMA node that worker `worker` runs on
+  size_t node(size_t worker) const {
+    return worker * numa_node_count() / size_;
+  }
+
+  // Index of the pool worker the calling thread is, or `NOT_A_WORKER`
+  static size_t current_worker() {
+    return current_worker_;
+  }
+
+  // Calls `f(part)` for every `part` in `[0, parts)` and waits for all of them to finish.
+  // Jobs submitted from inside a worker run inline on that worker, so nested parallel operations never deadlock.
+  // If parts throw, the other parts still run, and the first exception caught is rethrown here.
+  template <typename F>
+  void run(size_t parts, const F& f) {
+    if (parts <= 1 || current_worker_ != NOT_A_WORKER) {
+      for (size_t part = 0; part < parts; ++part) {
+        f(part);
+      }
+      return;
+    }
+
+    std::lock_guard job_lock(job_mutex_);
+    std::unique_lock lock(mutex_);
+    job_ = [](const void* context, size_t part) { (*static_cast<const F*>(context))(part); };
+    context_ = &f;
+    parts_ = parts;
+    pending_ = size_;
+    ++generation_;
+    wake_.notify_all();
+    done_.wait(lock, [this] { return pending_ == 0; });
+    if (std::exception_ptr error = std::exchange(error_, nullptr)) {
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  static size_t default_size() {
+    if (const char* env = std::getenv("CT_NUM_THREADS")) {
+      size_t size = std::strtoul(env, nullptr, 10);
+      if (size != 0) {
+        return size;
+      }
+    }
+    return std::thread::hardware_concurrency();
+  }
+
+  void work(size_t worker) {
+    current_worker_ = worker;
+    pin_current_thread_to_node(node(worker));
+
+    size_t seen = 0;
+    std::unique_lock lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      auto* job = job_;
+      const void* context = context_;
+      size_t parts = parts_;
+      lock.unlock();
+
+      std::exception_ptr error;
+      for (size_t part = worker; part < parts; part += size_) {
+        try {
+          job(context, part);
+        } catch (...) {
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      }
+
+      lock.lock();
+      if (error && !error_) {
+        error_ = std::move(error);
+      }
+      if (--pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+private:
+  size_t size_;
+  std::thread* workers_;
+
+  std::mutex job_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+
+  void (*job_)(const void*, size_t) = nullptr;
+  const void* context_ = nullptr;
+  size_t parts_ = 0;
+  size_t pending_ = 0;
+  size_t generation_ = 0;
+  std::exception_ptr error_;
+  bool stop_ = false;
+
+  inline static thread_local size_t current_worker_ = NOT_A_WORKER;
+};
+
+// Operations doing less work than this (in element operations) are not worth waking up the workers for
+inline constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+
+// Number of row blocks a large operation over `rows` rows is split into
+inline size_t max_row_blocks(size_t rows) {
+  return std::max<size_t>(1, std::min(rows, ThreadPool::instance().size()));
+}
+
+// Number of row blocks an operation over `rows` rows doing `work_per_row` element operations per row is split into
+inline size_t row_block_count(size_t rows, size_t work_per_row) {
+  return rows * work_per_row < PARALLEL_THRESHOLD ? 1 : max_row_blocks(rows);
+}
+
+// Calls `f(begin, end)` for each of `parts` contiguous blocks of `[0, rows)`. Block `i` is processed by pool
+// worker `i`, which is what `NumaPlacement::RowBlocks` relies on.
+template <typename F>
+void for_each_row_block(size_t rows, size_t parts, const F& f) {
+  if (parts <= 1) {
+    f(size_t{0}, rows);
+    return;
+  }
+  ThreadPool::instance().run(parts, [&f, rows, parts](size_t part) {
+    BlockRange range = block_range(rows, parts, part);
+    f(range.begin, range.end);
+  });
+}
+
+// Calls `f(begin, end)` for contiguous blocks of rows, in parallel when the operation is large enough. During
+// constant evaluation the whole range is processed by the calling thread.
+template <typename F>
+constexpr void parallel_rows(size_t rows, size_t work_per_row, const F& f) {
+  if consteval {
+    f(size_t{0}, rows);
+  } else {
+    for_each_row_block(rows, row_block_count(rows, work_per_row), f);
+  }
+}
+
+} // namespace ct::detail
@@ -0,0 +1,330 @@
+#pragma once
+
+#include "matrix.h"
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Range adaptors over matrices, for row and column pipelines that build no intermediate matrices:
+//
+//   for (auto row : ct::views::rows(m)) { ... }             // `RowView` of every row
+//   for (auto col : ct::views::cols(m)) { col *= scale; }   // `ColView` of every column
+//   m = ct::views::zip_transform(f, a, ct::views::transform(b, g));  // `m(i, j) = f(a(i, j), g(b(i, j)))` in one pass
+//
+// For per-row kernels that may run in parallel, see `Matrix::apply_rows`.
+
+namespace ct {
+
+namespace detail {
+
+// Iterator over the row (`ROW`) or column views of a matrix `M`, which may be const. Dereferencing produces the
+// view, so the iterator is random-access in the C++20 sense but only an input iterator for legacy algorithms.
+template <typename M, bool ROW>
+class LinesIterator {
+public:
+  using value_type = std::conditional_t<ROW, decltype(std::declval<M&>().row(0)), decltype(std::declval<M&>().col(0))>;
+  using reference = value_type;
+  using difference_type = std::ptrdiff_t;
+  using iterator_concept = std::random_access_iterator_tag;
+  using iterator_category = std::input_iterator_tag;
+
+public:
+  LinesIterator() = default;
+
+  constexpr value_type operator*() const {
+    size_t line = static_cast<size_t>(index_);
+    if constexpr (ROW) {
+      return matrix_->row(line);
+    } else {
+      return matrix_->col(line);
+    }
+  }
+
+  constexpr value_type operator[](difference_type n) const {
+    return *(*this + n);
+  }
+
+  constexpr LinesIterator& operator++() {
+    ++index_;
+    return *this;
+  }
+
+  constexpr LinesIterator operator++(int) {
+    LinesIterator copy = *this;
+    ++index_;
+    return copy;
+  }
+
+  constexpr LinesIterator& operator--() {
+    --index_;
+    return *this;
+  }
+
+  constexpr LinesIterator operator--(int) {
+    LinesIterator copy = *this;
+    --index_;
+    return copy;
+  }
+
+  constexpr LinesIterator& operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+
+  constexpr LinesIterator& operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+
+  friend constexpr LinesIterator operator+(LinesIterator it, difference_type n) {
+    return it += n;
+  }
+
+  friend constexpr LinesIterator operator+(difference_type n, LinesIterator it) {
+    return it += n;
+  }
+
+  friend constexpr LinesIterator operator-(LinesIterator it, difference_type n) {
+    return it -= n;
+  }
+
+  friend constexpr difference_type operator-(const LinesIterator& left, const LinesIterator& right) {
+    return left.index_ - right.index_;
+  }
+
+  friend constexpr bool operator==(const LinesIterator& left, const LinesIterator& right) {
+    return left.matrix_ == right.matrix_ && left.index_ == right.index_;
+  }
+
+  friend constexpr auto operator<=>(const LinesIterator& left, const LinesIterator& right) {
+    return left.index_ <=> right.index_;
+  }
+
+private:
+  constexpr LinesIterator(M* matrix, difference_type index)
+      : matrix_(matrix)
+      , index_(index) {}
+
+  template <typename U, bool R>
+  friend class LinesRange;
+
+private:
+  M* matrix_ = nullptr;
+  difference_type index_ = 0;
+};
+
+// Range of the row (`ROW`) or column views of a matrix `M`, which may be const. Through a mutable matrix every view
+// is obtained with `row()` or `col()` when the iterator is dereferenced, so the views are not meant to be created
+// from several threads at once; run per-row kernels in parallel with `Matrix::apply_rows` instead.
+template <typename M, bool ROW>
+class LinesRange : public std::ranges::view_interface<LinesRange<M, ROW>> {
+public:
+  using Iterator = LinesIterator<M, ROW>;
+
+public:
+  LinesRange() = default;
+
+  constexpr explicit LinesRange(M& matrix)
+      : matrix_(&matrix) {}
+
+  constexpr Iterator begin() const {
+    return {matrix_, 0};
+  }
+
+  constexpr Iterator end() const {
+    return {matrix_, static_cast<std::ptrdiff_t>(size())};
+  }
+
+  constexpr size_t size() const {
+    return matrix_ == nullptr ? 0 : ROW ? matrix_->rows() : matrix_->cols();
+  }
+
+private:
+  M* matrix_ = nullptr;
+};
+
+// Operand of an elementwise expression reading a matrix in place (or a matrix moved into the expression, `OWNED`)
+template <typename T, typename L, bool OWNED>
+class MatrixOperand {
+public:
+  using Layout = L;
+
+  struct Evaluator {
+    const T* data;
+
+    constexpr const T& operator()(size_t index) const {
+      return data[index];
+    }
+  };
+
+public:
+  constexpr explicit MatrixOperand(const Matrix<T, L>& matrix)
+    requires (!OWNED)
+      : matrix_(&matrix) {}
+
+  constexpr explicit MatrixOperand(Matrix<T, L>&& matrix)
+    requires OWNED
+      : matrix_(std::move(matrix)) {}
+
+  constexpr size_t rows() const {
+    return get().rows();
+  }
+
+  constexpr size_t cols() const {
+    return get().cols();
+  }
+
+  constexpr Evaluator evaluator() const {
+    return {get().data()};
+  }
+
+private:
+  constexpr const Matrix<T, L>& get() const {
+    if constexpr (OWNED) {
+      return matrix_;
+    } else {
+      return *matrix_;
+    }
+  }
+
+private:
+  std::conditional_t<OWNED, Matrix<T, L>, const Matrix<T, L>*> matrix_;
+};
+
+// Lazy `f(operands(i, j)...)` over operands of the same shape and layout `L`: matrices, or other elementwise views.
+// Nothing is computed until the view is assigned to a `Matrix` or an element is accessed, and nested views are
+// fused into the same pass.
+template <typename L, typename F, typename... Operands>
+class ElementwiseView {
+public:
+  using Layout = L;
+
+  // Computes the element at each buffer index, referring to the function of the view it was obtained from
+  template <typename... Evaluators>
+  struct Evaluator {
+    const F& f;
+    std::tuple<Evaluators...> operands;
+
+    constexpr decltype(auto) operator()(size_t index) const {
+      return std::apply([this, index](const Evaluators&... e) { return std::invoke(f, e(index)...); }, operands);
+    }
+  };
+
+public:
+  constexpr ElementwiseView(F f, Operands... operands)
+      : f_(std::move(f))
+      , operands_(std::move(operands)...) {}
+
+  constexpr size_t rows() const {
+    return std::get<0>(operands_).rows();
+  }
+
+  constexpr size_t cols() const {
+    return std::get<0>(operands_).cols();
+  }
+
+  constexpr size_t size() const {
+    return rows() * cols();
+  }
+
+  // Element `(row, col)`, computed on access
+  constexpr auto operator()(size_t row, size_t col) const {
+    return evaluator()(Layout::index(row, col, rows(), cols()));
+  }
+
+  constexpr auto evaluator() const {
+    return std::apply(
+        [this](const Operands&... operands) {
+          return Evaluator<decltype(operands.evaluator())...>{f_, {operands.evaluator()...}};
+        },
+        operands_
+    );
+  }
+
+private:
+  F f_;
+  std::tuple<Operands...> operands_;
+};
+
+template <typename T, typename L>
+constexpr MatrixOperand<T, L, false> make_operand(const Matrix<T, L>& matrix) {
+  return MatrixOperand<T, L, false>(matrix);
+}
+
+template <typename T, typename L>
+constexpr MatrixOperand<T, L, true> make_operand(Matrix<T, L>&& matrix) {
+  return MatrixOperand<T, L, true>(std::move(matrix));
+}
+
+template <typename L, typename F, typename... Operands>
+constexpr ElementwiseView<L, F, Operands...> make_operand(ElementwiseView<L, F, Operands...> view) {
+  return view;
+}
+
+// How `zip_transform` holds a source of type `Source`
+template <typename Source>
+using OperandOf = decltype(make_operand(std::declval<Source>()));
+
+} // namespace detail
+
+namespace views {
+
+// Range of the `RowView`s (`ConstRowView`s for a const matrix) of `m`
+template <typename T, typename Layout>
+constexpr detail::LinesRange<Matrix<T, Layout>, true> rows(Matrix<T, Layout>& m) {
+  return detail::LinesRange<Matrix<T, Layout>, true>(m);
+}
+
+template <typename T, typename Layout>
+constexpr detail::LinesRange<const Matrix<T, Layout>, true> rows(const Matrix<T, Layout>& m) {
+  return detail::LinesRange<const Matrix<T, Layout>, true>(m);
+}
+
+// The views would outlive the matrix
+template <typename T, typename Layout>
+void rows(Matrix<T, Layout>&& m) = delete;
+
+// Range of the `ColView`s (`ConstColView`s for a const matrix) of `m`
+template <typename T, typename Layout>
+constexpr detail::LinesRange<Matrix<T, Layout>, false> cols(Matrix<T, Layout>& m) {
+  return detail::LinesRange<Matrix<T, Layout>, false>(m);
+}
+
+template <typename T, typename Layout>
+constexpr detail::LinesRange<const Matrix<T, Layout>, false> cols(const Matrix<T, Layout>& m) {
+  return detail::LinesRange<const Matrix<T, Layout>, false>(m);
+}
+
+template <typename T, typename Layout>
+void cols(Matrix<T, Layout>&& m) = delete;
+
+// Lazy elementwise `f(sources(i, j)...)` over matrices or elementwise views of the same shape and layout.
+// Matrices passed as lvalues are read in place and must outlive the view; temporaries are moved into it.
+template <typename F, typename... Sources>
+  requires (sizeof...(Sources) > 0)
+constexpr auto zip_transform(F f, Sources&&... sources) {
+  using Layout = typename std::tuple_element_t<0, std::tuple<detail::OperandOf<Sources>...>>::Layout;
+  static_assert(
+      (std::is_same_v<typename detail::OperandOf<Sources>::Layout, Layout> && ...),
+      "all operands of an elementwise view must have the same layout"
+  );
+  return detail::ElementwiseView<Layout, F, detail::OperandOf<Sources>...>(
+      std::move(f),
+      detail::make_operand(std::forward<Sources>(sources))...
+  );
+}
+
+// Lazy elementwise `f(source(i, j))`
+template <typename Source, typename F>
+constexpr auto transform(Source&& source, F f) {
+  return zip_transform(std::move(f), std::forward<Source>(source));
+}
+
+} // namespace views
+
+} // namespace ct
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "buffer.h"
+#include "kernels.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+
+// Order of the floating-point reductions of products and sums.
+//
+// Floating-point addition is not associative, so a sum split into partial sums differently gives different bits.
+// In `ReductionMode::Fast` the split follows the thread pool: products with fewer rows than workers also split
+// their inner dimension among the workers, and `sum` adds one partial sum per worker, so results change in the last
+// bits with the number of threads. In `ReductionMode::Reproducible` every reduction follows an order fixed by the
+// shapes alone, whatever the thread count, the tuned blocking of the product kernel and the run:
+//
+// - the product splits the inner dimension into slices of `REPRODUCIBLE_DEPTH_CHUNK`, each accumulated by the
+//   product kernel in index order (four terms at a time), and adds the partial products pairwise, as `pairwise_sum`
+//   adds its values. Products of depth up to `REPRODUCIBLE_DEPTH_CHUNK` are a single slice, bit-identical to the
+//   fast mode ones;
+// - `sum` splits the buffer into runs of `REPRODUCIBLE_SUM_CHUNK` elements, each added in four interleaved lanes
+//   (`sum_lanes`), and adds the run sums pairwise.
+//
+// The products covered are `operator*` of row- and column-major matrices, `*=`, `multiply_into`, `multiply<Acc>`,
+// `multiply_chain`, `pow`, `rank_update`, `update_product` and `async_multiply`.
+//
+// Both still run in parallel: slices and runs are spread over the workers, and only their combination is fixed.
+// Results depend on the layout of the matrices, whose buffers are summed in storage order. The mode is process-wide;
+// it starts as `Reproducible` when `CT_REPRODUCIBLE` is set to anything but `0`.
+
+namespace ct {
+
+template <typename T, typename Layout>
+class Matrix;
+
+enum class ReductionMode {
+  Fast,
+  Reproducible,
+};
+
+// Depth of the slices of the inner dimension of products in reproducible mode (a multiple of the four rows the
+// product kernel consumes per pass)
+inline constexpr size_t REPRODUCIBLE_DEPTH_CHUNK = 1024;
+
+// Elements per run of `sum` in reproducible mode
+inline constexpr size_t REPRODUCIBLE_SUM_CHUNK = size_t{1} << 12;
+
+namespace detail {
+
+inline ReductionMode default_reduction_mode() {
+  const char* env = std::getenv("CT_REPRODUCIBLE");
+  bool reproducible = env != nullptr && *env != '\0' && (env[0] != '0' || env[1] != '\0');
+  return reproducible ? ReductionMode::Reproducible : ReductionMode::Fast;
+}
+
+inline std::atomic<ReductionMode> reduction_mode_setting{default_reduction_mode()};
+
+} // namespace detail
+
+inline ReductionMode reduction_mode() {
+  return detail::reduction_mode_setting.load(std::memory_order_relaxed);
+}
+
+inline void set_reduction_mode(ReductionMode mode) {
+  detail::reduction_mode_setting.store(mode, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+// Shortest slice of the inner dimension that fast mode gives a worker
+inline constexpr size_t MIN_DEPTH_CHUNK = 256;
+
+// Elements of partial products each worker keeps at a time while adding slices pairwise
+inline constexpr size_t DEPTH_SCRATCH = size_t{1} << 20;
+
+inline size_t ceil_div(size_t count, size_t divisor) {
+  return (count + divisor - 1) / divisor;
+}
+
+// `out[i] += in[i]` for `i` in `[0, count)`
+template <typename T>
+void add_elements(T* out, const T* in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] += in[i];
+  }
+}
+
+// Sum of `data[0, count)` in four interleaved lanes: lane `l` adds the elements `l`, `l + 4`, ... in order, and the
+// lanes are combined as `(lane 0 + lane 1) + (lane 2 + lane 3)`. The lanes break the dependency of each addition on
+// the previous one.
+template <typename T>
+T sum_lanes(const T* data, size_t count) {
+  T lanes[4] = {};
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    lanes[0] += data[i];
+    lanes[1] += data[i + 1];
+    lanes[2] += data[i + 2];
+    lanes[3] += data[i + 3];
+  }
+  for (; i < count; ++i) {
+    lanes[i % 4] += data[i];
+  }
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Sum of `values[0, count)` added pairwise, `values[c] += values[c + stride]` for every `c` multiple of `2 * stride`
+// and strides 1, 2, 4, ...; `values` is overwritten
+template <typename T>
+T pairwise_sum(T* values, size_t count) {
+  for (size_t stride = 1; stride < count; stride *= 2) {
+    for (size_t c = 0; c + stride < count; c += 2 * stride) {
+      values[c] += values[c + stride];
+    }
+  }
+  return count == 0 ? T() : values[0];
+}
+
+template <typename T>
+T sum_elements(const T* data, size_t count) {
+  if (reduction_mode() == ReductionMode::Reproducible) {
+    size_t chunks = ceil_div(count, REPRODUCIBLE_SUM_CHUNK);
+    PackedBuffer<T> partials(chunks);
+    parallel_rows(chunks, REPRODUCIBLE_SUM_CHUNK, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        size_t first = c * REPRODUCIBLE_SUM_CHUNK;
+        partials[c] = sum_lanes(data + first, std::min(REPRODUCIBLE_SUM_CHUNK, count - first));
+      }
+    });
+    return pairwise_sum(partials.data(), chunks);
+  }
+  size_t parts = row_block_count(count, 1);
+  PackedBuffer<T> partials(parts);
+  ThreadPool::instance().run(parts, [&](size_t part) {
+    BlockRange range = block_range(count, parts, part);
+    partials[part] = sum_lanes(data + range.begin, range.end - range.begin);
+  });
+  T total = T();
+  for (size_t part = 0; part < parts; ++part) {
+    total += partials[part];
+  }
+  return total;
+}
+
+// Depth of the slices of the inner dimension that `rows x depth` times `depth x cols` is split into, `depth` for none
+inline size_t depth_chunk(size_t rows, size_t depth, size_t cols) {
+  if (reduction_mode() == ReductionMode::Reproducible) {
+    return REPRODUCIBLE_DEPTH_CHUNK;
+  }
+  size_t workers = ThreadPool::instance().size();
+  if (rows >= workers || rows * depth * cols < PARALLEL_THRESHOLD) {
+    return depth;
+  }
+  size_t slices = ceil_div(workers, rows);
+  return std::max(MIN_DEPTH_CHUNK, ceil_div(ceil_div(depth, slices), 4) * 4);
+}
+
+// Rows `[begin, end)` of the sum of the products of the slices `[first, last)` of the inner dimension, `chunk` deep,
+// added pairwise as by `pairwise_sum` over the slices: through a binary counter holding one partial product per
+// level, in bands of rows. The sum is added to `out`, or written to it with `ASSIGN`.
+template <bool ASSIGN, typename Acc, typename T>
+void gemm_slices(
+    const T* left,
+    const T* right,
+    Acc* out,
+    size_t begin,
+    size_t end,
+    size_t depth,
+    size_t cols,
+    const GemmTiling& tiling,
+    size_t chunk,
+    size_t first,
+    size_t last
+) {
+  // An empty result (whose operands need not be) has nothing to sum, and no band height
+  if (begin == end || cols == 0) {
+    return;
+  }
+  size_t count = last - first;
+  size_t levels = static_cast<size_t>(std::bit_width(count));
+  size_t band = std::clamp<size_t>(DEPTH_SCRATCH / ((levels + 1) * cols), 1, end - begin);
+  PackedBuffer<Acc> scratch((levels + 1) * band * cols);
+  Acc* slots[64];
+  for (size_t row = begin; row < end; row += band) {
+    size_t height = std::min(band, end - row);
+    size_t size = height * cols;
+    for (size_t level = 0; level < levels; ++level) {
+      slots[level] = scratch.data() + level * band * cols;
+    }
+    Acc* spare = scratch.data() + levels * band * cols;
+    for (size_t c = first; c < last; ++c) {
+      size_t k = c * chunk;
+      std::fill_n(spare, size, Acc());
+      gemm_rows_strided(left + row * depth + k, depth, right + k * cols, spare, 0, height, std::min(chunk, depth - k),
+                        cols, tiling);
+      // Slice `c - first` completes the subtrees of the trailing ones of its index
+      size_t level = 0;
+      for (size_t index = c - first; index & 1; index >>= 1, ++level) {
+        add_elements(slots[level], spare, size);
+        std::swap(slots[level], spare);
+      }
+      std::swap(slots[level], spare);
+    }
+    // The subtrees left are those of the bits of `count`, the last one lowest
+    const Acc* sum = nullptr;
+    for (size_t level = 0; level < levels; ++level) {
+      if ((count >> level & 1) != 0) {
+        if (sum != nullptr) {
+          add_elements(slots[level], sum, size);
+        }
+        sum = slots[level];
+      }
+    }
+    if constexpr (ASSIGN) {
+      std::copy_n(sum, size, out + row * cols);
+    } else {
+      add_elements(out + row * cols, sum, size);
+    }
+  }
+}
+
+// `gemm_parallel` with the inner dimension split into slices `chunk` deep. Workers take bands of rows times aligned
+// power-of-two groups of slices, as many groups as it takes to occupy them all; a group is a subtree of the pairwise
+// sum, so the results do not depend on the grouping.
+template <typename Acc, typename T>
+void gemm_split_depth(
+    const T* left,
+    const T* right,
+    Acc* out,
+    size_t rows,
+    size_t depth,
+    size_t cols,
+    const GemmTiling& tiling,
+    size_t chunk
+) {
+  size_t chunks = ceil_div(depth, chunk);
+  size_t workers = ThreadPool::instance().size();
+  size_t row_blocks = max_row_blocks(rows);
+  size_t group = std::bit_ceil(chunks);
+  while (group > 1 && row_blocks * ceil_div(chunks, group) < workers) {
+    group /= 2;
+  }
+  size_t groups = ceil_div(chunks, group);
+  if (groups == 1) {
+    parallel_rows(rows, depth * cols, [&](size_t begin, size_t end) {
+      gemm_slices<false>(left, right, out, begin, end, depth, cols, tiling, chunk, 0, chunks);
+    });
+    return;
+  }
+  PackedBuffer<Acc> sums(groups * rows * cols);
+  ThreadPool::instance().run(row_blocks * groups, [&](size_t item) {
+    size_t g = item % groups;
+    BlockRange range = block_range(rows, row_blocks, item / groups);
+    gemm_slices<true>(left, right, sums.data() + g * rows * cols, range.begin, range.end, depth, cols, tiling, chunk,
+                      g * group, std::min(chunks, (g + 1) * group));
+  });
+  parallel_rows(rows, groups * cols, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      for (size_t stride = 1; stride < groups; stride *= 2) {
+        for (size_t g = 0; g + stride < groups; g += 2 * stride) {
+          add_elements(sums.data() + (g * rows + i) * cols, sums.data() + ((g + stride) * rows + i) * cols, cols);
+        }
+      }
+      add_elements(out + i * cols, sums.data() + i * cols, cols);
+    }
+  });
+}
+
+// `out += left * right` for `rows x depth` times `depth x cols`, all row-major, in parallel over rows, and over
+// slices of the inner dimension when the reduction mode asks for them (see `depth_chunk`)
+template <typename Acc, typename T>
+void gemm_parallel(
+    const T* left,
+    const T* right,
+    Acc* out,
+    size_t rows,
+    size_t depth,
+    size_t cols,
+    const GemmTiling& tiling = {}
+) {
+  size_t chunk = depth_chunk(rows, depth, cols);
+  if (chunk >= depth) {
+    parallel_rows(rows, depth * cols, [&](size_t begin, size_t end) {
+      gemm_rows(left, right, out, begin, end, depth, cols, tiling);
+    });
+  } else {
+    gemm_split_depth(left, right, out, rows, depth, cols, tiling, chunk);
+  }
+}
+
+// Rows `[begin, end)` of `gemm_parallel`, on the calling thread. In reproducible mode they are bit-identical to the
+// same rows of the whole product.
+template <typename Acc, typename T>
+void gemm_rows_ordered(
+    const T* left,
+    const T* right,
+    Acc* out,
+    size_t begin,
+    size_t end,
+    size_t depth,
+    size_t cols,
+    const GemmTiling& tiling = {}
+) {
+  if (reduction_mode() == ReductionMode::Reproducible && depth > REPRODUCIBLE_DEPTH_CHUNK) {
+    size_t chunks = ceil_div(depth, REPRODUCIBLE_DEPTH_CHUNK);
+    gemm_slices<false>(left, right, out, begin, end, depth, cols, tiling, REPRODUCIBLE_DEPTH_CHUNK, 0, chunks);
+  } else {
+    gemm_rows(left, right, out, begin, end, depth, cols, tiling);
+  }
+}
+
+} // namespace detail
+
+// Sum of the elements of `m`, in parallel, in the order of the reduction mode
+template <typename T, typename Layout>
+T sum(const Matrix<T, Layout>& m) {
+  return detail::sum_elements(m.data(), m.size());
+}
+
+} // namespace ct
@@ -0,0 +1,518 @@
+#pragma once
+
+#include "buffer.h"
+#include "compression.h"
+#include "matrix.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <ranges>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#ifdef __linux__
+#include <climits>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Binary wire format of a `Matrix<T>`: a 32-byte header followed by the elements in row-major order.
+//
+//   offset  size  field
+//        0     4  magic "CTMX"
+//        4     1  format version (1)
+//        5     1  flags: bit 0 = compressed payload, bit 1 = big-endian producer
+//        6     1  element kind (see `ElementKind`)
+//        7     1  element size in bytes
+//        8     8  rows
+//       16     8  columns
+//       24     8  payload size in bytes
+//
+// Integers are in the byte order of the producer. An uncompressed payload is the raw bytes of `data()`. A compressed
+// one is a sequence of blocks, each covering `SERIALIZE_BLOCK` bytes of the raw payload (the last one fewer): a
+// 32-bit stored size, with the top bit set when the block is stored raw because it did not compress, followed by
+// that many bytes of `lz_compress` output or raw data.
+
+namespace ct {
+
+// Thrown by `deserialize` for input that is truncated, malformed, or holds another element type
+class SerializationError : public std::exception {
+public:
+  const char* what() const noexcept override {
+    return "ct::SerializationError";
+  }
+};
+
+enum class Compression {
+  None,
+  // LZ4-style block compression, see "compression.h"; blocks are compressed in parallel
+  Lz,
+};
+
+namespace detail {
+
+inline constexpr char SERIALIZE_MAGIC[4] = {'C', 'T', 'M', 'X'};
+inline constexpr uint8_t SERIALIZE_VERSION = 1;
+inline constexpr size_t SERIALIZE_HEADER = 32;
+inline constexpr size_t SERIALIZE_BLOCK = size_t{256} << 10;
+inline constexpr uint32_t RAW_BLOCK = uint32_t{1} << 31;
+
+inline constexpr uint8_t FLAG_COMPRESSED = 1;
+inline constexpr uint8_t FLAG_BIG_ENDIAN = 2;
+
+enum class ElementKind : uint8_t {
+  // Any other trivially copyable type, checked by size only
+  Opaque,
+  Signed,
+  Unsigned,
+  Float,
+};
+
+template <typename T>
+constexpr ElementKind element_kind() {
+  if constexpr (std::is_floating_point_v<T>) {
+    return ElementKind::Float;
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    return ElementKind::Signed;
+  } else if constexpr (std::is_integral_v<T>) {
+    return ElementKind::Unsigned;
+  } else {
+    return ElementKind::Opaque;
+  }
+}
+
+inline constexpr uint8_t native_endian_flag() {
+  return std::endian::native == std::endian::big ? FLAG_BIG_ENDIAN : 0;
+}
+
+struct SerializedHeader {
+  uint8_t flags;
+  ElementKind kind;
+  uint8_t element_size;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t payload;
+};
+
+inline void encode_header(const SerializedHeader& header, unsigned char* out) {
+  std::memcpy(out, SERIALIZE_MAGIC, 4);
+  out[4] = SERIALIZE_VERSION;
+  out[5] = header.flags;
+  out[6] = static_cast<unsigned char>(header.kind);
+  out[7] = header.element_size;
+  std::memcpy(out + 8, &header.rows, 8);
+  std::memcpy(out + 16, &header.cols, 8);
+  std::memcpy(out + 24, &header.payload, 8);
+}
+
+inline SerializedHeader decode_header(const unsigned char* in) {
+  if (std::memcmp(in, SERIALIZE_MAGIC, 4) != 0 || in[4] != SERIALIZE_VERSION ||
+      (in[5] & FLAG_BIG_ENDIAN) != native_endian_flag()) {
+    throw SerializationError();
+  }
+  SerializedHeader header{in[5], static_cast<ElementKind>(in[6]), in[7], 0, 0, 0};
+  std::memcpy(&header.rows, in + 8, 8);
+  std::memcpy(&header.cols, in + 16, 8);
+  std::memcpy(&header.payload, in + 24, 8);
+  return header;
+}
+
+// A piece of the output, written without being copied into a staging buffer first
+struct Slice {
+  const void* data;
+  size_t size;
+};
+
+// Writes slices to a stream
+class StreamWriter {
+public:
+  explicit StreamWriter(std::ostream& out)
+      : out_(out) {}
+
+  void write(const Slice* slices, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      out_.write(static_cast<const char*>(slices[i].data), static_cast<std::streamsize>(slices[i].size));
+    }
+    if (!out_) {
+      throw SerializationError();
+    }
+  }
+
+private:
+  std::ostream& out_;
+};
+
+class StreamReader {
+public:
+  explicit StreamReader(std::istream& in)
+      : in_(in) {}
+
+  void read(void* out, size_t size) {
+    in_.read(static_cast<char*>(out), static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(in_.gcount()) != size) {
+      throw SerializationError();
+    }
+  }
+
+  // Bytes known to be left before the end of the stream; 0 if it cannot seek
+  size_t available() {
+    std::streampos here = in_.tellg();
+    if (here == std::streampos(-1)) {
+      return 0;
+    }
+    if (!in_.seekg(0, std::ios::end)) {
+      in_.clear();
+      return 0;
+    }
+    std::streampos end = in_.tellg();
+    in_.seekg(here);
+    return end > here ? static_cast<size_t>(end - here) : 0;
+  }
+
+private:
+  std::istream& in_;
+};
+
+#ifdef __linux__
+// Gathers slices into as few `writev` calls as possible (`IOV_MAX` slices each), resuming after partial writes
+class FdWriter {
+public:
+  explicit FdWriter(int fd)
+      : fd_(fd) {}
+
+  void write(const Slice* slices, size_t count) {
+    iovec vectors[IOV_MAX];
+    while (count != 0) {
+      size_t batch = std::min<size_t>(count, IOV_MAX);
+      for (size_t i = 0; i < batch; ++i) {
+        vectors[i] = {const_cast<void*>(slices[i].data), slices[i].size};
+      }
+      iovec* next = vectors;
+      size_t remaining = batch;
+      while (remaining != 0) {
+        ssize_t written = writev(fd_, next, static_cast<int>(remaining));
+        if (written < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::system_error(errno, std::generic_category(), "ct::serialize");
+        }
+        size_t done = static_cast<size_t>(written);
+        for (; remaining != 0 && done >= next->iov_len; --remaining) {
+          done -= next->iov_len;
+          ++next;
+        }
+        if (remaining != 0) {
+          next->iov_base = static_cast<char*>(next->iov_base) + done;
+          next->iov_len -= done;
+        }
+      }
+      slices += batch;
+      count -= batch;
+    }
+  }
+
+private:
+  int fd_;
+};
+
+class FdReader {
+public:
+  explicit FdReader(int fd)
+      : fd_(fd) {}
+
+  void read(void* out, size_t size) {
+    char* data = static_cast<char*>(out);
+    while (size != 0) {
+      ssize_t got = ::read(fd_, data, size);
+      if (got < 0 && errno == EINTR) {
+        continue;
+      }
+      if (got < 0) {
+        throw std::system_error(errno, std::generic_category(), "ct::deserialize");
+      }
+      if (got == 0) {
+        throw SerializationError();
+      }
+      data += got;
+      size -= static_cast<size_t>(got);
+    }
+  }
+
+  // Bytes known to be left before the end of the file; 0 for pipes, sockets and other descriptors of unknown size
+  size_t available() const {
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || !S_ISREG(info.st_mode)) {
+      return 0;
+    }
+    off_t here = lseek(fd_, 0, SEEK_CUR);
+    if (here < 0) {
+      return 0;
+    }
+    return here < info.st_size ? static_cast<size_t>(info.st_size - here) : 0;
+  }
+
+private:
+  int fd_;
+};
+#endif
+
+template <typename T>
+SerializedHeader make_header(size_t rows, size_t cols, uint8_t flags, size_t payload) {
+  return {
+      static_cast<uint8_t>(flags | native_endian_flag()),
+      element_kind<T>(),
+      static_cast<uint8_t>(sizeof(T)),
+      rows,
+      cols,
+      payload,
+  };
+}
+
+// Writes a header and an uncompressed payload in one gather: `slices[0]` is filled in with the header, and
+// `slices[1]` to `slices[count - 1]` hold the payload
+template <typename T, typename Writer>
+void write_raw(Writer& writer, size_t rows, size_t cols, Slice* slices, size_t count) {
+  unsigned char header[SERIALIZE_HEADER];
+  encode_header(make_header<T>(rows, cols, 0, rows * cols * sizeof(T)), header);
+  slices[0] = {header, SERIALIZE_HEADER};
+  writer.write(slices, count);
+}
+
+// Compresses `size` bytes in parallel, one block per `SERIALIZE_BLOCK`, and writes a header and the blocks.
+// Blocks that do not shrink are written straight from `data`.
+template <typename T, typename Writer>
+void write_compressed(Writer& writer, size_t rows, size_t cols, const unsigned char* data, size_t size) {
+  size_t blocks = (size + SERIALIZE_BLOCK - 1) / SERIALIZE_BLOCK;
+  size_t bound = lz_compress_bound(SERIALIZE_BLOCK);
+  PackedBuffer<unsigned char> compressed(blocks * bound);
+  PackedBuffer<uint32_t> stored(blocks);
+  parallel_rows(blocks, SERIALIZE_BLOCK, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; ++block) {
+      size_t offset = block * SERIALIZE_BLOCK;
+      size_t raw = std::min(SERIALIZE_BLOCK, size - offset);
+      size_t packed = lz_compress(data + offset, raw, compressed.data() + block * bound);
+      stored[block] = packed < raw ? static_cast<uint32_t>(packed) : static_cast<uint32_t>(raw) | RAW_BLOCK;
+    }
+  });
+
+  PackedBuffer<Slice> slices(1 + 2 * blocks);
+  size_t payload = 0;
+  for (size_t block = 0; block < blocks; ++block) {
+    size_t offset = block * SERIALIZE_BLOCK;
+    bool raw = (stored[block] & RAW_BLOCK) != 0;
+    size_t bytes = stored[block] & ~RAW_BLOCK;
+    slices[1 + 2 * block] = {&stored[block], sizeof(uint32_t)};
+    slices[2 + 2 * block] = {raw ? data + offset : compressed.data() + block * bound, bytes};
+    payload += sizeof(uint32_t) + bytes;
+  }
+  unsigned char header[SERIALIZE_HEADER];
+  encode_header(make_header<T>(rows, cols, FLAG_COMPRESSED, payload), header);
+  slices[0] = {header, SERIALIZE_HEADER};
+  writer.write(slices.data(), slices.size());
+}
+
+template <typename T, typename Writer>
+void write_matrix(Writer& writer, const Matrix<T>& m, Compression compression) {
+  const auto* data = reinterpret_cast<const unsigned char*>(m.data());
+  size_t size = m.size() * sizeof(T);
+  if (compression == Compression::Lz && size != 0) {
+    write_compressed<T>(writer, m.rows(), m.cols(), data, size);
+  } else {
+    Slice slices[2] = {{}, {data, size}};
+    write_raw<T>(writer, m.rows(), m.cols(), slices, 2);
+  }
+}
+
+// Destination of the raw payload bytes. When the input holds at least as many bytes as the header declares, they go
+// straight into the matrix; otherwise into a staging buffer that doubles as they arrive, so that a header declaring
+// more than the input holds runs out of input instead of allocating what it declares.
+template <typename T>
+class PayloadSink {
+public:
+  PayloadSink(size_t rows, size_t cols, bool staged)
+      : rows_(rows)
+      , cols_(cols)
+      , size_(rows * cols * sizeof(T)) {
+    if (staged) {
+      staged_ = PackedBuffer<unsigned char>(std::min(size_, SERIALIZE_BLOCK));
+    } else {
+      matrix_ = uninitialized_matrix<T>(rows, cols);
+    }
+  }
+
+  // Bytes that fit without growing the buffer
+  size_t capacity() const {
+    return matrix_.empty() ? staged_.size() : size_;
+  }
+
+  // The buffer, grown to hold at least the first `end` bytes
+  unsigned char* reserve(size_t end) {
+    if (!matrix_.empty()) {
+      return reinterpret_cast<unsigned char*>(matrix_.data());
+    }
+    if (end > staged_.size()) {
+      PackedBuffer<unsigned char> grown(std::min(size_, std::max(end, 2 * staged_.size())));
+      std::copy_n(staged_.data(), staged_.size(), grown.data());
+      staged_ = std::move(grown);
+    }
+    return staged_.data();
+  }
+
+  // The matrix, once all of its bytes arrived
+  Matrix<T> finish() {
+    if (matrix_.empty()) {
+      matrix_ = uninitialized_matrix<T>(rows_, cols_);
+      copy_elements(staged_.data(), reinterpret_cast<unsigned char*>(matrix_.data()), size_);
+    }
+    return std::move(matrix_);
+  }
+
+private:
+  size_t rows_;
+  size_t cols_;
+  size_t size_;
+  Matrix<T> matrix_;
+  PackedBuffer<unsigned char> staged_;
+};
+
+template <typename T, typename Reader>
+Matrix<T> read_matrix(Reader& reader) {
+  unsigned char encoded[SERIALIZE_HEADER];
+  reader.read(encoded, SERIALIZE_HEADER);
+  SerializedHeader header = decode_header(encoded);
+  if (header.kind != element_kind<T>() || header.element_size != sizeof(T)) {
+    throw SerializationError();
+  }
+  if (header.rows == 0 || header.cols == 0) {
+    if (header.payload != 0) {
+      throw SerializationError();
+    }
+    return Matrix<T>();
+  }
+  if (header.cols > std::numeric_limits<size_t>::max() / sizeof(T) / header.rows) {
+    throw SerializationError();
+  }
+  size_t size = header.rows * header.cols * sizeof(T);
+  bool compressed = (header.flags & FLAG_COMPRESSED) != 0;
+  // Every compressed block starts with its 32-bit stored size
+  if (compressed ? header.payload / sizeof(uint32_t) < (size - 1) / SERIALIZE_BLOCK + 1 : header.payload != size) {
+    throw SerializationError();
+  }
+
+  PayloadSink<T> sink(header.rows, header.cols, size > reader.available());
+  if (!compressed) {
+    for (size_t offset = 0; offset < size;) {
+      size_t end = std::max(sink.capacity(), std::min(size, offset + SERIALIZE_BLOCK));
+      reader.read(sink.reserve(end) + offset, end - offset);
+      offset = end;
+    }
+    return sink.finish();
+  }
+  PackedBuffer<unsigned char> block(lz_compress_bound(SERIALIZE_BLOCK));
+  size_t payload = 0;
+  for (size_t offset = 0; offset < size; offset += SERIALIZE_BLOCK) {
+    size_t raw = std::min(SERIALIZE_BLOCK, size - offset);
+    uint32_t stored;
+    reader.read(&stored, sizeof(stored));
+    size_t bytes = stored & ~RAW_BLOCK;
+    unsigned char* data = sink.reserve(offset + raw) + offset;
+    if ((stored & RAW_BLOCK) != 0) {
+      if (bytes != raw) {
+        throw SerializationError();
+      }
+      reader.read(data, raw);
+    } else {
+      if (bytes > block.size()) {
+        throw SerializationError();
+      }
+      reader.read(block.data(), bytes);
+      if (!lz_decompress(block.data(), bytes, data, raw)) {
+        throw SerializationError();
+      }
+    }
+    payload += sizeof(stored) + bytes;
+  }
+  if (payload != header.payload) {
+    throw SerializationError();
+  }
+  return sink.finish();
+}
+
+} // namespace detail
+
+// Writes `m` to `out` in the binary wire format described at the top of "serialize.h"
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void serialize(std::ostream& out, const Matrix<T>& m, Compression compression = Compression::None) {
+  detail::StreamWriter writer(out);
+  detail::write_matrix(writer, m, compression);
+}
+
+// Reads a matrix written by `serialize`; throws `SerializationError` for malformed input or another element type
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+Matrix<T> deserialize(std::istream& in) {
+  detail::StreamReader reader(in);
+  return detail::read_matrix<T>(reader);
+}
+
+#ifdef __linux__
+// Writes `m` to the file descriptor `fd` (a file, pipe or socket) with `writev`: the header and the element buffer,
+// or the header and the compressed blocks, are gathered into one call without being staged in a common buffer.
+// Throws `std::system_error` if writing fails.
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void serialize(int fd, const Matrix<T>& m, Compression compression = Compression::None) {
+  detail::FdWriter writer(fd);
+  detail::write_matrix(writer, m, compression);
+}
+
+// Writes the matrix made of `count` rows, e.g. `RowView`s picked from one or several matrices, to `fd`. Each row goes
+// into the `writev` call as is, so no rows are copied. Read back with `deserialize`. Throws `std::invalid_argument`,
+// before writing anything, if the rows are not all of the same length.
+template <std::ranges::contiguous_range Row>
+  requires std::is_trivially_copyable_v<std::ranges::range_value_t<Row>>
+void serialize_rows(int fd, const Row* rows, size_t count) {
+  using T = std::ranges::range_value_t<Row>;
+  size_t cols = count == 0 ? 0 : std::ranges::size(rows[0]);
+  for (size_t i = 1; i < count; ++i) {
+    if (std::ranges::size(rows[i]) != cols) {
+      throw std::invalid_argument("ct::serialize_rows: rows of different lengths");
+    }
+  }
+  if (cols == 0) {
+    count = 0;
+  }
+  detail::PackedBuffer<detail::Slice> slices(1 + count);
+  for (size_t i = 0; i < count; ++i) {
+    slices[1 + i] = {std::ranges::data(rows[i]), cols * sizeof(T)};
+  }
+  detail::FdWriter writer(fd);
+  detail::write_raw<T>(writer, count, cols, slices.data(), slices.size());
+}
+
+// Reads a matrix written by `serialize` or `serialize_rows` from `fd`. Uncompressed elements from a regular file
+// are read straight into the matrix buffer; from a pipe or socket, which cannot tell how much is left to read, they
+// are staged as they arrive. Throws `SerializationError` for malformed input or another element type, and
+// `std::system_error` if reading fails.
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+Matrix<T> deserialize(int fd) {
+  detail::FdReader reader(fd);
+  return detail::read_matrix<T>(reader);
+}
+#endif
+
+} // namespace ct
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "copy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace ct {
+
+namespace detail {
+
+inline std::atomic<size_t> column_prefetch_distance_setting{8};
+
+} // namespace detail
+
+// Number of elements ahead that column algorithms (`ColView::operator*=`, `ColView::accumulate`) prefetch. Every
+// step down a column of a row-major matrix lands on a different cache line, often on a different page, which the
+// hardware prefetcher does not follow for wide matrices. `0` disables prefetching.
+inline size_t column_prefetch_distance() {
+  return detail::column_prefetch_distance_setting.load(std::memory_order_relaxed);
+}
+
+inline void set_column_prefetch_distance(size_t distance) {
+  detail::column_prefetch_distance_setting.store(distance, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+// Hints that `*address` is about to be read (or written with `WRITE`)
+template <bool WRITE = false>
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, WRITE ? 1 : 0, 3);
+#else
+  static_cast<void>(address);
+#endif
+}
+
+// Bytes computed into a cached scratch buffer before being streamed out by `stream_generate`
+inline constexpr size_t STREAM_CHUNK = 4096;
+
+// Elements that `stream_generate` can write into raw memory
+template <typename T>
+inline constexpr bool STREAMABLE = std::is_trivially_copyable_v<T> && std::is_trivially_default_constructible_v<T>;
+
+// Elementwise results at least this many times the size of the LLC bypass the cache (see `last_level_cache_size`).
+// Unlike a copy, the result is computed from operands that go through the cache, and only well above the LLC size
+// do streaming stores beat writing through the cache.
+inline constexpr size_t STREAMING_STORE_LLC_FACTOR = 4;
+
+// Whether an elementwise result of `count` elements is written with streaming stores
+template <typename T>
+bool wants_streaming_store(size_t count) {
+  return STREAMABLE<T> && count * sizeof(T) >= STREAMING_STORE_LLC_FACTOR * last_level_cache_size();
+}
+
+// `out[i] = f(i)` for `i` in `[0, count)`, written with non-temporal stores. `out` may be raw memory. The values are
+// computed a chunk at a time into a scratch buffer that stays in L1, and each chunk is then streamed out.
+template <typename T, typename F>
+  requires STREAMABLE<T>
+void stream_generate(T* out, size_t count, const F& f) {
+  constexpr size_t CHUNK = std::max<size_t>(1, STREAM_CHUNK / sizeof(T));
+  T scratch[CHUNK];
+  for (size_t begin = 0; begin < count; begin += CHUNK) {
+    size_t size = std::min(CHUNK, count - begin);
+    for (size_t i = 0; i < size; ++i) {
+      scratch[i] = f(begin + i);
+    }
+    stream_copy(scratch, out + begin, size * sizeof(T));
+  }
+}
+
+} // namespace detail
+
+} // namespace ct
@@ -0,0 +1,637 @@
+#pragma once
+
+#include "buffer.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <utility>
+
+namespace ct {
+
+enum class Triangle {
+  Lower,
+  Upper,
+};
+
+template <typename T>
+class SymmetricMatrix;
+
+template <typename T, Triangle TRI>
+class TriangularMatrix;
+
+template <typename T>
+class BandMatrix;
+
+namespace detail {
+
+// Read-only iterator over a row (`ROW`) or a column of a structured matrix `M`. Elements are read through
+// `M::operator() const`, so the ones outside the stored part come out as zeros.
+template <typename M, bool ROW>
+class LineIterator {
+public:
+  using value_type = typename M::ValueType;
+  using reference = decltype(std::declval<const M&>()(0, 0));
+  using difference_type = std::ptrdiff_t;
+  using iterator_concept = std::random_access_iterator_tag;
+  using iterator_category = std::input_iterator_tag;
+
+public:
+  LineIterator() = default;
+
+  reference operator*() const {
+    return (*this)[0];
+  }
+
+  reference operator[](difference_type n) const {
+    size_t index = static_cast<size_t>(index_ + n);
+    return ROW ? (*matrix_)(line_, index) : (*matrix_)(index, line_);
+  }
+
+  LineIterator& operator++() {
+    ++index_;
+    return *this;
+  }
+
+  LineIterator operator++(int) {
+    LineIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  LineIterator& operator--() {
+    --index_;
+    return *this;
+  }
+
+  LineIterator operator--(int) {
+    LineIterator tmp = *this;
+    --*this;
+    return tmp;
+  }
+
+  LineIterator& operator+=(difference_type n) {
+    index_ += n;
+    return *this;
+  }
+
+  LineIterator& operator-=(difference_type n) {
+    index_ -= n;
+    return *this;
+  }
+
+  friend LineIterator operator+(LineIterator it, difference_type n) {
+    return it += n;
+  }
+
+  friend LineIterator operator+(difference_type n, LineIterator it) {
+    return it += n;
+  }
+
+  friend LineIterator operator-(LineIterator it, difference_type n) {
+    return it -= n;
+  }
+
+  friend difference_type operator-(const LineIterator& left, const LineIterator& right) {
+    return left.index_ - right.index_;
+  }
+
+  friend bool operator==(const LineIterator& left, const LineIterator& right) {
+    return left.matrix_ == right.matrix_ && left.line_ == right.line_ && left.index_ == right.index_;
+  }
+
+  friend auto operator<=>(const LineIterator& left, const LineIterator& right) {
+    return left.index_ <=> right.index_;
+  }
+
+private:
+  LineIterator(const M* matrix, size_t line, difference_type index)
+      : matrix_(matrix)
+      , line_(line)
+      , index_(index) {}
+
+  template <typename U, bool R>
+  friend class LineView;
+
+private:
+  const M* matrix_ = nullptr;
+  size_t line_ = 0;
+  difference_type index_ = 0;
+};
+
+// Read-only view of a row (`ROW`) or a column of a structured matrix `M`
+template <typename M, bool ROW>
+class LineView : public std::ranges::view_interface<LineView<M, ROW>> {
+public:
+  using Iterator = LineIterator<M, ROW>;
+
+public:
+  LineView() = default;
+
+  Iterator begin() const {
+    return {matrix_, line_, 0};
+  }
+
+  Iterator end() const {
+    return {matrix_, line_, static_cast<std::ptrdiff_t>(size())};
+  }
+
+  size_t size() const {
+    return matrix_ == nullptr ? 0 : ROW ? matrix_->cols() : matrix_->rows();
+  }
+
+private:
+  LineView(const M* matrix, size_t line)
+      : matrix_(matrix)
+      , line_(line) {}
+
+  template <typename U>
+  friend class ct::SymmetricMatrix;
+
+  template <typename U, Triangle TRI>
+  friend class ct::TriangularMatrix;
+
+  template <typename U>
+  friend class ct::BandMatrix;
+
+private:
+  const M* matrix_ = nullptr;
+  size_t line_ = 0;
+};
+
+// Contiguous stored part of a row of a structured matrix: columns `[first, last)`, starting at `data`
+template <typename T>
+struct RowSegment {
+  const T* data;
+  size_t first;
+  size_t last;
+};
+
+// `out[i][j] += sum_k left(i, k) * right[k][j]` for rows `i` in `[begin, end)`, where the nonzeros of row `i` of
+// `left` form the contiguous segment `segment(i)`. Blocked like `gemm_rows`, so every tile of `right` is reused for
+// all rows of the block whose segments reach into it, and no work is spent on the zeros outside the segments.
+template <typename T, typename Segment>
+void segment_rows_product(
+    Segment segment,
+    const T* right,
+    T* out,
+    size_t begin,
+    size_t end,
+    size_t cols,
+    const GemmTiling& tiling = {}
+) {
+  size_t depth_first = std::numeric_limits<size_t>::max();
+  size_t depth_last = 0;
+  for (size_t i = begin; i < end; ++i) {
+    RowSegment<T> s = segment(i);
+    depth_first = std::min(depth_first, s.first);
+    depth_last = std::max(depth_last, s.last);
+  }
+  for (size_t col_begin = 0; col_begin < cols; col_begin += tiling.col_tile) {
+    size_t width = std::min(cols - col_begin, tiling.col_tile);
+    for (size_t depth_begin = depth_first; depth_begin < depth_last; depth_begin += tiling.depth_tile) {
+      size_t depth_end = std::min(depth_last, depth_begin + tiling.depth_tile);
+      for (size_t i = begin; i < end; ++i) {
+        RowSegment<T> s = segment(i);
+        size_t k_begin = std::max(s.first, depth_begin);
+        size_t k_end = std::min(s.last, depth_end);
+        if (k_begin < k_end) {
+          gemm_tile(
+              s.data + (k_begin - s.first),
+              0,
+              right + k_begin * cols + col_begin,
+              cols,
+              out + i * cols + col_begin,
+              cols,
+              0,
+              1,
+              k_end - k_begin,
+              width
+          );
+        }
+      }
+    }
+  }
+}
+
+// Index of `(row, col)` in a packed triangle of order `n`; `(row, col)` must lie in the triangle
+template <Triangle TRI>
+size_t packed_index(size_t n, size_t row, size_t col) {
+  if constexpr (TRI == Triangle::Lower) {
+    static_cast<void>(n);
+    return row * (row + 1) / 2 + col;
+  } else {
+    return row * (2 * n - row + 1) / 2 + (col - row);
+  }
+}
+
+} // namespace detail
+
+// Square symmetric matrix storing only its lower triangle, `n * (n + 1) / 2` elements.
+// `m(i, j)` and `m(j, i)` refer to the same element.
+template <typename T>
+class SymmetricMatrix {
+public:
+  using ValueType = T;
+
+  using Reference = T&;
+  using ConstReference = const T&;
+
+  using ConstRowView = detail::LineView<SymmetricMatrix, true>;
+  using ConstColView = detail::LineView<SymmetricMatrix, false>;
+
+public:
+  SymmetricMatrix() = default;
+
+  explicit SymmetricMatrix(size_t n)
+      : storage_(n * (n + 1) / 2)
+      , n_(n) {}
+
+  // Lower triangle of the square matrix `m`
+  explicit SymmetricMatrix(const Matrix<T>& m)
+      : SymmetricMatrix(m.rows()) {
+    for (size_t i = 0; i < n_; ++i) {
+      std::copy_n(m.row_begin(i), i + 1, storage_.data() + row_offset(i));
+    }
+  }
+
+  SymmetricMatrix(const SymmetricMatrix&) = default;
+  SymmetricMatrix& operator=(const SymmetricMatrix&) = default;
+
+  // Moving leaves `other` empty
+  SymmetricMatrix(SymmetricMatrix&& other) noexcept
+      : storage_(std::move(other.storage_))
+      , n_(std::exchange(other.n_, 0)) {}
+
+  SymmetricMatrix& operator=(SymmetricMatrix&& other) noexcept {
+    storage_ = std::move(other.storage_);
+    n_ = std::exchange(other.n_, 0);
+    return *this;
+  }
+
+  size_t rows() const {
+    return n_;
+  }
+
+  size_t cols() const {
+    return n_;
+  }
+
+  // Number of stored elements
+  size_t stored_size() const {
+    return storage_.size();
+  }
+
+  bool empty() const {
+    return n_ == 0;
+  }
+
+  Reference operator()(size_t row, size_t col) {
+    return storage_[index(row, col)];
+  }
+
+  ConstReference operator()(size_t row, size_t col) const {
+    return storage_[index(row, col)];
+  }
+
+  ConstRowView row(size_t row) const {
+    return {this, row};
+  }
+
+  ConstColView col(size_t col) const {
+    return {this, col};
+  }
+
+  Matrix<T> to_dense() const {
+    Matrix<T> result(n_, n_);
+    for (size_t i = 0; i < n_; ++i) {
+      for (size_t j = 0; j <= i; ++j) {
+        result(i, j) = result(j, i) = (*this)(i, j);
+      }
+    }
+    return result;
+  }
+
+  friend bool operator==(const SymmetricMatrix& left, const SymmetricMatrix& right) = default;
+
+  // SYMM. Rows of `left` are unpacked a block at a time into a small buffer and fed to the dense kernel, so `left`
+  // is read from memory at half the traffic of its dense counterpart while the product runs at full kernel speed.
+  friend Matrix<T> operator*(const SymmetricMatrix& left, const Matrix<T>& right) {
+    size_t n = left.n_;
+    size_t cols = right.cols();
+    Matrix<T> result(n, cols, right.allocation_policy());
+    if (result.empty()) {
+      return result;
+    }
+    const T* in = right.data();
+    T* out = result.data();
+    detail::parallel_rows(n, n * cols, [&](size_t begin, size_t end) {
+      T* unpacked = new T[std::min(end - begin, ROW_BLOCK) * n];
+      for (size_t block = begin; block < end; block += ROW_BLOCK) {
+        size_t block_end = std::min(end, block + ROW_BLOCK);
+        for (size_t i = block; i < block_end; ++i) {
+          T* row = unpacked + (i - block) * n;
+          std::copy_n(left.storage_.data() + row_offset(i), i + 1, row);
+          for (size_t j = i + 1; j < n; ++j) {
+            row[j] = left.storage_[row_offset(j) + i];
+          }
+        }
+        detail::gemm_rows(unpacked, in, out + block * cols, 0, block_end - block, n, cols);
+      }
+      delete[] unpacked;
+    });
+    return result;
+  }
+
+private:
+  // Rows unpacked at a time by the product
+  static constexpr size_t ROW_BLOCK = 64;
+
+  static size_t row_offset(size_t row) {
+    return row * (row + 1) / 2;
+  }
+
+  static size_t index(size_t row, size_t col) {
+    return row >= col ? row_offset(row) + col : row_offset(col) + row;
+  }
+
+private:
+  detail::PackedBuffer<T> storage_;
+  size_t n_ = 0;
+};
+
+// Square lower or upper triangular matrix storing only its triangle, `n * (n + 1) / 2` elements.
+// Elements outside the triangle read as zero through the const accessors and must not be written.
+template <typename T, Triangle TRI = Triangle::Lower>
+class TriangularMatrix {
+public:
+  using ValueType = T;
+
+  using Reference = T&;
+
+  using ConstRowView = detail::LineView<TriangularMatrix, true>;
+  using ConstColView = detail::LineView<TriangularMatrix, false>;
+
+public:
+  TriangularMatrix() = default;
+
+  explicit TriangularMatrix(size_t n)
+      : storage_(n * (n + 1) / 2)
+      , n_(n) {}
+
+  // Triangle `TRI` of the square matrix `m`; the other triangle is ignored
+  explicit TriangularMatrix(const Matrix<T>& m)
+      : TriangularMatrix(m.rows()) {
+    for (size_t i = 0; i < n_; ++i) {
+      detail::RowSegment<T> s = segment(i);
+      std::copy(m.row_begin(i) + s.first, m.row_begin(i) + s.last, storage_.data() + index(i, s.first));
+    }
+  }
+
+  TriangularMatrix(const TriangularMatrix&) = default;
+  TriangularMatrix& operator=(const TriangularMatrix&) = default;
+
+  // Moving leaves `other` empty
+  TriangularMatrix(TriangularMatrix&& other) noexcept
+      : storage_(std::move(other.storage_))
+      , n_(std::exchange(other.n_, 0)) {}
+
+  TriangularMatrix& operator=(TriangularMatrix&& other) noexcept {
+    storage_ = std::move(other.storage_);
+    n_ = std::exchange(other.n_, 0);
+    return *this;
+  }
+
+  size_t rows() const {
+    return n_;
+  }
+
+  size_t cols() const {
+    return n_;
+  }
+
+  size_t stored_size() const {
+    return storage_.size();
+  }
+
+  bool empty() const {
+    return n_ == 0;
+  }
+
+  // Whether `(row, col)` lies in the stored triangle
+  bool stored(size_t row, size_t col) const {
+    return TRI == Triangle::Lower ? col <= row : row <= col;
+  }
+
+  // `(row, col)` must lie in the stored triangle
+  Reference operator()(size_t row, size_t col) {
+    return storage_[index(row, col)];
+  }
+
+  T operator()(size_t row, size_t col) const {
+    return stored(row, col) ? storage_[index(row, col)] : T();
+  }
+
+  ConstRowView row(size_t row) const {
+    return {this, row};
+  }
+
+  ConstColView col(size_t col) const {
+    return {this, col};
+  }
+
+  Matrix<T> to_dense() const {
+    Matrix<T> result(n_, n_);
+    for (size_t i = 0; i < n_; ++i) {
+      detail::RowSegment<T> s = segment(i);
+      std::copy(s.data, s.data + (s.last - s.first), result.row_begin(i) + s.first);
+    }
+    return result;
+  }
+
+  friend bool operator==(const TriangularMatrix& left, const TriangularMatrix& right) = default;
+
+  // TRMM: only the triangle is multiplied, about half the multiply-adds of the dense product
+  friend Matrix<T> operator*(const TriangularMatrix& left, const Matrix<T>& right) {
+    Matrix<T> result(left.n_, right.cols(), right.allocation_policy());
+    if (result.empty()) {
+      return result;
+    }
+    const T* in = right.data();
+    T* out = result.data();
+    detail::parallel_rows(left.n_, left.n_ * right.cols() / 2, [&](size_t begin, size_t end) {
+      detail::segment_rows_product([&left](size_t i) { return left.segment(i); }, in, out, begin, end, right.cols());
+    });
+    return result;
+  }
+
+private:
+  size_t index(size_t row, size_t col) const {
+    return detail::packed_index<TRI>(n_, row, col);
+  }
+
+  detail::RowSegment<T> segment(size_t row) const {
+    size_t first = TRI == Triangle::Lower ? 0 : row;
+    size_t last = TRI == Triangle::Lower ? row + 1 : n_;
+    return {storage_.data() + index(row, first), first, last};
+  }
+
+private:
+  detail::PackedBuffer<T> storage_;
+  size_t n_ = 0;
+};
+
+// `rows x cols` band matrix with `lower` subdiagonals and `upper` superdiagonals, stored row by row with
+// `lower + upper + 1` slots per row: `m(i, j)` lives at slot `j - i + lower` of row `i`. Elements outside the band
+// read as zero through the const accessors and must not be written.
+template <typename T>
+class BandMatrix {
+public:
+  using ValueType = T;
+
+  using Reference = T&;
+
+  using ConstRowView = detail::LineView<BandMatrix, true>;
+  using ConstColView = detail::LineView<BandMatrix, false>;
+
+public:
+  BandMatrix() = default;
+
+  BandMatrix(size_t rows, size_t cols, size_t lower, size_t upper)
+      : storage_(rows * (lower + upper + 1))
+      , rows_(rows)
+      , cols_(cols)
+      , lower_(lower)
+      , upper_(upper) {}
+
+  // The band of `m`; elements outside of it are ignored
+  BandMatrix(const Matrix<T>& m, size_t lower, size_t upper)
+      : BandMatrix(m.rows(), m.cols(), lower, upper) {
+    for (size_t i = 0; i < rows_; ++i) {
+      detail::RowSegment<T> s = segment(i);
+      std::copy(m.row_begin(i) + s.first, m.row_begin(i) + s.last, storage_.data() + index(i, s.first));
+    }
+  }
+
+  BandMatrix(const BandMatrix&) = default;
+  BandMatrix& operator=(const BandMatrix&) = default;
+
+  // Moving leaves `other` empty
+  BandMatrix(BandMatrix&& other) noexcept
+      : storage_(std::move(other.storage_))
+      , rows_(std::exchange(other.rows_, 0))
+      , cols_(std::exchange(other.cols_, 0))
+      , lower_(std::exchange(other.lower_, 0))
+      , upper_(std::exchange(other.upper_, 0)) {}
+
+  BandMatrix& operator=(BandMatrix&& other) noexcept {
+    storage_ = std::move(other.storage_);
+    rows_ = std::exchange(other.rows_, 0);
+    cols_ = std::exchange(other.cols_, 0);
+    lower_ = std::exchange(other.lower_, 0);
+    upper_ = std::exchange(other.upper_, 0);
+    return *this;
+  }
+
+  size_t rows() const {
+    return rows_;
+  }
+
+  size_t cols() const {
+    return cols_;
+  }
+
+  size_t lower() const {
+    return lower_;
+  }
+
+  size_t upper() const {
+    return upper_;
+  }
+
+  size_t stored_size() const {
+    return storage_.size();
+  }
+
+  bool empty() const {
+    return rows_ == 0 || cols_ == 0;
+  }
+
+  // Whether `(row, col)` lies in the band
+  bool stored(size_t row, size_t col) const {
+    return col + lower_ >= row && col <= row + upper_;
+  }
+
+  // `(row, col)` must lie in the band
+  Reference operator()(size_t row, size_t col) {
+    return storage_[index(row, col)];
+  }
+
+  T operator()(size_t row, size_t col) const {
+    return stored(row, col) ? storage_[index(row, col)] : T();
+  }
+
+  ConstRowView row(size_t row) const {
+    return {this, row};
+  }
+
+  ConstColView col(size_t col) const {
+    return {this, col};
+  }
+
+  Matrix<T> to_dense() const {
+    Matrix<T> result(rows_, cols_);
+    for (size_t i = 0; i < rows_ && !result.empty(); ++i) {
+      detail::RowSegment<T> s = segment(i);
+      std::copy(s.data, s.data + (s.last - s.first), result.row_begin(i) + s.first);
+    }
+    return result;
+  }
+
+  friend bool operator==(const BandMatrix& left, const BandMatrix& right) = default;
+
+  // Banded times dense: `lower + upper + 1` multiply-adds per output element instead of `cols()`
+  friend Matrix<T> operator*(const BandMatrix& left, const Matrix<T>& right) {
+    Matrix<T> result(left.rows_, right.cols(), right.allocation_policy());
+    if (result.empty() || left.empty()) {
+      return result;
+    }
+    const T* in = right.data();
+    T* out = result.data();
+    size_t band = left.lower_ + left.upper_ + 1;
+    detail::parallel_rows(left.rows_, band * right.cols(), [&](size_t begin, size_t end) {
+      detail::segment_rows_product([&left](size_t i) { return left.segment(i); }, in, out, begin, end, right.cols());
+    });
+    return result;
+  }
+
+private:
+  size_t index(size_t row, size_t col) const {
+    return row * (lower_ + upper_ + 1) + (col + lower_ - row);
+  }
+
+  // Columns of row `row` that lie both in the band and in the matrix
+  detail::RowSegment<T> segment(size_t row) const {
+    size_t first = row > lower_ ? row - lower_ : 0;
+    size_t last = std::min(cols_, row + upper_ + 1);
+    if (first >= last) {
+      return {storage_.data(), last, last};
+    }
+    return {storage_.data() + index(row, first), first, last};
+  }
+
+private:
+  detail::PackedBuffer<T> storage_;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  size_t lower_ = 0;
+  size_t upper_ = 0;
+};
+
+} // namespace ct
@@ -0,0 +1,332 @@
+#pragma once
+
+#include "kernels.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+// Shape-specialized blocking of the product kernel, tuned on the host at run time.
+//
+// Products are classified by the shape of their operands (`classify_shape`). The first large enough product of
+// each element type and shape class times the candidate blockings (`TUNING_CANDIDATES`) on a strip of its own
+// operands and keeps the fastest. Tuning is kept in memory unless `CT_TUNING_FILE` names a tuning file: then the
+// winners are written to it and read back by later processes, so a host sharing the file is tuned once (its
+// directory is created if needed). The file holds one line per tuned case:
+//
+//   f8 square 128 512    // element kind and size, shape class, depth tile, column tile
+
+namespace ct {
+
+// Shapes of `rows x depth` times `depth x cols` products, which favour different blockings
+enum class ShapeClass {
+  Square,     // no dimension dominates
+  TallSkinny, // many rows of a narrow product
+  ShortWide,  // few rows of a wide product
+  Deep,       // long inner dimension, small output
+  Shallow,    // short inner dimension, large output (rank-k update)
+};
+
+inline constexpr size_t SHAPE_CLASSES = 5;
+
+// Ratio from which a dimension counts as dominating the others
+inline constexpr size_t SHAPE_RATIO = 8;
+
+constexpr ShapeClass classify_shape(size_t rows, size_t depth, size_t cols) {
+  if (rows >= SHAPE_RATIO * std::max(depth, cols)) {
+    return ShapeClass::TallSkinny;
+  }
+  if (cols >= SHAPE_RATIO * std::max(rows, depth)) {
+    return ShapeClass::ShortWide;
+  }
+  if (depth >= SHAPE_RATIO * std::max(rows, cols)) {
+    return ShapeClass::Deep;
+  }
+  if (SHAPE_RATIO * depth <= std::min(rows, cols)) {
+    return ShapeClass::Shallow;
+  }
+  return ShapeClass::Square;
+}
+
+constexpr const char* shape_class_name(ShapeClass shape) {
+  switch (shape) {
+    case ShapeClass::Square:
+      return "square";
+    case ShapeClass::TallSkinny:
+      return "tall-skinny";
+    case ShapeClass::ShortWide:
+      return "short-wide";
+    case ShapeClass::Deep:
+      return "deep";
+    case ShapeClass::Shallow:
+      return "shallow";
+  }
+  return "";
+}
+
+namespace detail {
+
+// Blockings timed by the tuner. Depth tiles are multiples of the four rows `gemm_tile` consumes per pass, so every
+// candidate adds the products of an element in the same order and gives bit-identical results.
+inline constexpr GemmTiling TUNING_CANDIDATES[] = {
+    {64, 256},
+    {64, 512},
+    {64, 1024},
+    {128, 256},
+    {128, 512},
+    {128, 1024},
+    {256, 256},
+    {256, 512},
+    {256, 1024},
+};
+
+// Products doing less work than this (in multiply-adds) use the blocking already known for their case, and do not
+// trigger tuning: timing the candidates costs about as much as one such product
+inline constexpr size_t TUNING_THRESHOLD = size_t{1} << 27;
+
+// Multiply-adds each candidate is timed on
+inline constexpr size_t TUNING_WORK = size_t{1} << 22;
+
+// Timed runs per candidate; the fastest counts
+inline constexpr size_t TUNING_RUNS = 3;
+
+// Element types are tuned by kind and size: floating-point, signed and unsigned integers of 1 to 16 bytes
+inline constexpr size_t TUNING_KINDS = 3;
+inline constexpr size_t TUNING_SIZES = 5;
+inline constexpr char TUNING_KIND_NAMES[TUNING_KINDS] = {'f', 'i', 'u'};
+
+template <typename T>
+inline constexpr bool TUNABLE = std::is_arithmetic_v<T> && sizeof(T) <= 16 && std::has_single_bit(sizeof(T));
+
+template <typename T>
+constexpr size_t tuning_type(ShapeClass shape) {
+  size_t kind = std::is_floating_point_v<T> ? 0 : std::is_signed_v<T> ? 1 : 2;
+  size_t size = static_cast<size_t>(std::countr_zero(sizeof(T)));
+  return (kind * TUNING_SIZES + size) * SHAPE_CLASSES + static_cast<size_t>(shape);
+}
+
+} // namespace detail
+
+// Process-wide table of tuned blockings, optionally backed by a tuning file. Looking up a tuned case takes no lock;
+// the first product of an untuned case times the candidates without holding any lock either, and products of the
+// same case meanwhile use the default blocking.
+class KernelTuner {
+public:
+  // Loads the default tuning file on first use
+  static KernelTuner& instance() {
+    static KernelTuner tuner(default_path());
+    return tuner;
+  }
+
+  // `CT_TUNING_FILE`, or empty (tuning in memory only) if it is not set
+  static std::string default_path() {
+    const char* file = std::getenv("CT_TUNING_FILE");
+    return file != nullptr ? file : "";
+  }
+
+  KernelTuner(const KernelTuner&) = delete;
+  KernelTuner& operator=(const KernelTuner&) = delete;
+
+  // Blocking for `left * right` (`rows x depth` times `depth x cols`, row-major), tuning the case on `left` and
+  // `right` first if it is unknown, the product is large enough and no other thread is tuning it already
+  template <typename T>
+  detail::GemmTiling tiling(const T* left, const T* right, size_t rows, size_t depth, size_t cols) {
+    if constexpr (!detail::TUNABLE<T>) {
+      return {};
+    } else {
+      if (rows * depth * cols < detail::PARALLEL_THRESHOLD) {
+        return {};
+      }
+      size_t slot = detail::tuning_type<T>(classify_shape(rows, depth, cols));
+      uint64_t packed = slots_[slot].load(std::memory_order_acquire);
+      if (packed != UNTUNED) {
+        return unpack(packed);
+      }
+      if (rows * depth * cols < detail::TUNING_THRESHOLD || tuning_[slot].exchange(true, std::memory_order_acquire)) {
+        return {};
+      }
+      detail::GemmTiling best = measure(left, right, rows, depth, cols);
+      {
+        std::lock_guard lock(mutex_);
+        slots_[slot].store(pack(best), std::memory_order_release);
+        save_locked();
+      }
+      tuning_[slot].store(false, std::memory_order_release);
+      return best;
+    }
+  }
+
+  // Whether products of `T` of shape class `shape` have a tuned blocking, and which
+  template <typename T>
+  bool tuned(ShapeClass shape) const {
+    return detail::TUNABLE<T> && slots_[detail::tuning_type<T>(shape)].load(std::memory_order_acquire) != UNTUNED;
+  }
+
+  template <typename T>
+  detail::GemmTiling tiling(ShapeClass shape) const {
+    if (!detail::TUNABLE<T>) {
+      return {};
+    }
+    uint64_t packed = slots_[detail::tuning_type<T>(shape)].load(std::memory_order_acquire);
+    return packed == UNTUNED ? detail::GemmTiling{} : unpack(packed);
+  }
+
+  // Forgets every tuned blocking and switches to the tuning file `path` (none if empty), loading it
+  void reset(const std::string& path) {
+    std::lock_guard lock(mutex_);
+    for (std::atomic<uint64_t>& slot : slots_) {
+      slot.store(UNTUNED, std::memory_order_relaxed);
+    }
+    path_ = path;
+    load_locked();
+  }
+
+  std::string path() const {
+    std::lock_guard lock(mutex_);
+    return path_;
+  }
+
+private:
+  static constexpr size_t SLOTS = detail::TUNING_KINDS * detail::TUNING_SIZES * SHAPE_CLASSES;
+
+  // A slot holds the depth tile in its high half and the column tile in its low half, or `UNTUNED`
+  static constexpr uint64_t UNTUNED = 0;
+  static constexpr size_t MAX_TILE = 0xFFFFFFFF;
+
+  static uint64_t pack(detail::GemmTiling tiling) {
+    return uint64_t{tiling.depth_tile} << 32 | tiling.col_tile;
+  }
+
+  static detail::GemmTiling unpack(uint64_t packed) {
+    return {static_cast<size_t>(packed >> 32), static_cast<size_t>(packed & MAX_TILE)};
+  }
+
+  explicit KernelTuner(std::string path)
+      : path_(std::move(path)) {
+    load_locked();
+  }
+
+  // Fastest candidate on the first rows of the product, as many as make `TUNING_WORK` multiply-adds
+  template <typename T>
+  static detail::GemmTiling measure(const T* left, const T* right, size_t rows, size_t depth, size_t cols) {
+    size_t strip = std::clamp<size_t>(detail::TUNING_WORK / (depth * cols), 1, rows);
+    T* out = new T[strip * cols]();
+    detail::GemmTiling best;
+    auto best_time = std::chrono::steady_clock::duration::max();
+    // The first run only brings the operands into cache
+    detail::gemm_rows(left, right, out, 0, strip, depth, cols, best);
+    for (const detail::GemmTiling& candidate : detail::TUNING_CANDIDATES) {
+      for (size_t run = 0; run < detail::TUNING_RUNS; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        detail::gemm_rows(left, right, out, 0, strip, depth, cols, candidate);
+        auto time = std::chrono::steady_clock::now() - start;
+        if (time < best_time) {
+          best_time = time;
+          best = candidate;
+        }
+      }
+    }
+    delete[] out;
+    return best;
+  }
+
+  // Takes the cases of the tuning file that are not tuned yet. Unreadable files and malformed lines are ignored.
+  void load_locked() {
+    if (path_.empty()) {
+      return;
+    }
+    std::ifstream in(path_);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string type;
+      std::string shape;
+      detail::GemmTiling tiling;
+      if (!(fields >> type >> shape >> tiling.depth_tile >> tiling.col_tile) || tiling.depth_tile == 0 ||
+          tiling.depth_tile % 4 != 0 || tiling.depth_tile > MAX_TILE || tiling.col_tile == 0 ||
+          tiling.col_tile > MAX_TILE) {
+        continue;
+      }
+      size_t slot = parse_slot(type, shape);
+      if (slot != SLOTS && slots_[slot].load(std::memory_order_relaxed) == UNTUNED) {
+        slots_[slot].store(pack(tiling), std::memory_order_release);
+      }
+    }
+  }
+
+  // Rewrites the tuning file with its current cases merged with ours, through a temporary file renamed over it so
+  // that concurrent readers never see a partial file
+  void save_locked() {
+    if (path_.empty()) {
+      return;
+    }
+    load_locked();
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path_).parent_path(), error);
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::string temporary = path_ + ".tmp" + std::to_string(stamp);
+    {
+      std::ofstream out(temporary);
+      for (size_t slot = 0; slot < SLOTS; ++slot) {
+        uint64_t packed = slots_[slot].load(std::memory_order_relaxed);
+        if (packed != UNTUNED) {
+          detail::GemmTiling tiling = unpack(packed);
+          out << type_name(slot) << ' ' << shape_name(slot) << ' ' << tiling.depth_tile << ' ' << tiling.col_tile
+              << '\n';
+        }
+      }
+      if (!out.flush()) {
+        std::remove(temporary.c_str());
+        return;
+      }
+    }
+    if (std::rename(temporary.c_str(), path_.c_str()) != 0) {
+      std::remove(temporary.c_str());
+    }
+  }
+
+  // Element type of the case in slot `slot`, such as "f8" for `double`
+  static std::string type_name(size_t slot) {
+    size_t type = slot / SHAPE_CLASSES;
+    size_t size = size_t{1} << type % detail::TUNING_SIZES;
+    return detail::TUNING_KIND_NAMES[type / detail::TUNING_SIZES] + std::to_string(size);
+  }
+
+  static const char* shape_name(size_t slot) {
+    return shape_class_name(static_cast<ShapeClass>(slot % SHAPE_CLASSES));
+  }
+
+  // Slot of the case named `type` and `shape`, or `SLOTS`
+  static size_t parse_slot(const std::string& type, const std::string& shape) {
+    for (size_t slot = 0; slot < SLOTS; ++slot) {
+      if (type == type_name(slot) && shape == shape_name(slot)) {
+        return slot;
+      }
+    }
+    return SLOTS;
+  }
+
+private:
+  // Guards the tuning file and `path_`
+  mutable std::mutex mutex_;
+  std::string path_;
+  std::atomic<uint64_t> slots_[SLOTS] = {};
+  // Set while a thread times the candidates of the slot
+  std::atomic<bool> tuning_[SLOTS] = {};
+};
+
+} // namespace ct
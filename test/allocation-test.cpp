@@ -0,0 +1,267 @@
+#include "allocation.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace ct::test {
+
+class AllocationTest : public ::testing::TestWithParam<NumaPlacement> {
+protected:
+  void SetUp() override {
+    Element::reset_allocations();
+  }
+
+  AllocationPolicy policy() const {
+    return {.placement = GetParam()};
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    Placements,
+    AllocationTest,
+    ::testing::Values(NumaPlacement::Default, NumaPlacement::Interleaved, NumaPlacement::RowBlocks)
+);
+
+TEST_P(AllocationTest, zeros_ctor) {
+  constexpr size_t ROWS = 300;
+  constexpr size_t COLS = 500;
+
+  Matrix<Element> a(ROWS, COLS, policy());
+
+  EXPECT_EQ(ROWS, a.rows());
+  EXPECT_EQ(COLS, a.cols());
+  EXPECT_EQ(policy(), a.allocation_policy());
+  for (Element x : std::as_const(a)) {
+    EXPECT_EQ(0, x);
+  }
+}
+
+TEST_P(AllocationTest, zeros_ctor_empty) {
+  Matrix<Element> a(0, 10, policy());
+  expect_empty(a);
+  expect_allocations(0);
+}
+
+TEST_P(AllocationTest, page_aligned) {
+  Matrix<Element> a(300, 500, policy());
+
+  if (GetParam() != NumaPlacement::Default) {
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(std::as_const(a).data()) % detail::page_size());
+  }
+}
+
+TEST_P(AllocationTest, copy_keeps_policy) {
+  Matrix<Element> a(300, 500, policy());
+  fill(a);
+
+  Matrix<Element> b = a;
+  EXPECT_EQ(policy(), b.allocation_policy());
+  expect_equal(a, b);
+
+  Matrix<Element> c(2, 2);
+  c = a;
+  EXPECT_EQ(policy(), c.allocation_policy());
+  expect_equal(a, c);
+}
+
+TEST_P(AllocationTest, operations) {
+  Matrix<Element> a(300, 500, policy());
+  Matrix<Element> b(500, 200, policy());
+  fill(a);
+  fill(b);
+
+  Matrix<Element> expected_sum = a;
+  expected_sum += a;
+  Matrix<Element> sum = a + a;
+  EXPECT_EQ(policy(), sum.allocation_policy());
+  EXPECT_EQ(expected_sum, sum);
+
+  Matrix<Element> product = a * b;
+  EXPECT_EQ(policy(), product.allocation_policy());
+  for (size_t i = 0; i < a.rows(); i += 37) {
+    for (size_t j = 0; j < b.cols(); j += 41) {
+      Element expected = 0;
+      for (size_t k = 0; k < a.cols(); ++k) {
+        expected += a(i, k) * b(k, j);
+      }
+      EXPECT_EQ(expected, product(i, j));
+    }
+  }
+}
+
+TEST_P(AllocationTest, sharing) {
+  Matrix<Element> a(300, 500, policy());
+  fill(a);
+  a.enable_sharing();
+
+  Matrix<Element> b = a;
+  b(0, 0) = 1;
+
+  EXPECT_EQ(policy(), b.allocation_policy());
+  EXPECT_EQ(elem(0, 0), std::as_const(a)(0, 0));
+  EXPECT_EQ(1, std::as_const(b)(0, 0));
+}
+
+class HugePagesTest : public ::testing::TestWithParam<HugePages> {
+protected:
+  void SetUp() override {
+    Element::reset_allocations();
+  }
+
+  AllocationPolicy policy(size_t threshold) const {
+    return {.huge_pages = GetParam(), .huge_page_threshold = threshold};
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    Modes,
+    HugePagesTest,
+    ::testing::Values(HugePages::Never, HugePages::Transparent, HugePages::Explicit)
+);
+
+TEST_P(HugePagesTest, below_threshold) {
+  Matrix<Element> a(40, 100, policy(sizeof(Element) * 40 * 100 + 1));
+  fill(a);
+
+  expect_allocations(a.size());
+  EXPECT_EQ(elem(39, 99), std::as_const(a)(39, 99));
+}
+
+TEST_P(HugePagesTest, above_threshold) {
+  constexpr size_t ROWS = 1000;
+  constexpr size_t COLS = 700;
+
+  Matrix<Element> a(ROWS, COLS, policy(0));
+  fill(a);
+
+  if (GetParam() == HugePages::Never) {
+    expect_allocations(a.size());
+  } else {
+    expect_allocations(0);
+    // Both explicit huge pages and the transparent fallback start on a huge page boundary
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(std::as_const(a).data()) % detail::huge_page_size());
+  }
+
+  Matrix<Element> b = a;
+  b.col(COLS - 1) *= 2;
+  EXPECT_EQ(elem(ROWS - 1, COLS - 1) * 2, std::as_const(b)(ROWS - 1, COLS - 1));
+  EXPECT_EQ(elem(ROWS - 1, COLS - 1), std::as_const(a)(ROWS - 1, COLS - 1));
+}
+
+TEST_P(HugePagesTest, mapping_size) {
+  size_t bytes = (size_t{5} << 20) + 3;
+  size_t page = GetParam() == HugePages::Explicit      ? detail::hugetlb_page_size()
+                : GetParam() == HugePages::Transparent ? detail::huge_page_size()
+                                                       : detail::page_size();
+  EXPECT_EQ(page, detail::mapping_page_size(bytes, policy(0)));
+  EXPECT_EQ(0, detail::mapping_size(bytes, policy(0)) % page);
+  EXPECT_LT(detail::mapping_size(bytes, policy(0)) - bytes, page);
+  EXPECT_EQ(detail::page_size(), detail::mapping_page_size(bytes, policy(bytes + 1)));
+  EXPECT_EQ(0, detail::hugetlb_page_size() % detail::page_size());
+}
+
+TEST_P(HugePagesTest, with_numa_placement) {
+  AllocationPolicy p = policy(0);
+  p.placement = NumaPlacement::RowBlocks;
+
+  Matrix<Element> a(1000, 700, p);
+  fill(a);
+  Matrix<Element> b = a * Element(3);
+
+  EXPECT_EQ(p, b.allocation_policy());
+  EXPECT_EQ(elem(999, 699) * 3, std::as_const(b)(999, 699));
+}
+
+TEST(ParallelTest, block_range) {
+  constexpr size_t COUNT = 10;
+  constexpr size_t PARTS = 4;
+
+  size_t expected_begin = 0;
+  for (size_t i = 0; i < PARTS; ++i) {
+    detail::BlockRange range = detail::block_range(COUNT, PARTS, i);
+    EXPECT_EQ(expected_begin, range.begin);
+    EXPECT_LE(COUNT / PARTS, range.end - range.begin);
+    EXPECT_GE(COUNT / PARTS + 1, range.end - range.begin);
+    expected_begin = range.end;
+  }
+  EXPECT_EQ(COUNT, expected_begin);
+}
+
+TEST(ParallelTest, parts_run_on_fixed_workers) {
+  detail::ThreadPool& pool = detail::ThreadPool::instance();
+  constexpr size_t PARTS = 16;
+
+  size_t workers[PARTS];
+  pool.run(PARTS, [&workers](size_t part) { workers[part] = detail::ThreadPool::current_worker(); });
+
+  for (size_t part = 0; part < PARTS; ++part) {
+    EXPECT_EQ(part % pool.size(), workers[part]);
+    EXPECT_LT(pool.node(workers[part]), detail::numa_node_count());
+  }
+}
+
+TEST(ParallelTest, nested_run) {
+  constexpr size_t PARTS = 8;
+
+  std::atomic<size_t> count = 0;
+  detail::ThreadPool::instance().run(PARTS, [&count](size_t) {
+    detail::ThreadPool::instance().run(PARTS, [&count](size_t) { ++count; });
+  });
+
+  EXPECT_EQ(PARTS * PARTS, count);
+}
+
+TEST(ParallelTest, exception_from_worker) {
+  detail::ThreadPool& pool = detail::ThreadPool::instance();
+  size_t parts = 2 * pool.size() + 1;
+
+  std::atomic<size_t> count = 0;
+  EXPECT_THROW(
+      pool.run(parts, [&count, parts](size_t part) {
+        ++count;
+        if (part == parts - 1) {
+          throw std::runtime_error("part failed");
+        }
+      }),
+      std::runtime_error
+  );
+  EXPECT_EQ(parts, count);
+
+  // The pool stays usable, and a failure is not reported again by the next job
+  count = 0;
+  pool.run(parts, [&count](size_t) { ++count; });
+  EXPECT_EQ(parts, count);
+
+  // The last row block runs on the last worker
+  Matrix<int> m(1000, 1000);
+  EXPECT_THROW(
+      m.apply_rows([](Matrix<int>::RowView, size_t row) {
+        if (row == 999) {
+          throw std::runtime_error("row failed");
+        }
+      }),
+      std::runtime_error
+  );
+}
+
+TEST(ParallelTest, parallel_rows_covers_all_rows) {
+  constexpr size_t ROWS = 1000;
+
+  std::atomic<size_t> covered = 0;
+  detail::parallel_rows(ROWS, detail::PARALLEL_THRESHOLD, [&covered](size_t begin, size_t end) {
+    covered += end - begin;
+  });
+
+  EXPECT_EQ(ROWS, covered);
+  EXPECT_EQ(std::min(ROWS, detail::ThreadPool::instance().size()), detail::row_block_count(ROWS, 1 << 20));
+  EXPECT_EQ(1, detail::row_block_count(ROWS, 1));
+}
+
+} // namespace ct::test
@@ -0,0 +1,152 @@
+#include "async.h"
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <stop_token>
+#include <utility>
+
+namespace ct::test {
+
+namespace {
+
+Matrix<size_t> make_matrix(size_t rows, size_t cols) {
+  Matrix<size_t> m(rows, cols);
+  fill(m);
+  return m;
+}
+
+// An element whose product throws for the value `FAULT`
+struct Faulty {
+  static constexpr size_t FAULT = 13;
+
+  friend Faulty operator+(const Faulty& left, const Faulty& right) {
+    return {left.value + right.value};
+  }
+
+  friend Faulty operator*(const Faulty& left, const Faulty& right) {
+    if (left.value == FAULT || right.value == FAULT) {
+      throw std::runtime_error("faulty product");
+    }
+    return {left.value * right.value};
+  }
+
+  Faulty& operator+=(const Faulty& other) {
+    value += other.value;
+    return *this;
+  }
+
+  size_t value = 0;
+};
+
+Matrix<Faulty> make_faulty(size_t rows, size_t cols, size_t fault_row) {
+  Matrix<Faulty> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j).value = i == fault_row ? Faulty::FAULT : 1;
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(AsyncTest, multiply) {
+  Matrix<Element> a({
+      {1, 2, 3},
+      {4, 5, 6},
+      {7, 8, 9},
+  });
+  const Matrix<Element> b({
+      {10, 40},
+      {20, 50},
+      {30, 60},
+  });
+
+  AsyncProduct<Element> product = async_multiply(a, b);
+  EXPECT_TRUE(product.valid());
+
+  expect_equal(a * b, product.get());
+}
+
+TEST(AsyncTest, large) {
+  const Matrix<size_t> a = make_matrix(300, 200);
+  const Matrix<size_t> b = make_matrix(200, 250);
+
+  AsyncProduct<size_t> product = async_multiply(a, b);
+  product.wait();
+  EXPECT_TRUE(product.ready());
+
+  expect_equal(a * b, product.get());
+}
+
+TEST(AsyncTest, operands_are_snapshots) {
+  Matrix<size_t> a = make_matrix(60, 50);
+  Matrix<size_t> b = make_matrix(50, 40);
+  a.enable_sharing();
+  b.enable_sharing();
+  const Matrix<size_t> expected = a * b;
+
+  AsyncProduct<size_t> product = async_multiply(a, b);
+  a(0, 0) = 1000;
+  b = Matrix<size_t>();
+
+  expect_equal(expected, product.get());
+}
+
+TEST(AsyncTest, many_in_flight) {
+  constexpr size_t COUNT = 16;
+
+  const Matrix<size_t> a = make_matrix(40, 30);
+  AsyncProduct<size_t> products[COUNT];
+  for (size_t i = 0; i < COUNT; ++i) {
+    products[i] = async_multiply(a, a * i);
+  }
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    expect_equal(a * (a * i), products[i].get());
+  }
+}
+
+TEST(AsyncTest, cancelled_by_token) {
+  std::stop_source source;
+  source.request_stop();
+
+  AsyncProduct<size_t> product = async_multiply(make_matrix(10, 10), make_matrix(10, 10), source.get_token());
+
+  EXPECT_THROW(product.get(), OperationCancelled);
+}
+
+TEST(AsyncTest, cancel) {
+  const Matrix<size_t> a = make_matrix(500, 500);
+
+  AsyncProduct<size_t> product = async_multiply(a, a);
+  product.cancel();
+
+  // The product may already have been finished by the time `cancel` was called
+  try {
+    expect_equal(a * a, product.get());
+  } catch (const OperationCancelled&) {
+    SUCCEED();
+  }
+}
+
+TEST(AsyncTest, wait_for) {
+  AsyncProduct<size_t> product = async_multiply(make_matrix(20, 20), make_matrix(20, 20));
+
+  EXPECT_EQ(std::future_status::ready, product.wait_for(std::chrono::seconds(30)));
+}
+
+// Small enough to run on the executor thread, and large enough to be split among the pool workers
+TEST(AsyncTest, exception) {
+  for (size_t size : {size_t{4}, size_t{300}}) {
+    AsyncProduct<Faulty> product = async_multiply(make_faulty(size, size, size - 1), make_faulty(size, size, size));
+    EXPECT_THROW(product.get(), std::runtime_error);
+  }
+}
+
+} // namespace ct::test
@@ -0,0 +1,167 @@
+#include "bitmatrix.h"
+#include "matrix.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+
+namespace ct::test {
+
+namespace {
+
+// Random relation with about one entry in `sparsity` set
+Matrix<bool> make_relation(size_t rows, size_t cols, uint64_t seed, uint64_t sparsity) {
+  Matrix<bool> m(rows, cols);
+  uint64_t state = seed;
+  for (bool& x : m) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = (state >> 33) % sparsity == 0;
+  }
+  return m;
+}
+
+Matrix<bool> reference_product(const Matrix<bool>& a, const Matrix<bool>& b) {
+  Matrix<bool> result(a.rows(), b.cols());
+  for (size_t i = 0; i < a.rows(); ++i) {
+    for (size_t j = 0; j < b.cols(); ++j) {
+      for (size_t k = 0; k < a.cols() && !result(i, j); ++k) {
+        result(i, j) = a(i, k) && b(k, j);
+      }
+    }
+  }
+  return result;
+}
+
+// Floyd-Warshall on booleans, one entry at a time
+Matrix<bool> reference_closure(Matrix<bool> m) {
+  size_t n = m.rows();
+  for (size_t k = 0; k < n; ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        m(i, j) = m(i, j) || (m(i, k) && m(k, j));
+      }
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(BitMatrixTest, access_and_conversion) {
+  Matrix<bool> dense = make_relation(70, 131, 1, 3);
+  BitMatrix bits(dense);
+
+  EXPECT_EQ(70, bits.rows());
+  EXPECT_EQ(131, bits.cols());
+  EXPECT_EQ(3, bits.words_per_row());
+  EXPECT_EQ(70 * 3 * sizeof(uint64_t), bits.stored_bytes());
+  EXPECT_EQ(dense, bits.to_dense());
+  EXPECT_EQ(static_cast<size_t>(std::ranges::count(dense, true)), bits.count());
+
+  bits(69, 130) = !bits(69, 130);
+  bits(0, 64) = bits(0, 0);
+  dense(69, 130) = !dense(69, 130);
+  dense(0, 64) = dense(0, 0);
+  EXPECT_EQ(dense, bits.to_dense());
+
+  BitMatrix moved = std::move(bits);
+  EXPECT_TRUE(bits.empty());
+  EXPECT_EQ(dense, moved.to_dense());
+}
+
+TEST(BitMatrixTest, row_views) {
+  using Row = BitMatrix::ConstRowView;
+  EXPECT_TRUE(std::ranges::random_access_range<Row>);
+  EXPECT_TRUE(std::ranges::sized_range<Row>);
+  EXPECT_TRUE(std::ranges::view<Row>);
+
+  Matrix<bool> dense = make_relation(5, 100, 2, 2);
+  BitMatrix bits(dense);
+  const BitMatrix& cbits = bits;
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_TRUE(std::ranges::equal(dense.row(i), cbits.row(i)));
+    EXPECT_EQ(static_cast<size_t>(std::ranges::count(dense.row(i), true)), cbits.row(i).count());
+  }
+
+  BitMatrix::RowView row = bits.row(1);
+  row[99] = true;
+  row[0] = row[1];
+  EXPECT_TRUE(bits(1, 99));
+  EXPECT_EQ(bits(1, 1), bits(1, 0));
+
+  row |= cbits.row(2);
+  for (size_t j = 0; j < 100; ++j) {
+    EXPECT_EQ(bits(1, j), row[j]);
+    if (bits(2, j)) {
+      EXPECT_TRUE(bits(1, j));
+    }
+  }
+  EXPECT_EQ(100, std::ranges::distance(cbits.row(4)));
+}
+
+TEST(BitMatrixTest, elementwise) {
+  Matrix<bool> a = make_relation(9, 70, 3, 2);
+  Matrix<bool> b = make_relation(9, 70, 4, 2);
+  BitMatrix both = BitMatrix(a) & BitMatrix(b);
+  BitMatrix either = BitMatrix(a) | BitMatrix(b);
+
+  for (size_t i = 0; i < 9; ++i) {
+    for (size_t j = 0; j < 70; ++j) {
+      EXPECT_EQ(a(i, j) && b(i, j), both(i, j));
+      EXPECT_EQ(a(i, j) || b(i, j), either(i, j));
+    }
+  }
+}
+
+TEST(BitMatrixTest, product) {
+  // Sizes around word and table boundaries, and a depth spanning several words
+  for (size_t depth : {1, 7, 8, 9, 63, 64, 65, 200}) {
+    Matrix<bool> a = make_relation(37, depth, depth, 5);
+    Matrix<bool> b = make_relation(depth, 131, depth + 1, 5);
+    EXPECT_EQ(reference_product(a, b), (BitMatrix(a) * BitMatrix(b)).to_dense()) << "depth = " << depth;
+  }
+}
+
+TEST(BitMatrixTest, product_large) {
+  Matrix<bool> a = make_relation(300, 517, 5, 200);
+  Matrix<bool> b = make_relation(517, 260, 6, 200);
+  EXPECT_EQ(reference_product(a, b), (BitMatrix(a) * BitMatrix(b)).to_dense());
+}
+
+TEST(BitMatrixTest, product_degenerate_shapes) {
+  EXPECT_TRUE((BitMatrix(0, 5) * BitMatrix(5, 3)).empty());
+  EXPECT_TRUE((BitMatrix(4, 5) * BitMatrix(5, 0)).empty());
+  EXPECT_EQ(BitMatrix(4, 3), BitMatrix(4, 0) * BitMatrix(0, 3));
+  EXPECT_EQ(BitMatrix::identity(100), BitMatrix::identity(100) * BitMatrix::identity(100));
+}
+
+TEST(BitMatrixTest, transitive_closure) {
+  for (size_t n : {1, 2, 63, 64, 65, 150}) {
+    // About two edges per vertex: long paths, and many vertices not reaching each other
+    Matrix<bool> relation = make_relation(n, n, n, n / 2 + 1);
+    EXPECT_EQ(reference_closure(relation), transitive_closure(BitMatrix(relation)).to_dense()) << "n = " << n;
+  }
+  EXPECT_TRUE(transitive_closure(BitMatrix()).empty());
+}
+
+TEST(BitMatrixTest, transitive_closure_of_path) {
+  // Edges `i -> i + 1` against the order of the blocks: every later vertex must be reached
+  size_t n = 200;
+  BitMatrix path(n, n);
+  for (size_t i = 0; i + 1 < n; ++i) {
+    path(n - 1 - i - 1, n - 1 - i) = true;
+  }
+  BitMatrix closure = transitive_closure(path);
+  EXPECT_EQ(n * (n - 1) / 2, closure.count());
+  EXPECT_TRUE(closure(0, n - 1));
+  EXPECT_FALSE(closure(n - 1, 0));
+
+  path(n - 1, 0) = true;
+  EXPECT_EQ(n * n, transitive_closure(path).count());
+}
+
+} // namespace ct::test
@@ -0,0 +1,113 @@
+#include "checked.h"
+#include "layout.h"
+#include "matrix.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace ct::test {
+
+// Without checked access, iterators carry nothing beyond what they need to walk their line
+TEST(CheckedTest, zero_overhead_when_disabled) {
+  if (detail::CHECKED) {
+    GTEST_SKIP() << "checked-access build";
+  }
+  EXPECT_EQ(3 * sizeof(void*), sizeof(Matrix<int>::ColIterator));
+  EXPECT_EQ(3 * sizeof(void*), sizeof(Matrix<int, ColMajor>::RowIterator));
+  EXPECT_TRUE((std::is_same_v<int*, Matrix<int>::Iterator>));
+  EXPECT_TRUE((std::is_same_v<int*, Matrix<int>::RowIterator>));
+  EXPECT_TRUE((std::is_same_v<const int*, Matrix<int, ColMajor>::ConstColIterator>));
+
+  // Out-of-range accesses are not detected, but in-range ones work the same
+  Matrix<int> m({{1, 2}, {3, 4}});
+  EXPECT_EQ(3, m.col_begin(0)[1]);
+  EXPECT_EQ(4, m.row(1)[1]);
+}
+
+TEST(CheckedTest, element_and_line_indices) {
+  if (!detail::CHECKED) {
+    GTEST_SKIP() << "configure with -DCT_CHECKED=ON";
+  }
+  Matrix<int> m(3, 4);
+  const Matrix<int>& cm = m;
+
+  EXPECT_NO_THROW(m(2, 3));
+  EXPECT_THROW(m(3, 0), OutOfRange);
+  EXPECT_THROW(m(0, 4), OutOfRange);
+  EXPECT_THROW(cm(0, 4), OutOfRange);
+  EXPECT_THROW(m.row(3), OutOfRange);
+  EXPECT_THROW(cm.col(4), OutOfRange);
+  EXPECT_THROW(m.row_begin(3), OutOfRange);
+  EXPECT_THROW(cm.row_end(3), OutOfRange);
+  EXPECT_THROW(m.col_begin(4), OutOfRange);
+  EXPECT_THROW(cm.col_end(4), OutOfRange);
+  EXPECT_THROW(m.row(0)[4], OutOfRange);
+  EXPECT_THROW(cm.col(0)[3], OutOfRange);
+
+  Matrix<int> empty;
+  EXPECT_THROW(empty(0, 0), OutOfRange);
+}
+
+TEST(CheckedTest, iterator_ranges) {
+  if (!detail::CHECKED) {
+    GTEST_SKIP() << "configure with -DCT_CHECKED=ON";
+  }
+  Matrix<int> m(3, 4);
+
+  Matrix<int>::ColIterator col = m.col_begin(1);
+  EXPECT_NO_THROW(col[2]);
+  EXPECT_THROW(col[3], OutOfRange);
+  EXPECT_THROW(col[-1], OutOfRange);
+  EXPECT_THROW(--col, OutOfRange);
+  EXPECT_NO_THROW(col += 3);
+  EXPECT_THROW(*col, OutOfRange);
+  EXPECT_THROW(++col, OutOfRange);
+  EXPECT_THROW(m.col_begin(0) + 4, OutOfRange);
+
+  // Contiguous rows are bounded too
+  const Matrix<int>& cm = m;
+  EXPECT_NO_THROW(static_cast<void>(m.row_begin(1)[3]));
+  EXPECT_THROW(static_cast<void>(m.row_begin(1)[4]), OutOfRange);
+  EXPECT_THROW(static_cast<void>(cm.row_end(2) + 1), OutOfRange);
+  EXPECT_THROW(static_cast<void>(*cm.row_end(0)), OutOfRange);
+  EXPECT_THROW(static_cast<void>(*m.row(2).end()), OutOfRange);
+  EXPECT_THROW(static_cast<void>(std::prev(m.row(0).begin())), OutOfRange);
+
+  // So is the whole buffer
+  EXPECT_NO_THROW(static_cast<void>(m.begin()[11]));
+  EXPECT_THROW(static_cast<void>(m.begin()[12]), OutOfRange);
+  EXPECT_THROW(static_cast<void>(*cm.end()), OutOfRange);
+  EXPECT_THROW(static_cast<void>(cm.begin() - 1), OutOfRange);
+  EXPECT_THROW(static_cast<void>(std::next(m.end())), OutOfRange);
+
+  // A range walked to its end is fine
+  size_t count = 0;
+  for (int& x : m.col(3)) {
+    x = 1;
+    ++count;
+  }
+  EXPECT_EQ(3, count);
+}
+
+TEST(CheckedTest, other_layouts) {
+  if (!detail::CHECKED) {
+    GTEST_SKIP() << "configure with -DCT_CHECKED=ON";
+  }
+  Matrix<int, ColMajor> col_major(2, 5);
+  EXPECT_THROW(col_major(2, 0), OutOfRange);
+  EXPECT_THROW(col_major.row_begin(0)[5], OutOfRange);
+  EXPECT_NO_THROW(col_major.col(4)[1]);
+  EXPECT_THROW(static_cast<void>(col_major.col_begin(4)[2]), OutOfRange);
+  EXPECT_THROW(static_cast<void>(*col_major.col(0).end()), OutOfRange);
+
+  Matrix<int, Tiled<4>> tiled(6, 6);
+  EXPECT_THROW(tiled(0, 6), OutOfRange);
+  EXPECT_THROW(tiled.row_begin(5)[6], OutOfRange);
+  EXPECT_THROW(tiled.col_end(0) + 1, OutOfRange);
+  EXPECT_NO_THROW(tiled.col(5)[5]);
+}
+
+} // namespace ct::test
@@ -0,0 +1,187 @@
+#include "concurrent.h"
+#include "layout.h"
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace ct::test {
+
+namespace {
+
+constexpr size_t THREADS = 8;
+
+// Runs `f(thread)` on `THREADS` threads and joins them
+template <typename F>
+void run_threads(const F& f) {
+  std::thread threads[THREADS];
+  for (size_t t = 0; t < THREADS; ++t) {
+    threads[t] = std::thread([&f, t] { f(t); });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+TEST(ConcurrentTest, spin_lock) {
+  SpinLock lock;
+  size_t counter = 0;
+
+  run_threads([&](size_t) {
+    for (size_t i = 0; i < 10000; ++i) {
+      std::lock_guard guard(lock);
+      ++counter;
+    }
+  });
+
+  EXPECT_EQ(THREADS * 10000, counter);
+  EXPECT_TRUE(lock.try_lock());
+  EXPECT_FALSE(lock.try_lock());
+  lock.unlock();
+}
+
+TEST(ConcurrentTest, atomic_adder) {
+  Matrix<int64_t> m(3, 4);
+  Matrix<double, ColMajor> d(3, 4);
+  AtomicAdder<int64_t> m_adder(m);
+  AtomicAdder<double, ColMajor> d_adder(d);
+
+  // Every thread hits the same few elements
+  run_threads([&](size_t t) {
+    for (size_t i = 0; i < 5000; ++i) {
+      m_adder.add(i % 3, i % 4, int64_t{1});
+      d_adder.add(1, 2, static_cast<double>(t));
+    }
+  });
+
+  Matrix<int64_t> expected(3, 4);
+  for (size_t i = 0; i < 5000; ++i) {
+    expected(i % 3, i % 4) += THREADS;
+  }
+  EXPECT_EQ(expected, m);
+  EXPECT_EQ(5000.0 * (THREADS * (THREADS - 1) / 2), d(1, 2));
+  EXPECT_EQ(0, d(2, 1));
+}
+
+// Detaching from a shared buffer and marking the rows dirty happen once, when the adder is built
+TEST(ConcurrentTest, atomic_adder_shared_and_tracked) {
+  Matrix<int64_t> m(50, 8);
+  m.enable_sharing();
+  const Matrix<int64_t> copy = m;
+  m.track_dirty_rows();
+  m.clear_dirty_rows();
+
+  AtomicAdder<int64_t> adder(m);
+  EXPECT_EQ(m.rows(), m.dirty_row_count());
+  run_threads([&](size_t t) {
+    for (size_t i = 0; i < 1000; ++i) {
+      adder.add(i % 50, t, int64_t{1});
+    }
+  });
+
+  EXPECT_EQ(20, m(0, 0));
+  EXPECT_EQ(20, m(49, 7));
+  EXPECT_EQ(0, copy(0, 0));
+}
+
+TEST(ConcurrentTest, row_locks) {
+  constexpr size_t ROWS = 10;
+  constexpr size_t COLS = 50;
+
+  Matrix<size_t> m(ROWS, COLS);
+  RowLocks<size_t> locks(m);
+  EXPECT_EQ(ROWS, locks.stripes());
+
+  size_t ones[COLS];
+  std::fill(std::begin(ones), std::end(ones), 1);
+  run_threads([&](size_t t) {
+    for (size_t i = 0; i < 1000; ++i) {
+      locks.add((i + t) % ROWS, ones);
+      locks.add(i % ROWS, i % COLS, 2);
+    }
+  });
+
+  size_t expected_row = THREADS * 1000 / ROWS;
+  for (size_t i = 0; i < ROWS; ++i) {
+    for (size_t j = 0; j < COLS; ++j) {
+      // Every thread also adds 2 to `(i, j)` for each `k` with `k % ROWS == i` and `k % COLS == j`
+      size_t hits = 0;
+      for (size_t k = 0; k < 1000; ++k) {
+        hits += k % ROWS == i && k % COLS == j;
+      }
+      EXPECT_EQ(expected_row + 2 * THREADS * hits, m(i, j));
+    }
+  }
+}
+
+TEST(ConcurrentTest, row_locks_striped) {
+  Matrix<int, ColMajor> m(100, 3);
+  RowLocks<int, ColMajor> locks(m, 7);
+  EXPECT_EQ(7, locks.stripes());
+
+  run_threads([&](size_t) {
+    for (size_t row = 0; row < 100; ++row) {
+      locks.update(row, [row](auto view) {
+        for (int& x : view) {
+          x += static_cast<int>(row);
+        }
+      });
+    }
+  });
+
+  for (size_t row = 0; row < 100; ++row) {
+    for (size_t col = 0; col < 3; ++col) {
+      EXPECT_EQ(static_cast<int>(THREADS * row), m(row, col));
+    }
+  }
+}
+
+TEST(ConcurrentTest, sharded_accumulator) {
+  ShardedAccumulator<Element> accumulator(20, 30, 3);
+  EXPECT_EQ(3, accumulator.shards());
+
+  Element row[30];
+  std::fill(std::begin(row), std::end(row), Element(2));
+  run_threads([&](size_t t) {
+    for (size_t i = 0; i < 20; ++i) {
+      for (size_t j = 0; j < 30; ++j) {
+        accumulator.add(i, j, elem(i, j));
+      }
+      accumulator.add((i + t) % 20, row);
+    }
+  });
+
+  Matrix<Element> sum = accumulator.reduce();
+  for (size_t i = 0; i < 20; ++i) {
+    for (size_t j = 0; j < 30; ++j) {
+      EXPECT_EQ(elem(i, j) * THREADS + 2 * THREADS, sum(i, j));
+    }
+  }
+
+  Matrix<Element> target(20, 30);
+  fill(target);
+  accumulator.reduce_into(target);
+  EXPECT_EQ(elem(3, 4) * (THREADS + 1) + 2 * THREADS, target(3, 4));
+
+  accumulator.clear();
+  expect_equal(Matrix<Element>(20, 30), accumulator.reduce());
+}
+
+TEST(ConcurrentTest, sharded_accumulator_idle_shards) {
+  Element::reset_allocations();
+  ShardedAccumulator<Element> accumulator(10, 10, 64);
+  accumulator.add(1, 2, 5);
+
+  // Only the shard of this thread was allocated
+  expect_allocations(100);
+  EXPECT_EQ(5, accumulator.reduce()(1, 2));
+}
+
+} // namespace ct::test
@@ -0,0 +1,117 @@
+#include "layout.h"
+#include "matrix.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <ranges>
+#include <utility>
+
+namespace ct::test {
+
+namespace {
+
+constexpr Matrix<int> rotation() {
+  return Matrix<int>({
+      {0, -1},
+      {1, 0},
+  });
+}
+
+constexpr Matrix<int> make_matrix(size_t rows, size_t cols) {
+  Matrix<int> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<int>(i * 10 + j);
+    }
+  }
+  return m;
+}
+
+// A product computed by the compiler and copied out into a plain array that lives in the binary
+template <size_t ROWS, size_t COLS>
+struct Table {
+  int values[ROWS][COLS];
+};
+
+constexpr Table<3, 4> TABLE = [] {
+  Matrix<int> product = make_matrix(3, 5) * make_matrix(5, 4);
+  Table<3, 4> table{};
+  for (size_t i = 0; i < 3; ++i) {
+    std::copy(product.row_begin(i), product.row_end(i), table.values[i]);
+  }
+  return table;
+}();
+
+} // namespace
+
+TEST(ConstexprTest, construction_and_access) {
+  static_assert(rotation().rows() == 2);
+  static_assert(rotation().cols() == 2);
+  static_assert(rotation()(0, 1) == -1);
+  static_assert(rotation()(1, 0) == 1);
+  static_assert(Matrix<int>(3, 4)(2, 3) == 0);
+  static_assert(Matrix<int>().empty());
+  static_assert(Matrix<int>(0, 5).empty());
+}
+
+TEST(ConstexprTest, arithmetic) {
+  static_assert(rotation() * rotation() == Matrix<int>({{-1, 0}, {0, -1}}));
+  static_assert(rotation() * rotation() * rotation() * rotation() == Matrix<int>({{1, 0}, {0, 1}}));
+  static_assert(rotation() + rotation() == rotation() * 2);
+  static_assert(rotation() - rotation() == Matrix<int>(2, 2));
+  static_assert(3 * rotation() == rotation() * 3);
+  static_assert(rotation() != Matrix<int>(2, 2));
+  static_assert(rotation() != Matrix<int>(2, 3));
+  static_assert([] {
+    Matrix<int> m = rotation();
+    m *= rotation();
+    m += rotation();
+    m -= Matrix<int>({{0, 0}, {0, 1}});
+    return m == Matrix<int>({{-1, -1}, {1, -2}});
+  }());
+}
+
+TEST(ConstexprTest, copy_and_move) {
+  static_assert([] {
+    Matrix<int> a = make_matrix(3, 3);
+    Matrix<int> b = a;
+    b(0, 0) = 100;
+    Matrix<int> c = std::move(b);
+    a = c;
+    return a(0, 0) == 100 && b.empty() && a == c;
+  }());
+}
+
+TEST(ConstexprTest, views) {
+  static_assert(std::ranges::equal(make_matrix(3, 4).row(1), std::initializer_list<int>{10, 11, 12, 13}));
+  static_assert(std::ranges::equal(make_matrix(3, 4).col(2), std::initializer_list<int>{2, 12, 22}));
+  static_assert([] {
+    Matrix<int> m = make_matrix(3, 4);
+    m.col(0) *= 2;
+    m.row(2) *= 0;
+    return m(1, 0) == 20 && m(2, 3) == 0 && m(1, 1) == 11;
+  }());
+}
+
+TEST(ConstexprTest, layouts) {
+  static_assert([] {
+    Matrix<int, ColMajor> a(make_matrix(4, 6));
+    Matrix<int, Tiled<4>> b(make_matrix(6, 5));
+    Matrix<int> expected = make_matrix(4, 6) * make_matrix(6, 5);
+    return Matrix<int>(a * Matrix<int, ColMajor>(b)) == expected && Matrix<int>(Matrix<int, Tiled<4>>(a) * b) == expected;
+  }());
+}
+
+TEST(ConstexprTest, baked_table) {
+  Matrix<int> product = make_matrix(3, 5) * make_matrix(5, 4);
+
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      EXPECT_EQ(product(i, j), TABLE.values[i][j]);
+    }
+  }
+}
+
+} // namespace ct::test
@@ -1,8 +1,12 @@
+#include "copy.h"
 #include "matrix.h"
 #include "test-helpers.h"
 
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <numeric>
+
 namespace ct::test {
 
 class ConstructorsTest : public ::testing::Test {
@@ -183,4 +187,44 @@ TEST_F(ConstructorsTest, copy_assignment_empty) {
   expect_allocations(SIZE_B);
 }
 
+TEST_F(ConstructorsTest, copy_trivially_copyable) {
+  // Large enough to be split over the workers and, with huge pages, to take the mapped path
+  for (const AllocationPolicy& policy : {AllocationPolicy{}, AllocationPolicy{.huge_pages = HugePages::Transparent}}) {
+    Matrix<int64_t> a(1000, 1001, policy);
+    std::iota(a.begin(), a.end(), int64_t{-500});
+
+    Matrix<int64_t> b = a;
+    EXPECT_EQ(a, b);
+
+    Matrix<int64_t> c(1000, 1001, policy);
+    c = a;
+    EXPECT_EQ(a, c);
+  }
+}
+
+TEST_F(ConstructorsTest, stream_copy) {
+  unsigned char from[300];
+  std::iota(std::begin(from), std::end(from), static_cast<unsigned char>(0));
+
+  // Every combination of misaligned source, misaligned destination and partial tail
+  for (size_t offset = 0; offset < 16; ++offset) {
+    for (size_t bytes : {0, 1, 15, 64, 65, 200, 283}) {
+      unsigned char to[300] = {};
+      detail::stream_copy(from + 16 - offset, to + offset, bytes);
+      EXPECT_TRUE(std::equal(from + 16 - offset, from + 16 - offset + bytes, to + offset));
+      EXPECT_EQ(0, to[offset + bytes]);
+    }
+  }
+}
+
+TEST_F(ConstructorsTest, copy_elements) {
+  Matrix<Element> a(30, 40);
+  fill(a);
+  Matrix<Element> b(30, 40);
+
+  detail::copy_elements(a.data(), b.data(), a.size());
+
+  expect_equal(a, b);
+}
+
 } // namespace ct::test
@@ -0,0 +1,149 @@
+#include "convolution.h"
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+
+namespace ct::test {
+
+namespace {
+
+constexpr Boundary BOUNDARIES[] = {Boundary::Zero, Boundary::Clamp, Boundary::Reflect, Boundary::Wrap};
+constexpr ConvolutionMethod METHODS[] = {ConvolutionMethod::Direct, ConvolutionMethod::Im2col};
+
+// Pixel `(i, j)` of the image extended by `boundary`, each axis remapped separately
+template <typename T>
+T pixel(const Matrix<T>& image, std::ptrdiff_t i, std::ptrdiff_t j, Boundary boundary) {
+  auto remap = [boundary](std::ptrdiff_t index, std::ptrdiff_t size) -> std::ptrdiff_t {
+    switch (boundary) {
+      case Boundary::Zero:
+        return index >= 0 && index < size ? index : -1;
+      case Boundary::Clamp:
+        return index < 0 ? 0 : index >= size ? size - 1 : index;
+      case Boundary::Reflect:
+        while (index < 0 || index >= size) {
+          index = index < 0 ? -index - 1 : 2 * size - index - 1;
+        }
+        return index;
+      case Boundary::Wrap:
+        return ((index % size) + size) % size;
+    }
+    return -1;
+  };
+  std::ptrdiff_t row = remap(i, static_cast<std::ptrdiff_t>(image.rows()));
+  std::ptrdiff_t col = remap(j, static_cast<std::ptrdiff_t>(image.cols()));
+  return row < 0 || col < 0 ? T() : image(static_cast<size_t>(row), static_cast<size_t>(col));
+}
+
+template <typename T>
+Matrix<T> reference_convolve(const Matrix<T>& image, const Matrix<T>& kernel, Boundary boundary) {
+  Matrix<T> result(image.rows(), image.cols());
+  std::ptrdiff_t anchor_row = static_cast<std::ptrdiff_t>(kernel.rows() / 2);
+  std::ptrdiff_t anchor_col = static_cast<std::ptrdiff_t>(kernel.cols() / 2);
+  for (size_t i = 0; i < image.rows(); ++i) {
+    for (size_t j = 0; j < image.cols(); ++j) {
+      T sum = T();
+      for (size_t p = 0; p < kernel.rows(); ++p) {
+        for (size_t q = 0; q < kernel.cols(); ++q) {
+          std::ptrdiff_t row = static_cast<std::ptrdiff_t>(i + p) - anchor_row;
+          std::ptrdiff_t col = static_cast<std::ptrdiff_t>(j + q) - anchor_col;
+          sum += kernel(p, q) * pixel(image, row, col, boundary);
+        }
+      }
+      result(i, j) = sum;
+    }
+  }
+  return result;
+}
+
+Matrix<int> make_matrix(size_t rows, size_t cols, int seed) {
+  Matrix<int> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<int>(elem(i, j) * static_cast<size_t>(seed) % 23) - 11;
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(ConvolutionTest, boundaries_and_methods) {
+  Matrix<int> image = make_matrix(23, 37, 3);
+  struct Shape {
+    size_t rows;
+    size_t cols;
+  };
+  // Odd and even kernels, one-dimensional ones, and one larger than the image
+  for (Shape shape : {Shape{1, 1}, Shape{3, 3}, Shape{4, 5}, Shape{1, 9}, Shape{7, 1}, Shape{9, 9}, Shape{30, 50}}) {
+    Matrix<int> kernel = make_matrix(shape.rows, shape.cols, 5);
+    for (Boundary boundary : BOUNDARIES) {
+      Matrix<int> expected = reference_convolve(image, kernel, boundary);
+      for (ConvolutionMethod method : METHODS) {
+        EXPECT_EQ(expected, convolve2d(image, kernel, boundary, method))
+            << shape.rows << "x" << shape.cols << " kernel, boundary " << static_cast<int>(boundary) << ", method "
+            << static_cast<int>(method);
+      }
+      EXPECT_EQ(expected, convolve2d(image, kernel, boundary));
+    }
+  }
+}
+
+TEST(ConvolutionTest, thin_images) {
+  Matrix<int> kernel = make_matrix(3, 3, 7);
+  for (Matrix<int> image : {make_matrix(1, 40, 1), make_matrix(40, 1, 1), make_matrix(2, 2, 1)}) {
+    for (Boundary boundary : BOUNDARIES) {
+      Matrix<int> expected = reference_convolve(image, kernel, boundary);
+      for (ConvolutionMethod method : METHODS) {
+        EXPECT_EQ(expected, convolve2d(image, kernel, boundary, method));
+      }
+    }
+  }
+}
+
+TEST(ConvolutionTest, identity_and_shift) {
+  Matrix<int> image = make_matrix(10, 12, 1);
+  EXPECT_EQ(image, convolve2d(image, Matrix<int>({{0, 0, 0}, {0, 1, 0}, {0, 0, 0}})));
+
+  // Reading the right neighbour shifts the image left
+  Matrix<int> shifted = convolve2d(image, Matrix<int>({{0, 0, 1}}), Boundary::Wrap);
+  EXPECT_EQ(image(4, 5), shifted(4, 4));
+  EXPECT_EQ(image(4, 0), shifted(4, 11));
+}
+
+TEST(ConvolutionTest, degenerate_shapes) {
+  expect_empty(convolve2d(Matrix<int>(), Matrix<int>({{1}})));
+  EXPECT_EQ(Matrix<int>(3, 4), convolve2d(make_matrix(3, 4, 1), Matrix<int>()));
+}
+
+TEST(ConvolutionTest, large_float_image) {
+  // Large enough to be split in row bands over the thread pool, with blocks of im2col columns
+  Matrix<float> image(700, 900);
+  for (size_t i = 0; i < 700; ++i) {
+    for (size_t j = 0; j < 900; ++j) {
+      image(i, j) = std::sin(static_cast<float>(i * 900 + j));
+    }
+  }
+  for (size_t size : {5, 17}) {
+    Matrix<float> kernel(size, size);
+    for (size_t p = 0; p < size; ++p) {
+      for (size_t q = 0; q < size; ++q) {
+        kernel(p, q) = 1.0f / static_cast<float>(p + q + 1);
+      }
+    }
+    Matrix<float> expected = reference_convolve(image, kernel, Boundary::Reflect);
+    for (ConvolutionMethod method : METHODS) {
+      Matrix<float> result = convolve2d(image, kernel, Boundary::Reflect, method);
+      for (size_t i = 0; i < 700; i += 7) {
+        for (size_t j = 0; j < 900; ++j) {
+          ASSERT_NEAR(expected(i, j), result(i, j), 1e-3f) << i << ", " << j;
+        }
+      }
+    }
+  }
+}
+
+} // namespace ct::test
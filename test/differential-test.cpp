@@ -0,0 +1,745 @@
+#include "async.h"
+#include "bitmatrix.h"
+#include "convolution.h"
+#include "copy.h"
+#include "elementwise.h"
+#include "layout.h"
+#include "lu.h"
+#include "matrix.h"
+#include "modular.h"
+#include "multiply.h"
+#include "ranges.h"
+#include "reduction.h"
+#include "serialize.h"
+#include "streaming.h"
+#include "structured.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <utility>
+
+// Randomized differential tests: every optimized path (blocked, parallel, streaming, lowered) against a naive
+// reference written with `operator()` only, over random shapes that include the empty `0 x N` and `N x 0` matrices,
+// shapes straddling the tile sizes, and shapes large enough for the parallel paths. Cases are drawn from a fixed
+// seed; `CT_FUZZ_SEED` and `CT_FUZZ_CASES` change the seed and the number of cases per property, and a failing case
+// reports the seed that reproduces it. Integer results must match exactly; floating-point ones must lie within a
+// bound on the rounding error of a `long double` reference.
+
+namespace ct::test {
+
+namespace {
+
+using Tiled5 = Tiled<5>;
+
+uint64_t fuzz_seed() {
+  const char* env = std::getenv("CT_FUZZ_SEED");
+  return env != nullptr ? std::strtoull(env, nullptr, 10) : 20261019;
+}
+
+size_t fuzz_cases() {
+  const char* env = std::getenv("CT_FUZZ_CASES");
+  size_t cases = env != nullptr ? std::strtoul(env, nullptr, 10) : 0;
+  return cases != 0 ? cases : 48;
+}
+
+class Fuzzer {
+public:
+  explicit Fuzzer(uint64_t seed)
+      : engine_(seed) {}
+
+  size_t below(size_t bound) {
+    return std::uniform_int_distribution<size_t>(0, bound - 1)(engine_);
+  }
+
+  // Zero one time in eight, else mostly small, sometimes up to `large`
+  size_t dim(size_t large) {
+    switch (below(8)) {
+    case 0:
+      return 0;
+    case 1:
+      return std::max<size_t>(1, large / 2 + below(large / 2 + 1));
+    case 2:
+    case 3:
+      return 9 + below(56);
+    default:
+      return 1 + below(8);
+    }
+  }
+
+  int64_t value(int64_t bound = 9) {
+    return std::uniform_int_distribution<int64_t>(-bound, bound)(engine_);
+  }
+
+  double real() {
+    return std::uniform_real_distribution<double>(-1, 1)(engine_);
+  }
+
+  template <typename T, typename Layout = RowMajor>
+  Matrix<T, Layout> real_matrix(size_t rows, size_t cols) {
+    Matrix<T, Layout> m(rows, cols);
+    for (size_t i = 0; i < m.rows(); ++i) {
+      for (size_t j = 0; j < m.cols(); ++j) {
+        m(i, j) = static_cast<T>(real());
+      }
+    }
+    return m;
+  }
+
+  template <typename T, typename Layout = RowMajor>
+  Matrix<T, Layout> matrix(size_t rows, size_t cols, int64_t bound = 9) {
+    Matrix<T, Layout> m(rows, cols);
+    for (size_t i = 0; i < m.rows(); ++i) {
+      for (size_t j = 0; j < m.cols(); ++j) {
+        m(i, j) = static_cast<T>(value(bound));
+      }
+    }
+    return m;
+  }
+
+  std::mt19937_64& engine() {
+    return engine_;
+  }
+
+private:
+  std::mt19937_64 engine_;
+};
+
+// Runs `property(fuzzer)` for every case, each with its own seed
+template <typename F>
+void for_each_case(const F& property) {
+  uint64_t seed = fuzz_seed();
+  size_t cases = fuzz_cases();
+  for (size_t c = 0; c < cases; ++c) {
+    uint64_t case_seed = seed + c;
+    SCOPED_TRACE("CT_FUZZ_SEED=" + std::to_string(case_seed) + " CT_FUZZ_CASES=1");
+    Fuzzer fuzzer(case_seed);
+    property(fuzzer);
+    if (::testing::Test::HasFatalFailure()) {
+      return;
+    }
+  }
+}
+
+template <typename T, typename L1, typename L2>
+void expect_same(const Matrix<T, L1>& expected, const Matrix<T, L2>& actual) {
+  ASSERT_EQ(expected.rows(), actual.rows());
+  ASSERT_EQ(expected.cols(), actual.cols());
+  ASSERT_EQ(expected.empty(), actual.empty());
+  for (size_t i = 0; i < expected.rows(); ++i) {
+    for (size_t j = 0; j < expected.cols(); ++j) {
+      ASSERT_EQ(expected(i, j), actual(i, j)) << "at (" << i << ", " << j << ")";
+    }
+  }
+}
+
+template <typename T, typename Layout, typename F>
+Matrix<T, Layout> reference_map(const Matrix<T, Layout>& a, const F& f) {
+  Matrix<T, Layout> result(a.rows(), a.cols());
+  for (size_t i = 0; i < a.rows(); ++i) {
+    for (size_t j = 0; j < a.cols(); ++j) {
+      result(i, j) = f(i, j);
+    }
+  }
+  return result;
+}
+
+template <typename Acc, typename T, typename Layout>
+Matrix<Acc> reference_product(const Matrix<T, Layout>& a, const Matrix<T, Layout>& b) {
+  Matrix<Acc> result(a.rows(), b.cols());
+  for (size_t i = 0; i < result.rows(); ++i) {
+    for (size_t j = 0; j < result.cols(); ++j) {
+      Acc sum = Acc();
+      for (size_t k = 0; k < a.cols(); ++k) {
+        sum += static_cast<Acc>(a(i, k)) * static_cast<Acc>(b(k, j));
+      }
+      result(i, j) = sum;
+    }
+  }
+  return result;
+}
+
+// `actual` against `a * b` computed in `long double`: every element within a few rounding errors of `T` per term,
+// relative to the sum of the magnitudes of its terms
+template <typename T, typename Source, typename L1, typename L2>
+void expect_product_near(const Matrix<Source, L1>& a, const Matrix<Source, L1>& b, const Matrix<T, L2>& actual) {
+  Matrix<T> shape(a.rows(), b.cols());
+  ASSERT_EQ(shape.rows(), actual.rows());
+  ASSERT_EQ(shape.cols(), actual.cols());
+  for (size_t i = 0; i < actual.rows(); ++i) {
+    for (size_t j = 0; j < actual.cols(); ++j) {
+      long double sum = 0;
+      long double magnitude = 0;
+      for (size_t k = 0; k < a.cols(); ++k) {
+        long double term = static_cast<long double>(a(i, k)) * static_cast<long double>(b(k, j));
+        sum += term;
+        magnitude += std::fabs(term);
+      }
+      long double epsilon = std::numeric_limits<T>::epsilon();
+      long double tolerance = 4 * static_cast<long double>(a.cols() + 1) * epsilon * magnitude;
+      ASSERT_LE(std::fabs(sum - static_cast<long double>(actual(i, j))), tolerance) << "at (" << i << ", " << j << ")";
+    }
+  }
+}
+
+template <typename T, typename L1, typename L2>
+void expect_near(const Matrix<T, L1>& expected, const Matrix<T, L2>& actual, T tolerance) {
+  ASSERT_EQ(expected.rows(), actual.rows());
+  ASSERT_EQ(expected.cols(), actual.cols());
+  for (size_t i = 0; i < expected.rows(); ++i) {
+    for (size_t j = 0; j < expected.cols(); ++j) {
+      ASSERT_NEAR(expected(i, j), actual(i, j), tolerance) << "at (" << i << ", " << j << ")";
+    }
+  }
+}
+
+// Index read for `index` on an axis of `size` pixels extended by `boundary`, or `size` for a zero
+size_t reference_boundary(std::ptrdiff_t index, std::ptrdiff_t size, Boundary boundary) {
+  if (index < 0 || index >= size) {
+    switch (boundary) {
+    case Boundary::Zero:
+      return static_cast<size_t>(size);
+    case Boundary::Clamp:
+      index = index < 0 ? 0 : size - 1;
+      break;
+    case Boundary::Reflect:
+      while (index < 0 || index >= size) {
+        index = index < 0 ? -index - 1 : 2 * size - index - 1;
+      }
+      break;
+    case Boundary::Wrap:
+      index = (index % size + size) % size;
+      break;
+    }
+  }
+  return static_cast<size_t>(index);
+}
+
+template <typename Layout>
+void check_elementwise(Fuzzer& fuzzer) {
+  size_t rows = fuzzer.dim(700);
+  size_t cols = fuzzer.dim(700);
+  Matrix<int64_t, Layout> a = fuzzer.matrix<int64_t, Layout>(rows, cols);
+  Matrix<int64_t, Layout> b = fuzzer.matrix<int64_t, Layout>(rows, cols);
+  int64_t factor = fuzzer.value();
+
+  Matrix<int64_t, Layout> sum = reference_map(a, [&](size_t i, size_t j) { return a(i, j) + b(i, j); });
+  Matrix<int64_t, Layout> difference = reference_map(a, [&](size_t i, size_t j) { return a(i, j) - b(i, j); });
+  Matrix<int64_t, Layout> scaled = reference_map(a, [&](size_t i, size_t j) { return a(i, j) * factor; });
+  Matrix<int64_t, Layout> product = reference_map(a, [&](size_t i, size_t j) { return a(i, j) * b(i, j); });
+
+  expect_same(sum, a + b);
+  expect_same(difference, a - b);
+  expect_same(scaled, a * factor);
+  expect_same(scaled, factor * a);
+  expect_same(product, hadamard(a, b));
+  EXPECT_TRUE(sum == a + b);
+
+  Matrix<int64_t, Layout> c = a;
+  c += b;
+  expect_same(sum, c);
+  c -= b;
+  expect_same(a, c);
+  c *= factor;
+  expect_same(scaled, c);
+  c = a;
+  hadamard_in_place(c, b);
+  expect_same(product, c);
+
+  int64_t total = 0;
+  for (size_t i = 0; i < a.rows(); ++i) {
+    for (size_t j = 0; j < a.cols(); ++j) {
+      total += a(i, j);
+    }
+  }
+  EXPECT_EQ(total, ct::sum(a));
+
+  if (!a.empty()) {
+    Matrix<int64_t> line = fuzzer.matrix<int64_t>(1, std::max(a.rows(), a.cols()));
+    expect_same(reference_map(a, [&](size_t i, size_t j) { return a(i, j) + line(0, j); }),
+                add_to_each_row(a, line.row(0) | std::views::take(a.cols())));
+    expect_same(reference_map(a, [&](size_t i, size_t j) { return a(i, j) + line(0, i); }),
+                add_to_each_col(a, line.row(0) | std::views::take(a.rows())));
+  }
+}
+
+template <typename Layout>
+void check_products(Fuzzer& fuzzer) {
+  size_t rows = fuzzer.dim(200);
+  size_t depth = fuzzer.dim(200);
+  size_t cols = fuzzer.dim(200);
+  // Deep products with few rows take the split inner dimension paths of "reduction.h"
+  if (fuzzer.below(6) == 0) {
+    rows = 1 + fuzzer.below(6);
+    depth = REPRODUCIBLE_DEPTH_CHUNK + fuzzer.below(3 * REPRODUCIBLE_DEPTH_CHUNK);
+    cols = 1 + fuzzer.below(40);
+  }
+  Matrix<int64_t, Layout> a = fuzzer.matrix<int64_t, Layout>(rows, depth);
+  Matrix<int64_t, Layout> b = fuzzer.matrix<int64_t, Layout>(depth, cols);
+  Matrix<int64_t> expected = reference_product<int64_t>(a, b);
+
+  for (ReductionMode mode : {ReductionMode::Fast, ReductionMode::Reproducible}) {
+    set_reduction_mode(mode);
+    expect_same(expected, a * b);
+    Matrix<int64_t, Layout> c = a;
+    c *= b;
+    expect_same(expected, c);
+  }
+}
+
+template <typename Layout>
+void check_floating_products(Fuzzer& fuzzer) {
+  size_t rows = fuzzer.dim(150);
+  size_t depth = fuzzer.dim(150);
+  size_t cols = fuzzer.dim(150);
+  if (fuzzer.below(6) == 0) {
+    rows = 1 + fuzzer.below(6);
+    depth = REPRODUCIBLE_DEPTH_CHUNK + fuzzer.below(3 * REPRODUCIBLE_DEPTH_CHUNK);
+  }
+  Matrix<double, Layout> a = fuzzer.real_matrix<double, Layout>(rows, depth);
+  Matrix<double, Layout> b = fuzzer.real_matrix<double, Layout>(depth, cols);
+  Matrix<float, Layout> narrow_a = fuzzer.real_matrix<float, Layout>(rows, depth);
+  Matrix<float, Layout> narrow_b = fuzzer.real_matrix<float, Layout>(depth, cols);
+  Matrix<int32_t, Layout> int_a = fuzzer.matrix<int32_t, Layout>(rows, depth);
+  Matrix<int32_t, Layout> int_b = fuzzer.matrix<int32_t, Layout>(depth, cols);
+
+  for (ReductionMode mode : {ReductionMode::Fast, ReductionMode::Reproducible}) {
+    set_reduction_mode(mode);
+    expect_product_near(a, b, a * b);
+    expect_product_near(narrow_a, narrow_b, narrow_a * narrow_b);
+    expect_same(reference_product<int32_t>(int_a, int_b), int_a * int_b);
+  }
+}
+
+template <typename Layout>
+void check_fused_views(Fuzzer& fuzzer) {
+  size_t rows = fuzzer.dim(700);
+  size_t cols = fuzzer.dim(700);
+  Matrix<int64_t, Layout> a = fuzzer.matrix<int64_t, Layout>(rows, cols);
+  Matrix<int64_t, Layout> b = fuzzer.matrix<int64_t, Layout>(rows, cols);
+  int64_t factor = fuzzer.value();
+  auto scale = [factor](int64_t x) { return x * factor; };
+  auto combine = [](int64_t x, int64_t y) { return 3 * x - y; };
+
+  Matrix<int64_t, Layout> expected = reference_map(a, [&](size_t i, size_t j) {
+    return 3 * a(i, j) - b(i, j) * factor;
+  });
+  expect_same(expected, Matrix<int64_t, Layout>(views::zip_transform(combine, a, views::transform(b, scale))));
+
+  // Into a matrix of another shape, and in place
+  Matrix<int64_t, Layout> out = fuzzer.matrix<int64_t, Layout>(fuzzer.dim(50), fuzzer.dim(50));
+  out = views::zip_transform(combine, a, views::transform(b, scale));
+  expect_same(expected, out);
+  Matrix<int64_t, Layout> scaled = reference_map(a, [&](size_t i, size_t j) { return a(i, j) * factor; });
+  a = views::transform(a, scale);
+  expect_same(scaled, a);
+}
+
+} // namespace
+
+class DifferentialTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mode_ = reduction_mode();
+  }
+
+  void TearDown() override {
+    set_reduction_mode(mode_);
+  }
+
+private:
+  ReductionMode mode_ = ReductionMode::Fast;
+};
+
+TEST_F(DifferentialTest, elementwise) {
+  for_each_case([](Fuzzer& fuzzer) {
+    check_elementwise<RowMajor>(fuzzer);
+    check_elementwise<ColMajor>(fuzzer);
+    check_elementwise<Tiled5>(fuzzer);
+  });
+}
+
+TEST_F(DifferentialTest, products) {
+  for_each_case([](Fuzzer& fuzzer) {
+    check_products<RowMajor>(fuzzer);
+    check_products<ColMajor>(fuzzer);
+    check_products<Tiled5>(fuzzer);
+  });
+}
+
+TEST_F(DifferentialTest, floating_products) {
+  for_each_case([](Fuzzer& fuzzer) {
+    check_floating_products<RowMajor>(fuzzer);
+    check_floating_products<ColMajor>(fuzzer);
+    check_floating_products<Tiled5>(fuzzer);
+  });
+}
+
+TEST_F(DifferentialTest, product_variants) {
+  for_each_case([](Fuzzer& fuzzer) {
+    size_t rows = fuzzer.dim(150);
+    size_t depth = fuzzer.dim(150);
+    size_t cols = fuzzer.dim(150);
+    Matrix<int32_t> narrow_a = fuzzer.matrix<int32_t>(rows, depth, 1000);
+    Matrix<int32_t> narrow_b = fuzzer.matrix<int32_t>(depth, cols, 1000);
+    expect_same(reference_product<int64_t>(narrow_a, narrow_b), multiply<int64_t>(narrow_a, narrow_b));
+    Matrix<int8_t> byte_a = fuzzer.matrix<int8_t>(rows, depth);
+    Matrix<int8_t> byte_b = fuzzer.matrix<int8_t>(depth, cols);
+    expect_same(reference_product<int32_t>(byte_a, byte_b), multiply<int32_t>(byte_a, byte_b));
+
+    // Widening: the products of two floats are exact in double
+    Matrix<float> float_a = fuzzer.real_matrix<float>(rows, depth);
+    Matrix<float> float_b = fuzzer.real_matrix<float>(depth, cols);
+    expect_product_near(float_a, float_b, multiply<double>(float_a, float_b));
+
+    Matrix<int64_t> a = fuzzer.matrix<int64_t>(rows, depth);
+    Matrix<int64_t> b = fuzzer.matrix<int64_t>(depth, cols);
+    Matrix<int64_t> expected = reference_product<int64_t>(a, b);
+
+    // Into a buffer of the right shape, of another shape, and into an operand
+    Matrix<int64_t> out = fuzzer.below(2) == 0 ? Matrix<int64_t>(a.rows(), b.cols()) : fuzzer.matrix<int64_t>(3, 4);
+    multiply_into(a, b, out);
+    expect_same(expected, out);
+
+    // `c += u * v` on top of a random `c`
+    Matrix<int64_t> c = fuzzer.matrix<int64_t>(expected.rows(), expected.cols());
+    Matrix<int64_t> updated = reference_map(c, [&](size_t i, size_t j) { return c(i, j) + expected(i, j); });
+    if (!c.empty()) {
+      rank_update(c, a, b);
+      expect_same(updated, c);
+    }
+
+    Matrix<int64_t> d = fuzzer.matrix<int64_t>(b.cols(), fuzzer.dim(60));
+    expect_same(reference_product<int64_t>(expected, d), multiply_chain(a, b, d));
+
+    size_t n = fuzzer.dim(40);
+    Matrix<int64_t> square = fuzzer.matrix<int64_t>(n, n, 2);
+    Matrix<int64_t> power = identity<int64_t>(n);
+    size_t exponent = fuzzer.below(5);
+    for (size_t e = 0; e < exponent; ++e) {
+      power = reference_product<int64_t>(power, square);
+    }
+    expect_same(power, pow(square, exponent));
+  });
+}
+
+TEST_F(DifferentialTest, update_product) {
+  for_each_case([](Fuzzer& fuzzer) {
+    if (fuzzer.below(2) == 0) {
+      set_reduction_mode(ReductionMode::Reproducible);
+    }
+    size_t rows = 1 + fuzzer.below(120);
+    size_t depth = fuzzer.below(4) == 0 ? REPRODUCIBLE_DEPTH_CHUNK + fuzzer.below(1000) : 1 + fuzzer.below(120);
+    size_t cols = 1 + fuzzer.below(60);
+    Matrix<int64_t> a = fuzzer.matrix<int64_t>(rows, depth);
+    Matrix<int64_t> b = fuzzer.matrix<int64_t>(depth, cols);
+    Matrix<int64_t> c = a * b;
+    a.track_dirty_rows();
+    b.track_dirty_rows();
+    c.track_dirty_rows();
+    c.clear_dirty_rows();
+    for (size_t changes = fuzzer.below(rows + 1); changes > 0; --changes) {
+      size_t i = fuzzer.below(rows);
+      for (size_t k = 0; k < depth; ++k) {
+        a(i, k) = fuzzer.value();
+      }
+    }
+    size_t dirty = a.dirty_row_count();
+    update_product(c, a, b);
+    // The dirty rows only were recomputed, by the incremental kernel rather than a full product
+    EXPECT_EQ(dirty, c.dirty_row_count());
+    expect_same(reference_product<int64_t>(a, b), c);
+  });
+}
+
+TEST_F(DifferentialTest, kronecker) {
+  for_each_case([](Fuzzer& fuzzer) {
+    Matrix<int64_t> a = fuzzer.matrix<int64_t>(fuzzer.dim(20), fuzzer.dim(20));
+    Matrix<int64_t> b = fuzzer.matrix<int64_t>(fuzzer.dim(20), fuzzer.dim(20));
+    Matrix<int64_t> expected(a.rows() * b.rows(), a.cols() * b.cols());
+    for (size_t i = 0; i < expected.rows(); ++i) {
+      for (size_t j = 0; j < expected.cols(); ++j) {
+        expected(i, j) = a(i / b.rows(), j / b.cols()) * b(i % b.rows(), j % b.cols());
+      }
+    }
+    expect_same(expected, kronecker(a, b));
+  });
+}
+
+TEST_F(DifferentialTest, convolution) {
+  for_each_case([](Fuzzer& fuzzer) {
+    Matrix<int64_t> image = fuzzer.matrix<int64_t>(fuzzer.dim(120), fuzzer.dim(120));
+    Matrix<int64_t> kernel = fuzzer.matrix<int64_t>(fuzzer.dim(10), fuzzer.dim(10));
+    auto rows = static_cast<std::ptrdiff_t>(image.rows());
+    auto cols = static_cast<std::ptrdiff_t>(image.cols());
+    for (Boundary boundary : {Boundary::Zero, Boundary::Clamp, Boundary::Reflect, Boundary::Wrap}) {
+      Matrix<int64_t> expected = reference_map(image, [&](size_t i, size_t j) {
+        int64_t sum = 0;
+        for (size_t p = 0; p < kernel.rows(); ++p) {
+          for (size_t q = 0; q < kernel.cols(); ++q) {
+            auto row = static_cast<std::ptrdiff_t>(i + p - kernel.rows() / 2);
+            auto col = static_cast<std::ptrdiff_t>(j + q - kernel.cols() / 2);
+            size_t r = reference_boundary(row, rows, boundary);
+            size_t c = reference_boundary(col, cols, boundary);
+            sum += r == image.rows() || c == image.cols() ? 0 : kernel(p, q) * image(r, c);
+          }
+        }
+        return sum;
+      });
+      for (ConvolutionMethod method : {ConvolutionMethod::Auto, ConvolutionMethod::Direct, ConvolutionMethod::Im2col}) {
+        expect_same(expected, convolve2d(image, kernel, boundary, method));
+      }
+    }
+  });
+}
+
+TEST_F(DifferentialTest, bit_matrix) {
+  for_each_case([](Fuzzer& fuzzer) {
+    size_t n = fuzzer.dim(150);
+    size_t m = fuzzer.dim(150);
+    // Sparse enough for the closure not to saturate at once
+    Matrix<int64_t> a = reference_map(Matrix<int64_t>(n, m), [&](size_t, size_t) { return fuzzer.below(40) == 0; });
+    Matrix<int64_t> b = reference_map(Matrix<int64_t>(m, n), [&](size_t, size_t) { return fuzzer.below(3) == 0; });
+
+    Matrix<int64_t> counts = reference_product<int64_t>(a, b);
+    Matrix<bool> expected(counts.rows(), counts.cols());
+    for (size_t i = 0; i < counts.rows(); ++i) {
+      for (size_t j = 0; j < counts.cols(); ++j) {
+        expected(i, j) = counts(i, j) != 0;
+      }
+    }
+    expect_same(expected, (BitMatrix(a) * BitMatrix(b)).to_dense());
+
+    if (a.rows() == a.cols()) {
+      Matrix<bool> closure(a.rows(), a.cols());
+      for (size_t i = 0; i < a.rows(); ++i) {
+        for (size_t j = 0; j < a.cols(); ++j) {
+          closure(i, j) = a(i, j) != 0;
+        }
+      }
+      for (size_t k = 0; k < closure.rows(); ++k) {
+        for (size_t i = 0; i < closure.rows(); ++i) {
+          for (size_t j = 0; j < closure.cols(); ++j) {
+            closure(i, j) = closure(i, j) || (closure(i, k) && closure(k, j));
+          }
+        }
+      }
+      expect_same(closure, transitive_closure(BitMatrix(a)).to_dense());
+    }
+  });
+}
+
+TEST_F(DifferentialTest, multiply_mod) {
+  for_each_case([](Fuzzer& fuzzer) {
+    constexpr uint64_t MODULI[] = {2, 3, 65537, (uint64_t{1} << 32) - 5, (uint64_t{1} << 32) + 15,
+                                   (uint64_t{1} << 61) - 1, ~uint64_t{0} - 58};
+    uint64_t p = fuzzer.below(3) == 0 ? 2 + fuzzer.engine()() % ((uint64_t{1} << 62) - 2) : MODULI[fuzzer.below(7)];
+    size_t rows = fuzzer.dim(100);
+    size_t depth = fuzzer.dim(300);
+    size_t cols = fuzzer.dim(100);
+    auto random = [&](size_t, size_t) { return fuzzer.engine()(); };
+    Matrix<uint64_t> a = reference_map(Matrix<uint64_t>(rows, depth), random);
+    Matrix<uint64_t> b = reference_map(Matrix<uint64_t>(depth, cols), random);
+
+    __extension__ typedef unsigned __int128 Wide;
+    Matrix<uint64_t> expected(a.rows(), b.cols());
+    for (size_t i = 0; i < expected.rows(); ++i) {
+      for (size_t j = 0; j < expected.cols(); ++j) {
+        Wide sum = 0;
+        for (size_t k = 0; k < a.cols(); ++k) {
+          sum = (sum + static_cast<Wide>(a(i, k) % p) * (b(k, j) % p)) % p;
+        }
+        expected(i, j) = static_cast<uint64_t>(sum);
+      }
+    }
+    for (ModularReduction reduction :
+         {ModularReduction::Lazy, ModularReduction::Barrett, ModularReduction::Montgomery}) {
+      expect_same(expected, multiply_mod(a, b, p, reduction));
+    }
+  });
+}
+
+TEST_F(DifferentialTest, serialize) {
+  for_each_case([](Fuzzer& fuzzer) {
+    // Runs of equal values give the compressor matches
+    Matrix<int64_t> m = fuzzer.matrix<int64_t>(fuzzer.dim(400), fuzzer.dim(400), fuzzer.below(2) == 0 ? 1 : 1 << 20);
+    for (Compression compression : {Compression::None, Compression::Lz}) {
+      std::stringstream stream;
+      serialize(stream, m, compression);
+      expect_same(m, deserialize<int64_t>(stream));
+    }
+  });
+}
+
+TEST_F(DifferentialTest, async_multiply) {
+  for_each_case([](Fuzzer& fuzzer) {
+    bool reproducible = fuzzer.below(2) == 0;
+    set_reduction_mode(reproducible ? ReductionMode::Reproducible : ReductionMode::Fast);
+    size_t rows = fuzzer.dim(200);
+    size_t depth = fuzzer.below(4) == 0 ? REPRODUCIBLE_DEPTH_CHUNK + fuzzer.below(2000) : fuzzer.dim(200);
+    size_t cols = fuzzer.dim(200);
+    Matrix<int64_t> a = fuzzer.matrix<int64_t>(rows, depth);
+    Matrix<int64_t> b = fuzzer.matrix<int64_t>(depth, cols);
+    expect_same(reference_product<int64_t>(a, b), async_multiply(a, b).get());
+
+    Matrix<double> real_a = fuzzer.real_matrix<double>(rows, depth);
+    Matrix<double> real_b = fuzzer.real_matrix<double>(depth, cols);
+    Matrix<double> product = async_multiply(real_a, real_b).get();
+    expect_product_near(real_a, real_b, product);
+    // Same bits as the synchronous product whatever the thread count
+    if (reproducible) {
+      expect_same(real_a * real_b, product);
+    }
+  });
+}
+
+TEST_F(DifferentialTest, structured_products) {
+  for_each_case([](Fuzzer& fuzzer) {
+    size_t n = fuzzer.dim(200);
+    Matrix<int64_t> dense = fuzzer.matrix<int64_t>(n, n);
+    Matrix<int64_t> right = fuzzer.matrix<int64_t>(n, fuzzer.dim(120));
+
+    Matrix<int64_t> symmetric = reference_map(dense, [&](size_t i, size_t j) {
+      return dense(std::max(i, j), std::min(i, j));
+    });
+    Matrix<int64_t> lower = reference_map(dense, [&](size_t i, size_t j) { return j <= i ? dense(i, j) : 0; });
+    Matrix<int64_t> upper = reference_map(dense, [&](size_t i, size_t j) { return j >= i ? dense(i, j) : 0; });
+    expect_same(reference_product<int64_t>(symmetric, right), SymmetricMatrix<int64_t>(dense) * right);
+    expect_same(reference_product<int64_t>(lower, right), TriangularMatrix<int64_t>(dense) * right);
+    expect_same(reference_product<int64_t>(upper, right), TriangularMatrix<int64_t, Triangle::Upper>(dense) * right);
+
+    Matrix<int64_t> wide = fuzzer.matrix<int64_t>(fuzzer.dim(200), n);
+    size_t below = fuzzer.below(4) == 0 ? fuzzer.below(wide.rows() + 1) : fuzzer.below(4);
+    size_t above = fuzzer.below(4) == 0 ? fuzzer.below(n + 1) : fuzzer.below(4);
+    Matrix<int64_t> band = reference_map(wide, [&](size_t i, size_t j) {
+      return j + below >= i && j <= i + above ? wide(i, j) : 0;
+    });
+    expect_same(reference_product<int64_t>(band, right), BandMatrix<int64_t>(wide, below, above) * right);
+  });
+}
+
+TEST_F(DifferentialTest, lu) {
+  for_each_case([](Fuzzer& fuzzer) {
+    // Diagonally dominant, so nonsingular and well conditioned, with its rows shuffled so that pivoting is needed
+    size_t n = fuzzer.dim(150);
+    Matrix<double> dominant = fuzzer.real_matrix<double>(n, n);
+    for (size_t i = 0; i < dominant.rows(); ++i) {
+      dominant(i, i) += (fuzzer.below(2) == 0 ? 1.0 : -1.0) * static_cast<double>(n + 1);
+    }
+    size_t order[150];
+    for (size_t i = 0; i < n; ++i) {
+      order[i] = i;
+    }
+    std::shuffle(order, order + n, fuzzer.engine());
+    Matrix<double> a = reference_map(dominant, [&](size_t i, size_t j) { return dominant(order[i], j); });
+    Matrix<double> b = fuzzer.real_matrix<double>(n, fuzzer.dim(20));
+    double tolerance = 1e-12 * static_cast<double>(n + 1) * static_cast<double>(n + 1);
+
+    // `P * a = L * U`
+    Matrix<double> factors = a;
+    LuPivots pivots = ct::lu(factors);
+    Matrix<double> permuted = a;
+    for (size_t k = 0; k < pivots.size(); ++k) {
+      for (size_t j = 0; j < n; ++j) {
+        std::swap(permuted(k, j), permuted(pivots[k], j));
+      }
+    }
+    Matrix<double> l = reference_map(factors, [&](size_t i, size_t j) {
+      return i == j ? 1 : j < i ? factors(i, j) : 0;
+    });
+    Matrix<double> u = reference_map(factors, [&](size_t i, size_t j) { return j >= i ? factors(i, j) : 0; });
+    expect_near(permuted, reference_product<double>(l, u), tolerance);
+
+    if (!b.empty()) {
+      expect_near(b, reference_product<double>(a, solve(a, b)), tolerance);
+    }
+    expect_near(identity<double>(n), reference_product<double>(a, inverse(a)), tolerance);
+  });
+}
+
+TEST_F(DifferentialTest, fused_views) {
+  for_each_case([](Fuzzer& fuzzer) {
+    check_fused_views<RowMajor>(fuzzer);
+    check_fused_views<ColMajor>(fuzzer);
+    check_fused_views<Tiled5>(fuzzer);
+  });
+}
+
+TEST_F(DifferentialTest, column_views) {
+  size_t distance = column_prefetch_distance();
+  for_each_case([](Fuzzer& fuzzer) {
+    // Around the prefetch distance, which splits the walk in two loops
+    set_column_prefetch_distance(fuzzer.below(4) == 0 ? 0 : 1 + fuzzer.below(32));
+    Matrix<int64_t> m = fuzzer.matrix<int64_t>(fuzzer.dim(700), fuzzer.dim(100));
+    if (m.empty()) {
+      return;
+    }
+    size_t col = fuzzer.below(m.cols());
+    int64_t sum = 0;
+    int64_t largest = std::numeric_limits<int64_t>::min();
+    for (size_t i = 0; i < m.rows(); ++i) {
+      sum += m(i, col);
+      largest = std::max(largest, m(i, col));
+    }
+    EXPECT_EQ(sum, m.col(col).accumulate());
+    EXPECT_EQ(largest, std::as_const(m).col(col).accumulate(largest, [](int64_t x, int64_t y) {
+      return std::max(x, y);
+    }));
+
+    int64_t factor = fuzzer.value();
+    Matrix<int64_t> expected = reference_map(m, [&](size_t i, size_t j) {
+      return j == col ? m(i, j) * factor + 1 : m(i, j);
+    });
+    m.col(col) *= factor;
+    m.col(col).for_each([](int64_t& x) { ++x; });
+    expect_same(expected, m);
+  });
+  set_column_prefetch_distance(distance);
+}
+
+TEST_F(DifferentialTest, copies) {
+  for_each_case([](Fuzzer& fuzzer) {
+    // Sometimes larger than the last-level cache, which the parallel copies and elementwise results stream past
+    size_t count = fuzzer.below(8) == 0 ? detail::last_level_cache_size() / sizeof(int64_t) + fuzzer.below(1000)
+                                        : fuzzer.below(100000);
+    uint64_t seed = fuzzer.engine()();
+    detail::PackedBuffer<int64_t> from(count);
+    detail::PackedBuffer<int64_t> to(count);
+    // Signed 62-bit values, so that the elementwise sums below cannot overflow
+    for (size_t i = 0; i < count; ++i) {
+      from[i] = static_cast<int64_t>(seed * (i + 1)) >> 2;
+    }
+    detail::copy_elements(from.data(), to.data(), count);
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(from[i], to[i]) << "at " << i;
+    }
+
+    // Unaligned ends on both sides
+    size_t bytes = fuzzer.below(std::min<size_t>(count * sizeof(int64_t), 1 << 16) + 1);
+    size_t from_offset = fuzzer.below(16);
+    size_t to_offset = fuzzer.below(16);
+    bytes = bytes > 16 ? bytes - 16 : 0;
+    unsigned char* in = reinterpret_cast<unsigned char*>(from.data()) + from_offset;
+    unsigned char* out = reinterpret_cast<unsigned char*>(to.data()) + to_offset;
+    std::fill(out, out + bytes, 0);
+    detail::stream_copy(in, out, bytes);
+    ASSERT_TRUE(std::equal(in, in + bytes, out));
+
+    // Copies and elementwise results of the same size
+    size_t cols = 1 + fuzzer.below(1000);
+    Matrix<int64_t> m = reference_map(Matrix<int64_t>(count / cols, cols), [&](size_t i, size_t j) {
+      return from[i * cols + j];
+    });
+    expect_same(m, Matrix<int64_t>(m));
+    expect_same(reference_map(m, [&](size_t i, size_t j) { return 2 * m(i, j); }), m + m);
+  });
+}
+
+} // namespace ct::test
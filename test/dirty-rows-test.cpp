@@ -0,0 +1,125 @@
+#include "layout.h"
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+namespace ct::test {
+
+namespace {
+
+template <typename T, typename Layout>
+void expect_dirty(const Matrix<T, Layout>& m, std::initializer_list<size_t> dirty) {
+  EXPECT_EQ(dirty.size(), m.dirty_row_count());
+  for (size_t i = 0; i < m.rows(); ++i) {
+    EXPECT_EQ(std::ranges::find(dirty, i) != dirty.end(), m.row_dirty(i)) << "  where i = " << i;
+  }
+}
+
+} // namespace
+
+TEST(DirtyRowsTest, untracked) {
+  Matrix<Element> a(5, 5);
+
+  EXPECT_FALSE(a.tracks_dirty_rows());
+  EXPECT_EQ(5, a.dirty_row_count());
+  EXPECT_TRUE(a.row_dirty(3));
+  a.clear_dirty_rows();
+  EXPECT_TRUE(a.row_dirty(3));
+}
+
+TEST(DirtyRowsTest, row_accessors) {
+  Matrix<Element> a(100, 10);
+  a.track_dirty_rows();
+
+  EXPECT_TRUE(a.tracks_dirty_rows());
+  expect_dirty(a, {});
+
+  a(3, 4) = 1;
+  a.row(70) *= 2;
+  *a.row_begin(64) = 5;
+  a.row_end(99);
+  static_cast<void>(std::as_const(a)(5, 5));
+  static_cast<void>(std::as_const(a).row(6));
+  expect_dirty(a, {3, 64, 70, 99});
+
+  a.clear_dirty_rows();
+  expect_dirty(a, {});
+  a.mark_row_dirty(0);
+  expect_dirty(a, {0});
+}
+
+TEST(DirtyRowsTest, whole_matrix_writes) {
+  Matrix<Element> a(70, 3);
+  a.track_dirty_rows();
+
+  a.col(1);
+  EXPECT_EQ(70, a.dirty_row_count());
+
+  a.clear_dirty_rows();
+  a.data();
+  EXPECT_EQ(70, a.dirty_row_count());
+
+  a.clear_dirty_rows();
+  a += a;
+  EXPECT_EQ(70, a.dirty_row_count());
+
+  a.clear_dirty_rows();
+  a = Matrix<Element>(70, 3);
+  EXPECT_EQ(70, a.dirty_row_count());
+
+  // Assigning a matrix with a different number of rows keeps tracking, with every row dirty
+  a = Matrix<Element>(130, 2);
+  EXPECT_TRUE(a.tracks_dirty_rows());
+  EXPECT_EQ(130, a.dirty_row_count());
+  a.clear_dirty_rows();
+  a(129, 1) = 1;
+  expect_dirty(a, {129});
+}
+
+TEST(DirtyRowsTest, copy_and_move) {
+  Matrix<Element> a(10, 10);
+  a.track_dirty_rows();
+  a(2, 2) = 1;
+
+  Matrix<Element> copy = a;
+  EXPECT_FALSE(copy.tracks_dirty_rows());
+
+  Matrix<Element> moved = std::move(a);
+  EXPECT_TRUE(moved.tracks_dirty_rows());
+  expect_dirty(moved, {2});
+  EXPECT_FALSE(a.tracks_dirty_rows());
+}
+
+TEST(DirtyRowsTest, other_layouts) {
+  Matrix<Element, ColMajor> a(40, 30);
+  Matrix<Element, Tiled<16>> b(40, 30);
+  a.track_dirty_rows();
+  b.track_dirty_rows();
+
+  a.row(7) *= 2;
+  a(33, 2) = 1;
+  b.row(7) *= 2;
+  b(33, 2) = 1;
+
+  expect_dirty(a, {7, 33});
+  expect_dirty(b, {7, 33});
+}
+
+TEST(DirtyRowsTest, shared_buffer) {
+  Matrix<Element> a(20, 20);
+  a.enable_sharing();
+  a.track_dirty_rows();
+  Matrix<Element> b = a;
+
+  a(4, 4) = 3;
+
+  expect_dirty(a, {4});
+  EXPECT_EQ(0, std::as_const(b)(4, 4));
+}
+
+} // namespace ct::test
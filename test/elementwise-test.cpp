@@ -0,0 +1,143 @@
+#include "elementwise.h"
+#include "layout.h"
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+
+namespace ct::test {
+
+namespace {
+
+template <typename Layout = RowMajor>
+Matrix<Element, Layout> make_matrix(size_t rows, size_t cols, size_t offset = 0) {
+  Matrix<Element, Layout> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = elem(i, j) + offset;
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(ElementwiseTest, hadamard) {
+  Matrix<Element> a = make_matrix(30, 40);
+  Matrix<Element> b = make_matrix(30, 40, 3);
+
+  Matrix<Element> c = hadamard(a, b);
+  for (size_t i = 0; i < 30; ++i) {
+    for (size_t j = 0; j < 40; ++j) {
+      EXPECT_EQ(elem(i, j) * (elem(i, j) + 3), c(i, j).value);
+    }
+  }
+
+  Element::reset_allocations();
+  hadamard_in_place(a, b);
+  expect_allocations(0);
+  EXPECT_EQ(c, a);
+
+  // Squaring in place through the matrix itself
+  hadamard_in_place(b, b);
+  EXPECT_EQ((elem(29, 39) + 3) * (elem(29, 39) + 3), b(29, 39).value);
+
+  expect_empty(hadamard(Matrix<Element>(), Matrix<Element>()));
+}
+
+TEST(ElementwiseTest, hadamard_large_col_major) {
+  Matrix<double, ColMajor> a(1000, 700);
+  Matrix<double, ColMajor> b(1000, 700);
+  for (size_t i = 0; i < 1000; ++i) {
+    for (size_t j = 0; j < 700; ++j) {
+      a(i, j) = static_cast<double>(i % 13);
+      b(i, j) = static_cast<double>(j % 7) / 2;
+    }
+  }
+  Matrix<double, ColMajor> c = hadamard(a, b);
+  hadamard_in_place(a, b);
+  EXPECT_EQ(c, a);
+  EXPECT_EQ(static_cast<double>(999 % 13) * static_cast<double>(699 % 7) / 2, c(999, 699));
+}
+
+TEST(ElementwiseTest, add_to_each_row) {
+  Matrix<Element> m = make_matrix(20, 6);
+  Matrix<Element> bias = make_matrix(1, 6, 1000);
+
+  Matrix<Element> shifted = add_to_each_row(m, bias.row(0));
+  for (size_t i = 0; i < 20; ++i) {
+    for (size_t j = 0; j < 6; ++j) {
+      EXPECT_EQ(elem(i, j) + elem(0, j) + 1000, shifted(i, j).value);
+    }
+  }
+
+  // A row of the matrix itself is read before any row is written
+  Element::reset_allocations();
+  add_to_each_row_in_place(m, m.row(3));
+  expect_allocations(6);
+  for (size_t i = 0; i < 20; ++i) {
+    EXPECT_EQ(elem(i, 5) + elem(3, 5), m(i, 5).value);
+  }
+
+  Element values[] = {1, 2, 3};
+  Matrix<Element, ColMajor> col_major = make_matrix<ColMajor>(4, 3);
+  add_to_each_row_in_place(col_major, values);
+  EXPECT_EQ(elem(3, 2) + 3, col_major(3, 2).value);
+}
+
+TEST(ElementwiseTest, add_to_each_col) {
+  Matrix<Element> m = make_matrix(7, 300);
+  Matrix<Element> original = m;
+
+  Matrix<Element> shifted = add_to_each_col(m, m.col(299));
+  add_to_each_col_in_place(m, m.col(299));
+  EXPECT_EQ(shifted, m);
+  for (size_t i = 0; i < 7; ++i) {
+    for (size_t j = 0; j < 300; ++j) {
+      EXPECT_EQ(original(i, j).value + original(i, 299).value, m(i, j).value);
+    }
+  }
+}
+
+TEST(ElementwiseTest, kronecker) {
+  Matrix<int> a({{1, 2}, {3, 4}});
+  Matrix<int> b({{0, 5}, {6, 7}});
+  expect_equal(
+      Matrix<int>({
+          {0, 5, 0, 10},
+          {6, 7, 12, 14},
+          {0, 15, 0, 20},
+          {18, 21, 24, 28},
+      }),
+      kronecker(a, b)
+  );
+
+  Matrix<int, ColMajor> ca({{1, 2, 3}});
+  Matrix<int, ColMajor> cb({{1}, {-1}});
+  expect_equal(Matrix<int, ColMajor>({{1, 2, 3}, {-1, -2, -3}}), kronecker(ca, cb));
+
+  expect_empty(kronecker(Matrix<int>(), b));
+}
+
+TEST(ElementwiseTest, kronecker_into) {
+  Matrix<Element> a = make_matrix(9, 5);
+  Matrix<Element> b = make_matrix(11, 13, 1);
+  Matrix<Element> out = kronecker(a, b);
+  ASSERT_EQ(99, out.rows());
+  ASSERT_EQ(65, out.cols());
+  for (size_t i = 0; i < 99; ++i) {
+    for (size_t j = 0; j < 65; ++j) {
+      EXPECT_EQ(a(i / 11, j / 13).value * b(i % 11, j % 13).value, out(i, j).value);
+    }
+  }
+
+  // The buffer of a result of the right shape is reused
+  Element::reset_allocations();
+  kronecker_into(b, a, out);
+  expect_allocations(0);
+  EXPECT_EQ(b(10, 12).value * a(8, 4).value, out(98, 64).value);
+}
+
+} // namespace ct::test
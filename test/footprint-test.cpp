@@ -0,0 +1,122 @@
+#include "allocation.h"
+#include "footprint.h"
+#include "matrix.h"
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ct::test {
+
+// Every test accounts a distinct element type, and compares the counters with their values when it starts
+
+TEST(FootprintTest, counts_buffers) {
+  MemoryUsage start = memory_usage<int16_t>();
+  size_t bytes = 300 * 400 * sizeof(int16_t);
+  {
+    Matrix<int16_t> a(300, 400);
+    Matrix<int16_t> b = a;
+    Matrix<int16_t> moved = std::move(b);
+    Matrix<int16_t> empty(0, 10);
+
+    MemoryUsage usage = memory_usage<const int16_t>();
+    EXPECT_EQ(start.live_bytes + 2 * bytes, usage.live_bytes);
+    EXPECT_EQ(start.live_buffers + 2, usage.live_buffers);
+    EXPECT_EQ(start.allocations + 2, usage.allocations);
+    EXPECT_LE(start.live_bytes + 2 * bytes, usage.peak_bytes);
+  }
+  MemoryUsage usage = memory_usage<int16_t>();
+  EXPECT_EQ(start.live_bytes, usage.live_bytes);
+  EXPECT_EQ(start.live_buffers, usage.live_buffers);
+  EXPECT_EQ(start.allocations + 2, usage.allocations);
+  EXPECT_LE(start.live_bytes + 2 * bytes, usage.peak_bytes);
+}
+
+TEST(FootprintTest, small_buffers_are_exact) {
+  MemoryUsage start = memory_usage<int8_t>();
+  MemoryUsage all_start = memory_usage();
+  {
+    Matrix<int8_t> small[100];
+    for (Matrix<int8_t>& m : small) {
+      m = Matrix<int8_t>(3, 5);
+    }
+    Matrix<int8_t> shared = small[0];
+    shared.enable_sharing();
+    // Shares the buffer of `shared`
+    Matrix<int8_t> copy = shared;
+
+    MemoryUsage usage = memory_usage<int8_t>();
+    EXPECT_EQ(start.live_bytes + 101 * 15, usage.live_bytes);
+    EXPECT_EQ(start.live_buffers + 101, usage.live_buffers);
+    EXPECT_LE(all_start.live_bytes + 101 * 15, memory_usage().live_bytes);
+  }
+  EXPECT_EQ(start.live_bytes, memory_usage<int8_t>().live_bytes);
+  EXPECT_EQ(start.live_buffers, memory_usage<int8_t>().live_buffers);
+}
+
+TEST(FootprintTest, scope_reports_peak_of_temporaries) {
+  Matrix<float> a(256, 256);
+  Matrix<float> b(256, 256);
+  size_t bytes = 256 * 256 * sizeof(float);
+
+  MemoryScope<float> scope;
+  MemoryUsage start = scope.usage();
+  EXPECT_EQ(0, start.allocations);
+  EXPECT_EQ(start.live_bytes, start.peak_bytes);
+  {
+    Matrix<float> c = (a + b) * a - b;
+    EXPECT_EQ(start.live_bytes + bytes, scope.usage().live_bytes);
+  }
+  MemoryUsage usage = scope.usage();
+  EXPECT_EQ(start.live_bytes, usage.live_bytes);
+  EXPECT_LE(start.live_bytes + 2 * bytes, usage.peak_bytes);
+  EXPECT_LE(3, usage.allocations);
+  EXPECT_EQ(usage.peak_bytes, scope.peak_bytes());
+}
+
+TEST(FootprintTest, nested_scopes) {
+  size_t bytes = 200 * 200 * sizeof(uint64_t);
+  MemoryScope<uint64_t> outer;
+  size_t start = outer.usage().live_bytes;
+  {
+    Matrix<uint64_t> m(200, 200);
+  }
+  {
+    MemoryScope<uint64_t> inner;
+    EXPECT_EQ(start, inner.peak_bytes());
+    Matrix<uint64_t> m(100, 200);
+    EXPECT_EQ(start + bytes / 2, inner.peak_bytes());
+  }
+  EXPECT_EQ(start + bytes, outer.peak_bytes());
+  EXPECT_EQ(start + bytes, memory_usage<uint64_t>().peak_bytes);
+}
+
+TEST(FootprintTest, threads) {
+  MemoryUsage start = memory_usage<uint32_t>();
+  constexpr size_t PARTS = 64;
+  Matrix<uint32_t> kept[PARTS];
+  detail::ThreadPool::instance().run(PARTS, [&kept](size_t part) {
+    for (size_t i = 0; i < 10; ++i) {
+      Matrix<uint32_t> temporary(16, 16);
+    }
+    kept[part] = Matrix<uint32_t>(8, 16);
+  });
+
+  MemoryUsage usage = memory_usage<uint32_t>();
+  EXPECT_EQ(start.live_bytes + PARTS * 8 * 16 * sizeof(uint32_t), usage.live_bytes);
+  EXPECT_EQ(start.live_buffers + PARTS, usage.live_buffers);
+  EXPECT_EQ(start.allocations + PARTS * 11, usage.allocations);
+}
+
+TEST(FootprintTest, mapped_buffers_count_pages) {
+  MemoryUsage start = memory_usage<uint16_t>();
+  {
+    Matrix<uint16_t> m(3, 5, AllocationPolicy{.placement = NumaPlacement::Interleaved});
+    EXPECT_EQ(start.live_bytes + detail::page_size(), memory_usage<uint16_t>().live_bytes);
+  }
+  EXPECT_EQ(start.live_bytes, memory_usage<uint16_t>().live_bytes);
+}
+
+} // namespace ct::test
@@ -0,0 +1,185 @@
+#include "layout.h"
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+namespace ct::test {
+
+template <typename Layout>
+class LayoutTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Element::reset_allocations();
+  }
+
+  using LayoutMatrix = Matrix<Element, Layout>;
+
+  static LayoutMatrix make_matrix(size_t rows, size_t cols) {
+    LayoutMatrix m(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < cols; ++j) {
+        m(i, j) = elem(i, j);
+      }
+    }
+    return m;
+  }
+};
+
+using Layouts = ::testing::Types<RowMajor, ColMajor, Tiled<16>, Tiled<64>>;
+TYPED_TEST_SUITE(LayoutTest, Layouts);
+
+TYPED_TEST(LayoutTest, traits) {
+  using M = Matrix<Element, TypeParam>;
+
+  EXPECT_TRUE(std::ranges::contiguous_range<M>);
+  EXPECT_TRUE(std::random_access_iterator<typename M::RowIterator>);
+  EXPECT_TRUE(std::random_access_iterator<typename M::ConstColIterator>);
+  EXPECT_TRUE(std::ranges::random_access_range<typename M::RowView>);
+  EXPECT_TRUE(std::ranges::random_access_range<typename M::ConstColView>);
+  EXPECT_TRUE(std::is_trivial_v<typename M::RowIterator>);
+  EXPECT_TRUE(std::is_trivial_v<typename M::ConstColIterator>);
+}
+
+TYPED_TEST(LayoutTest, element_access) {
+  constexpr size_t ROWS = 70;
+  constexpr size_t COLS = 45;
+
+  auto a = this->make_matrix(ROWS, COLS);
+
+  expect_allocations(ROWS * COLS);
+  EXPECT_TRUE(std::ranges::is_permutation(a, Matrix<Element>(a)));
+  for (size_t i = 0; i < ROWS; ++i) {
+    for (size_t j = 0; j < COLS; ++j) {
+      EXPECT_EQ(elem(i, j), std::as_const(a)(i, j));
+    }
+  }
+}
+
+TYPED_TEST(LayoutTest, rows_and_cols) {
+  constexpr size_t ROWS = 37;
+  constexpr size_t COLS = 70;
+
+  auto a = this->make_matrix(ROWS, COLS);
+  const auto& ca = a;
+
+  for (size_t i = 0; i < ROWS; ++i) {
+    size_t j = 0;
+    for (auto it = ca.row_begin(i); it != ca.row_end(i); ++it, ++j) {
+      EXPECT_EQ(elem(i, j), *it);
+    }
+    EXPECT_EQ(COLS, j);
+    EXPECT_EQ(COLS, ca.row(i).size());
+    EXPECT_EQ(elem(i, COLS - 1), ca.row(i)[COLS - 1]);
+  }
+  for (size_t j = 0; j < COLS; ++j) {
+    size_t i = 0;
+    for (const Element& x : ca.col(j)) {
+      EXPECT_EQ(elem(i, j), x);
+      ++i;
+    }
+    EXPECT_EQ(ROWS, i);
+    EXPECT_EQ(ROWS, std::distance(ca.col_begin(j), ca.col_end(j)));
+  }
+
+  a.row(5) *= 2;
+  a.col(7) *= 3;
+  EXPECT_EQ(elem(5, 7) * 6, ca(5, 7));
+  EXPECT_EQ(elem(5, 8) * 2, ca(5, 8));
+  EXPECT_EQ(elem(6, 7) * 3, ca(6, 7));
+}
+
+TYPED_TEST(LayoutTest, init_ctor) {
+  const Matrix<Element, TypeParam> a({
+      {1, 2, 3},
+      {4, 5, 6},
+  });
+
+  EXPECT_EQ(2, a.rows());
+  EXPECT_EQ(3, a.cols());
+  EXPECT_EQ(4, a(1, 0));
+  EXPECT_EQ(3, a(0, 2));
+}
+
+TYPED_TEST(LayoutTest, conversions) {
+  const Matrix<Element> dense = [] {
+    Matrix<Element> m(150, 97);
+    fill(m);
+    return m;
+  }();
+
+  const Matrix<Element, TypeParam> converted(dense);
+  expect_equal(dense, converted);
+
+  expect_equal(dense, Matrix<Element>(converted));
+  expect_equal(dense, Matrix<Element, TypeParam>(Matrix<Element, ColMajor>(converted)));
+  expect_equal(dense, Matrix<Element, TypeParam>(Matrix<Element, Tiled<32>>(converted)));
+}
+
+TYPED_TEST(LayoutTest, elementwise) {
+  auto a = this->make_matrix(90, 130);
+  auto b = this->make_matrix(90, 130);
+  b *= 3;
+
+  Matrix<Element> sum = Matrix<Element>(a) + Matrix<Element>(b);
+  expect_equal(sum, a + b);
+  expect_equal(Matrix<Element>(b) - Matrix<Element>(a), b - a);
+  expect_equal(Matrix<Element>(a) * Element(5), Element(5) * a);
+  EXPECT_EQ(a * Element(3), b);
+}
+
+TYPED_TEST(LayoutTest, multiply) {
+  for (auto [rows, depth, cols] : {std::tuple<size_t, size_t, size_t>{1, 1, 1}, {70, 45, 33}, {130, 150, 90}}) {
+    auto a = this->make_matrix(rows, depth);
+    auto b = this->make_matrix(depth, cols);
+
+    expect_equal(Matrix<Element>(a) * Matrix<Element>(b), a * b);
+  }
+}
+
+TYPED_TEST(LayoutTest, sharing_and_placement) {
+  auto a = this->make_matrix(300, 200);
+  a.enable_sharing();
+
+  auto b = a;
+  b.col(3) *= 2;
+  EXPECT_EQ(elem(10, 3), std::as_const(a)(10, 3));
+  EXPECT_EQ(elem(10, 3) * 2, std::as_const(b)(10, 3));
+
+  Matrix<Element, TypeParam> placed(300, 200, {.placement = NumaPlacement::RowBlocks});
+  placed += a;
+  EXPECT_EQ(a, placed);
+}
+
+TYPED_TEST(LayoutTest, empty) {
+  Matrix<Element, TypeParam> a(0, 10);
+
+  expect_empty(a);
+  expect_empty(a * a);
+  expect_empty(Matrix<Element>(a));
+  expect_allocations(0);
+}
+
+TEST(LayoutIndexTest, storage_order) {
+  const Matrix<int, ColMajor> a({
+      {1, 2, 3},
+      {4, 5, 6},
+  });
+  EXPECT_TRUE(std::ranges::equal(a, std::initializer_list<int>{1, 4, 2, 5, 3, 6}));
+  EXPECT_EQ(std::as_const(a).data() + 2, &*a.col_begin(1));
+
+  // 2x2 tiles; the bottom tiles are one row high and the right tiles one column wide
+  const Matrix<int, Tiled<2>> b({
+      {1, 2, 3},
+      {4, 5, 6},
+      {7, 8, 9},
+  });
+  EXPECT_TRUE(std::ranges::equal(b, std::initializer_list<int>{1, 2, 4, 5, 3, 6, 7, 8, 9}));
+}
+
+} // namespace ct::test
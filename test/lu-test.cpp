@@ -0,0 +1,187 @@
+#include "lu.h"
+#include "matrix.h"
+#include "multiply.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace ct::test {
+
+namespace {
+
+// Deterministic pseudo-random matrix with entries in `[-1, 1)`
+template <typename T>
+Matrix<T> random_matrix(size_t rows, size_t cols, uint64_t seed) {
+  Matrix<T> m(rows, cols);
+  for (T& x : m) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = static_cast<T>(static_cast<double>(seed >> 11) / static_cast<double>(uint64_t{1} << 52) - 1);
+  }
+  return m;
+}
+
+template <typename T>
+void expect_near(const Matrix<T>& expected, const Matrix<T>& actual, double tolerance) {
+  ASSERT_EQ(expected.rows(), actual.rows());
+  ASSERT_EQ(expected.cols(), actual.cols());
+  for (size_t i = 0; i < expected.rows(); ++i) {
+    for (size_t j = 0; j < expected.cols(); ++j) {
+      EXPECT_NEAR(expected(i, j), actual(i, j), tolerance) << "  where i = " << i << ", j = " << j;
+    }
+  }
+}
+
+// `P * a` and `L * U` rebuilt from the factors
+template <typename T>
+std::pair<Matrix<T>, Matrix<T>> reconstruct(Matrix<T> a, const Matrix<T>& factors, const LuPivots& pivots) {
+  size_t n = a.rows();
+  for (size_t k = 0; k < n; ++k) {
+    std::swap_ranges(a.row_begin(k), a.row_end(k), a.row_begin(pivots[k]));
+  }
+  Matrix<T> l(n, n);
+  Matrix<T> u(n, n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      if (j < i) {
+        l(i, j) = factors(i, j);
+      } else {
+        u(i, j) = factors(i, j);
+      }
+    }
+    l(i, i) = 1;
+  }
+  return {std::move(a), l * u};
+}
+
+} // namespace
+
+class LuTest : public ::testing::TestWithParam<size_t> {};
+
+INSTANTIATE_TEST_SUITE_P(Sizes, LuTest, ::testing::Values(1, 2, 17, 63, 64, 65, 130, 300));
+
+TEST_P(LuTest, factors) {
+  const Matrix<double> a = random_matrix<double>(GetParam(), GetParam(), 1);
+
+  Matrix<double> factors = a;
+  LuPivots pivots = lu(factors);
+
+  EXPECT_EQ(GetParam(), pivots.size());
+  for (size_t k = 0; k < pivots.size(); ++k) {
+    EXPECT_GE(pivots[k], k);
+    EXPECT_LT(pivots[k], GetParam());
+    // Partial pivoting keeps every multiplier at most 1 in magnitude
+    for (size_t i = k + 1; i < GetParam(); ++i) {
+      EXPECT_LE(std::abs(factors(i, k)), 1.0);
+    }
+  }
+  auto [permuted, product] = reconstruct(a, factors, pivots);
+  expect_near(permuted, product, 1e-12 * static_cast<double>(GetParam()));
+}
+
+TEST_P(LuTest, solve) {
+  const Matrix<double> a = random_matrix<double>(GetParam(), GetParam(), 2);
+  const Matrix<double> b = random_matrix<double>(GetParam(), 7, 3);
+
+  Matrix<double> x = solve(a, b);
+
+  expect_near(b, a * x, 1e-9 * static_cast<double>(GetParam()));
+}
+
+TEST_P(LuTest, inverse) {
+  const Matrix<double> a = random_matrix<double>(GetParam(), GetParam(), 4);
+
+  Matrix<double> inv = inverse(a);
+
+  expect_near(identity<double>(GetParam()), a * inv, 1e-9 * static_cast<double>(GetParam()));
+  expect_near(identity<double>(GetParam()), inv * a, 1e-9 * static_cast<double>(GetParam()));
+}
+
+TEST(LuSolveTest, needs_pivoting) {
+  const Matrix<double> a({
+      {0, 2, 1},
+      {1, 1, 1},
+      {2, 1, 0},
+  });
+  const Matrix<double> b({
+      {7},
+      {6},
+      {4},
+  });
+
+  Matrix<double> factors = a;
+  LuPivots pivots = lu(factors);
+  EXPECT_EQ(2, pivots[0]);
+  EXPECT_EQ(2, pivots[1]);
+  EXPECT_EQ(1, pivots.sign());
+
+  // x = (1, 2, 3)
+  expect_near(
+      Matrix<double>({
+          {1},
+          {2},
+          {3},
+      }),
+      lu_solve(factors, pivots, b),
+      1e-12
+  );
+}
+
+TEST(LuSolveTest, determinant) {
+  const Matrix<double> a({
+      {2, 1, 1},
+      {4, -6, 0},
+      {-2, 7, 2},
+  });
+
+  Matrix<double> factors = a;
+  LuPivots pivots = lu(factors);
+
+  double determinant = pivots.sign();
+  for (size_t i = 0; i < 3; ++i) {
+    determinant *= factors(i, i);
+  }
+  EXPECT_NEAR(-16, determinant, 1e-12);
+}
+
+TEST(LuSolveTest, single_precision) {
+  const Matrix<float> a = random_matrix<float>(100, 100, 5);
+  const Matrix<float> b = random_matrix<float>(100, 3, 6);
+
+  expect_near(b, a * solve(a, b), 1e-3);
+}
+
+TEST(LuSolveTest, singular) {
+  Matrix<double> zero(3, 3);
+  EXPECT_THROW(lu(zero), SingularMatrix);
+  EXPECT_THROW(inverse(Matrix<double>({{1, 2}, {2, 4}})), SingularMatrix);
+}
+
+TEST(LuSolveTest, shape_mismatch) {
+  Matrix<double> wide(3, 4);
+  EXPECT_THROW(lu(wide), std::invalid_argument);
+  EXPECT_THROW(inverse(Matrix<double>(4, 3)), std::invalid_argument);
+  EXPECT_THROW(solve(Matrix<double>(4, 3), Matrix<double>(4, 1)), std::invalid_argument);
+
+  Matrix<double> a = identity<double>(3);
+  EXPECT_THROW(solve(a, Matrix<double>(2, 1)), std::invalid_argument);
+  EXPECT_THROW(solve(a, Matrix<double>(4, 2)), std::invalid_argument);
+  LuPivots pivots = lu(a);
+  EXPECT_THROW(lu_solve(a, pivots, Matrix<double>(5, 1)), std::invalid_argument);
+  EXPECT_THROW(lu_solve(a, LuPivots(2), Matrix<double>(3, 1)), std::invalid_argument);
+}
+
+TEST(LuSolveTest, empty) {
+  Matrix<double> a;
+
+  LuPivots pivots = lu(a);
+
+  EXPECT_EQ(0, pivots.size());
+  EXPECT_TRUE(solve(a, Matrix<double>()).empty());
+  EXPECT_TRUE(inverse(a).empty());
+}
+
+} // namespace ct::test
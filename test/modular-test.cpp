@@ -0,0 +1,138 @@
+#include "matrix.h"
+#include "modular.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace ct::test {
+
+namespace {
+
+constexpr ModularReduction REDUCTIONS[] = {
+    ModularReduction::Lazy,
+    ModularReduction::Barrett,
+    ModularReduction::Montgomery,
+};
+
+// Moduli around the boundaries of the narrow and wide kernels
+constexpr uint64_t MODULI[] = {
+    2,
+    3,
+    998244353,                      // NTT prime
+    4294967291,                     // largest prime below 2^32
+    uint64_t{1} << 32,              // largest narrow modulus
+    4294967311,                     // smallest prime above 2^32
+    (uint64_t{1} << 61) - 1,        // Mersenne prime
+    9223372036854775783ULL,         // largest prime below 2^63
+    18446744073709551557ULL,        // largest prime below 2^64
+};
+
+Matrix<uint64_t> reference_multiply_mod(const Matrix<uint64_t>& a, const Matrix<uint64_t>& b, uint64_t p) {
+  Matrix<uint64_t> result(a.rows(), b.cols());
+  for (size_t i = 0; i < a.rows(); ++i) {
+    for (size_t j = 0; j < b.cols(); ++j) {
+      uint64_t sum = 0;
+      for (size_t k = 0; k < a.cols(); ++k) {
+        __extension__ typedef unsigned __int128 Wide;
+        uint64_t product = static_cast<uint64_t>(static_cast<Wide>(a(i, k) % p) * (b(k, j) % p) % p);
+        sum = static_cast<uint64_t>((static_cast<Wide>(sum) + product) % p);
+      }
+      result(i, j) = sum;
+    }
+  }
+  return result;
+}
+
+// Values spread over the whole `uint64_t` range, most of them larger than the modulus
+Matrix<uint64_t> make_matrix(size_t rows, size_t cols, uint64_t seed) {
+  Matrix<uint64_t> m(rows, cols);
+  uint64_t state = seed;
+  for (uint64_t& x : m) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    x = state ^ (state >> 29);
+  }
+  return m;
+}
+
+// Largest residues, maximizing the accumulated sums
+Matrix<uint64_t> filled(size_t rows, size_t cols, uint64_t value) {
+  Matrix<uint64_t> m(rows, cols);
+  for (uint64_t& x : m) {
+    x = value;
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(ModularTest, random_operands) {
+  Matrix<uint64_t> a = make_matrix(13, 300, 1);
+  Matrix<uint64_t> b = make_matrix(300, 21, 2);
+
+  for (uint64_t p : MODULI) {
+    Matrix<uint64_t> expected = reference_multiply_mod(a, b, p);
+    for (ModularReduction reduction : REDUCTIONS) {
+      EXPECT_EQ(expected, multiply_mod(a, b, p, reduction)) << "p = " << p;
+    }
+  }
+}
+
+TEST(ModularTest, largest_residues) {
+  for (uint64_t p : MODULI) {
+    Matrix<uint64_t> a = filled(9, 517, p - 1);
+    Matrix<uint64_t> b = filled(517, 5, p - 1);
+    Matrix<uint64_t> expected = reference_multiply_mod(a, b, p);
+    for (ModularReduction reduction : REDUCTIONS) {
+      EXPECT_EQ(expected, multiply_mod(a, b, p, reduction)) << "p = " << p;
+    }
+  }
+}
+
+TEST(ModularTest, wide_panels) {
+  // More columns than one column tile, and a depth that is not a multiple of the depth tile
+  Matrix<uint64_t> a = make_matrix(20, 131, 3);
+  Matrix<uint64_t> b = make_matrix(131, 700, 4);
+
+  for (uint64_t p : {uint64_t{998244353}, uint64_t{(uint64_t{1} << 61) - 1}}) {
+    Matrix<uint64_t> expected = reference_multiply_mod(a, b, p);
+    for (ModularReduction reduction : REDUCTIONS) {
+      EXPECT_EQ(expected, multiply_mod(a, b, p, reduction)) << "p = " << p;
+    }
+  }
+}
+
+TEST(ModularTest, degenerate_shapes) {
+  for (ModularReduction reduction : REDUCTIONS) {
+    EXPECT_TRUE(multiply_mod(Matrix<uint64_t>(3, 0), Matrix<uint64_t>(0, 4), 7, reduction).empty());
+    EXPECT_TRUE(multiply_mod(Matrix<uint64_t>(0, 5), Matrix<uint64_t>(5, 2), 7, reduction).empty());
+    EXPECT_EQ(Matrix<uint64_t>({{4}}), multiply_mod(Matrix<uint64_t>({{20}}), Matrix<uint64_t>({{10}}), 7, reduction));
+  }
+}
+
+TEST(ModularTest, invalid_modulus) {
+  Matrix<uint64_t> a = make_matrix(2, 2, 1);
+  for (ModularReduction reduction : REDUCTIONS) {
+    EXPECT_THROW(multiply_mod(a, a, 0, reduction), std::invalid_argument);
+    EXPECT_THROW(multiply_mod(a, a, 1, reduction), std::invalid_argument);
+  }
+}
+
+TEST(ModularTest, montgomery_falls_back_for_even_moduli) {
+  Matrix<uint64_t> a = make_matrix(6, 40, 5);
+  Matrix<uint64_t> b = make_matrix(40, 6, 6);
+
+  for (uint64_t p : {uint64_t{1} << 40, uint64_t{1000000}, uint64_t{1} << 63}) {
+    EXPECT_EQ(reference_multiply_mod(a, b, p), multiply_mod(a, b, p, ModularReduction::Montgomery));
+  }
+}
+
+TEST(ModularTest, montgomery_inverse) {
+  for (uint64_t p : {uint64_t{3}, uint64_t{998244353}, uint64_t{9223372036854775783ULL}}) {
+    EXPECT_EQ(0 - uint64_t{1}, p * detail::MontgomeryReducer::negated_inverse(p));
+  }
+}
+
+} // namespace ct::test
@@ -0,0 +1,342 @@
+#include "matrix.h"
+#include "multiply.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace ct::test {
+
+class MultiplyTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Element::reset_allocations();
+  }
+};
+
+namespace {
+
+template <typename Acc, typename T>
+Matrix<Acc> reference_multiply(const Matrix<T>& left, const Matrix<T>& right) {
+  Matrix<Acc> result(left.rows(), right.cols());
+  for (size_t i = 0; i < left.rows(); ++i) {
+    for (size_t j = 0; j < right.cols(); ++j) {
+      for (size_t k = 0; k < left.cols(); ++k) {
+        result(i, j) += static_cast<Acc>(left(i, k)) * static_cast<Acc>(right(k, j));
+      }
+    }
+  }
+  return result;
+}
+
+template <typename T>
+Matrix<T> make_matrix(size_t rows, size_t cols, T first, T step) {
+  Matrix<T> m(rows, cols);
+  T value = first;
+  for (T& x : m) {
+    x = value;
+    value = static_cast<T>(value + step);
+  }
+  return m;
+}
+
+} // namespace
+
+TEST_F(MultiplyTest, same_type) {
+  const Matrix<Element> a({
+      {1, 2, 3},
+      {4, 5, 6},
+      {7, 8, 9},
+  });
+  const Matrix<Element> b({
+      {10, 40},
+      {20, 50},
+      {30, 60},
+  });
+
+  expect_equal(a * b, multiply<Element>(a, b));
+}
+
+TEST_F(MultiplyTest, int8_to_int32) {
+  const Matrix<int8_t> a = make_matrix<int8_t>(33, 70, 127, -3);
+  const Matrix<int8_t> b = make_matrix<int8_t>(70, 45, -128, 5);
+
+  Matrix<int32_t> product = multiply<int32_t>(a, b);
+
+  expect_equal(reference_multiply<int32_t>(a, b), product);
+}
+
+TEST_F(MultiplyTest, int8_does_not_overflow) {
+  constexpr size_t SIZE = 100;
+  Matrix<int8_t> a(SIZE, SIZE);
+  for (int8_t& x : a) {
+    x = std::numeric_limits<int8_t>::min();
+  }
+
+  Matrix<int32_t> product = multiply<int32_t>(a, a);
+
+  for (int32_t x : product) {
+    EXPECT_EQ(128 * 128 * static_cast<int32_t>(SIZE), x);
+  }
+}
+
+TEST_F(MultiplyTest, int16_to_int64) {
+  const Matrix<int16_t> a = make_matrix<int16_t>(17, 130, 32000, -511);
+  const Matrix<int16_t> b = make_matrix<int16_t>(130, 9, -32000, 1021);
+
+  expect_equal(reference_multiply<int64_t>(a, b), multiply<int64_t>(a, b));
+}
+
+TEST_F(MultiplyTest, float_to_double) {
+  constexpr size_t SIZE = 64;
+  Matrix<float> a(SIZE, SIZE);
+  Matrix<float> b(SIZE, SIZE);
+  for (size_t i = 0; i < SIZE; ++i) {
+    a(i, 0) = 1e8F;
+    a(i, 1) = 1;
+    a(i, 2) = -1e8F;
+    b(0, i) = 1;
+    b(1, i) = 1;
+    b(2, i) = 1;
+  }
+
+  Matrix<double> product = multiply<double>(a, b);
+
+  for (double x : product) {
+    EXPECT_EQ(1.0, x);
+  }
+}
+
+TEST_F(MultiplyTest, large_parallel) {
+  const Matrix<int16_t> a = make_matrix<int16_t>(150, 301, 1, 7);
+  const Matrix<int16_t> b = make_matrix<int16_t>(301, 170, 3, 11);
+
+  expect_equal(reference_multiply<int64_t>(a, b), multiply<int64_t>(a, b));
+}
+
+TEST_F(MultiplyTest, empty) {
+  Matrix<int8_t> a;
+  Matrix<int32_t> product = multiply<int32_t>(a, a);
+
+  expect_empty(product);
+}
+
+TEST_F(MultiplyTest, multiply_into_reuses_buffer) {
+  const Matrix<Element> a = make_matrix<Element>(20, 30, 1, 3);
+  const Matrix<Element> b = make_matrix<Element>(30, 10, 2, 5);
+  Matrix<Element> out(20, 10);
+  const Element* buffer = std::as_const(out).data();
+  Element::reset_allocations();
+
+  multiply_into(a, b, out);
+
+  expect_allocations(0);
+  EXPECT_EQ(buffer, std::as_const(out).data());
+  expect_equal(a * b, out);
+}
+
+TEST_F(MultiplyTest, multiply_into_reshapes) {
+  const Matrix<Element> a = make_matrix<Element>(7, 3, 1, 1);
+  const Matrix<Element> b = make_matrix<Element>(3, 5, 4, 2);
+  Matrix<Element> out;
+
+  multiply_into(a, b, out);
+  expect_equal(a * b, out);
+
+  Matrix<Element> c = make_matrix<Element>(3, 3, 1, 1);
+  multiply_into(c, c, c);
+  expect_equal(reference_multiply<Element>(make_matrix<Element>(3, 3, 1, 1), make_matrix<Element>(3, 3, 1, 1)), c);
+}
+
+TEST_F(MultiplyTest, pow) {
+  const Matrix<Element> a({
+      {1, 1},
+      {1, 0},
+  });
+
+  expect_equal(identity<Element>(2), pow(a, 0));
+  expect_equal(a, pow(a, 1));
+  // Fibonacci numbers
+  expect_equal(
+      Matrix<Element>({
+          {89, 55},
+          {55, 34},
+      }),
+      pow(a, 10)
+  );
+}
+
+TEST_F(MultiplyTest, pow_matches_repeated_multiply) {
+  const Matrix<uint64_t> a = make_matrix<uint64_t>(37, 37, 5, 3);
+
+  Matrix<uint64_t> expected = a;
+  for (size_t k = 2; k <= 13; ++k) {
+    expected *= a;
+    expect_equal(expected, pow(a, k));
+  }
+}
+
+TEST_F(MultiplyTest, pow_allocations) {
+  const Matrix<Element> a = make_matrix<Element>(8, 8, 1, 1);
+  Element::reset_allocations();
+
+  Matrix<Element> result = pow(a, 1000);
+
+  // `base`, `result` and one scratch buffer
+  expect_allocations(3 * a.size());
+}
+
+TEST_F(MultiplyTest, chain_matches_left_to_right) {
+  const Matrix<Element> a = make_matrix<Element>(10, 30, 1, 1);
+  const Matrix<Element> b = make_matrix<Element>(30, 5, 2, 3);
+  const Matrix<Element> c = make_matrix<Element>(5, 60, 1, 2);
+  const Matrix<Element> d = make_matrix<Element>(60, 4, 3, 1);
+
+  expect_equal(a, multiply_chain(a));
+  expect_equal(a * b, multiply_chain(a, b));
+  expect_equal(a * b * c, multiply_chain(a, b, c));
+  expect_equal(a * b * c * d, multiply_chain(a, b, c, d));
+}
+
+TEST_F(MultiplyTest, chain_order) {
+  Matrix<int> a(10, 100);
+  Matrix<int> b(100, 5);
+  Matrix<int> c(5, 50);
+  const Matrix<int>* operands[] = {&a, &b, &c};
+
+  detail::ChainEvaluator<int> chain(operands, 3);
+
+  // `(a * b) * c`: 10 * 100 * 5 + 10 * 5 * 50 multiply-adds, against 75000 for `a * (b * c)`
+  EXPECT_EQ(7500, chain.cost());
+  EXPECT_EQ(1, chain.split(0, 2));
+}
+
+TEST_F(MultiplyTest, chain_reuses_workspaces) {
+  constexpr size_t LENGTH = 8;
+  Matrix<Element> m[LENGTH];
+  for (size_t i = 0; i < LENGTH; ++i) {
+    m[i] = make_matrix<Element>(16, 16, 1, 1);
+  }
+  Element::reset_allocations();
+
+  Matrix<Element> result = multiply_chain(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7]);
+
+  // The result and at most one scratch buffer per intermediate that is alive at the same time
+  expect_allocations((LENGTH - 1) * m[0].size());
+  expect_equal(pow(m[0], LENGTH), result);
+}
+
+TEST_F(MultiplyTest, workspace) {
+  detail::Workspace<Element> workspace(3);
+
+  Element* small = workspace.acquire(10);
+  Element* large = workspace.acquire(20);
+  EXPECT_NE(small, large);
+  workspace.release(small);
+  workspace.release(large);
+  expect_allocations(10 + 20);
+
+  EXPECT_EQ(large, workspace.acquire(15));
+  EXPECT_EQ(small, workspace.acquire(5));
+  workspace.release(small);
+  workspace.acquire(30);
+  expect_allocations(10 + 20 + 30);
+}
+
+TEST_F(MultiplyTest, chain_with_empty) {
+  Matrix<Element> a(3, 0);
+  Matrix<Element> b;
+
+  expect_empty(multiply_chain(a, b, b));
+  expect_empty(pow(a, 5));
+}
+
+TEST_F(MultiplyTest, update_product) {
+  Matrix<int64_t> a = make_matrix<int64_t>(150, 70, 1, 3);
+  Matrix<int64_t> b = make_matrix<int64_t>(70, 90, -40, 1);
+  Matrix<int64_t> c = a * b;
+  a.track_dirty_rows();
+  b.track_dirty_rows();
+  c.track_dirty_rows();
+
+  // A run of consecutive rows, isolated rows and the last row
+  for (size_t i : {3, 10, 11, 12, 13, 80, 149}) {
+    a.row(i) *= 2;
+  }
+  a(0, 69) = 7;
+  update_product(c, a, b);
+
+  expect_equal(a * b, c);
+  EXPECT_EQ(0, a.dirty_row_count());
+  EXPECT_EQ(8, c.dirty_row_count());
+  EXPECT_TRUE(c.row_dirty(12));
+  EXPECT_FALSE(c.row_dirty(14));
+
+  // Nothing changed
+  update_product(c, a, b);
+  expect_equal(a * b, c);
+
+  // A change of `b` forces a full product
+  b(5, 5) = 1000;
+  update_product(c, a, b);
+  expect_equal(a * b, c);
+  EXPECT_EQ(0, b.dirty_row_count());
+}
+
+TEST_F(MultiplyTest, update_product_fallbacks) {
+  Matrix<Element> a = make_matrix<Element>(30, 20, 1, 1);
+  Matrix<Element> b = make_matrix<Element>(20, 10, 2, 1);
+
+  // Untracked `a`, and a `c` of the wrong shape
+  Matrix<Element> c;
+  update_product(c, a, b);
+  expect_equal(a * b, c);
+
+  a.track_dirty_rows();
+  b.track_dirty_rows();
+  a(1, 1) = 0;
+  update_product(c, a, b);
+  expect_equal(a * b, c);
+
+  Matrix<Element> empty;
+  empty.track_dirty_rows();
+  Matrix<Element> out;
+  update_product(out, empty, empty);
+  expect_empty(out);
+}
+
+TEST_F(MultiplyTest, rank_update) {
+  const Matrix<int64_t> a = make_matrix<int64_t>(60, 50, 1, 2);
+  Matrix<int64_t> b = make_matrix<int64_t>(50, 40, -7, 3);
+  Matrix<int64_t> c = a * b;
+
+  // Rows 10..13 of `b` change: update `c` with the matching 4 columns of `a` times the row differences
+  Matrix<int64_t> u(60, 4);
+  Matrix<int64_t> v(4, 40);
+  for (size_t k = 0; k < 4; ++k) {
+    for (size_t i = 0; i < 60; ++i) {
+      u(i, k) = std::as_const(a)(i, 10 + k);
+    }
+    for (size_t j = 0; j < 40; ++j) {
+      int64_t delta = static_cast<int64_t>(k + j) - 5;
+      v(k, j) = delta;
+      b(10 + k, j) += delta;
+    }
+  }
+  rank_update(c, u, v);
+
+  expect_equal(a * b, c);
+
+  Matrix<int64_t> square = make_matrix<int64_t>(5, 5, 1, 1);
+  Matrix<int64_t> expected = square + square * square;
+  rank_update(square, square, square);
+  expect_equal(expected, square);
+
+  rank_update(c, Matrix<int64_t>(), Matrix<int64_t>());
+  expect_equal(a * b, c);
+}
+
+} // namespace ct::test
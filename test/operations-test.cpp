@@ -3,7 +3,9 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdint>
 #include <numeric>
+#include <utility>
 
 namespace ct::test {
 
@@ -333,4 +335,39 @@ TEST_F(OperationsTest, mul_scalar_return_value) {
   expect_allocations(a.size() + b.size());
 }
 
+TEST_F(OperationsTest, elementwise_streaming) {
+  // Four times larger than the LLC of most machines, so the results are written with streaming stores
+  constexpr size_t ROWS = 4096;
+  constexpr size_t COLS = 4099;
+
+  Matrix<double> a(ROWS, COLS);
+  std::iota(a.begin(), a.end(), 0.0);
+  Matrix<double> b = a * 3.0;
+
+  Matrix<double> sum = a + b;
+  Matrix<double> difference = b - a;
+  Matrix<double> scaled = 2.0 * a;
+  for (size_t i = 0; i < ROWS; i += 97) {
+    for (size_t j = 0; j < COLS; ++j) {
+      double x = std::as_const(a)(i, j);
+      EXPECT_EQ(3 * x, std::as_const(b)(i, j));
+      EXPECT_EQ(4 * x, std::as_const(sum)(i, j));
+      EXPECT_EQ(2 * x, std::as_const(difference)(i, j));
+      EXPECT_EQ(2 * x, std::as_const(scaled)(i, j));
+    }
+  }
+  EXPECT_EQ(difference, scaled);
+}
+
+TEST_F(OperationsTest, stream_generate) {
+  for (size_t count : {0, 1, 511, 512, 513, 5000}) {
+    Matrix<int64_t> out(1, count + 1);
+    detail::stream_generate(out.data() + 1, count, [](size_t i) { return static_cast<int64_t>(i * i); });
+    EXPECT_EQ(0, std::as_const(out)(0, 0));
+    for (size_t i = 0; i < count; ++i) {
+      EXPECT_EQ(static_cast<int64_t>(i * i), std::as_const(out)(0, i + 1));
+    }
+  }
+}
+
 } // namespace ct::test
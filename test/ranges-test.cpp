@@ -0,0 +1,205 @@
+#include "layout.h"
+#include "matrix.h"
+#include "ranges.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <ranges>
+#include <type_traits>
+
+namespace ct::test {
+
+namespace {
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<double>(elem(i, j) % 17) / 4.0;
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(RangesTest, range_categories) {
+  using Rows = decltype(views::rows(std::declval<Matrix<Element>&>()));
+  using ConstRows = decltype(views::rows(std::declval<const Matrix<Element>&>()));
+  using Cols = decltype(views::cols(std::declval<Matrix<Element>&>()));
+
+  EXPECT_TRUE(std::ranges::random_access_range<Rows>);
+  EXPECT_TRUE(std::ranges::sized_range<Rows>);
+  EXPECT_TRUE(std::ranges::view<Rows>);
+  EXPECT_TRUE(std::ranges::random_access_range<Cols>);
+  EXPECT_TRUE((std::is_same_v<Matrix<Element>::RowView, std::ranges::range_value_t<Rows>>));
+  EXPECT_TRUE((std::is_same_v<Matrix<Element>::ConstRowView, std::ranges::range_value_t<ConstRows>>));
+  EXPECT_TRUE((std::is_same_v<Matrix<Element>::ColView, std::ranges::range_value_t<Cols>>));
+}
+
+TEST(RangesTest, rows_and_cols) {
+  Matrix<Element> m(4, 3);
+  fill(m);
+  const Matrix<Element>& cm = m;
+
+  size_t i = 0;
+  for (auto row : views::rows(cm)) {
+    EXPECT_TRUE(std::ranges::equal(cm.row(i), row));
+    ++i;
+  }
+  EXPECT_EQ(4, i);
+  EXPECT_EQ(3, std::ranges::size(views::cols(m)));
+  EXPECT_TRUE(std::ranges::equal(cm.col(2), views::cols(cm)[2]));
+  EXPECT_TRUE(std::ranges::equal(cm.row(3), *(views::rows(cm).end() - 1)));
+
+  // Per-column scale
+  size_t factor = 1;
+  for (auto col : views::cols(m)) {
+    col *= factor++;
+  }
+  for (size_t r = 0; r < 4; ++r) {
+    for (size_t c = 0; c < 3; ++c) {
+      EXPECT_EQ(elem(r, c) * (c + 1), m(r, c).value);
+    }
+  }
+
+  // Composes with standard adaptors
+  auto sums = views::rows(cm) | std::views::transform([](auto row) {
+                return std::accumulate(row.begin(), row.end(), Element(0)).value;
+              });
+  EXPECT_EQ(elem(1, 0) + 2 * elem(1, 1) + 3 * elem(1, 2), sums[1]);
+}
+
+TEST(RangesTest, rows_of_col_major) {
+  Matrix<int, ColMajor> m({{1, 2, 3}, {4, 5, 6}});
+
+  for (auto row : views::rows(m)) {
+    row *= 10;
+  }
+  int expected[] = {10, 20, 30, 40, 50, 60};
+  EXPECT_TRUE(std::ranges::equal(expected, views::rows(m) | std::views::join));
+}
+
+TEST(RangesTest, apply_rows_softmax) {
+  Matrix<double> m = make_matrix(37, 300);
+  Matrix<double> original = m;
+
+  m.apply_rows([](Matrix<double>::RowView row) {
+    double max = *std::max_element(row.begin(), row.end());
+    double sum = 0;
+    for (double& x : row) {
+      x = std::exp(x - max);
+      sum += x;
+    }
+    row *= 1 / sum;
+  });
+
+  for (size_t i = 0; i < m.rows(); ++i) {
+    double sum = 0;
+    for (size_t j = 0; j < m.cols(); ++j) {
+      sum += std::exp(original(i, j));
+    }
+    for (size_t j = 0; j < m.cols(); ++j) {
+      EXPECT_NEAR(std::exp(original(i, j)) / sum, m(i, j), 1e-12);
+    }
+  }
+}
+
+TEST(RangesTest, apply_rows_with_index) {
+  Matrix<size_t> m(1000, 8);
+  m.track_dirty_rows();
+  m.apply_rows([](Matrix<size_t>::RowView row, size_t i) { std::ranges::fill(row, i); });
+  EXPECT_EQ(1000, m.dirty_row_count());
+
+  const Matrix<size_t>& cm = m;
+  size_t* sums = new size_t[1000];
+  cm.apply_rows([sums](Matrix<size_t>::ConstRowView row, size_t i) {
+    sums[i] = std::accumulate(row.begin(), row.end(), size_t{0});
+  });
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(8 * i, sums[i]);
+  }
+  delete[] sums;
+}
+
+TEST(RangesTest, transform_assigns_in_one_pass) {
+  Matrix<Element> a(50, 40);
+  Matrix<Element> b(50, 40);
+  fill(a);
+  fill(b);
+  Matrix<Element> out(50, 40);
+
+  Element::reset_allocations();
+  auto twice = views::transform(b, [](const Element& x) { return x * Element(2); });
+  out = views::zip_transform(std::plus<>{}, a, twice);
+  expect_allocations(0);
+
+  for (size_t i = 0; i < 50; ++i) {
+    for (size_t j = 0; j < 40; ++j) {
+      EXPECT_EQ(3 * elem(i, j), out(i, j).value);
+      EXPECT_EQ(2 * elem(i, j), twice(i, j).value);
+    }
+  }
+
+  Element::reset_allocations();
+  Matrix<Element> built(views::zip_transform(std::multiplies<>{}, a, twice));
+  expect_allocations(a.size());
+  EXPECT_EQ(2 * elem(3, 4) * elem(3, 4), built(3, 4).value);
+}
+
+TEST(RangesTest, transform_in_place_and_reshape) {
+  Matrix<double> m = make_matrix(30, 20);
+  Matrix<double> copy = m;
+  copy.enable_sharing();
+  Matrix<double> shared = copy;
+
+  shared = views::transform(shared, [](double x) { return x * x; });
+  for (size_t i = 0; i < 30; ++i) {
+    for (size_t j = 0; j < 20; ++j) {
+      EXPECT_EQ(m(i, j) * m(i, j), shared(i, j));
+    }
+  }
+  EXPECT_EQ(m, copy);
+
+  Matrix<double> small(2, 2);
+  small = views::transform(m, [](double x) { return -x; });
+  EXPECT_EQ(30, small.rows());
+  EXPECT_EQ(20, small.cols());
+  EXPECT_EQ(-m(29, 19), small(29, 19));
+
+  Matrix<double> empty;
+  empty = views::transform(Matrix<double>(), [](double x) { return x; });
+  expect_empty(empty);
+}
+
+TEST(RangesTest, transform_owns_temporaries) {
+  Matrix<double> a = make_matrix(10, 10);
+  auto view = views::transform(a + a, [](double x) { return x + 1; });
+  Matrix<double> result(view);
+  EXPECT_EQ(2 * a(7, 3) + 1, result(7, 3));
+}
+
+TEST(RangesTest, transform_col_major) {
+  Matrix<int, ColMajor> a({{1, 2, 3}, {4, 5, 6}});
+  Matrix<int, ColMajor> b({{6, 5, 4}, {3, 2, 1}});
+
+  Matrix<int, ColMajor> c(views::zip_transform([](int x, int y) { return x * 10 + y; }, a, b));
+  expect_equal(Matrix<int, ColMajor>({{16, 25, 34}, {43, 52, 61}}), c);
+}
+
+TEST(RangesTest, transform_large) {
+  Matrix<double> a = make_matrix(2048, 2048);
+  Matrix<double> b = make_matrix(2048, 2048);
+
+  Matrix<double> c(views::zip_transform([](double x, double y) { return 2 * x - y; }, a, b));
+  EXPECT_EQ(a, c);
+}
+
+} // namespace ct::test
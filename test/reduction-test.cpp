@@ -0,0 +1,233 @@
+#include "async.h"
+#include "layout.h"
+#include "matrix.h"
+#include "multiply.h"
+#include "reduction.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace ct::test {
+
+namespace {
+
+// Values of very different magnitudes, so that the order of the additions shows in the last bits
+double value(size_t i, size_t j) {
+  double mantissa = static_cast<double>((i * 7919 + j * 104729) % 2003) - 1001.5;
+  return std::ldexp(mantissa, static_cast<int>((i + 3 * j) % 41) - 20);
+}
+
+template <typename Layout = RowMajor>
+Matrix<double, Layout> make_matrix(size_t rows, size_t cols, size_t seed = 0) {
+  Matrix<double, Layout> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = value(i + seed, j);
+    }
+  }
+  return m;
+}
+
+// Enough partial sums for the shapes below
+constexpr size_t MAX_PARTIALS = 128;
+
+// The pairwise order of `reduction.h`, spelled out independently
+double pairwise(double* values, size_t count) {
+  for (size_t stride = 1; stride < count; stride *= 2) {
+    for (size_t c = 0; c + stride < count; c += 2 * stride) {
+      values[c] += values[c + stride];
+    }
+  }
+  return count == 0 ? 0.0 : values[0];
+}
+
+// Element `(i, j)` of `a * b` in reproducible mode: slices of `REPRODUCIBLE_DEPTH_CHUNK`, each accumulated four
+// products at a time as the product kernel does, added pairwise
+double reproducible_element(const Matrix<double>& a, const Matrix<double>& b, size_t i, size_t j) {
+  double slices[MAX_PARTIALS];
+  size_t count = 0;
+  for (size_t first = 0; first < a.cols(); first += REPRODUCIBLE_DEPTH_CHUNK) {
+    size_t last = std::min(a.cols(), first + REPRODUCIBLE_DEPTH_CHUNK);
+    double slice = 0;
+    size_t k = first;
+    for (; k + 4 <= last; k += 4) {
+      slice += a(i, k) * b(k, j) + a(i, k + 1) * b(k + 1, j) + a(i, k + 2) * b(k + 2, j) + a(i, k + 3) * b(k + 3, j);
+    }
+    for (; k < last; ++k) {
+      slice += a(i, k) * b(k, j);
+    }
+    slices[count++] = slice;
+  }
+  return 0.0 + pairwise(slices, count);
+}
+
+// `sum` in reproducible mode: runs of `REPRODUCIBLE_SUM_CHUNK` elements in four lanes, added pairwise
+double reproducible_sum(const double* data, size_t count) {
+  double runs[MAX_PARTIALS];
+  size_t runs_count = 0;
+  for (size_t first = 0; first < count; first += REPRODUCIBLE_SUM_CHUNK) {
+    size_t last = std::min(count, first + REPRODUCIBLE_SUM_CHUNK);
+    double lanes[4] = {};
+    for (size_t i = first; i < last; ++i) {
+      lanes[(i - first) % 4] += data[i];
+    }
+    runs[runs_count++] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+  return pairwise(runs, runs_count);
+}
+
+void expect_reproducible_product(const Matrix<double>& a, const Matrix<double>& b, const Matrix<double>& c) {
+  ASSERT_EQ(a.rows(), c.rows());
+  ASSERT_EQ(b.cols(), c.cols());
+  for (size_t i = 0; i < c.rows(); ++i) {
+    for (size_t j = 0; j < c.cols(); ++j) {
+      ASSERT_EQ(reproducible_element(a, b, i, j), c(i, j)) << i << ", " << j;
+    }
+  }
+}
+
+} // namespace
+
+class ReductionTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mode_ = reduction_mode();
+  }
+
+  void TearDown() override {
+    set_reduction_mode(mode_);
+  }
+
+private:
+  ReductionMode mode_ = ReductionMode::Fast;
+};
+
+// The order checked against the reference is the same whatever `CT_NUM_THREADS`, so runs with different thread
+// counts give the same bits
+TEST_F(ReductionTest, reproducible_product) {
+  set_reduction_mode(ReductionMode::Reproducible);
+  struct Shape {
+    size_t rows;
+    size_t depth;
+    size_t cols;
+  };
+  // One slice; few rows and many slices (grouped among the workers); many rows and a partial last slice
+  for (Shape shape : {Shape{5, 1000, 9}, Shape{2, 9 * REPRODUCIBLE_DEPTH_CHUNK + 3, 7}, Shape{70, 3000, 33}}) {
+    Matrix<double> a = make_matrix(shape.rows, shape.depth);
+    Matrix<double> b = make_matrix(shape.depth, shape.cols, 1);
+    expect_reproducible_product(a, b, a * b);
+
+    Matrix<double> c;
+    multiply_into(a, b, c);
+    expect_reproducible_product(a, b, c);
+  }
+}
+
+TEST_F(ReductionTest, reproducible_empty_product) {
+  set_reduction_mode(ReductionMode::Reproducible);
+  Matrix<double> a = make_matrix(3, 2500);
+  Matrix<double> b(2500, 0);
+  EXPECT_TRUE((a * b).empty());
+  EXPECT_TRUE(async_multiply(a, b).get().empty());
+  EXPECT_TRUE((make_matrix<ColMajor>(0, 2500) * make_matrix<ColMajor>(2500, 4)).empty());
+}
+
+TEST_F(ReductionTest, reproducible_product_layouts) {
+  set_reduction_mode(ReductionMode::Reproducible);
+  Matrix<double> a = make_matrix(6, 2500);
+  Matrix<double> b = make_matrix(2500, 11, 1);
+  Matrix<double> c = a * b;
+
+  Matrix<double, ColMajor> col_c = make_matrix<ColMajor>(6, 2500) * make_matrix<ColMajor>(2500, 11, 1);
+  for (size_t i = 0; i < c.rows(); ++i) {
+    for (size_t j = 0; j < c.cols(); ++j) {
+      EXPECT_EQ(c(i, j), col_c(i, j));
+    }
+  }
+}
+
+TEST_F(ReductionTest, reproducible_update_product) {
+  set_reduction_mode(ReductionMode::Reproducible);
+  Matrix<double> a = make_matrix(40, 2100);
+  Matrix<double> b = make_matrix(2100, 13, 1);
+  Matrix<double> c = a * b;
+  a.track_dirty_rows();
+  b.track_dirty_rows();
+  c.track_dirty_rows();
+  c.clear_dirty_rows();
+  for (size_t j = 0; j < a.cols(); ++j) {
+    a(7, j) = value(j, 7);
+    a(8, j) = -value(j, 8);
+  }
+  update_product(c, a, b);
+  // Only the two changed rows were recomputed, by the incremental kernel
+  EXPECT_EQ(2, c.dirty_row_count());
+  expect_reproducible_product(a, b, c);
+}
+
+TEST_F(ReductionTest, reproducible_async_product) {
+  set_reduction_mode(ReductionMode::Reproducible);
+  Matrix<double> a = make_matrix(30, 3 * REPRODUCIBLE_DEPTH_CHUNK + 5);
+  Matrix<double> b = make_matrix(3 * REPRODUCIBLE_DEPTH_CHUNK + 5, 9, 1);
+  expect_reproducible_product(a, b, async_multiply(a, b).get());
+}
+
+// The same bits as the synchronous product in fast mode too, also when a short product splits its inner dimension
+TEST_F(ReductionTest, fast_async_product) {
+  set_reduction_mode(ReductionMode::Fast);
+  for (size_t rows : {size_t{1}, size_t{2}, size_t{70}}) {
+    Matrix<double> a = make_matrix(rows, 20000);
+    Matrix<double> b = make_matrix(20000, 5, 1);
+    EXPECT_EQ(a * b, async_multiply(a, b).get());
+  }
+}
+
+TEST_F(ReductionTest, reproducible_sum) {
+  set_reduction_mode(ReductionMode::Reproducible);
+  size_t chunk = REPRODUCIBLE_SUM_CHUNK;
+  for (size_t cols : {size_t{1}, chunk - 1, chunk + 1, 3 * chunk + 5}) {
+    Matrix<double> m = make_matrix(1, cols);
+    EXPECT_EQ(reproducible_sum(std::as_const(m).data(), m.size()), sum(m));
+  }
+  Matrix<double> m = make_matrix(300, 1000);
+  EXPECT_EQ(reproducible_sum(std::as_const(m).data(), m.size()), sum(m));
+  EXPECT_EQ(0.0, sum(Matrix<double>()));
+}
+
+// Fast mode splits differently, but adds the same terms
+TEST_F(ReductionTest, fast_mode) {
+  set_reduction_mode(ReductionMode::Fast);
+  Matrix<int64_t> a(2, 20000);
+  Matrix<int64_t> b(20000, 5);
+  for (size_t k = 0; k < 20000; ++k) {
+    a(0, k) = static_cast<int64_t>(k % 13) - 6;
+    a(1, k) = static_cast<int64_t>(k % 7);
+    for (size_t j = 0; j < 5; ++j) {
+      b(k, j) = static_cast<int64_t>((k + j) % 11) - 5;
+    }
+  }
+  Matrix<int64_t> c = a * b;
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      int64_t expected = 0;
+      for (size_t k = 0; k < 20000; ++k) {
+        expected += a(i, k) * b(k, j);
+      }
+      EXPECT_EQ(expected, c(i, j));
+    }
+  }
+
+  Matrix<double> m = make_matrix(300, 1000);
+  double scale = 0;
+  for (double x : std::as_const(m)) {
+    scale += std::abs(x);
+  }
+  EXPECT_NEAR(reproducible_sum(std::as_const(m).data(), m.size()), sum(m), scale * 1e-12);
+}
+
+} // namespace ct::test
@@ -0,0 +1,296 @@
+#include "compression.h"
+#include "matrix.h"
+#include "serialize.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <unistd.h>
+
+namespace ct::test {
+
+namespace {
+
+// Smooth values that compress well, with an occasional irregular one
+Matrix<int32_t> repetitive(size_t rows, size_t cols) {
+  Matrix<int32_t> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<int32_t>((j % 16) + (i * j % 101 == 0 ? i : 0));
+    }
+  }
+  return m;
+}
+
+Matrix<double> noise(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  uint64_t state = 88172645463325252ULL;
+  for (double& x : m) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    x = static_cast<double>(state % 1000003) / 7.0;
+  }
+  return m;
+}
+
+template <typename T>
+Matrix<T> round_trip(const Matrix<T>& m, Compression compression) {
+  std::stringstream stream;
+  serialize(stream, m, compression);
+  return deserialize<T>(stream);
+}
+
+std::string serialized(const Matrix<int32_t>& m, Compression compression) {
+  std::stringstream stream;
+  serialize(stream, m, compression);
+  return stream.str();
+}
+
+Matrix<int32_t> parse(const std::string& bytes) {
+  std::stringstream stream(bytes);
+  return deserialize<int32_t>(stream);
+}
+
+} // namespace
+
+TEST(SerializeTest, lz_round_trip) {
+  for (size_t size : {0, 1, 11, 12, 13, 100, 4096, 70000, 300000}) {
+    uint8_t* input = new uint8_t[size + 1];
+    for (size_t i = 0; i < size; ++i) {
+      input[i] = static_cast<uint8_t>(i % 7 == 0 ? i * 2654435761U >> 13 : i % 5);
+    }
+    uint8_t* compressed = new uint8_t[detail::lz_compress_bound(size)];
+    uint8_t* output = new uint8_t[size + 1];
+
+    size_t packed = detail::lz_compress(input, size, compressed);
+    EXPECT_LE(packed, detail::lz_compress_bound(size));
+    EXPECT_TRUE(detail::lz_decompress(compressed, packed, output, size)) << size;
+    EXPECT_EQ(0, std::memcmp(input, output, size)) << size;
+    if (size > 0) {
+      EXPECT_FALSE(detail::lz_decompress(compressed, packed, output, size - 1));
+      EXPECT_FALSE(detail::lz_decompress(compressed, packed - 1, output, size));
+    }
+
+    delete[] output;
+    delete[] compressed;
+    delete[] input;
+  }
+}
+
+TEST(SerializeTest, lz_long_runs) {
+  constexpr size_t SIZE = 100000;
+  uint8_t* input = new uint8_t[SIZE]();
+  uint8_t* compressed = new uint8_t[detail::lz_compress_bound(SIZE)];
+  uint8_t* output = new uint8_t[SIZE];
+
+  size_t packed = detail::lz_compress(input, SIZE, compressed);
+  EXPECT_LT(packed, SIZE / 100);
+  EXPECT_TRUE(detail::lz_decompress(compressed, packed, output, SIZE));
+  EXPECT_EQ(0, std::memcmp(input, output, SIZE));
+
+  delete[] output;
+  delete[] compressed;
+  delete[] input;
+}
+
+TEST(SerializeTest, stream_round_trip) {
+  Matrix<int32_t> a = repetitive(300, 517);
+  Matrix<double> b = noise(129, 1000);
+
+  for (Compression compression : {Compression::None, Compression::Lz}) {
+    EXPECT_EQ(a, round_trip(a, compression));
+    EXPECT_EQ(b, round_trip(b, compression));
+    EXPECT_EQ(Matrix<float>(), round_trip(Matrix<float>(), compression));
+    EXPECT_EQ(Matrix<uint8_t>({{7}}), round_trip(Matrix<uint8_t>({{7}}), compression));
+  }
+}
+
+TEST(SerializeTest, compression_shrinks_repetitive_data) {
+  Matrix<int32_t> a = repetitive(300, 517);
+
+  std::string raw = serialized(a, Compression::None);
+  std::string compressed = serialized(a, Compression::Lz);
+
+  EXPECT_EQ(detail::SERIALIZE_HEADER + a.size() * sizeof(int32_t), raw.size());
+  EXPECT_LT(compressed.size(), raw.size() / 4);
+}
+
+TEST(SerializeTest, incompressible_blocks_are_stored) {
+  Matrix<double> b = noise(129, 1000);
+
+  std::string compressed;
+  {
+    std::stringstream stream;
+    serialize(stream, b, Compression::Lz);
+    compressed = stream.str();
+  }
+
+  size_t blocks = (b.size() * sizeof(double) + detail::SERIALIZE_BLOCK - 1) / detail::SERIALIZE_BLOCK;
+  EXPECT_LE(compressed.size(), detail::SERIALIZE_HEADER + b.size() * sizeof(double) + blocks * sizeof(uint32_t));
+}
+
+TEST(SerializeTest, rejects_malformed_input) {
+  Matrix<int32_t> a = repetitive(64, 100);
+
+  for (Compression compression : {Compression::None, Compression::Lz}) {
+    std::string bytes = serialized(a, compression);
+
+    EXPECT_THROW(parse(bytes.substr(0, 10)), SerializationError);
+    EXPECT_THROW(parse(bytes.substr(0, bytes.size() - 1)), SerializationError);
+
+    std::string magic = bytes;
+    magic[0] = 'X';
+    EXPECT_THROW(parse(magic), SerializationError);
+
+    std::string rows = bytes;
+    rows[8] = 65;
+    EXPECT_THROW(parse(rows), SerializationError);
+
+    std::string huge = bytes;
+    huge[15] = 0x40;
+    EXPECT_THROW(parse(huge), SerializationError);
+
+    std::stringstream stream(bytes);
+    EXPECT_THROW(deserialize<float>(stream), SerializationError);
+    std::stringstream unsigned_stream(bytes);
+    EXPECT_THROW(deserialize<uint32_t>(unsigned_stream), SerializationError);
+  }
+
+  std::string corrupt = serialized(a, Compression::Lz);
+  corrupt[detail::SERIALIZE_HEADER + 4] = static_cast<char>(0xff);
+  EXPECT_THROW(parse(corrupt), SerializationError);
+}
+
+TEST(SerializeTest, rejects_sizes_beyond_input) {
+  // Headers declaring 2^40 elements, followed by a few bytes: the reader runs out of input instead of allocating
+  Matrix<int32_t> a = repetitive(4, 4);
+  for (Compression compression : {Compression::None, Compression::Lz}) {
+    std::string bytes = serialized(a, compression);
+    uint64_t rows = uint64_t{1} << 20;
+    std::memcpy(bytes.data() + 8, &rows, 8);
+    std::memcpy(bytes.data() + 16, &rows, 8);
+    uint64_t payload = rows * rows * sizeof(int32_t);
+    std::memcpy(bytes.data() + 24, &payload, 8);
+    EXPECT_THROW(parse(bytes), SerializationError);
+
+    // Same from a pipe, which cannot tell how many bytes are left
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(static_cast<ssize_t>(bytes.size()), write(fds[1], bytes.data(), bytes.size()));
+    close(fds[1]);
+    EXPECT_THROW(deserialize<int32_t>(fds[0]), SerializationError);
+    close(fds[0]);
+  }
+
+  // A compressed payload too short to hold the size of every block
+  std::string bytes = serialized(repetitive(1000, 1000), Compression::Lz);
+  uint64_t payload = 4;
+  std::memcpy(bytes.data() + 24, &payload, 8);
+  EXPECT_THROW(parse(bytes), SerializationError);
+}
+
+TEST(SerializeTest, pipe_round_trip) {
+  Matrix<int32_t> a = repetitive(500, 300);
+
+  for (Compression compression : {Compression::None, Compression::Lz}) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+
+    // Larger than the pipe buffer, so the writer blocks and sees partial writes while the reader drains it
+    std::thread writer([&] {
+      serialize(fds[1], a, compression);
+      close(fds[1]);
+    });
+    Matrix<int32_t> b = deserialize<int32_t>(fds[0]);
+    writer.join();
+    close(fds[0]);
+
+    EXPECT_EQ(a, b);
+  }
+}
+
+TEST(SerializeTest, file_round_trip) {
+  Matrix<double> a = noise(100, 77);
+  Matrix<int32_t> b = repetitive(1000, 33);
+
+  FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  int fd = fileno(file);
+
+  serialize(fd, a);
+  serialize(fd, b, Compression::Lz);
+  ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+
+  EXPECT_EQ(a, deserialize<double>(fd));
+  EXPECT_EQ(b, deserialize<int32_t>(fd));
+  EXPECT_THROW(deserialize<double>(fd), SerializationError);
+
+  std::fclose(file);
+}
+
+TEST(SerializeTest, serialize_rows) {
+  Matrix<int32_t> a = repetitive(10, 7);
+  Matrix<int32_t> b = repetitive(5, 7) * 3;
+
+  Matrix<int32_t>::ConstRowView rows[] = {a.row(9), b.row(0), a.row(2), b.row(4)};
+
+  FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  int fd = fileno(file);
+
+  serialize_rows(fd, rows, 4);
+  serialize_rows(fd, rows, 0);
+  ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+
+  Matrix<int32_t> picked = deserialize<int32_t>(fd);
+  ASSERT_EQ(4, picked.rows());
+  ASSERT_EQ(7, picked.cols());
+  for (size_t j = 0; j < 7; ++j) {
+    EXPECT_EQ(a(9, j), picked(0, j));
+    EXPECT_EQ(b(0, j), picked(1, j));
+    EXPECT_EQ(a(2, j), picked(2, j));
+    EXPECT_EQ(b(4, j), picked(3, j));
+  }
+  EXPECT_EQ(Matrix<int32_t>(), deserialize<int32_t>(fd));
+
+  std::fclose(file);
+}
+
+TEST(SerializeTest, serialize_rows_rejects_ragged_rows) {
+  Matrix<int32_t> a = repetitive(3, 7);
+  Matrix<int32_t> b = repetitive(3, 5);
+
+  FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  int fd = fileno(file);
+
+  Matrix<int32_t>::ConstRowView longer[] = {b.row(0), a.row(1)};
+  Matrix<int32_t>::ConstRowView shorter[] = {a.row(0), a.row(2), b.row(1)};
+  EXPECT_THROW(serialize_rows(fd, longer, 2), std::invalid_argument);
+  EXPECT_THROW(serialize_rows(fd, shorter, 3), std::invalid_argument);
+  EXPECT_EQ(0, lseek(fd, 0, SEEK_END));
+
+  std::fclose(file);
+}
+
+TEST(SerializeTest, write_error) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  close(fds[1]);
+
+  EXPECT_THROW(serialize(fds[1], Matrix<int32_t>(2, 2)), std::system_error);
+  close(fds[0]);
+}
+
+} // namespace ct::test
@@ -0,0 +1,217 @@
+#include "matrix.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <utility>
+
+namespace ct::test {
+
+class SharingTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Element::reset_allocations();
+  }
+};
+
+TEST_F(SharingTest, disabled_by_default) {
+  Matrix<Element> a(2, 3);
+
+  EXPECT_FALSE(a.sharing_enabled());
+  EXPECT_EQ(1, a.use_count());
+
+  Matrix<Element> b = a;
+
+  EXPECT_NE(std::as_const(a).data(), std::as_const(b).data());
+  EXPECT_EQ(1, b.use_count());
+}
+
+TEST_F(SharingTest, empty) {
+  Matrix<Element> a;
+  a.enable_sharing();
+
+  EXPECT_FALSE(a.sharing_enabled());
+  expect_empty(a);
+}
+
+TEST_F(SharingTest, copy_ctor) {
+  constexpr size_t ROWS = 40;
+  constexpr size_t COLS = 100;
+  constexpr size_t SIZE = ROWS * COLS;
+
+  Matrix<Element> a(ROWS, COLS);
+  fill(a);
+  a.enable_sharing();
+
+  Matrix<Element> b = a;
+  Matrix<Element> c = b;
+
+  EXPECT_TRUE(c.sharing_enabled());
+  EXPECT_EQ(3, a.use_count());
+  EXPECT_EQ(std::as_const(a).data(), std::as_const(c).data());
+  expect_equal(a, c);
+
+  expect_allocations(SIZE);
+}
+
+TEST_F(SharingTest, copy_assignment) {
+  constexpr size_t ROWS = 40;
+  constexpr size_t COLS = 100;
+  constexpr size_t SIZE = ROWS * COLS;
+
+  Matrix<Element> a(ROWS, COLS);
+  fill(a);
+  a.enable_sharing();
+
+  Matrix<Element> b(ROWS, COLS);
+  b = a;
+
+  EXPECT_EQ(2, a.use_count());
+  EXPECT_EQ(std::as_const(a).data(), std::as_const(b).data());
+
+  b = b;
+  EXPECT_EQ(2, a.use_count());
+
+  b = Matrix<Element>();
+  EXPECT_EQ(1, a.use_count());
+  expect_empty(b);
+
+  expect_allocations(SIZE * 2);
+}
+
+TEST_F(SharingTest, detach_on_element_access) {
+  Matrix<Element> a({
+      {1, 2, 3},
+      {4, 5, 6},
+  });
+  a.enable_sharing();
+  Matrix<Element> b = a;
+
+  b(1, 1) = 42;
+
+  EXPECT_EQ(1, a.use_count());
+  EXPECT_EQ(1, b.use_count());
+  EXPECT_EQ(5, std::as_const(a)(1, 1));
+  EXPECT_EQ(42, std::as_const(b)(1, 1));
+
+  expect_allocations(a.size() * 2);
+}
+
+TEST_F(SharingTest, detach_on_mutable_accessors) {
+  Matrix<Element> a({
+      {1, 2, 3},
+      {4, 5, 6},
+  });
+  a.enable_sharing();
+
+  auto expect_detached = [&a](auto access) {
+    Matrix<Element> b = a;
+    ASSERT_EQ(std::as_const(a).data(), std::as_const(b).data());
+    access(b);
+    EXPECT_NE(std::as_const(a).data(), std::as_const(b).data());
+    EXPECT_EQ(a, b);
+  };
+
+  expect_detached([](Matrix<Element>& m) { m.data(); });
+  expect_detached([](Matrix<Element>& m) { m.begin(); });
+  expect_detached([](Matrix<Element>& m) { m.end(); });
+  expect_detached([](Matrix<Element>& m) { m.row(1); });
+  expect_detached([](Matrix<Element>& m) { m.col(1); });
+  expect_detached([](Matrix<Element>& m) { m.row_begin(1); });
+  expect_detached([](Matrix<Element>& m) { m.col_begin(1); });
+  expect_detached([](Matrix<Element>& m) { m *= 1; });
+}
+
+TEST_F(SharingTest, no_detach_when_unique) {
+  Matrix<Element> a(2, 3);
+  a.enable_sharing();
+  const Element* data = std::as_const(a).data();
+
+  a(1, 1) = 42;
+  a.row(0) *= 2;
+
+  EXPECT_EQ(data, a.data());
+  expect_allocations(a.size());
+}
+
+TEST_F(SharingTest, source_is_not_modified) {
+  Matrix<Element> a({
+      {1, 2, 3},
+      {4, 5, 6},
+  });
+  const Matrix<Element> expected = a;
+  a.enable_sharing();
+  Matrix<Element> b = a;
+
+  b += a;
+  b.row(0) *= 10;
+  b.col(2) *= 10;
+
+  expect_equal(expected, a);
+  expect_equal(
+      Matrix<Element>({
+          {20, 40, 600},
+          {8, 10, 120},
+      }),
+      b
+  );
+}
+
+TEST_F(SharingTest, multiply_keeps_mode) {
+  Matrix<Element> a({
+      {1, 2},
+      {3, 4},
+  });
+  a.enable_sharing();
+  Matrix<Element> b = a;
+
+  b *= a;
+
+  EXPECT_TRUE(b.sharing_enabled());
+  EXPECT_EQ(1, a.use_count());
+  EXPECT_EQ(1, b.use_count());
+  expect_equal(
+      Matrix<Element>({
+          {7, 10},
+          {15, 22},
+      }),
+      b
+  );
+}
+
+TEST_F(SharingTest, concurrent_readers) {
+  constexpr size_t ROWS = 40;
+  constexpr size_t COLS = 100;
+  constexpr size_t THREADS = 4;
+  constexpr size_t COPIES = 1000;
+
+  Matrix<size_t> a(ROWS, COLS);
+  fill(a);
+  a.enable_sharing();
+
+  std::thread threads[THREADS];
+  for (std::thread& thread : threads) {
+    thread = std::thread([&a] {
+      for (size_t i = 0; i < COPIES; ++i) {
+        Matrix<size_t> copy = a;
+        size_t sum = 0;
+        for (size_t x : std::as_const(copy).row(i % ROWS)) {
+          sum += x;
+        }
+        EXPECT_EQ(elem(i % ROWS, 0) * COLS + elem(0, COLS - 1) * COLS / 2, sum);
+        if (i % 2 == 0) {
+          copy(0, 0) = 1;
+          EXPECT_EQ(elem(0, 0), std::as_const(a)(0, 0));
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(1, a.use_count());
+}
+
+} // namespace ct::test
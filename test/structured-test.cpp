@@ -0,0 +1,197 @@
+#include "matrix.h"
+#include "structured.h"
+#include "test-helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+namespace ct::test {
+
+class StructuredTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Element::reset_allocations();
+  }
+};
+
+namespace {
+
+Matrix<Element> make_dense(size_t rows, size_t cols) {
+  Matrix<Element> m(rows, cols);
+  fill(m);
+  return m;
+}
+
+template <typename M>
+void expect_matches_dense(const M& m, const Matrix<Element>& dense) {
+  ASSERT_EQ(dense.rows(), m.rows());
+  ASSERT_EQ(dense.cols(), m.cols());
+  for (size_t i = 0; i < m.rows(); ++i) {
+    for (size_t j = 0; j < m.cols(); ++j) {
+      EXPECT_EQ(dense(i, j), m(i, j));
+    }
+    EXPECT_TRUE(std::ranges::equal(dense.row(i), m.row(i)));
+  }
+  for (size_t j = 0; j < m.cols(); ++j) {
+    EXPECT_TRUE(std::ranges::equal(dense.col(j), m.col(j)));
+  }
+}
+
+} // namespace
+
+TEST_F(StructuredTest, view_traits) {
+  using RowView = SymmetricMatrix<Element>::ConstRowView;
+  using ColView = TriangularMatrix<Element, Triangle::Upper>::ConstColView;
+
+  EXPECT_TRUE(std::ranges::random_access_range<RowView>);
+  EXPECT_TRUE(std::ranges::sized_range<RowView>);
+  EXPECT_TRUE(std::ranges::view<RowView>);
+  EXPECT_TRUE(std::random_access_iterator<ColView::Iterator>);
+  EXPECT_TRUE(std::ranges::view<BandMatrix<Element>::ConstRowView>);
+}
+
+TEST_F(StructuredTest, symmetric) {
+  constexpr size_t N = 30;
+
+  SymmetricMatrix<Element> s(N);
+  EXPECT_EQ(N * (N + 1) / 2, s.stored_size());
+  expect_allocations(N * (N + 1) / 2);
+
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j <= i; ++j) {
+      s(i, j) = elem(i, j);
+    }
+  }
+  s(3, 17) = 1;
+
+  EXPECT_EQ(1, std::as_const(s)(17, 3));
+  Matrix<Element> dense = s.to_dense();
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      EXPECT_EQ(dense(i, j), dense(j, i));
+    }
+  }
+  expect_matches_dense(s, dense);
+  EXPECT_EQ(s, SymmetricMatrix<Element>(dense));
+}
+
+TEST_F(StructuredTest, triangular_lower) {
+  const Matrix<Element> dense = make_dense(25, 25);
+
+  TriangularMatrix<Element> t(dense);
+
+  Matrix<Element> expected = dense;
+  for (size_t i = 0; i < 25; ++i) {
+    for (size_t j = i + 1; j < 25; ++j) {
+      expected(i, j) = 0;
+    }
+  }
+  EXPECT_TRUE(t.stored(3, 2));
+  EXPECT_FALSE(t.stored(2, 3));
+  expect_matches_dense(t, expected);
+  expect_equal(expected, t.to_dense());
+}
+
+TEST_F(StructuredTest, triangular_upper) {
+  const Matrix<Element> dense = make_dense(25, 25);
+
+  TriangularMatrix<Element, Triangle::Upper> t(dense);
+  t(4, 9) = 3;
+
+  Matrix<Element> expected = dense;
+  expected(4, 9) = 3;
+  for (size_t i = 0; i < 25; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      expected(i, j) = 0;
+    }
+  }
+  expect_matches_dense(t, expected);
+  expect_equal(expected, t.to_dense());
+}
+
+TEST_F(StructuredTest, band) {
+  const Matrix<Element> dense = make_dense(20, 30);
+
+  BandMatrix<Element> b(dense, 2, 3);
+
+  EXPECT_EQ(20 * 6, b.stored_size());
+  Matrix<Element> expected = dense;
+  for (size_t i = 0; i < 20; ++i) {
+    for (size_t j = 0; j < 30; ++j) {
+      if (j + 2 < i || j > i + 3) {
+        expected(i, j) = 0;
+      }
+    }
+  }
+  expect_matches_dense(b, expected);
+  expect_equal(expected, b.to_dense());
+}
+
+TEST_F(StructuredTest, band_taller_than_wide) {
+  const Matrix<Element> dense = make_dense(40, 10);
+
+  BandMatrix<Element> b(dense, 1, 1);
+
+  EXPECT_EQ(0, std::as_const(b)(20, 5));
+  expect_equal(b.to_dense() * make_dense(10, 7), b * make_dense(10, 7));
+}
+
+TEST_F(StructuredTest, symm) {
+  const Matrix<Element> right = make_dense(70, 45);
+  SymmetricMatrix<Element> s(make_dense(70, 70));
+
+  expect_equal(s.to_dense() * right, s * right);
+}
+
+TEST_F(StructuredTest, trmm) {
+  const Matrix<Element> dense = make_dense(150, 150);
+  const Matrix<Element> right = make_dense(150, 600);
+
+  TriangularMatrix<Element> lower(dense);
+  TriangularMatrix<Element, Triangle::Upper> upper(dense);
+
+  expect_equal(lower.to_dense() * right, lower * right);
+  expect_equal(upper.to_dense() * right, upper * right);
+}
+
+TEST_F(StructuredTest, banded_times_dense) {
+  const Matrix<Element> dense = make_dense(300, 200);
+  const Matrix<Element> right = make_dense(200, 50);
+
+  for (auto [lower, upper] : {std::pair<size_t, size_t>{0, 0}, {1, 1}, {5, 0}, {0, 7}, {299, 199}}) {
+    BandMatrix<Element> b(dense, lower, upper);
+    expect_equal(b.to_dense() * right, b * right);
+  }
+}
+
+TEST_F(StructuredTest, empty) {
+  SymmetricMatrix<Element> s;
+  TriangularMatrix<Element> t(0);
+  BandMatrix<Element> b(0, 0, 1, 1);
+
+  expect_allocations(0);
+  expect_empty(s * Matrix<Element>());
+  expect_empty(t * Matrix<Element>());
+  expect_empty(b * Matrix<Element>());
+  EXPECT_EQ(0, s.row(0).size());
+}
+
+TEST_F(StructuredTest, copy) {
+  SymmetricMatrix<Element> s(make_dense(10, 10));
+
+  SymmetricMatrix<Element> copy = s;
+  copy(1, 2) = 0;
+
+  EXPECT_NE(s, copy);
+  EXPECT_EQ(elem(2, 1), std::as_const(s)(1, 2));
+
+  SymmetricMatrix<Element> moved = std::move(copy);
+  EXPECT_EQ(0, std::as_const(moved)(2, 1));
+  EXPECT_TRUE(copy.empty());
+}
+
+} // namespace ct::test
@@ -12,6 +12,10 @@ struct Element {
     return ::operator new[](count);
   }
 
+  void operator delete[](void* pointer) {
+    ::operator delete[](pointer);
+  }
+
   Element() = default;
 
   Element(size_t value)
@@ -61,8 +65,8 @@ public:
   size_t value;
 };
 
-inline bool operator==(Matrix<Element>::ConstIterator it, Matrix<Element>::ConstColIterator col_it) {
-  return it == col_it.operator->();
+inline bool operator==(const Element* element, Matrix<Element>::ConstColIterator col_it) {
+  return element == col_it.operator->();
 }
 
 inline void expect_allocations(size_t expected_allocations) {
@@ -82,8 +86,8 @@ void fill(Matrix<T>& a) {
   }
 }
 
-template <typename T>
-void expect_empty(const Matrix<T>& m) {
+template <typename T, typename Layout>
+void expect_empty(const Matrix<T, Layout>& m) {
   EXPECT_EQ(0, m.rows());
   EXPECT_EQ(0, m.cols());
   EXPECT_EQ(0, m.size());
@@ -91,8 +95,8 @@ void expect_empty(const Matrix<T>& m) {
   EXPECT_EQ(nullptr, m.data());
 }
 
-template <typename T>
-void expect_equal(const Matrix<T>& expected, const Matrix<T>& actual) {
+template <typename T, typename ExpectedLayout, typename ActualLayout>
+void expect_equal(const Matrix<T, ExpectedLayout>& expected, const Matrix<T, ActualLayout>& actual) {
   EXPECT_EQ(expected.rows(), actual.rows());
   EXPECT_EQ(expected.cols(), actual.cols());
   EXPECT_EQ(expected.size(), actual.size());
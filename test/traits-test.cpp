@@ -16,11 +16,19 @@ TEST(TraitsTest, member_types) {
   EXPECT_TRAIT(std::is_same_v<Element*, Matrix<Element>::Pointer>);
   EXPECT_TRAIT(std::is_same_v<const Element*, Matrix<Element>::ConstPointer>);
 
+#ifdef CT_CHECKED
+  EXPECT_TRAIT(std::is_same_v<detail::BoundedPointer<Element>, Matrix<Element>::Iterator>);
+  EXPECT_TRAIT(std::is_same_v<detail::BoundedPointer<const Element>, Matrix<Element>::ConstIterator>);
+
+  EXPECT_TRAIT(std::is_same_v<detail::BoundedPointer<Element>, Matrix<Element>::RowIterator>);
+  EXPECT_TRAIT(std::is_same_v<detail::BoundedPointer<const Element>, Matrix<Element>::ConstRowIterator>);
+#else
   EXPECT_TRAIT(std::is_same_v<Element*, Matrix<Element>::Iterator>);
   EXPECT_TRAIT(std::is_same_v<const Element*, Matrix<Element>::ConstIterator>);
 
   EXPECT_TRAIT(std::is_same_v<Element*, Matrix<Element>::RowIterator>);
   EXPECT_TRAIT(std::is_same_v<const Element*, Matrix<Element>::ConstRowIterator>);
+#endif
 }
 
 TEST(TraitsTest, iterator_categories) {
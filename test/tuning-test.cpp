@@ -0,0 +1,182 @@
+#include "matrix.h"
+#include "multiply.h"
+#include "test-helpers.h"
+#include "tuning.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace ct::test {
+
+namespace {
+
+// Points the tuner at a fresh tuning file for the duration of a test
+class TuningFile {
+public:
+  explicit TuningFile(const std::string& contents = "")
+      : path_((std::filesystem::temp_directory_path() / "ct-tuning-test").string()) {
+    std::ofstream(path_) << contents;
+    KernelTuner::instance().reset(path_);
+  }
+
+  TuningFile(const TuningFile&) = delete;
+  TuningFile& operator=(const TuningFile&) = delete;
+
+  ~TuningFile() {
+    std::remove(path_.c_str());
+    KernelTuner::instance().reset(KernelTuner::default_path());
+  }
+
+  std::string contents() const {
+    std::ostringstream out;
+    out << std::ifstream(path_).rdbuf();
+    return out.str();
+  }
+
+private:
+  std::string path_;
+};
+
+Matrix<double> make_matrix(size_t rows, size_t cols) {
+  Matrix<double> m(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<double>(elem(i, j) % 19) / 8.0 - 1.0;
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST(TuningTest, classify_shape) {
+  EXPECT_EQ(ShapeClass::Square, classify_shape(1000, 1000, 1000));
+  EXPECT_EQ(ShapeClass::Square, classify_shape(1000, 200, 700));
+  EXPECT_EQ(ShapeClass::TallSkinny, classify_shape(100000, 64, 64));
+  EXPECT_EQ(ShapeClass::ShortWide, classify_shape(16, 100, 4096));
+  EXPECT_EQ(ShapeClass::Deep, classify_shape(32, 100000, 32));
+  EXPECT_EQ(ShapeClass::Shallow, classify_shape(2000, 16, 3000));
+  EXPECT_STREQ("tall-skinny", shape_class_name(ShapeClass::TallSkinny));
+}
+
+TEST(TuningTest, first_large_product_tunes_and_saves) {
+  TuningFile file;
+  EXPECT_FALSE(KernelTuner::instance().tuned<double>(ShapeClass::Square));
+
+  // Smaller products do not pay for tuning
+  Matrix<double> small = make_matrix(100, 100);
+  Matrix<double> unused = small * small;
+  EXPECT_FALSE(KernelTuner::instance().tuned<double>(ShapeClass::Square));
+
+  Matrix<double> a = make_matrix(512, 512);
+  Matrix<double> b = make_matrix(512, 512);
+  Matrix<double> c = a * b;
+  EXPECT_TRUE(KernelTuner::instance().tuned<double>(ShapeClass::Square));
+  EXPECT_FALSE(KernelTuner::instance().tuned<double>(ShapeClass::TallSkinny));
+  EXPECT_FALSE(KernelTuner::instance().tuned<float>(ShapeClass::Square));
+
+  // Every candidate blocking adds the products in the same order
+  EXPECT_EQ(multiply<double>(a, b), c);
+
+  detail::GemmTiling tiling = KernelTuner::instance().tiling<double>(ShapeClass::Square);
+  std::ostringstream line;
+  line << "f8 square " << tiling.depth_tile << ' ' << tiling.col_tile << '\n';
+  EXPECT_EQ(line.str(), file.contents());
+}
+
+TEST(TuningTest, loads_tuning_file) {
+  TuningFile file(
+      "f4 tall-skinny 64 256\n"
+      "i2 deep 256 1024\n"
+      "f8 square 0 512\n"   // a depth tile of zero is rejected
+      "f8 shallow 128\n"    // and so are incomplete lines
+      "c8 square 128 512\n" // and unknown types
+  );
+  KernelTuner& tuner = KernelTuner::instance();
+
+  EXPECT_TRUE(tuner.tuned<float>(ShapeClass::TallSkinny));
+  EXPECT_EQ(64, tuner.tiling<float>(ShapeClass::TallSkinny).depth_tile);
+  EXPECT_EQ(256, tuner.tiling<float>(ShapeClass::TallSkinny).col_tile);
+  EXPECT_TRUE(tuner.tuned<short>(ShapeClass::Deep));
+  EXPECT_EQ(1024, tuner.tiling<short>(ShapeClass::Deep).col_tile);
+  EXPECT_FALSE(tuner.tuned<unsigned short>(ShapeClass::Deep));
+  EXPECT_FALSE(tuner.tuned<double>(ShapeClass::Square));
+  EXPECT_FALSE(tuner.tuned<double>(ShapeClass::Shallow));
+
+  // Products of a tuned case use the loaded blocking
+  Matrix<float> a(4096, 40);
+  Matrix<float> b(40, 40);
+  for (size_t i = 0; i < 40; ++i) {
+    a(i, i) = 2;
+    b(i, i) = 3;
+  }
+  Matrix<float> c = a * b;
+  EXPECT_EQ(6, c(39, 39));
+  EXPECT_EQ(0, c(4095, 0));
+}
+
+TEST(TuningTest, untunable_types_use_default_blocking) {
+  TuningFile file;
+  EXPECT_FALSE(KernelTuner::instance().tuned<Element>(ShapeClass::Square));
+
+  Matrix<Element> a(300, 300);
+  fill(a);
+  Matrix<Element> c = a * a;
+  size_t expected = 0;
+  for (size_t k = 0; k < 300; ++k) {
+    expected += elem(1, k) * elem(k, 2);
+  }
+  EXPECT_EQ(expected, c(1, 2).value);
+  EXPECT_EQ("", file.contents());
+}
+
+// The tuning file is opt-in: nothing is written into the home directory by default
+TEST(TuningTest, default_path) {
+  const char* previous = std::getenv("CT_TUNING_FILE");
+  std::string saved = previous != nullptr ? previous : "";
+  unsetenv("CT_TUNING_FILE");
+  EXPECT_EQ("", KernelTuner::default_path());
+  setenv("CT_TUNING_FILE", "/tmp/tuning", 1);
+  EXPECT_EQ("/tmp/tuning", KernelTuner::default_path());
+  if (previous != nullptr) {
+    setenv("CT_TUNING_FILE", saved.c_str(), 1);
+  } else {
+    unsetenv("CT_TUNING_FILE");
+  }
+}
+
+TEST(TuningTest, creates_directory) {
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "ct-tuning-test-directory";
+  std::filesystem::remove_all(directory);
+  KernelTuner::instance().reset((directory / "cache" / "tuning").string());
+
+  Matrix<double> a = make_matrix(512, 512);
+  Matrix<double> c = a * a;
+  EXPECT_TRUE(KernelTuner::instance().tuned<double>(ShapeClass::Square));
+  EXPECT_TRUE(std::filesystem::exists(directory / "cache" / "tuning"));
+
+  std::filesystem::remove_all(directory);
+  KernelTuner::instance().reset(KernelTuner::default_path());
+}
+
+TEST(TuningTest, in_memory_tuning) {
+  KernelTuner::instance().reset("");
+  EXPECT_EQ("", KernelTuner::instance().path());
+
+  Matrix<double> a = make_matrix(8192, 128);
+  Matrix<double> b = make_matrix(128, 128);
+  Matrix<double> c = a * b;
+  EXPECT_TRUE(KernelTuner::instance().tuned<double>(ShapeClass::TallSkinny));
+  EXPECT_EQ(multiply<double>(a, b), c);
+
+  KernelTuner::instance().reset(KernelTuner::default_path());
+}
+
+} // namespace ct::test
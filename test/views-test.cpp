@@ -3,6 +3,9 @@
 
 #include <gtest/gtest.h>
 
+#include <functional>
+#include <utility>
+
 namespace ct::test {
 
 class ViewsTest : public ::testing::Test {
@@ -184,4 +187,47 @@ TEST_F(ViewsTest, const_col_view) {
   }
 }
 
+TEST_F(ViewsTest, col_view_prefetch_distance) {
+  constexpr size_t ROWS = 40;
+  constexpr size_t COLS = 100;
+  constexpr size_t CHOSEN_COL = 7;
+
+  const size_t default_distance = column_prefetch_distance();
+  for (size_t distance : {0, 1, 8, 39, 40, 1000}) {
+    set_column_prefetch_distance(distance);
+    EXPECT_EQ(distance, column_prefetch_distance());
+
+    Matrix<Element> a(ROWS, COLS);
+    fill(a);
+    a.col(CHOSEN_COL) *= 3;
+
+    Element expected = 0;
+    for (size_t i = 0; i < ROWS; ++i) {
+      EXPECT_EQ(elem(i, CHOSEN_COL) * 3, a(i, CHOSEN_COL));
+      EXPECT_EQ(elem(i, CHOSEN_COL + 1), a(i, CHOSEN_COL + 1));
+      expected += a(i, CHOSEN_COL);
+    }
+    EXPECT_EQ(expected, std::as_const(a).col(CHOSEN_COL).accumulate());
+  }
+  set_column_prefetch_distance(default_distance);
+}
+
+TEST_F(ViewsTest, col_view_for_each) {
+  Matrix<Element> a(10, 4);
+  fill(a);
+
+  size_t i = 0;
+  std::as_const(a).col(2).for_each([&](const Element& x) {
+    EXPECT_EQ(&a(i, 2), &x);
+    ++i;
+  });
+  EXPECT_EQ(10, i);
+
+  Element product = 1;
+  for (size_t row = 0; row < 10; ++row) {
+    product = product * elem(row, 1);
+  }
+  EXPECT_EQ(product, a.col(1).accumulate(Element(1), std::multiplies<>{}));
+}
+
 } // namespace ct::test